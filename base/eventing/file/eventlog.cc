@@ -1,7 +1,9 @@
 #include "base/eventing/file/eventlog.h"
 
+#include <chrono>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <utility>
 
 #include "base/util/compat.h"
@@ -14,8 +16,33 @@ namespace vertexai {
 namespace eventing {
 namespace file {
 
+namespace {
+
+// The default number of events that may be buffered.
+constexpr std::uint32_t kDefaultQueueSize = 16384;
+
+// The maximum number of events written per Record.
+constexpr int kBatchSize = 256;
+
+// How often the writer checks for buffered events, if it isn't woken by the buffer filling up.
+constexpr std::chrono::milliseconds kWriteInterval{10};
+
+std::uint64_t QueueSize(const proto::EventLog& config) {
+  std::uint64_t size = 1;
+  while (size < (config.queue_size() ? config.queue_size() : kDefaultQueueSize)) {
+    size <<= 1;
+  }
+  return size;
+}
+
+}  // namespace
+
+constexpr std::uint64_t EventLog::kClosedBit;
+
 EventLog::EventLog(const proto::EventLog& config)
     : config_{config},
+      slots_{new Slot[QueueSize(config)]},
+      mask_{QueueSize(config) - 1},
       std_file_out_{config.filename(), std::ios::binary},
       ostr_out_{std::make_unique<gpi::OstreamOutputStream>(&std_file_out_)},
       gzip_out_{std::make_unique<gpi::GzipOutputStream>(ostr_out_.get(), gpi::GzipOutputStream::Options())},
@@ -24,40 +51,141 @@ EventLog::EventLog(const proto::EventLog& config)
     throw std::runtime_error(std::string("unable to open \"") + config.filename() + "\" for writing");
   }
   LOG(INFO) << "Writing event log to " << config.filename();
+  for (std::uint64_t pos = 0; pos <= mask_; ++pos) {
+    slots_[pos].sequence.store(pos, std::memory_order_relaxed);
+  }
   proto::Record record;
   record.mutable_magic()->set_value(proto::Magic::Eventlog);
-  LogRecordLocked(std::move(record));
+  LogRecord(record);
+  writer_ = std::thread{[this]() { WriterMain(); }};
 }
 
 EventLog::~EventLog() { FlushAndClose(); }
 
 void EventLog::LogEvent(context::proto::Event event) {
-  std::lock_guard<std::mutex> lock{mu_};
-  if (closed_) {
+  if (closed_.load(std::memory_order_relaxed)) {
     return;
   }
-  if (!wrote_uuid_) {
-    event.mutable_activity_id()->set_stream_uuid(ToByteString(stream_uuid()));
-    wrote_uuid_ = true;
+  if (Enqueue(&event) == EnqueueResult::kFull) {
+    CountDroppedEvent();
   }
-  proto::Record record;
-  *record.add_event() = std::move(event);
-  LogRecordLocked(std::move(record));
+}
+
+// Counts an event dropped because the buffer was full, unless the log's already been closed (in which case the event
+// is ignored, as if it had been logged after the close).
+bool EventLog::CountDroppedEvent() {
+  std::uint64_t dropped = dropped_events_.load(std::memory_order_relaxed);
+  while (!(dropped & kClosedBit)) {
+    if (dropped_events_.compare_exchange_weak(dropped, dropped + 1, std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 void EventLog::FlushAndClose() {
-  std::lock_guard<std::mutex> lock{mu_};
-  if (closed_) {
+  if (closed_.exchange(true)) {
     return;
   }
-  closed_ = true;
+  {
+    std::lock_guard<std::mutex> lock{mu_};
+  }
+  cv_.notify_one();
+  writer_.join();
+  if (dropped_events()) {
+    LOG(WARNING) << "Event log " << config_.filename() << " dropped " << dropped_events() << " events";
+  }
+}
+
+// A bounded multi-producer queue, after Vyukov: producers claim a position with a CAS, fill the position's slot, and
+// then publish it by advancing the slot's sequence number.
+EventLog::EnqueueResult EventLog::Enqueue(context::proto::Event* event) {
+  std::uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  for (;;) {
+    if (pos & kClosedBit) {
+      return EnqueueResult::kClosed;
+    }
+    Slot* slot = &slots_[pos & mask_];
+    auto dif = static_cast<std::int64_t>(slot->sequence.load(std::memory_order_acquire) - pos);
+    if (dif < 0) {
+      return EnqueueResult::kFull;  // The writer hasn't yet taken the event a full buffer ago.
+    }
+    if (dif == 0 && enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+      slot->event.Swap(event);
+      slot->sequence.store(pos + 1, std::memory_order_release);
+      // Wake the writer early if the buffer is half full; otherwise, it'll get to the event on its next pass.
+      if (pos + 1 - dequeue_pos_.load(std::memory_order_relaxed) == (mask_ + 1) / 2) {
+        cv_.notify_one();
+      }
+      return EnqueueResult::kQueued;
+    }
+    if (dif > 0) {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void EventLog::WriterMain() {
+  while (!closed_) {
+    while (WriteBatch()) {
+    }
+    std::unique_lock<std::mutex> lock{mu_};
+    if (!closed_) {
+      cv_.wait_for(lock, kWriteInterval);
+    }
+  }
+
+  // Stop further events from being queued, and write the ones that were.  A producer may have claimed a position
+  // without yet publishing its event; it's about to, so wait for it.
+  std::uint64_t end = enqueue_pos_.fetch_or(kClosedBit) & ~kClosedBit;
+  for (;;) {
+    while (WriteBatch()) {
+    }
+    if (dequeue_pos_.load(std::memory_order_relaxed) == end) {
+      break;
+    }
+    std::this_thread::yield();
+  }
+
+  // Likewise stop further events from being counted as dropped, and record the count.
+  std::uint64_t dropped = dropped_events_.fetch_or(kClosedBit) & ~kClosedBit;
+  if (dropped) {
+    proto::Record record;
+    record.set_dropped_events(dropped);
+    LogRecord(record);
+  }
+
   coded_out_.reset();
   gzip_out_.reset();
   ostr_out_.reset();
   std_file_out_.close();
 }
 
-void EventLog::LogRecordLocked(proto::Record record) {
+bool EventLog::WriteBatch() {
+  // Clearing the record keeps its events around, so that they (and their storage) are swapped back into the slots.
+  batch_.Clear();
+  std::uint64_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+  for (; batch_.event_size() < kBatchSize; ++pos) {
+    Slot* slot = &slots_[pos & mask_];
+    if (slot->sequence.load(std::memory_order_acquire) != pos + 1) {
+      break;
+    }
+    batch_.add_event()->Swap(&slot->event);
+    slot->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+  }
+  if (!batch_.event_size()) {
+    return false;
+  }
+  if (!wrote_uuid_) {
+    batch_.mutable_event(0)->mutable_activity_id()->set_stream_uuid(ToByteString(stream_uuid()));
+    wrote_uuid_ = true;
+  }
+  LogRecord(batch_);
+  return true;
+}
+
+void EventLog::LogRecord(const proto::Record& record) {
   coded_out_->WriteVarint32(record.ByteSize());
   record.SerializeToCodedStream(coded_out_.get());
 }
@@ -96,7 +224,9 @@ bool Reader::Read(context::proto::Event* event) {
       return false;
     }
 
-    if (!record.has_magic() && !record.event_size()) {
+    dropped_events_ += record.dropped_events();
+
+    if (!record.has_magic() && !record.event_size() && !record.dropped_events()) {
       return false;
     }
   }
@@ -4,10 +4,14 @@
 #include <google/protobuf/io/gzip_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <fstream>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 
 #include "base/context/eventlog.h"
 #include "base/eventing/file/eventlog.pb.h"
@@ -16,6 +20,15 @@ namespace vertexai {
 namespace eventing {
 namespace file {
 
+// Writes events to a gzipped file of Records.
+//
+// Logging an event only moves it into a fixed-size ring buffer; a background thread batches the buffered events into
+// Records, and does the serialization and compression.  If the writer falls behind and the buffer fills, subsequent
+// events are dropped (and counted) rather than blocking the caller; the count is written to the end of the log.
+//
+// Closing the log sets a closed bit in the enqueue position and the drop count, after which no event can be queued or
+// counted as dropped; the writer then drains every event queued before that point.  Events logged concurrently with
+// closing are thus either written, or counted, or ignored as having been logged after the close.
 class EventLog final : public context::EventLog {
  public:
   explicit EventLog(const proto::EventLog& config);
@@ -25,26 +38,59 @@ class EventLog final : public context::EventLog {
 
   void FlushAndClose() override;
 
+  // The number of events dropped because the buffer was full.
+  std::uint64_t dropped_events() const { return dropped_events_ & ~kClosedBit; }
+
  private:
-  void LogRecordLocked(proto::Record record);
+  // A buffered event.  The sequence number is used to hand the slot off between the producers and the writer: a
+  // producer may fill the slot for position pos once its sequence is pos, and the writer may take it once its sequence
+  // is pos + 1.
+  struct Slot {
+    std::atomic<std::uint64_t> sequence;
+    context::proto::Event event;
+  };
+
+  static constexpr std::uint64_t kClosedBit = std::uint64_t{1} << 63;
+
+  enum class EnqueueResult { kQueued, kFull, kClosed };
+
+  EnqueueResult Enqueue(context::proto::Event* event);
+  bool CountDroppedEvent();
+  void WriterMain();
+  bool WriteBatch();
+  void LogRecord(const proto::Record& record);
 
   // The client configuration.
   proto::EventLog config_;
 
+  // The ring buffer.  The enqueue position and the drop count carry kClosedBit once the log's been closed.
+  std::unique_ptr<Slot[]> slots_;
+  std::uint64_t mask_;
+  std::atomic<std::uint64_t> enqueue_pos_{0};
+  std::atomic<std::uint64_t> dequeue_pos_{0};
+  std::atomic<std::uint64_t> dropped_events_{0};
+
+  // Whether the log's been closed (checked first by producers, to skip the queue).
+  std::atomic<bool> closed_{false};
+
+  // Used to wake the writer when the buffer's filling up, or when the log's closed.
   std::mutex mu_;
+  std::condition_variable cv_;
 
   // The output stream chain.  Note that for portability, we use a OstreamOutputStream; if this becomes an issue,
-  // FileOutputStream is slightly faster.
+  // FileOutputStream is slightly faster.  These are only used by the writer thread.
   std::ofstream std_file_out_;
   std::unique_ptr<google::protobuf::io::OstreamOutputStream> ostr_out_;
   std::unique_ptr<google::protobuf::io::GzipOutputStream> gzip_out_;
   std::unique_ptr<google::protobuf::io::CodedOutputStream> coded_out_;
 
-  // Whether the log's been closed.
-  bool closed_ = false;
-
   // Whether the UUID's been written.
   bool wrote_uuid_ = false;
+
+  // The record used for each batch; its events are reused from batch to batch.
+  proto::Record batch_;
+
+  std::thread writer_;
 };
 
 class Reader final {
@@ -53,6 +99,9 @@ class Reader final {
 
   bool Read(context::proto::Event* event);
 
+  // The number of events the log reports as dropped; available once Read has returned false.
+  std::uint64_t dropped_events() const { return dropped_events_; }
+
  private:
   std::mutex mu_;
   std::ifstream std_file_in_;
@@ -61,6 +110,7 @@ class Reader final {
   std::unique_ptr<google::protobuf::io::CodedInputStream> coded_in_;
   int idx = 0;
   proto::Record record;
+  std::uint64_t dropped_events_ = 0;
 };
 
 }  // namespace file
@@ -1,9 +1,14 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <fstream>
+#include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
+#include "base/context/context.h"
 #include "base/eventing/file/eventlog.h"
 #include "base/eventing/file/eventlog.pb.h"
 #include "base/util/compat.h"
@@ -12,6 +17,8 @@
 
 using ::testing::Eq;
 using ::testing::EqualsProtoText;
+using ::testing::Ge;
+using ::testing::Gt;
 
 namespace vertexai {
 namespace eventing {
@@ -49,6 +56,104 @@ TEST_F(EventLogTest, CanReport) {
   }
 }
 
+// Logs events from several threads at once; each event's verb is "thread:index".
+void LogConcurrently(EventLog* eventlog, std::size_t threads, std::size_t events) {
+  std::vector<std::thread> loggers;
+  for (std::size_t t = 0; t < threads; ++t) {
+    loggers.emplace_back([eventlog, t, events]() {
+      for (std::size_t i = 0; i < events; ++i) {
+        context::proto::Event event;
+        event.set_verb(std::to_string(t) + ":" + std::to_string(i));
+        eventlog->LogEvent(std::move(event));
+      }
+    });
+  }
+  for (auto& logger : loggers) {
+    logger.join();
+  }
+}
+
+TEST_F(EventLogTest, ConcurrentWritersKeepTheirOrder) {
+  constexpr std::size_t kThreads = 4;
+  constexpr std::size_t kEvents = 1000;
+  LogConcurrently(eventlog_.get(), kThreads, kEvents);
+  eventlog_->FlushAndClose();
+  EXPECT_THAT(eventlog_->dropped_events(), Eq(0));
+
+  Reader reader{kTestFilename};
+  context::proto::Event event;
+  std::vector<std::size_t> next(kThreads);
+  while (reader.Read(&event)) {
+    auto sep = event.verb().find(':');
+    auto t = std::stoul(event.verb().substr(0, sep));
+    ASSERT_THAT(std::stoul(event.verb().substr(sep + 1)), Eq(next[t]));
+    next[t]++;
+  }
+  EXPECT_THAT(next, Eq(std::vector<std::size_t>(kThreads, kEvents)));
+}
+
+TEST_F(EventLogTest, DropsEventsWhenFull) {
+  constexpr std::size_t kThreads = 4;
+  constexpr std::size_t kEvents = 10000;
+  config_.set_queue_size(4);
+  eventlog_ = std::make_unique<EventLog>(config_);
+  LogConcurrently(eventlog_.get(), kThreads, kEvents);
+  eventlog_->FlushAndClose();
+
+  Reader reader{kTestFilename};
+  context::proto::Event event;
+  std::size_t written = 0;
+  while (reader.Read(&event)) {
+    written++;
+  }
+  EXPECT_THAT(written, Gt(0));
+  EXPECT_THAT(written + eventlog_->dropped_events(), Eq(kThreads * kEvents));
+  EXPECT_THAT(reader.dropped_events(), Eq(eventlog_->dropped_events()));
+}
+
+TEST_F(EventLogTest, ClosingWhileLoggingAccountsForEvents) {
+  constexpr std::size_t kThreads = 4;
+  config_.set_queue_size(64);
+  eventlog_ = std::make_unique<EventLog>(config_);
+  std::atomic<bool> started{false};
+  std::vector<std::thread> loggers;
+  for (std::size_t t = 0; t < kThreads; ++t) {
+    loggers.emplace_back([this, t, &started]() {
+      for (std::size_t i = 0; i < 100000; ++i) {
+        context::proto::Event event;
+        event.set_verb(std::to_string(t) + ":" + std::to_string(i));
+        eventlog_->LogEvent(std::move(event));
+        started = true;
+      }
+    });
+  }
+  while (!started) {
+    std::this_thread::yield();
+  }
+  eventlog_->FlushAndClose();
+  auto dropped = eventlog_->dropped_events();
+  for (auto& logger : loggers) {
+    logger.join();
+  }
+  // Events logged after the close are ignored, rather than counted.
+  EXPECT_THAT(eventlog_->dropped_events(), Eq(dropped));
+
+  Reader reader{kTestFilename};
+  context::proto::Event event;
+  std::vector<std::size_t> next(kThreads);
+  std::size_t written = 0;
+  while (reader.Read(&event)) {
+    auto sep = event.verb().find(':');
+    auto t = std::stoul(event.verb().substr(0, sep));
+    auto idx = std::stoul(event.verb().substr(sep + 1));
+    ASSERT_THAT(idx, Ge(next[t]));
+    next[t] = idx + 1;
+    written++;
+  }
+  EXPECT_THAT(written, Gt(0));
+  EXPECT_THAT(reader.dropped_events(), Eq(dropped));
+}
+
 }  // namespace
 }  // namespace file
 }  // namespace eventing
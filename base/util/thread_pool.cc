@@ -0,0 +1,19 @@
+// Copyright 2019 Intel Corporation
+
+#include "base/util/thread_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+
+namespace vertexai {
+
+boost::asio::thread_pool* SharedThreadPool() {
+  // Intentionally leaked, so that work running during static destruction
+  // doesn't find the pool already joined.
+  static boost::asio::thread_pool* pool =
+      new boost::asio::thread_pool(std::max<std::size_t>(1, std::thread::hardware_concurrency()));
+  return pool;
+}
+
+}  // namespace vertexai
@@ -0,0 +1,20 @@
+// Copyright 2019 Intel Corporation
+
+#pragma once
+
+#include <boost/asio/thread_pool.hpp>
+
+namespace vertexai {
+
+// The process-wide pool for CPU-bound work: building CPU kernels, running
+// their grids, and running compiler passes in parallel.  It has one thread per
+// hardware thread, and is created on first use.
+//
+// Callers post helpers to the pool and claim work on the calling thread as
+// well (see tile::hal::cpu::GridScheduler and tile::codegen::ParallelFor), so
+// a call never waits for a pool thread to become free.  That keeps the pool
+// safe to share between unrelated callers, and to use from within its own
+// threads.
+boost::asio::thread_pool* SharedThreadPool();
+
+}  // namespace vertexai
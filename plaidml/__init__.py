@@ -725,6 +725,29 @@ class _Library(plaidml.library.Library):
         self.plaidml_schedule_invocation.restype = ctypes.POINTER(_C_Invocation)
         self.plaidml_schedule_invocation.errcheck = self._check_err
 
+        # PLAIDML_API bool plaidml_is_invocation_complete(plaidml_invocation* invocation);
+        self.plaidml_is_invocation_complete = lib.plaidml_is_invocation_complete
+        self.plaidml_is_invocation_complete.argtypes = [
+            ctypes.POINTER(_C_Invocation)  # plaidml_invocation* invocation
+        ]
+        self.plaidml_is_invocation_complete.restype = ctypes.c_bool
+
+        # PLAIDML_API bool plaidml_wait_for_invocation(plaidml_invocation* invocation, int64_t timeout_ms);
+        self.plaidml_wait_for_invocation = lib.plaidml_wait_for_invocation
+        self.plaidml_wait_for_invocation.argtypes = [
+            ctypes.POINTER(_C_Invocation),  # plaidml_invocation* invocation
+            ctypes.c_int64  # int64_t timeout_ms
+        ]
+        self.plaidml_wait_for_invocation.restype = ctypes.c_bool
+        self.plaidml_wait_for_invocation.errcheck = self._check_err
+
+        # PLAIDML_API int64_t plaidml_get_invocation_execution_ns(plaidml_invocation* invocation);
+        self.plaidml_get_invocation_execution_ns = lib.plaidml_get_invocation_execution_ns
+        self.plaidml_get_invocation_execution_ns.argtypes = [
+            ctypes.POINTER(_C_Invocation)  # plaidml_invocation* invocation
+        ]
+        self.plaidml_get_invocation_execution_ns.restype = ctypes.c_int64
+
         # PLAIDML_API void plaidml_free_invocation(plaidml_invocation* invocation);
         self.plaidml_free_invocation = lib.plaidml_free_invocation
         self.plaidml_free_invocation.argtypes = [
@@ -1449,6 +1472,22 @@ class Invocation(object):
         self._as_parameter_ = _lib().plaidml_schedule_invocation(ctx, invoker)
         self._free = _lib().plaidml_free_invocation
 
+    def is_complete(self):
+        return _lib().plaidml_is_invocation_complete(self)
+
+    def wait(self, timeout=None):
+        """Waits for the invocation to finish, raising its error if it failed.
+
+        Args:
+            timeout (float): The maximum time to wait, in seconds, or None to wait indefinitely.
+        """
+        _lib().plaidml_wait_for_invocation(self, -1 if timeout is None else int(timeout * 1000))
+
+    def execution_seconds(self):
+        """Returns the invocation's execution time, or None if it hasn't finished."""
+        ns = _lib().plaidml_get_invocation_execution_ns(self)
+        return None if ns < 0 else ns / 1e9
+
     def __del__(self):
         if hasattr(self, '_free'):
             self._free(self)
@@ -8,6 +8,7 @@ const char kOk[] = "Ok";
 const char kOom[] = "Out of memory";
 const char kNoSuchFeature[] = "The requested feature is not available";
 const char kCancelled[] = "Cancelled";
+const char kDeadlineExceeded[] = "Deadline exceeded";
 const char kNoDevices[] = "No PlaidML compute devices available";
 const char kInvalidArgument[] = "Invalid argument specified";
 
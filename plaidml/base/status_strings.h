@@ -20,6 +20,9 @@ extern const char kNoSuchFeature[];
 // The string used for generic "cancelled" status messages.
 extern const char kCancelled[];
 
+// The string used for generic "deadline exceeded" status messages.
+extern const char kDeadlineExceeded[];
+
 // The string used for "no-devices" status messages.
 extern const char kNoDevices[];
 
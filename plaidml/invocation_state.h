@@ -0,0 +1,113 @@
+// Copyright 2019 Intel Corporation.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+#include "plaidml/base/status.h"
+#include "plaidml/base/status_strings.h"
+
+namespace vertexai {
+
+// The state of one particular run of a Plaid function, as tracked by a plaidml_invocation: whether the run has
+// finished, how it turned out, and who to tell when it does.
+class InvocationState {
+ public:
+  typedef void (*Callback)(void* arg, bool success);
+
+  // Records the time at which the computation was submitted.
+  void Start() { start_ = std::chrono::steady_clock::now(); }
+
+  // Records the computation's outcome, waking waiters and invoking any callback.
+  void Complete(std::exception_ptr error) noexcept {
+    Callback callback = nullptr;
+    void* arg = nullptr;
+    {
+      std::lock_guard<std::mutex> lock{mu_};
+      execution_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_)
+                          .count();
+      error_ = error;
+      complete_ = true;
+      std::swap(callback, callback_);
+      arg = callback_arg_;
+    }
+    cv_.notify_all();
+    if (callback) {
+      Invoke(callback, arg);
+    }
+  }
+
+  bool IsComplete() {
+    std::lock_guard<std::mutex> lock{mu_};
+    return complete_;
+  }
+
+  // Waits for the computation, reporting its outcome via the thread's status.
+  bool Wait(std::int64_t timeout_ms) {
+    std::unique_lock<std::mutex> lock{mu_};
+    if (timeout_ms < 0) {
+      cv_.wait(lock, [this] { return complete_; });
+    } else if (!cv_.wait_for(lock, std::chrono::milliseconds{timeout_ms}, [this] { return complete_; })) {
+      SetLastStatus(VAI_STATUS_DEADLINE_EXCEEDED, status_strings::kDeadlineExceeded);
+      return false;
+    }
+    if (error_) {
+      SetLastException(error_);
+      return false;
+    }
+    return true;
+  }
+
+  bool SetCallback(Callback callback, void* arg) {
+    {
+      std::lock_guard<std::mutex> lock{mu_};
+      if (callback_set_) {
+        SetLastStatus(VAI_STATUS_FAILED_PRECONDITION, "An invocation callback has already been set");
+        return false;
+      }
+      callback_set_ = true;
+      if (!complete_) {
+        callback_ = callback;
+        callback_arg_ = arg;
+        return true;
+      }
+    }
+    Invoke(callback, arg);
+    return true;
+  }
+
+  std::int64_t ExecutionNs() {
+    std::lock_guard<std::mutex> lock{mu_};
+    return complete_ ? execution_ns_ : -1;
+  }
+
+ private:
+  void Invoke(Callback callback, void* arg) noexcept {
+    std::exception_ptr error;
+    {
+      std::lock_guard<std::mutex> lock{mu_};
+      error = error_;
+    }
+    if (error) {
+      SetLastException(error);
+    }
+    callback(arg, !error);
+  }
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::chrono::steady_clock::time_point start_;
+  bool complete_ = false;
+  std::exception_ptr error_;
+  std::int64_t execution_ns_ = -1;
+  bool callback_set_ = false;
+  Callback callback_ = nullptr;
+  void* callback_arg_ = nullptr;
+};
+
+}  // namespace vertexai
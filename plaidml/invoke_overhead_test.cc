@@ -0,0 +1,80 @@
+// Copyright 2018 Intel Corporation.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+#include "base/util/logging.h"
+#include "plaidml/plaidml++.h"
+#include "testing/benchmark.h"
+#include "testing/plaidml_config.h"
+
+using ::testing::Eq;
+using ::testing::Ne;
+
+namespace vertexai {
+namespace plaidml {
+namespace {
+
+// Measures the host-side cost of scheduling small programs, which is dominated
+// by per-invocation bookkeeping rather than by device execution.  Each
+// iteration rebinds the invoker's input and output buffers (as a request loop
+// would), schedules the program, and waits for it to complete.
+class InvokeOverheadTest : public ::testing::TestWithParam<const char*> {
+ protected:
+  void SetUp() final {
+    vai_clear_status();
+    ctx_ = std::make_shared<vertexai::ctx>();
+    std::vector<device_config> configs = enumerate_devices(ctx_, vertexai::testing::PlaidMLConfig());
+    ASSERT_THAT(configs.size(), Ne(0));
+    dev_ = configs[0].open();
+  }
+
+  std::shared_ptr<ctx> ctx_;
+  device dev_;
+};
+
+constexpr std::size_t kWarmupIterations = 10;
+constexpr std::size_t kIterations = 1000;
+constexpr std::size_t kBufferSets = 2;
+
+TEST_P(InvokeOverheadTest, Schedule) {
+  function func(GetParam());
+
+  std::vector<tensor<float>> as, bs, cs;
+  for (std::size_t i = 0; i < kBufferSets; ++i) {
+    as.emplace_back(dev_.allocate(shape<float>(ctx_, {16, 16})));
+    bs.emplace_back(dev_.allocate(shape<float>(ctx_, {16, 16})));
+    cs.emplace_back(dev_.allocate(shape<float>(ctx_, {16, 16})));
+  }
+
+  invoker call(ctx_, func);
+
+  // Each iteration rebinds, schedules, and waits; the time spent scheduling is also tracked on its own.
+  testing::BenchmarkMicros schedule_time{0};
+  auto total_time = testing::MeanTime(kWarmupIterations, kIterations, [&](std::size_t i) {
+    std::size_t set = i % kBufferSets;
+    call.set_input("A", as[set]).set_input("B", bs[set]).set_output("C", cs[set]);
+    auto start = std::chrono::steady_clock::now();
+    auto invocation = call.invoke();
+    if (kWarmupIterations <= i) {
+      schedule_time += std::chrono::steady_clock::now() - start;
+    }
+    ASSERT_THAT(plaidml_wait_for_invocation(invocation.get(), -1), Eq(true));
+  });
+
+  LOG(INFO) << "Schedule: " << schedule_time.count() / kIterations << "us/invocation; "
+            << "total: " << total_time.count() << "us/invocation";
+}
+
+INSTANTIATE_TEST_CASE_P(Add, InvokeOverheadTest, ::testing::Values("function (A, B) -> (C) { C = A + B; }"));
+
+INSTANTIATE_TEST_CASE_P(MatMul, InvokeOverheadTest,
+                        ::testing::Values("function (A[M, K], B[K, N]) -> (C) { "
+                                          "C[m, n : M, N] = +(A[m, k] * B[k, n]); }"));
+
+}  // namespace
+}  // namespace plaidml
+}  // namespace vertexai
@@ -11,18 +11,22 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <exception>
 #include <fstream>
+#include <iomanip>
 #include <list>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <sstream>
 #include <string>
+#include <unordered_set>
 #include <utility>
 
 #include <boost/filesystem.hpp>
@@ -33,6 +37,7 @@
 #include "base/util/env.h"
 #include "base/util/error.h"
 #include "base/util/logging.h"
+#include "base/util/perf_counter.h"
 #include "base/util/sync.h"
 #include "base/util/type_url.h"
 #include "base/util/zipfile.h"
@@ -41,11 +46,13 @@
 #include "plaidml/base/status.h"
 #include "plaidml/base/status_strings.h"
 #include "plaidml/config.h"
+#include "plaidml/invocation_state.h"
 #include "plaidml/plaidml.pb.h"
 #include "tile/base/buffer.h"
 #include "tile/base/lru_cache.h"
 #include "tile/base/program_cache.h"
 #include "tile/lang/compose.h"
+#include "tile/lang/fnv1a64.h"
 #include "tile/lang/gen_stripe.h"
 #include "tile/lang/parser.h"
 #include "tile/lang/symbolic.h"
@@ -148,10 +155,15 @@ class Evaluator final {
   explicit Evaluator(plaidml_devconf* devconf)
       : platform_{devconf->platform},
         id_{devconf->device.dev_id()},
+        config_key_{ConfigKey(devconf->device)},
         program_cache_{std::make_shared<tile::ProgramCache>(platform_, 500 /* TODO: Make this configurable */)} {}
 
   const std::shared_ptr<tile::Platform>& get_platform() const { return platform_; }
   const std::string& get_id() const { return id_; }
+
+  // Identifies the device's configuration; compiled executables saved for one device are only loaded onto devices
+  // with the same configuration key.
+  const std::string& get_config_key() const { return config_key_; }
   const std::shared_ptr<tile::ProgramCache>& get_program_cache() const { return program_cache_; }
 
   std::shared_ptr<tile::Program> MakeProgram(const context::Context& ctx, const tile::proto::Program& prog) {
@@ -161,8 +173,16 @@ class Evaluator final {
   }
 
  private:
+  static std::string ConfigKey(const tile::proto::Device& device) {
+    std::string config = device.description() + '\n' + device.config();
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << fnv1a64::hash(config.c_str());
+    return key.str();
+  }
+
   std::shared_ptr<tile::Platform> platform_;
   std::string id_;
+  std::string config_key_;
   std::shared_ptr<tile::ProgramCache> program_cache_;
 };
 
@@ -438,6 +458,40 @@ extern "C" plaidml_buffer* plaidml_alloc_buffer(vai_ctx* ctx, plaidml_device* de
   }
 }
 
+extern "C" plaidml_buffer* plaidml_import_host_buffer(vai_ctx* ctx, plaidml_device* device, void* base, uint64_t size,
+                                                      void (*release)(void* arg, void* base), void* arg) {
+  if (!device) {
+    IVLOG(1, "Called plaidml_import_host_buffer on invalid device; thus out of memory.");
+    vertexai::SetLastOOM();
+    return nullptr;
+  }
+
+  if (!ctx) {
+    vertexai::SetLastStatus(VAI_STATUS_CANCELLED, status_strings::kCancelled);
+    return nullptr;
+  }
+
+  try {
+    context::Activity activity{ctx->activity.ctx(), "vertexai::ImportHostBuffer"};
+    // The release callback is only armed once the import succeeds; if it fails, the caller keeps the memory.
+    auto armed = std::make_shared<std::atomic<bool>>(false);
+    auto on_release = [armed, release, arg, base]() {
+      if (*armed && release) {
+        release(arg, base);
+      }
+    };
+    auto buffer = device->evaluator->get_platform()->ImportHostBuffer(ctx->activity.ctx(), device->evaluator->get_id(),
+                                                                      base, size, on_release);
+    auto result = std::make_unique<plaidml_buffer>(
+        std::move(activity), std::make_shared<BufferState>(std::move(buffer), device->evaluator));
+    *armed = true;
+    return result.release();
+  } catch (...) {
+    vertexai::SetLastException(std::current_exception());
+    return nullptr;
+  }
+}
+
 extern "C" void plaidml_free_buffer(plaidml_buffer* buffer) { delete buffer; }
 
 extern "C" plaidml_mapping* plaidml_map_buffer_current(plaidml_buffer* buffer,
@@ -920,6 +974,25 @@ std::shared_ptr<TensorValue> ReadTensor(vai_ctx* ctx, vertexai::UnZipArchive* zi
   return tile::lang::TensorValue::make(bs, ts, true);
 }
 
+// Supplies the device's program cache with the compiled executable saved in the archive for the device's
+// configuration (if any), so that the first invocation of the saved program doesn't need to recompile it.
+void ReadExecutable(vertexai::UnZipArchive* zip_file, const std::shared_ptr<Evaluator>& evaluator) {
+  const auto& key = evaluator->get_config_key();
+  if (!zip_file->Exist("program_" + key) || !zip_file->Exist("executable_" + key)) {
+    return;
+  }
+  tile::proto::Program prog;
+  if (!prog.ParseFromString(zip_file->OpenFile("program_" + key).ReadString())) {
+    LOG(WARNING) << "Unable to parse the saved program; it will be recompiled";
+    return;
+  }
+  prog.set_dev_id(evaluator->get_id());
+  if (!evaluator->get_program_cache()->AddSerializedProgram("sdk", prog,
+                                                            zip_file->OpenFile("executable_" + key).ReadString())) {
+    VLOG(1) << "The saved program has already been compiled for this device; ignoring its saved executable";
+  }
+}
+
 }  // namespace
 
 extern "C" bool plaidml_save_function(plaidml_function* function, const char* filename) {
@@ -960,6 +1033,7 @@ extern "C" plaidml_function* plaidml_load_function(vai_ctx* ctx, plaidml_device*
         inputs.push_back(ReadTensor(ctx, &zip_file, platform->evaluator, "data_" + in.name));
       }
     }
+    ReadExecutable(&zip_file, platform->evaluator);
     return new plaidml_function{std::make_shared<BoundFunction>(p, inputs)};
   } catch (...) {
     vertexai::SetLastException(std::current_exception());
@@ -1329,6 +1403,29 @@ std::map<std::string, ApplierParameterShape> ToApplierParameterShapes(
   return result;
 }
 
+// Returns true iff rebinding a parameter from one value to the other leaves
+// the invoker's prepared state (output shapes, run info, program) valid.
+template <class V, class W>
+bool SameApplierParameterShape(const std::shared_ptr<V>& lhs, const std::shared_ptr<W>& rhs) {
+  ApplierParameterShape lhs_shape{lhs};
+  ApplierParameterShape rhs_shape{rhs};
+  return !(lhs_shape < rhs_shape) && !(rhs_shape < lhs_shape);
+}
+
+// A compiled program, along with the bindings it was compiled for.  An invoker
+// keeps the program it last ran, so that repeated invocations with unchanged
+// shapes skip rebuilding the program proto and looking it up in the program
+// cache; they only need to bind the current buffers and launch.
+struct PreparedProgram {
+  std::shared_ptr<RunInfo> runinfo;
+  std::shared_ptr<Evaluator> evaluator;
+  std::set<std::string> consumed_inputs;
+  std::shared_ptr<tile::Program> program;
+};
+
+// Counts the invoker programs prepared, i.e. the invocations that couldn't reuse their invoker's prepared program.
+vertexai::PerfCounter invoker_programs_prepared("invoker_programs_prepared");
+
 }  // namespace
 
 struct plaidml_invoker {
@@ -1345,6 +1442,8 @@ struct plaidml_invoker {
       runinfo_cache{kRuninfoCacheSize};
 
   std::shared_ptr<RunInfo> runinfo;
+
+  PreparedProgram prepared;
 };
 
 namespace {
@@ -1381,6 +1480,107 @@ void BuildInvokerRunInfo(plaidml_invoker* invoker, const std::string& name) {
       });
 }
 
+// The device buffers bound to an invoker's inputs and outputs.
+struct InvokerBindings {
+  std::shared_ptr<Evaluator> evaluator;
+  std::map<std::string, std::shared_ptr<tile::Buffer>> in_buffers;
+  std::map<std::string, std::shared_ptr<tile::Buffer>> out_buffers;
+  std::set<std::string> consumed_inputs;  // Inputs whose buffers are also bound to outputs
+};
+
+InvokerBindings BindInvoker(plaidml_invoker* invoker) {
+  InvokerBindings bindings;
+  bindings.in_buffers = BindBuffers(invoker->runinfo->input_buffers, invoker->inputs, &bindings.evaluator);
+  bindings.out_buffers = BindBuffers(invoker->runinfo->output_buffers, invoker->outputs, &bindings.evaluator);
+
+  if (!bindings.evaluator) {
+    throw vertexai::error::FailedPrecondition{"Function has neither inputs nor outputs"};
+  }
+
+  std::unordered_set<const tile::Buffer*> output_set;
+  for (const auto& kv : bindings.out_buffers) {
+    output_set.insert(kv.second.get());
+  }
+  for (const auto& kv : invoker->runinfo->input_shapes) {
+    if (output_set.count(bindings.in_buffers[kv.first].get())) {
+      bindings.consumed_inputs.insert(kv.first);
+    }
+  }
+  return bindings;
+}
+
+tile::proto::Program MakeInvokerProgramProto(plaidml_invoker* invoker, const InvokerBindings& bindings) {
+  const auto& evaluator = bindings.evaluator;
+  const auto& consumed_inputs = bindings.consumed_inputs;
+  tile::proto::Program prog;
+  prog.set_dev_id(evaluator->get_id());
+  prog.set_code(invoker->runinfo->code);
+  for (const auto& kv : invoker->runinfo->input_shapes) {
+    auto& input = (*prog.mutable_inputs())[kv.first];
+    *input.mutable_shape() = tile::IntoProto(kv.second);
+    if (consumed_inputs.count(kv.first)) {
+      input.set_consumed(true);
+    }
+  }
+  for (const auto& kv : invoker->runinfo->output_shapes) {
+    *(*prog.mutable_outputs())[kv.first].mutable_shape() = tile::IntoProto(kv.second);
+  }
+
+  size_t max_trials = 1;
+  auto env_trials = vertexai::env::Get("PLAIDML_KERNEL_TRIALS");
+  if (env_trials.length()) {
+    auto env_value = std::atoi(env_trials.c_str());
+    if (env_value) {
+      max_trials = env_value;
+    }
+  }
+
+  size_t max_trial_runs = 1;
+  auto env_runs = vertexai::env::Get("PLAIDML_KERNEL_TRIAL_RUNS");
+  if (env_runs.length()) {
+    auto env_value = std::atoi(env_runs.c_str());
+    if (env_value) {
+      max_trial_runs = env_value;
+    }
+  }
+
+  double early_stop_margin = 0;
+  auto env_margin = vertexai::env::Get("PLAIDML_KERNEL_TRIAL_MARGIN");
+  if (env_margin.length()) {
+    early_stop_margin = std::atof(env_margin.c_str());
+  }
+
+  size_t max_parallel_builds = 0;
+  auto env_builds = vertexai::env::Get("PLAIDML_KERNEL_TRIAL_BUILDS");
+  if (env_builds.length()) {
+    max_parallel_builds = std::atoi(env_builds.c_str());
+  }
+
+  auto* params = prog.mutable_tile_scanning_params();
+  params->set_max_trials(max_trials);
+  params->set_max_trial_runs(max_trial_runs);
+  params->set_early_stop_margin(early_stop_margin);
+  params->set_max_parallel_builds(max_parallel_builds);
+
+  return prog;
+}
+
+// Returns the compiled program for the invoker's current bindings, reusing the
+// invoker's previously prepared program when the bindings haven't changed.
+std::shared_ptr<tile::Program> PrepareInvokerProgram(const context::Context& ctx, plaidml_invoker* invoker,
+                                                     const InvokerBindings& bindings) {
+  auto& prepared = invoker->prepared;
+  if (prepared.program && prepared.runinfo == invoker->runinfo && prepared.evaluator == bindings.evaluator &&
+      prepared.consumed_inputs == bindings.consumed_inputs) {
+    return prepared.program;
+  }
+
+  auto program = bindings.evaluator->MakeProgram(ctx, MakeInvokerProgramProto(invoker, bindings));
+  invoker_programs_prepared.inc();
+  prepared = PreparedProgram{invoker->runinfo, bindings.evaluator, bindings.consumed_inputs, program};
+  return program;
+}
+
 }  // namespace
 
 extern "C" plaidml_invoker* plaidml_alloc_invoker(vai_ctx* ctx, plaidml_function* function) {
@@ -1415,7 +1615,13 @@ extern "C" bool plaidml_set_invoker_input(plaidml_invoker* invoker, const char*
         default:
           throw vertexai::error::InvalidArgument{"Invocation inputs must be tensors or constants"};
       }
-      invoker->inputs[name] = var->value;
+      auto& input = invoker->inputs[name];
+      bool same_shape = input && SameApplierParameterShape(input, var->value);
+      input = var->value;
+      if (same_shape) {
+        // Only the bound buffer changed; the prepared program stays usable.
+        return true;
+      }
     } else {
       invoker->inputs.erase(name);
     }
@@ -1471,7 +1677,13 @@ extern "C" bool plaidml_set_invoker_output(plaidml_invoker* invoker, const char*
       if (var->value->type() != Value::TENSOR) {
         throw vertexai::error::InvalidArgument{"Invocation outputs must be tensors"};
       }
-      invoker->outputs[name] = std::dynamic_pointer_cast<TensorValue>(var->value);
+      auto& output = invoker->outputs[name];
+      auto value = std::dynamic_pointer_cast<TensorValue>(var->value);
+      bool same_shape = output && SameApplierParameterShape(output, value);
+      output = std::move(value);
+      if (same_shape) {
+        return true;
+      }
     } else {
       invoker->outputs.erase(name);
     }
@@ -1505,6 +1717,26 @@ extern "C" bool plaidml_save_invoker(plaidml_invoker* invoker, const char* filen
         return true;
       }
 
+      case PLAIDML_FILE_FORMAT_TILE_EXECUTABLE: {
+        // Compile the program (if it hasn't been already) before writing anything.
+        BuildInvokerRunInfo(invoker, "invoker_program");
+        auto bindings = BindInvoker(invoker);
+        auto program = PrepareInvokerProgram(context::Context{}, invoker, bindings);
+        auto executable = bindings.evaluator->get_platform()->SerializeProgram(context::Context{}, program.get());
+        if (executable.empty()) {
+          throw vertexai::error::Unimplemented{"The invoker's device cannot serialize compiled programs"};
+        }
+        const auto& key = bindings.evaluator->get_config_key();
+        zipFile out_file = zipOpen64(filename, 0);
+        WriteVersion(out_file);
+        WriteFunction(out_file, *invoker->func);
+        WriteMetadata(out_file, *invoker->func, invoker->inputs);
+        WriteString(out_file, "program_" + key, MakeInvokerProgramProto(invoker, bindings).SerializeAsString());
+        WriteString(out_file, "executable_" + key, executable);
+        zipClose(out_file, nullptr);
+        return true;
+      }
+
       case PLAIDML_FILE_FORMAT_STRIPE_HUMAN:
       case PLAIDML_FILE_FORMAT_STRIPE_PROTOTXT:
       case PLAIDML_FILE_FORMAT_STRIPE_BINARY:
@@ -1550,13 +1782,13 @@ extern "C" bool plaidml_save_invoker(plaidml_invoker* invoker, const char* filen
 
 // plaidml_invocation
 //
-// Currently, the actual invocation structure is a placeholder; it
-// represents a particular invocation of a Plaid function, but it
-// doesn't have any useful data.  The intention is that it gives us a
-// place to stand to query information about the invocation, attach
-// callbacks, &c.
+// An invocation tracks one particular run of a Plaid function.  The run's
+// continuation completes the invocation's state on whichever thread finishes
+// the run, so tracking an invocation doesn't need a thread of its own.
 
-struct plaidml_invocation {};
+struct plaidml_invocation {
+  std::shared_ptr<vertexai::InvocationState> state;
+};
 
 extern "C" plaidml_invocation* plaidml_schedule_invocation(vai_ctx* ctx, plaidml_invoker* invoker) {
   if (!ctx || !invoker) {
@@ -1565,75 +1797,32 @@ extern "C" plaidml_invocation* plaidml_schedule_invocation(vai_ctx* ctx, plaidml
   }
   context::Activity activity{ctx->activity.ctx(), "plaidml::invoker::ScheduleInvocation"};
   try {
-    auto invocation = std::make_unique<plaidml_invocation>();
+    auto invocation =
+        std::make_unique<plaidml_invocation>(plaidml_invocation{std::make_shared<vertexai::InvocationState>()});
     auto rundown = std::make_shared<context::Rundown>();
     rundown->TryEnterGate(activity.ctx().gate());
     BuildInvokerRunInfo(invoker, "invoker_program");
 
     // Gather up the appropriate buffers
-    std::shared_ptr<Evaluator> evaluator;
-
-    auto in_buffers = BindBuffers(invoker->runinfo->input_buffers, invoker->inputs, &evaluator);
-    auto out_buffers = BindBuffers(invoker->runinfo->output_buffers, invoker->outputs, &evaluator);
-
-    std::unordered_set<const tile::Buffer*> output_set;
-    for (const auto& kv : out_buffers) {
-      output_set.insert(kv.second.get());
-    }
-
-    if (!evaluator) {
-      throw vertexai::error::FailedPrecondition{"Function has neither inputs nor outputs"};
-    }
-
-    tile::proto::Program prog;
-    prog.set_dev_id(evaluator->get_id());
-    prog.set_code(invoker->runinfo->code);
-    for (const auto& kv : invoker->runinfo->input_shapes) {
-      auto& input = (*prog.mutable_inputs())[kv.first];
-      *input.mutable_shape() = tile::IntoProto(kv.second);
-      if (output_set.count(in_buffers[kv.first].get())) {
-        input.set_consumed(true);
-      }
-    }
-    for (const auto& kv : invoker->runinfo->output_shapes) {
-      *(*prog.mutable_outputs())[kv.first].mutable_shape() = tile::IntoProto(kv.second);
-    }
-
-    size_t max_trials = 1;
-    auto env_trials = vertexai::env::Get("PLAIDML_KERNEL_TRIALS");
-    if (env_trials.length()) {
-      auto env_value = std::atoi(env_trials.c_str());
-      if (env_value) {
-        max_trials = env_value;
-      }
-    }
-
-    size_t max_trial_runs = 1;
-    auto env_runs = vertexai::env::Get("PLAIDML_KERNEL_TRIAL_RUNS");
-    if (env_runs.length()) {
-      auto env_value = std::atoi(env_runs.c_str());
-      if (env_value) {
-        max_trial_runs = env_value;
-      }
-    }
-
-    auto* params = prog.mutable_tile_scanning_params();
-    params->set_max_trials(max_trials);
-    params->set_max_trial_runs(max_trial_runs);
-
-    auto program = evaluator->MakeProgram(activity.ctx(), prog);
+    auto bindings = BindInvoker(invoker);
+    auto program = PrepareInvokerProgram(activity.ctx(), invoker, bindings);
 
     // Run the program
-    auto result = program->Run(activity.ctx(), in_buffers, out_buffers);
-    result.then(boost::launch::async, [rundown = std::move(rundown)](decltype(result) fut) {
-      try {
-        fut.get();
-      } catch (const std::exception& ex) {
-        // TODO: We need a better way to notify users if the asynchronous results
-        // of an invocation are valid, perhaps by allowing a callback to be specified.
-        LOG(ERROR) << ex.what();
-      }
-    });
+    invocation->state->Start();
+    auto result = program->Run(activity.ctx(), std::move(bindings.in_buffers), std::move(bindings.out_buffers));
+    result.then(boost::launch::sync,
+                [rundown = std::move(rundown), state = invocation->state](decltype(result) fut) noexcept {
+                  std::exception_ptr error;
+                  try {
+                    fut.get();
+                  } catch (const std::exception& ex) {
+                    LOG(ERROR) << ex.what();
+                    error = std::current_exception();
+                  } catch (...) {
+                    error = std::current_exception();
+                  }
+                  state->Complete(error);
+                });
 
     return invocation.release();
   } catch (...) {
@@ -1642,6 +1831,49 @@ extern "C" plaidml_invocation* plaidml_schedule_invocation(vai_ctx* ctx, plaidml
   }
 }
 
+extern "C" bool plaidml_is_invocation_complete(plaidml_invocation* invocation) {
+  if (!invocation) {
+    vertexai::SetLastOOM();
+    return false;
+  }
+  return invocation->state->IsComplete();
+}
+
+extern "C" bool plaidml_wait_for_invocation(plaidml_invocation* invocation, int64_t timeout_ms) {
+  if (!invocation) {
+    vertexai::SetLastOOM();
+    return false;
+  }
+  try {
+    return invocation->state->Wait(timeout_ms);
+  } catch (...) {
+    vertexai::SetLastException(std::current_exception());
+    return false;
+  }
+}
+
+extern "C" bool plaidml_set_invocation_callback(plaidml_invocation* invocation,
+                                                void (*callback)(void* arg, bool success), void* arg) {
+  if (!invocation || !callback) {
+    vertexai::SetLastOOM();
+    return false;
+  }
+  try {
+    return invocation->state->SetCallback(callback, arg);
+  } catch (...) {
+    vertexai::SetLastException(std::current_exception());
+    return false;
+  }
+}
+
+extern "C" int64_t plaidml_get_invocation_execution_ns(plaidml_invocation* invocation) {
+  if (!invocation) {
+    vertexai::SetLastOOM();
+    return -1;
+  }
+  return invocation->state->ExecutionNs();
+}
+
 extern "C" void plaidml_free_invocation(plaidml_invocation* invocation) { delete invocation; }
 
 // plaidml_gradient
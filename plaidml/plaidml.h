@@ -166,6 +166,29 @@ typedef struct plaidml_mapping plaidml_mapping;
 // NULL.
 PLAIDML_API plaidml_buffer* plaidml_alloc_buffer(vai_ctx* ctx, plaidml_device* device, uint64_t size);
 
+// The alignment, in bytes, required of host memory supplied to plaidml_import_host_buffer.
+#define PLAIDML_HOST_BUFFER_ALIGNMENT 64
+
+// Makes a buffer that directly uses caller-owned host memory, without copying
+// it: programs read their inputs from the memory and write their outputs to it
+// in place, and mappings of the buffer map the memory itself.
+//
+// The memory must be aligned to PLAIDML_HOST_BUFFER_ALIGNMENT bytes, and must
+// remain valid until the library invokes the release callback (if non-NULL)
+// with the supplied arg and the memory's base address.  The library invokes
+// the callback exactly once, after the buffer has been freed and any
+// invocations using it have completed.  If the call fails, the callback is
+// never invoked, and the caller retains ownership of the memory.
+//
+// Only devices that operate on host memory support this call; other devices
+// fail it with VAI_STATUS_UNIMPLEMENTED.  Outputs are written to an imported
+// buffer in place, so an invocation fails if an imported buffer bound as an
+// output is also bound as any of its inputs or other outputs (unless the
+// program itself updates that input in place).  After a failed invocation, an
+// imported output buffer remains usable, but its contents are unspecified.
+PLAIDML_API plaidml_buffer* plaidml_import_host_buffer(vai_ctx* ctx, plaidml_device* device, void* base, uint64_t size,
+                                                       void (*release)(void* arg, void* base), void* arg);
+
 // Frees a buffer.  After this call, the buffer should not be used for any
 // subsequent calls.  Freeing a NULL buffer is a no-op.
 PLAIDML_API void plaidml_free_buffer(plaidml_buffer* buffer);
@@ -377,7 +400,10 @@ PLAIDML_API plaidml_function* plaidml_build_coded_function(const char* code, con
 
 // TODO: Make more general method to serialize things.
 
-// Load a function (possibly with bound tensors) from a file
+// Load a function (possibly with bound tensors) from a file.  If the file
+// contains a compiled program for the device's configuration (see
+// PLAIDML_FILE_FORMAT_TILE_EXECUTABLE), the program is made available to
+// invocations of the function on the device.
 PLAIDML_API plaidml_function* plaidml_load_function(vai_ctx* ctx, plaidml_device* dev, const char* filename);
 
 // Store a function (possibly with bound tensors) from to a file
@@ -518,15 +544,25 @@ PLAIDML_API plaidml_shape* plaidml_alloc_invoker_output_shape(plaidml_invoker* i
 PLAIDML_API bool plaidml_set_invoker_output(plaidml_invoker* invoker, const char* name, plaidml_var* var);
 
 // PlaidML Stripe file formats.
+//
+// PLAIDML_FILE_FORMAT_TILE_EXECUTABLE is a Tile archive (as written by
+// PLAIDML_FILE_FORMAT_TILE) that also contains the program compiled for
+// the invoker's current bindings on the invoker's device.  When such an
+// archive is loaded by plaidml_load_function onto a device with the same
+// configuration, invoking the function with the same shapes uses the
+// compiled program instead of recompiling it; otherwise, the program is
+// recompiled as usual.
 typedef enum {
   PLAIDML_FILE_FORMAT_TILE = 1,
   PLAIDML_FILE_FORMAT_STRIPE_HUMAN = 2,
   PLAIDML_FILE_FORMAT_STRIPE_PROTOTXT = 3,
   PLAIDML_FILE_FORMAT_STRIPE_BINARY = 4,
+  PLAIDML_FILE_FORMAT_TILE_EXECUTABLE = 5,
 } plaidml_file_format;
 
 // Serializes an invoker to a file.  All inputs to the invoker must
-// already be set to concrete values that are consistent in size.
+// already be set to concrete values that are consistent in size; for
+// PLAIDML_FILE_FORMAT_TILE_EXECUTABLE, the outputs must be set as well.
 PLAIDML_API bool plaidml_save_invoker(plaidml_invoker* invoker, const char* filename, plaidml_file_format format);
 
 // A PlaidML invocation describes one particular run of a function.
@@ -553,13 +589,48 @@ typedef struct plaidml_invocation plaidml_invocation;
 // Note that this call may return before the computation described by
 // the function has actually completed; the computation is scheduled,
 // not complete.  Errors that occur asynchronously will be reported
-// when the buffers updated by running the function are remapped.
+// when the buffers updated by running the function are remapped, and
+// through the returned invocation.
 //
 // Once this call returns, the invoker's inputs and outputs may be set
 // by the caller, and the invoker may be used for another run of the
 // invoker's function, even if the first run has not yet completed.
 PLAIDML_API plaidml_invocation* plaidml_schedule_invocation(vai_ctx* ctx, plaidml_invoker* invoker);
 
+// Returns true if the invocation's computation has finished, whether or
+// not it succeeded.  A NULL invocation is never complete.
+PLAIDML_API bool plaidml_is_invocation_complete(plaidml_invocation* invocation);
+
+// Waits for an invocation's computation to finish.  A negative timeout
+// waits indefinitely.
+//
+// Returns true if the computation finished successfully.  Otherwise,
+// returns false, with the computation's error, or VAI_STATUS_DEADLINE_EXCEEDED
+// if the timeout expired first, in the current thread's thread-local
+// storage.
+PLAIDML_API bool plaidml_wait_for_invocation(plaidml_invocation* invocation, int64_t timeout_ms);
+
+// Arranges for the callback to be invoked with the supplied arg once the
+// invocation's computation has finished, with success set to true if the
+// computation succeeded.  On failure, the computation's error is available
+// to the callback via vai_last_status().
+//
+// The library invokes the callback exactly once: synchronously, if the
+// computation has already finished, and otherwise on the thread that
+// finishes it, which may be a library-internal thread, so the callback should
+// return quickly.  The callback is invoked even if the invocation is freed
+// first.  Each invocation accepts at most one callback; returns false (with
+// VAI_STATUS_FAILED_PRECONDITION) if one has already been set, in which case
+// the supplied callback will never be invoked.
+PLAIDML_API bool plaidml_set_invocation_callback(plaidml_invocation* invocation,
+                                                 void (*callback)(void* arg, bool success), void* arg);
+
+// Returns the time, in nanoseconds, from when the invocation's computation
+// was submitted to the device until it finished, or -1 if the computation
+// hasn't finished yet (or the invocation is NULL).  This excludes the time
+// spent preparing the computation within plaidml_schedule_invocation().
+PLAIDML_API int64_t plaidml_get_invocation_execution_ns(plaidml_invocation* invocation);
+
 // Frees an invocation.  After this call, the invocation should not be
 // used for any subsequent calls.  Freeing a NULL invocation is a no-op.
 PLAIDML_API void plaidml_free_invocation(plaidml_invocation* invocation);
@@ -3,13 +3,22 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "base/util/error.h"
 #include "plaidml/base/base.h"
 #include "plaidml/base/context.h"
+#include "plaidml/invocation_state.h"
 #include "plaidml/plaidml++.h"
 #include "plaidml/plaidml.h"
 #include "testing/matchers.h"
 #include "testing/plaidml_config.h"
 
+using ::testing::Eq;
 using ::testing::Gt;
 using ::testing::IsVaiStatus;
 using ::testing::Not;
@@ -153,6 +162,10 @@ TEST(PlaidML_C_API, BroadcastOne) {
 
   EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_OK));
 
+  EXPECT_TRUE(plaidml_wait_for_invocation(invocation.get(), -1));
+  EXPECT_TRUE(plaidml_is_invocation_complete(invocation.get()));
+  EXPECT_GE(plaidml_get_invocation_execution_ns(invocation.get()), 0);
+
   {
     std::unique_ptr<plaidml_mapping> c_map{plaidml_map_buffer_current(c_buf.get(), nullptr, nullptr)};
     EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_OK));
@@ -171,6 +184,203 @@ TEST(PlaidML_C_API, BroadcastOne) {
   }
 }
 
+// Records the calls of an invocation callback, which may be made on another thread.
+struct CallbackLog {
+  std::atomic<int> calls{0};
+  bool success = false;
+  vai_status status = VAI_STATUS_OK;
+  std::promise<void> called;
+
+  static void Record(void* arg, bool success) {
+    auto* log = static_cast<CallbackLog*>(arg);
+    log->success = success;
+    log->status = vai_last_status();
+    if (++log->calls == 1) {
+      log->called.set_value();
+    }
+  }
+};
+
+TEST(InvocationState, CallbackFiresOnce) {
+  vai_clear_status();
+  vertexai::InvocationState state;
+  state.Start();
+  CallbackLog log;
+  EXPECT_TRUE(state.SetCallback(&CallbackLog::Record, &log));
+  EXPECT_THAT(log.calls, Eq(0));
+
+  state.Complete(nullptr);
+  EXPECT_THAT(log.calls, Eq(1));
+  EXPECT_TRUE(log.success);
+  EXPECT_THAT(log.status, Eq(VAI_STATUS_OK));
+
+  // Only one callback may be set; the second is never invoked.
+  CallbackLog second;
+  EXPECT_FALSE(state.SetCallback(&CallbackLog::Record, &second));
+  EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_FAILED_PRECONDITION));
+  EXPECT_THAT(second.calls, Eq(0));
+  EXPECT_THAT(log.calls, Eq(1));
+}
+
+TEST(InvocationState, CallbackSetAfterCompletion) {
+  vai_clear_status();
+  vertexai::InvocationState state;
+  state.Start();
+  state.Complete(nullptr);
+
+  // The callback is invoked synchronously.
+  CallbackLog log;
+  EXPECT_TRUE(state.SetCallback(&CallbackLog::Record, &log));
+  EXPECT_THAT(log.calls, Eq(1));
+  EXPECT_TRUE(log.success);
+}
+
+TEST(InvocationState, WaitTimesOut) {
+  vai_clear_status();
+  vertexai::InvocationState state;
+  state.Start();
+  EXPECT_FALSE(state.Wait(10));
+  EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_DEADLINE_EXCEEDED));
+  EXPECT_FALSE(state.IsComplete());
+  EXPECT_THAT(state.ExecutionNs(), Eq(-1));
+
+  // Completion on another thread wakes an indefinite wait.
+  vai_clear_status();
+  std::thread completer{[&state]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    state.Complete(nullptr);
+  }};
+  EXPECT_TRUE(state.Wait(-1));
+  completer.join();
+  EXPECT_TRUE(state.IsComplete());
+  EXPECT_GE(state.ExecutionNs(), 0);
+}
+
+TEST(InvocationState, ErrorPropagates) {
+  vai_clear_status();
+  vertexai::InvocationState state;
+  state.Start();
+  CallbackLog log;
+  EXPECT_TRUE(state.SetCallback(&CallbackLog::Record, &log));
+
+  // The failure is completed on another thread, as a failed run is; the callback runs there.
+  std::thread completer{[&state]() {
+    state.Complete(std::make_exception_ptr(vertexai::error::Internal{"Kernel failed"}));
+  }};
+  completer.join();
+  EXPECT_THAT(log.calls, Eq(1));
+  EXPECT_FALSE(log.success);
+  EXPECT_THAT(log.status, Eq(VAI_STATUS_INTERNAL));
+
+  // Waiting reports the same failure, as does a late callback.
+  EXPECT_FALSE(state.Wait(-1));
+  EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_INTERNAL));
+  vertexai::InvocationState late;
+  late.Start();
+  late.Complete(std::make_exception_ptr(vertexai::error::Internal{"Kernel failed"}));
+  CallbackLog late_log;
+  EXPECT_TRUE(late.SetCallback(&CallbackLog::Record, &late_log));
+  EXPECT_THAT(late_log.calls, Eq(1));
+  EXPECT_FALSE(late_log.success);
+  EXPECT_THAT(late_log.status, Eq(VAI_STATUS_INTERNAL));
+}
+
+TEST(PlaidML_C_API, InvocationCallback) {
+  vai_clear_status();
+  auto ctx = std::make_shared<vertexai::ctx>();
+  auto devices = plaidml::enumerate_devices(ctx, vertexai::testing::PlaidMLConfig());
+  plaidml::device dev = devices[0].open();
+  plaidml::function add("function (A, B) -> (C) { C = A + B; }");
+  plaidml::tensor<float> a = dev.allocate(plaidml::shape<float>(ctx, {64}));
+  plaidml::tensor<float> b = dev.allocate(plaidml::shape<float>(ctx, {64}));
+  for (auto* t : {&a, &b}) {
+    plaidml::mapping<float> data = t->map(plaidml::map_for_write);
+    for (size_t i = 0; i < 64; i++) {
+      data(i) = 1;
+    }
+  }
+  plaidml::tensor<float> c = dev.allocate(plaidml::shape<float>(ctx, {64}));
+  plaidml::invoker invoker(ctx, add);
+  invoker.set_input("A", a).set_input("B", b).set_output("C", c);
+
+  // A callback set right after scheduling, whether or not the run has finished, fires once the run succeeds.
+  auto invocation = invoker.invoke();
+  CallbackLog log;
+  EXPECT_TRUE(plaidml_set_invocation_callback(invocation.get(), &CallbackLog::Record, &log));
+  EXPECT_TRUE(plaidml_wait_for_invocation(invocation.get(), -1));
+  log.called.get_future().wait();
+  EXPECT_THAT(log.calls, Eq(1));
+  EXPECT_TRUE(log.success);
+  EXPECT_FALSE(plaidml_set_invocation_callback(invocation.get(), &CallbackLog::Record, &log));
+  EXPECT_THAT(log.calls, Eq(1));
+
+  // A callback set after the run has finished fires immediately.
+  auto second = invoker.invoke();
+  EXPECT_TRUE(plaidml_wait_for_invocation(second.get(), -1));
+  CallbackLog late_log;
+  EXPECT_TRUE(plaidml_set_invocation_callback(second.get(), &CallbackLog::Record, &late_log));
+  EXPECT_THAT(late_log.calls, Eq(1));
+  EXPECT_TRUE(late_log.success);
+
+  {
+    plaidml::mapping<float> data = c.map(plaidml::map_for_read);
+    EXPECT_FLOAT_EQ(data(0u), 2);
+    EXPECT_FLOAT_EQ(data(63u), 2);
+  }
+}
+
+TEST(PlaidML_C_API, InvokerReusesPreparedProgram) {
+  vai_clear_status();
+  auto ctx = std::make_shared<vertexai::ctx>();
+  auto devices = plaidml::enumerate_devices(ctx, vertexai::testing::PlaidMLConfig());
+  plaidml::device dev = devices[0].open();
+  plaidml::function add("function (A, B) -> (C) { C = A + B; }");
+  plaidml::invoker invoker(ctx, add);
+
+  // Binds fresh tensors of the given size, with A = a and B = b, and runs the invoker; returns C.
+  auto run = [&](size_t size, float a, float b) {
+    std::vector<plaidml::tensor<float>> inputs;
+    for (float value : {a, b}) {
+      inputs.emplace_back(dev.allocate(plaidml::shape<float>(ctx, {size})));
+      plaidml::mapping<float> data = inputs.back().map(plaidml::map_for_write);
+      for (size_t i = 0; i < size; i++) {
+        data(i) = value;
+      }
+    }
+    plaidml::tensor<float> output = dev.allocate(plaidml::shape<float>(ctx, {size}));
+    invoker.set_input("A", inputs[0]).set_input("B", inputs[1]).set_output("C", output);
+    EXPECT_TRUE(plaidml_wait_for_invocation(invoker.invoke().get(), -1));
+    return output;
+  };
+
+  auto prepared = vai_get_perf_counter("invoker_programs_prepared");
+  {
+    auto output = run(16, 1, 2);
+    EXPECT_THAT(vai_get_perf_counter("invoker_programs_prepared"), Eq(prepared + 1));
+    plaidml::mapping<float> data = output.map(plaidml::map_for_read);
+    EXPECT_FLOAT_EQ(data(0u), 3);
+    EXPECT_FLOAT_EQ(data(15u), 3);
+  }
+
+  // Rebinding same-shaped tensors reuses the prepared program, and runs it on the new buffers.
+  {
+    auto output = run(16, 10, 20);
+    EXPECT_THAT(vai_get_perf_counter("invoker_programs_prepared"), Eq(prepared + 1));
+    plaidml::mapping<float> data = output.map(plaidml::map_for_read);
+    EXPECT_FLOAT_EQ(data(0u), 30);
+    EXPECT_FLOAT_EQ(data(15u), 30);
+  }
+
+  // Rebinding differently-shaped tensors invalidates the prepared program.
+  {
+    auto output = run(32, 100, 200);
+    EXPECT_THAT(vai_get_perf_counter("invoker_programs_prepared"), Eq(prepared + 2));
+    plaidml::mapping<float> data = output.map(plaidml::map_for_read);
+    EXPECT_FLOAT_EQ(data(0u), 300);
+    EXPECT_FLOAT_EQ(data(31u), 300);
+  }
+}
+
 TEST(PlaidML_C_API, BroadcastBoth) {
   vai_clear_status();
 
@@ -350,6 +560,153 @@ TEST(PlaidML_C_API, MatMul) {
   }
 }
 
+TEST(PlaidML_C_API, ImportHostBuffer) {
+  vai_clear_status();
+
+  std::unique_ptr<plaidml_function> matmul{
+      plaidml_build_coded_function("function (B[X,Z], C[Z,Y]) -> (A) { A[x,y : X,Y] = +(B[x,z] * C[z,y]); }", nullptr)};
+  EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_OK));
+
+  std::unique_ptr<vai_ctx> ctx{vai_alloc_ctx()};
+  std::unique_ptr<plaidml_device_enumerator> dev_enum{
+      plaidml_alloc_device_enumerator_with_config(ctx.get(), vertexai::testing::PlaidMLConfig(), nullptr, nullptr)};
+  std::unique_ptr<plaidml_device> dev{
+      plaidml_open_device(ctx.get(), plaidml_get_devconf(ctx.get(), dev_enum.get(), 0))};
+  EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_OK));
+
+  alignas(PLAIDML_HOST_BUFFER_ALIGNMENT) float in[9] = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0};
+  alignas(PLAIDML_HOST_BUFFER_ALIGNMENT) float out[9] = {};
+  int releases = 0;
+  auto release = [](void* arg, void* /* base */) { ++*static_cast<int*>(arg); };
+
+  std::unique_ptr<plaidml_buffer> inbuf{
+      plaidml_import_host_buffer(ctx.get(), dev.get(), in, sizeof(in), release, &releases)};
+  if (!inbuf && vai_last_status() == VAI_STATUS_UNIMPLEMENTED) {
+    // The configured device doesn't operate on host memory.
+    return;
+  }
+  EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_OK));
+
+  // Misaligned memory is rejected, and the caller keeps it.
+  std::unique_ptr<plaidml_buffer> badbuf{
+      plaidml_import_host_buffer(ctx.get(), dev.get(), in + 1, 8 * sizeof(float), release, &releases)};
+  EXPECT_EQ(badbuf, nullptr);
+  EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_INVALID_ARGUMENT));
+  vai_clear_status();
+
+  std::unique_ptr<plaidml_buffer> outbuf{
+      plaidml_import_host_buffer(ctx.get(), dev.get(), out, sizeof(out), release, &releases)};
+  EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_OK));
+
+  std::unique_ptr<plaidml_shape> shape{plaidml_alloc_shape(ctx.get(), PLAIDML_DATA_FLOAT32)};
+  plaidml_add_dimension(ctx.get(), shape.get(), 3, 3);
+  plaidml_add_dimension(ctx.get(), shape.get(), 3, 1);
+
+  std::unique_ptr<plaidml_var> a{plaidml_alloc_tensor(ctx.get(), outbuf.get(), shape.get())};
+  std::unique_ptr<plaidml_var> b{plaidml_alloc_tensor(ctx.get(), inbuf.get(), shape.get())};
+  std::unique_ptr<plaidml_var> c{plaidml_alloc_tensor(ctx.get(), inbuf.get(), shape.get())};
+
+  std::unique_ptr<plaidml_invoker> invoker{plaidml_alloc_invoker(ctx.get(), matmul.get())};
+  plaidml_set_invoker_input(invoker.get(), "B", b.get());
+  plaidml_set_invoker_input(invoker.get(), "C", c.get());
+  plaidml_set_invoker_output(invoker.get(), "A", a.get());
+  std::unique_ptr<plaidml_invocation> invocation{plaidml_schedule_invocation(ctx.get(), invoker.get())};
+  EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_OK));
+
+  {
+    // Mapping the output waits for the program, and maps the caller's memory itself.
+    std::unique_ptr<plaidml_mapping> outmap{plaidml_map_buffer_current(outbuf.get(), nullptr, nullptr)};
+    EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_OK));
+    EXPECT_EQ(reinterpret_cast<float*>(plaidml_get_mapping_base(ctx.get(), outmap.get())), out);
+  }
+
+  EXPECT_FLOAT_EQ(out[0], 1.0 + 8.0 + 21.0);
+  EXPECT_FLOAT_EQ(out[1], 2.0 + 10.0 + 24.0);
+  EXPECT_FLOAT_EQ(out[2], 3.0 + 12.0 + 27.0);
+  EXPECT_FLOAT_EQ(out[3], 4.0 + 20.0 + 42.0);
+  EXPECT_FLOAT_EQ(out[4], 8.0 + 25.0 + 48.0);
+  EXPECT_FLOAT_EQ(out[5], 12.0 + 30.0 + 54.0);
+  EXPECT_FLOAT_EQ(out[6], 7.0 + 32.0 + 63.0);
+  EXPECT_FLOAT_EQ(out[7], 14.0 + 40.0 + 72.0);
+  EXPECT_FLOAT_EQ(out[8], 21.0 + 48.0 + 81.0);
+
+  invocation.reset();
+  invoker.reset();
+  a.reset();
+  b.reset();
+  c.reset();
+  EXPECT_EQ(releases, 0);
+  inbuf.reset();
+  outbuf.reset();
+  EXPECT_EQ(releases, 2);
+}
+
+TEST(PlaidML_C_API, ImportHostBufferAliasing) {
+  vai_clear_status();
+
+  std::unique_ptr<plaidml_function> matmul{
+      plaidml_build_coded_function("function (B[X,Z], C[Z,Y]) -> (A) { A[x,y : X,Y] = +(B[x,z] * C[z,y]); }", nullptr)};
+  EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_OK));
+
+  std::unique_ptr<vai_ctx> ctx{vai_alloc_ctx()};
+  std::unique_ptr<plaidml_device_enumerator> dev_enum{
+      plaidml_alloc_device_enumerator_with_config(ctx.get(), vertexai::testing::PlaidMLConfig(), nullptr, nullptr)};
+  std::unique_ptr<plaidml_device> dev{
+      plaidml_open_device(ctx.get(), plaidml_get_devconf(ctx.get(), dev_enum.get(), 0))};
+  EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_OK));
+
+  alignas(PLAIDML_HOST_BUFFER_ALIGNMENT) float in[9] = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0};
+  alignas(PLAIDML_HOST_BUFFER_ALIGNMENT) float out[9] = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0};
+
+  std::unique_ptr<plaidml_buffer> inbuf{
+      plaidml_import_host_buffer(ctx.get(), dev.get(), in, sizeof(in), nullptr, nullptr)};
+  if (!inbuf && vai_last_status() == VAI_STATUS_UNIMPLEMENTED) {
+    // The configured device doesn't operate on host memory.
+    return;
+  }
+  std::unique_ptr<plaidml_buffer> outbuf{
+      plaidml_import_host_buffer(ctx.get(), dev.get(), out, sizeof(out), nullptr, nullptr)};
+  EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_OK));
+
+  std::unique_ptr<plaidml_shape> shape{plaidml_alloc_shape(ctx.get(), PLAIDML_DATA_FLOAT32)};
+  plaidml_add_dimension(ctx.get(), shape.get(), 3, 3);
+  plaidml_add_dimension(ctx.get(), shape.get(), 3, 1);
+
+  std::unique_ptr<plaidml_var> a{plaidml_alloc_tensor(ctx.get(), outbuf.get(), shape.get())};
+  std::unique_ptr<plaidml_var> b{plaidml_alloc_tensor(ctx.get(), inbuf.get(), shape.get())};
+  std::unique_ptr<plaidml_var> c{plaidml_alloc_tensor(ctx.get(), outbuf.get(), shape.get())};
+
+  // The output's memory is also one of the inputs, so writing it in place would corrupt the input as it's read; the
+  // invocation fails.
+  std::unique_ptr<plaidml_invoker> invoker{plaidml_alloc_invoker(ctx.get(), matmul.get())};
+  plaidml_set_invoker_input(invoker.get(), "B", b.get());
+  plaidml_set_invoker_input(invoker.get(), "C", c.get());
+  plaidml_set_invoker_output(invoker.get(), "A", a.get());
+  std::unique_ptr<plaidml_invocation> invocation{plaidml_schedule_invocation(ctx.get(), invoker.get())};
+  EXPECT_FALSE(invocation && plaidml_wait_for_invocation(invocation.get(), -1));
+  EXPECT_THAT(vai_last_status(), Not(IsVaiStatus(VAI_STATUS_OK)));
+  vai_clear_status();
+  invocation.reset();
+
+  // The failure leaves both of the caller's buffers intact and usable.
+  for (int i = 0; i < 9; ++i) {
+    EXPECT_FLOAT_EQ(out[i], in[i]);
+  }
+  std::unique_ptr<plaidml_var> c2{plaidml_alloc_tensor(ctx.get(), inbuf.get(), shape.get())};
+  plaidml_set_invoker_input(invoker.get(), "C", c2.get());
+  invocation.reset(plaidml_schedule_invocation(ctx.get(), invoker.get()));
+  ASSERT_THAT(invocation, NotNull());
+  EXPECT_TRUE(plaidml_wait_for_invocation(invocation.get(), -1));
+  EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_OK));
+  {
+    std::unique_ptr<plaidml_mapping> outmap{plaidml_map_buffer_current(outbuf.get(), nullptr, nullptr)};
+    EXPECT_THAT(vai_last_status(), IsVaiStatus(VAI_STATUS_OK));
+  }
+  EXPECT_FLOAT_EQ(out[0], 1.0 + 8.0 + 21.0);
+  EXPECT_FLOAT_EQ(out[4], 8.0 + 25.0 + 48.0);
+  EXPECT_FLOAT_EQ(out[8], 21.0 + 48.0 + 81.0);
+}
+
 TEST(PlaidML_C_API, Save) {
   vai_clear_status();
   auto ctx = std::make_shared<vertexai::ctx>();
@@ -390,4 +747,63 @@ TEST(PlaidML_C_API, Save) {
   }
 }
 
+TEST(PlaidML_C_API, SaveExecutable) {
+  vai_clear_status();
+  auto ctx = std::make_shared<vertexai::ctx>();
+  auto devices = plaidml::enumerate_devices(ctx, vertexai::testing::PlaidMLConfig());
+  const char* code = "function (B[X,Z], C[Z,Y]) -> (A) { A[x,y : X,Y] = +(B[x,z] * C[z,y]); }";
+
+  // Allocates a matmul's inputs on a device, filled with 2s.
+  auto make_inputs = [&](const plaidml::device& dev) {
+    std::vector<plaidml::tensor<float>> inputs;
+    for (int input = 0; input < 2; ++input) {
+      inputs.emplace_back(dev.allocate(plaidml::shape<float>(ctx, {64, 64})));
+      plaidml::mapping<float> data = inputs.back().map(plaidml::map_for_write);
+      for (size_t i = 0; i < 64; i++) {
+        for (size_t j = 0; j < 64; j++) {
+          data(i, j) = 2;
+        }
+      }
+    }
+    return inputs;
+  };
+
+  // Save the function along with its compiled program.
+  {
+    plaidml::device dev = devices[0].open();
+    plaidml::function matmul(code);
+    auto inputs = make_inputs(dev);
+    plaidml::tensor<float> output = dev.allocate(plaidml::shape<float>(ctx, {64, 64}));
+    plaidml::invoker call(ctx, matmul);
+    call.set_input("B", inputs[0]).set_input("C", inputs[1]).set_output("A", output);
+    try {
+      call.save("test_executable.plaidml", PLAIDML_FILE_FORMAT_TILE_EXECUTABLE);
+    } catch (vertexai::vai_exception& ex) {
+      // Not every device can serialize its compiled programs.
+      ASSERT_THAT(ex.status(), Eq(VAI_STATUS_UNIMPLEMENTED));
+      return;
+    }
+  }
+
+  // Reload it onto a freshly opened device (whose program cache is empty), bind, and execute; the program should be
+  // restored rather than compiled.
+  plaidml::device dev = devices[0].open();
+  auto inputs = make_inputs(dev);
+  auto compiled = vai_get_perf_counter("programs_compiled");
+  auto restored = vai_get_perf_counter("programs_restored");
+  plaidml::function matmul;
+  plaidml::tensor<float> output = dev.allocate(plaidml::shape<float>(ctx, {64, 64}));
+  matmul.load(ctx, dev, "test_executable.plaidml");
+
+  plaidml::invoker(ctx, matmul).set_input("B", inputs[0]).set_input("C", inputs[1]).set_output("A", output).invoke();
+  EXPECT_THAT(vai_get_perf_counter("programs_compiled"), Eq(compiled));
+  EXPECT_THAT(vai_get_perf_counter("programs_restored"), Eq(restored + 1));
+
+  {
+    plaidml::mapping<float> data = output.map(plaidml::map_for_read);
+    EXPECT_FLOAT_EQ(data(0u, 0u), 256);
+    EXPECT_FLOAT_EQ(data(63u, 63u), 256);
+  }
+}
+
 }  // namespace
@@ -0,0 +1,30 @@
+// Copyright 2019 Intel Corporation.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace vertexai {
+namespace testing {
+
+// The unit benchmarks report their times in.
+using BenchmarkMicros = std::chrono::duration<double, std::micro>;
+
+// Calls fn(i) for i in [0, warmup + iterations), and returns the mean wall-clock time of the calls after the first
+// warmup.  Benchmarks are manual tests: they report their times with LOG(INFO), leaving the checks to the regular
+// tests.
+template <typename F>
+BenchmarkMicros MeanTime(std::size_t warmup, std::size_t iterations, F&& fn) {
+  for (std::size_t i = 0; i < warmup; ++i) {
+    fn(i);
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = warmup; i < warmup + iterations; ++i) {
+    fn(i);
+  }
+  return BenchmarkMicros{std::chrono::steady_clock::now() - start} / iterations;
+}
+
+}  // namespace testing
+}  // namespace vertexai
@@ -5,6 +5,7 @@
 // These interfaces define the data model provided by all HAL drivers.
 
 #include <chrono>
+#include <functional>
 #include <initializer_list>
 #include <memory>
 #include <string>
@@ -14,6 +15,7 @@
 #include <boost/thread/future.hpp>
 
 #include "base/context/context.h"
+#include "base/util/error.h"
 #include "tile/lang/generate.h"
 #include "tile/proto/hal.pb.h"
 
@@ -146,6 +148,14 @@ class Memory {
 
   // Makes an arena for use with the associated device.
   virtual std::shared_ptr<Arena> MakeArena(std::uint64_t size, BufferAccessMask access) = 0;
+
+  // Makes a buffer for use with the associated device that directly uses existing host memory, which must be aligned
+  // to ArenaBufferAlignment().  The memory must remain valid until the buffer calls release, which it does once it's
+  // no longer referenced.  Memories that can't use host memory in place throw error::Unimplemented.
+  virtual std::shared_ptr<Buffer> ImportHostBuffer(void* /* base */, std::uint64_t /* size */,
+                                                   std::function<void()> /* release */) {
+    throw error::Unimplemented{"This device cannot use host memory in place"};
+  }
 };
 
 // A Tile executable program that can be run on a processor.
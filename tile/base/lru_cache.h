@@ -2,62 +2,117 @@
 
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <future>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace vertexai {
 namespace tile {
 
+// Selects an ordered map, keyed using Compare, as the cache's lookup map.
+template <typename Compare>
+struct OrderedLruMap {
+  template <typename K, typename V>
+  using type = std::map<K, V, Compare>;
+};
+
+// Selects a hash map, keyed using Hash and KeyEqual, as the cache's lookup map.
+template <typename Hash, typename KeyEqual>
+struct HashedLruMap {
+  template <typename K, typename V>
+  using type = std::unordered_map<K, V, Hash, KeyEqual>;
+};
+
 // A simplistic LRU cache implementation.
-// The cache must be externally synchronized.
+// The cache is internally synchronized.
 // Value must be CopyConstructible.
-template <typename Key, typename Value, typename Compare = std::less<Key>>
-class LruCache {
+//
+// The cache lock is never held while a value is being built.  The first lookup
+// of a missing key installs an in-flight entry and runs the builder outside
+// the lock; concurrent lookups of the same key wait for that build instead of
+// starting their own, while lookups of other keys proceed unimpeded.  A builder
+// must therefore never look up its own key.
+template <typename Key, typename Value, typename MapSelector>
+class BasicLruCache {
  public:
-  explicit LruCache(std::size_t size_max) : size_max_(size_max) {}
+  explicit BasicLruCache(std::size_t size_max) : size_max_(size_max) {}
 
   // Finds the value associated with the specified key.  If the value is not in
   // the cache, Builder() will be invoked to construct it; this adds a value to
   // the cache, which may result in an eviction of the least recently used
-  // entry in the cache.  If an exception is thrown by the builder, the cache
-  // is left unmodified, as if this function was never called (strong exception
-  // guarantee).
+  // entry in the cache.  If an exception is thrown by the builder, it is
+  // propagated to every caller waiting on that build, and the cache is left
+  // as if the lookup had never happened.
   template <typename Builder>
   Value Lookup(const Key& key, const Builder& builder) {
-    std::unique_lock<std::mutex> lock{mu_};
+    if (size_max_ == 0) {
+      return builder();
+    }
 
-    auto it = entries_.find(key);
+    std::promise<Value> promise;
+    std::shared_future<Value> future;
+    std::uint64_t generation = 0;
+    {
+      std::lock_guard<std::mutex> lock{mu_};
+      auto it = entries_.find(key);
+      if (it != entries_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second.lru_ent);
+        future = it->second.value;
+      } else {
+        generation = ++next_generation_;
+        future = promise.get_future().share();
+        it = entries_.emplace(key, MapEnt{future, generation, lru_.end()}).first;
+        it->second.lru_ent = lru_.emplace(lru_.begin(), &*it);
+        while (size_max_ < entries_.size()) {
+          entries_.erase(lru_.back()->first);
+          lru_.pop_back();
+        }
+      }
+    }
 
-    if (it != entries_.end()) {
-      lru_.erase(it->second.lru_ent);
-      it->second.lru_ent = lru_.emplace(lru_.begin(), LruEnt{it});
-      return it->second.value;
+    if (!generation) {
+      // Either a completed entry, or one being built by another thread.
+      return future.get();
     }
 
-    Value result = builder();
-    if (size_max_ > 0) {
-      it = entries_.emplace(key, MapEnt{result, lru_.end()}).first;
-      while (lru_.size() > 0 && size_max_ < entries_.size()) {
-        entries_.erase(lru_.back().map_ent);
-        lru_.pop_back();
+    try {
+      Value result = builder();
+      promise.set_value(result);
+      return result;
+    } catch (...) {
+      {
+        std::lock_guard<std::mutex> lock{mu_};
+        auto it = entries_.find(key);
+        if (it != entries_.end() && it->second.generation == generation) {
+          lru_.erase(it->second.lru_ent);
+          entries_.erase(it);
+        }
       }
-      it->second.lru_ent = lru_.emplace(lru_.begin(), LruEnt{it});
+      promise.set_exception(std::current_exception());
+      throw;
     }
-    return result;
   }
 
  private:
-  struct LruEnt;
+  struct MapEnt;
 
-  struct MapEnt {
-    Value value;
-    typename std::list<LruEnt>::iterator lru_ent;
-  };
+  using Map = typename MapSelector::template type<Key, MapEnt>;
+
+  // The LRU list points at map elements; element addresses (unlike hash map
+  // iterators) are stable across insertions.
+  using LruList = std::list<std::pair<const Key, MapEnt>*>;
 
-  struct LruEnt {
-    typename std::map<Key, MapEnt>::iterator map_ent;
+  struct MapEnt {
+    std::shared_future<Value> value;
+    std::uint64_t generation;  // Identifies the build that created this entry
+    typename LruList::iterator lru_ent;
   };
 
   // The maximum cache size.
@@ -67,11 +122,45 @@ class LruCache {
   std::mutex mu_;
 
   // The entry lookup map.
-  std::map<Key, MapEnt, Compare> entries_;
+  Map entries_;
 
   // The LRU list.  Recently used entries are at the front; the next entry to
   // evict is at the back.
-  std::list<LruEnt> lru_;
+  LruList lru_;
+
+  // The generation to assign to the next entry.
+  std::uint64_t next_generation_ = 0;
+};
+
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+using LruCache = BasicLruCache<Key, Value, OrderedLruMap<Compare>>;
+
+// An LRU cache split into independently-locked shards by key hash, for caches
+// shared by many threads.  Recency is tracked per shard, so eviction order is
+// only approximately LRU across the whole cache.
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class ShardedLruCache {
+ public:
+  static constexpr std::size_t kDefaultShardCount = 16;
+
+  explicit ShardedLruCache(std::size_t size_max, std::size_t shard_count = kDefaultShardCount) {
+    std::size_t shard_max = (size_max + shard_count - 1) / shard_count;
+    for (std::size_t idx = 0; idx < shard_count; ++idx) {
+      shards_.emplace_back(std::make_unique<Shard>(shard_max));
+    }
+  }
+
+  // Finds the value associated with the specified key, building it if
+  // necessary; see BasicLruCache::Lookup.
+  template <typename Builder>
+  Value Lookup(const Key& key, const Builder& builder) {
+    return shards_[Hash{}(key) % shards_.size()]->Lookup(key, builder);
+  }
+
+ private:
+  using Shard = BasicLruCache<Key, Value, HashedLruMap<Hash, KeyEqual>>;
+
+  std::vector<std::unique_ptr<Shard>> shards_;
 };
 
 }  // namespace tile
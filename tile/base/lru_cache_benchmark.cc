@@ -0,0 +1,57 @@
+// Copyright 2018 Intel Corporation.
+
+#include <gmock/gmock.h>
+
+#include <thread>
+#include <vector>
+
+#include "base/util/logging.h"
+#include "testing/benchmark.h"
+#include "tile/base/lru_cache.h"
+
+namespace vertexai {
+namespace tile {
+namespace {
+
+// Measures lookup throughput with N threads hitting a small set of hot keys
+// and a stream of cold keys (which always miss and build).
+template <typename Cache>
+void RunContention(const char* name) {
+  const int kLookupsPerThread = 20000;
+  const int kHotKeys = 8;
+  for (int thread_count : {1, 2, 4, 8, 16}) {
+    Cache cache{256};
+    auto time = testing::MeanTime(0, 1, [&](std::size_t) {
+      std::vector<std::thread> threads;
+      for (int tidx = 0; tidx < thread_count; ++tidx) {
+        threads.emplace_back([&, tidx]() {
+          for (int idx = 0; idx < kLookupsPerThread; ++idx) {
+            // One lookup in eight is for a cold key.
+            int key = (idx % 8) ? idx % kHotKeys : kHotKeys + tidx * kLookupsPerThread + idx;
+            cache.Lookup(key, [key]() {
+              volatile int sink = 0;
+              for (int spin = 0; spin < 2000; ++spin) {
+                sink = sink + spin;
+              }
+              return key;
+            });
+          }
+        });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+    });
+    LOG(INFO) << name << ": " << thread_count << " threads, " << (thread_count * kLookupsPerThread) / time.count()
+              << " lookups/us";
+  }
+}
+
+TEST(LruCacheBenchmark, Contention) {
+  RunContention<LruCache<int, int>>("LruCache");
+  RunContention<ShardedLruCache<int, int>>("ShardedLruCache");
+}
+
+}  // namespace
+}  // namespace tile
+}  // namespace vertexai
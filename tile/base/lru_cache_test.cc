@@ -0,0 +1,101 @@
+// Copyright 2018 Intel Corporation.
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tile/base/lru_cache.h"
+
+using ::testing::Eq;
+
+namespace vertexai {
+namespace tile {
+namespace {
+
+TEST(LruCacheTest, BuildsOnceAndEvictsLeastRecentlyUsed) {
+  LruCache<int, std::string> cache{2};
+  int builds = 0;
+  auto build = [&](int key) {
+    return [&builds, key]() {
+      ++builds;
+      return std::to_string(key);
+    };
+  };
+  EXPECT_THAT(cache.Lookup(1, build(1)), Eq("1"));
+  EXPECT_THAT(cache.Lookup(2, build(2)), Eq("2"));
+  EXPECT_THAT(cache.Lookup(1, build(1)), Eq("1"));
+  EXPECT_THAT(builds, Eq(2));
+  // Inserting 3 evicts 2, the least recently used entry.
+  EXPECT_THAT(cache.Lookup(3, build(3)), Eq("3"));
+  EXPECT_THAT(cache.Lookup(1, build(1)), Eq("1"));
+  EXPECT_THAT(builds, Eq(3));
+  EXPECT_THAT(cache.Lookup(2, build(2)), Eq("2"));
+  EXPECT_THAT(builds, Eq(4));
+}
+
+TEST(LruCacheTest, FailedBuildLeavesCacheUnmodified) {
+  LruCache<int, int> cache{4};
+  EXPECT_THROW(cache.Lookup(1, []() -> int { throw std::runtime_error("build failed"); }), std::runtime_error);
+  EXPECT_THAT(cache.Lookup(1, []() { return 42; }), Eq(42));
+}
+
+TEST(LruCacheTest, ConcurrentLookupsCoalesce) {
+  ShardedLruCache<int, int> cache{16};
+  std::atomic<int> builds{0};
+  std::vector<std::thread> threads;
+  for (int idx = 0; idx < 8; ++idx) {
+    threads.emplace_back([&]() {
+      EXPECT_THAT(cache.Lookup(7, [&]() {
+        ++builds;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return 49;
+      }),
+                  Eq(49));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_THAT(builds.load(), Eq(1));
+}
+
+TEST(LruCacheTest, DistinctKeysBuildConcurrently) {
+  // Each build waits for all of the builds to start, which only happens if
+  // they run concurrently; builds held under the cache lock would wait until
+  // the timeout.
+  LruCache<int, int> cache{16};
+  const int kThreads = 4;
+  std::mutex mu;
+  std::condition_variable cv;
+  int started = 0;
+  std::atomic<int> overlapped{0};
+  std::vector<std::thread> threads;
+  for (int idx = 0; idx < kThreads; ++idx) {
+    threads.emplace_back([&, idx]() {
+      cache.Lookup(idx, [&]() {
+        std::unique_lock<std::mutex> lock{mu};
+        ++started;
+        cv.notify_all();
+        if (cv.wait_for(lock, std::chrono::seconds(10), [&]() { return started == kThreads; })) {
+          ++overlapped;
+        }
+        return idx;
+      });
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_THAT(overlapped.load(), Eq(kThreads));
+}
+
+}  // namespace
+}  // namespace tile
+}  // namespace vertexai
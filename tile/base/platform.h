@@ -2,11 +2,13 @@
 
 #pragma once
 
+#include <functional>
 #include <list>
 #include <memory>
 #include <string>
 
 #include "base/context/context.h"
+#include "base/util/error.h"
 #include "tile/base/buffer.h"
 #include "tile/base/program.h"
 #include "tile/lang/generate.h"
@@ -26,9 +28,34 @@ class Platform {
   virtual std::shared_ptr<Buffer> MakeBuffer(const context::Context& ctx, const std::string& device_id,
                                              std::uint64_t size) = 0;
 
+  // Makes a buffer on the target device that directly uses existing host memory, without copying it.  The memory must
+  // remain valid until release is called, which happens once the buffer is no longer referenced, including by any
+  // running programs.  Program outputs written to the buffer are written to the memory in place.  Platforms and
+  // devices that can't use host memory in place throw error::Unimplemented.
+  virtual std::shared_ptr<Buffer> ImportHostBuffer(const context::Context& /* ctx */,
+                                                   const std::string& /* device_id */, void* /* base */,
+                                                   std::uint64_t /* size */, std::function<void()> /* release */) {
+    throw error::Unimplemented{"This platform cannot use host memory in place"};
+  }
+
   // Builds (pre-compiling if possible) a program for executing the supplied Program
   virtual std::unique_ptr<Program> MakeProgram(const context::Context& ctx, const proto::Program& program) = 0;
 
+  // Serializes the compiled form of a program built by this platform, so that it can be restored by
+  // DeserializeProgram without being recompiled.  Returns an empty string if the program can't be serialized.
+  virtual std::string SerializeProgram(const context::Context& /* ctx */, Program* /* program */) {
+    return std::string{};
+  }
+
+  // Restores a program serialized by SerializeProgram.  The supplied Program must be the one the serialized program
+  // was built from.  Returns nullptr if the serialized program doesn't match the program's device, in which case the
+  // caller should build the program with MakeProgram instead.
+  virtual std::unique_ptr<Program> DeserializeProgram(const context::Context& /* ctx */,
+                                                      const proto::Program& /* program */,
+                                                      const std::string& /* serialized */) {
+    return nullptr;
+  }
+
   virtual void ListDevices(const context::Context& ctx, const proto::ListDevicesRequest& request,
                            proto::ListDevicesResponse* response) = 0;
 
@@ -2,8 +2,10 @@
 
 #include "tile/base/program_cache.h"
 
+#include <functional>
 #include <map>
 #include <sstream>
+#include <utility>
 
 #include "base/util/logging.h"
 
@@ -21,6 +23,11 @@ std::tuple<std::string, std::shared_ptr<Program>> ProgramCache::GetProgram(const
   return std::make_tuple(entry->id(), entry->GetProgram(ctx, platform_.get()));
 }
 
+bool ProgramCache::AddSerializedProgram(const std::string& fallback_id, const tile::proto::Program& program,
+                                        std::string serialized) {
+  return GetEntry(fallback_id, program)->SetSerialized(std::move(serialized));
+}
+
 std::shared_ptr<lang::Program> ProgramCache::GetParsedProgram(const context::Context& ctx,
                                                               const std::string& fallback_id,
                                                               const tile::proto::Program& program) {
@@ -29,6 +36,11 @@ std::shared_ptr<lang::Program> ProgramCache::GetParsedProgram(const context::Con
 
 namespace {
 
+// Mixes a value into a running hash (as boost::hash_combine does, widened to 64 bits).
+std::uint64_t HashCombine(std::uint64_t seed, std::uint64_t value) {
+  return seed ^ (value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2));
+}
+
 template <typename M>
 void SerializeShapemap(std::ostringstream* serialized, const M& m) {
   std::map<std::string, const proto::TensorShape&> shapes;
@@ -47,6 +59,12 @@ void SerializeShapemap(std::ostringstream* serialized, const M& m) {
 
 }  // namespace
 
+ProgramCache::Key::Key(std::string subdevice_, std::string ops_)
+    : subdevice{std::move(subdevice_)}, ops{std::move(ops_)} {
+  std::hash<std::string> hasher;
+  hash = HashCombine(HashCombine(0, hasher(subdevice)), hasher(ops));
+}
+
 std::shared_ptr<ProgramCache::Entry> ProgramCache::GetEntry(const std::string& fallback_id,
                                                             const tile::proto::Program& program) {
   std::ostringstream serialized;
@@ -59,9 +77,6 @@ std::shared_ptr<ProgramCache::Entry> ProgramCache::GetEntry(const std::string& f
   SerializeShapemap(&serialized, program.inputs());
   SerializeShapemap(&serialized, program.outputs());
 
-  // The cache itself must be externally synchronized.
-  std::lock_guard<std::mutex> lock{mu_};
-
   return cache_.Lookup(Key{program.dev_id(), serialized.str()}, [&]() {
     std::string cid = "c" + std::to_string(next_id_++);
     if (program.id().size()) {
@@ -79,12 +94,39 @@ std::shared_ptr<ProgramCache::Entry> ProgramCache::GetEntry(const std::string& f
 
 std::shared_ptr<Program> ProgramCache::Entry::GetProgram(const context::Context& ctx, Platform* dev) {
   std::call_once(compile_once_, [this, ctx, dev]() {
-    compiled_ = dev->MakeProgram(ctx, proto_);
+    std::string serialized;
+    {
+      std::lock_guard<std::mutex> lock{serialized_mu_};
+      std::swap(serialized, serialized_);
+      built_ = true;
+    }
+    if (serialized.size()) {
+      try {
+        compiled_ = dev->DeserializeProgram(ctx, proto_, serialized);
+      } catch (const std::exception& ex) {
+        LOG(WARNING) << "Unable to restore serialized program " << id_ << "; recompiling: " << ex.what();
+      }
+      if (compiled_) {
+        VLOG(1) << "Restored program " << id_ << " from its serialized form";
+      }
+    }
+    if (!compiled_) {
+      compiled_ = dev->MakeProgram(ctx, proto_);
+    }
     proto_.Clear();
   });
   return compiled_;
 }
 
+bool ProgramCache::Entry::SetSerialized(std::string serialized) {
+  std::lock_guard<std::mutex> lock{serialized_mu_};
+  if (built_) {
+    return false;
+  }
+  serialized_ = std::move(serialized);
+  return true;
+}
+
 std::shared_ptr<lang::Program> ProgramCache::Entry::GetParsedProgram() {
   std::call_once(parse_once_, [this]() {
     lang::Parser parser;
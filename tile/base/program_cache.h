@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -33,25 +35,36 @@ class ProgramCache final {
                                                                const std::string& fallback_id,
                                                                const tile::proto::Program& program);
 
+  // Supplies a serialized compiled form (see Platform::SerializeProgram) for the requested program.  If the program
+  // hasn't been built yet, it will be restored from the serialized form instead of being compiled, falling back to
+  // compilation if the serialized form can't be used.  Returns false, discarding the serialized form, if the program
+  // has already been built.
+  bool AddSerializedProgram(const std::string& fallback_id, const tile::proto::Program& program,
+                            std::string serialized);
+
   // Returns the output of the tile parser, which is generally used during program setup.
   std::shared_ptr<lang::Program> GetParsedProgram(const context::Context& ctx, const std::string& fallback_id,
                                                   const tile::proto::Program& program);
 
  private:
+  // Cache keys carry a precomputed hash of their contents, which is used both
+  // to select a cache shard and to reject mismatches without comparing the
+  // (potentially very large) ops string.
   struct Key {
+    Key(std::string subdevice_, std::string ops_);
+
     std::string subdevice;
     std::string ops;
+    std::uint64_t hash;
   };
 
-  struct KeyComp {
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const { return static_cast<std::size_t>(key.hash); }
+  };
+
+  struct KeyEqual {
     bool operator()(const Key& lhs, const Key& rhs) const {
-      if (lhs.subdevice < rhs.subdevice) {
-        return true;
-      }
-      if (rhs.subdevice < lhs.subdevice) {
-        return false;
-      }
-      return lhs.ops < rhs.ops;
+      return lhs.hash == rhs.hash && lhs.subdevice == rhs.subdevice && lhs.ops == rhs.ops;
     }
   };
 
@@ -63,12 +76,18 @@ class ProgramCache final {
 
     std::shared_ptr<Program> GetProgram(const context::Context& ctx, Platform* dev);
 
+    // Returns false if the program has already been built.
+    bool SetSerialized(std::string serialized);
+
     std::shared_ptr<lang::Program> GetParsedProgram();
 
    private:
     std::string id_;
     std::once_flag compile_once_, parse_once_;
     tile::proto::Program proto_;
+    std::mutex serialized_mu_;
+    std::string serialized_;
+    bool built_ = false;  // Set once the program starts building; guarded by serialized_mu_
     std::shared_ptr<Program> compiled_;
     std::shared_ptr<lang::Program> parsed_;
   };
@@ -77,9 +96,8 @@ class ProgramCache final {
 
   std::shared_ptr<Platform> platform_;
 
-  std::mutex mu_;
-  int next_id_ = 1;
-  LruCache<Key, std::shared_ptr<Entry>, KeyComp> cache_;
+  std::atomic<int> next_id_{1};
+  ShardedLruCache<Key, std::shared_ptr<Entry>, KeyHash, KeyEqual> cache_;
 };
 
 }  // namespace tile
@@ -2,6 +2,9 @@
 
 #include "tile/base/schedule.h"
 
+#include <string>
+#include <vector>
+
 #include "base/util/error.h"
 
 namespace vertexai {
@@ -101,6 +104,9 @@ void ScheduleToProto(proto::Schedule* pb, const Schedule& schedule) {
     apb->set_size(alloc.byte_size);
     apb->set_input(alloc.input);
     apb->set_output(alloc.output);
+    for (auto alias : alloc.safe_self_alias_allocs) {
+      apb->add_safe_self_alias_aidxs(alias->idx);
+    }
   }
 
   std::size_t sidx = 0;
@@ -109,6 +115,9 @@ void ScheduleToProto(proto::Schedule* pb, const Schedule& schedule) {
     for (auto dep : step.deps) {
       spb->add_deps(dep->idx);
     }
+    for (const auto& output : step.outputs) {
+      spb->add_output_add_deps(output.add_dep);
+    }
     switch (step.tag) {
       case Step::Tag::kRun: {
         auto* run_pb = spb->mutable_run();
@@ -145,6 +154,77 @@ void ScheduleToProto(proto::Schedule* pb, const Schedule& schedule) {
   }
 }
 
+Schedule ScheduleFromProto(const proto::Schedule& pb) {
+  Schedule schedule;
+
+  std::vector<Alloc*> allocs;
+  for (const auto& apb : pb.allocs()) {
+    schedule.allocs.emplace_back();
+    auto& alloc = schedule.allocs.back();
+    alloc.byte_size = apb.size();
+    alloc.input = apb.input();
+    alloc.output = apb.output();
+    allocs.push_back(&alloc);
+  }
+  auto lookup_alloc = [&](std::uint64_t aidx) {
+    if (allocs.size() <= aidx) {
+      throw error::DataLoss{"In schedule proto parsing: invalid alloc index " + std::to_string(aidx)};
+    }
+    return allocs[aidx];
+  };
+  for (std::size_t aidx = 0; aidx < allocs.size(); ++aidx) {
+    for (auto alias : pb.allocs(aidx).safe_self_alias_aidxs()) {
+      allocs[aidx]->safe_self_alias_allocs.insert(lookup_alloc(alias));
+    }
+  }
+
+  std::vector<Step*> steps;
+  for (const auto& spb : pb.steps()) {
+    switch (spb.action_case()) {
+      case proto::Step::kRun: {
+        schedule.steps.emplace_back(Step::Tag::kRun);
+        auto& step = schedule.steps.back();
+        step.kidx = spb.run().kidx();
+        for (auto aidx : spb.run().output_aidxs()) {
+          step.outputs.emplace_back(OutputInfo{lookup_alloc(aidx), false});
+        }
+        for (auto aidx : spb.run().input_aidxs()) {
+          step.inputs.emplace_back(lookup_alloc(aidx));
+        }
+        break;
+      }
+      case proto::Step::kCopy: {
+        schedule.steps.emplace_back(Step::Tag::kCopy);
+        auto& step = schedule.steps.back();
+        step.byte_count = spb.copy().count_bytes();
+        step.outputs.emplace_back(OutputInfo{lookup_alloc(spb.copy().to_aidx()), false});
+        step.inputs.emplace_back(lookup_alloc(spb.copy().from_aidx()));
+        break;
+      }
+      default:
+        throw error::DataLoss{"In schedule proto parsing: step " + std::to_string(steps.size()) +
+                              " has an invalid action"};
+    }
+    auto& step = schedule.steps.back();
+    for (int oidx = 0; oidx < spb.output_add_deps_size() && oidx < static_cast<int>(step.outputs.size()); ++oidx) {
+      step.outputs[oidx].add_dep = spb.output_add_deps(oidx);
+    }
+    steps.push_back(&step);
+  }
+  for (std::size_t sidx = 0; sidx < steps.size(); ++sidx) {
+    for (auto dep : pb.steps(sidx).deps()) {
+      if (steps.size() <= dep) {
+        throw error::DataLoss{"In schedule proto parsing: step " + std::to_string(sidx) +
+                              " has an invalid dependency " + std::to_string(dep)};
+      }
+      steps[sidx]->deps.insert(steps[dep]);
+    }
+  }
+
+  schedule.Reindex();
+  return schedule;
+}
+
 }  // namespace schedule
 }  // namespace tile
 }  // namespace vertexai
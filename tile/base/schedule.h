@@ -81,6 +81,9 @@ inline MAKE_LOGGABLE(Schedule, schedule, os) {
 // Serializes a schedule to a protocol buffer.
 void ScheduleToProto(proto::Schedule* pb, const Schedule& schedule);
 
+// Deserializes a schedule from a protocol buffer produced by ScheduleToProto.
+Schedule ScheduleFromProto(const proto::Schedule& pb);
+
 }  // namespace schedule
 }  // namespace tile
 }  // namespace vertexai
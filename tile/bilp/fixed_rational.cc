@@ -0,0 +1,78 @@
+#include "tile/bilp/fixed_rational.h"
+
+namespace vertexai {
+namespace tile {
+namespace bilp {
+
+FixedRational::FixedRational(const math::Rational& value) {
+  const math::Integer& num = boost::multiprecision::numerator(value);
+  const math::Integer& den = boost::multiprecision::denominator(value);
+  if (num < -INT64_MAX || INT64_MAX < num || INT64_MAX < den) {
+    throw Overflow{};
+  }
+  // Rationals are kept in reduced form, with a positive denominator.
+  num_ = static_cast<std::int64_t>(num);
+  den_ = static_cast<std::int64_t>(den);
+}
+
+std::string FixedRational::str() const {
+  if (den_ == 1) {
+    return std::to_string(num_);
+  }
+  return std::to_string(num_) + "/" + std::to_string(den_);
+}
+
+FixedRational Floor(const FixedRational& x) {
+  std::int64_t quot = x.numerator() / x.denominator();
+  if (x.numerator() < 0 && quot * x.denominator() != x.numerator()) {
+    --quot;
+  }
+  return quot;
+}
+
+void FixedMatrix::multRow(size_t r, const FixedRational& multiplier) {
+  for (size_t i = 0; i < size2(); i++) {
+    (*this)(r, i) *= multiplier;
+  }
+}
+
+void FixedMatrix::addRowMultToRow(size_t dest_row, size_t src_row, const FixedRational& multiplier) {
+  if (multiplier != 0) {
+    for (size_t i = 0; i < size2(); i++) {
+      const FixedRational& src = (*this)(src_row, i);
+      if (src != 0) {
+        (*this)(dest_row, i) += multiplier * src;
+      }
+    }
+  }
+}
+
+void FixedMatrix::makePivotAt(size_t row, size_t col) {
+  if ((*this)(row, col) == 0) {
+    throw std::runtime_error("Cannot pivot matrix at entry containing 0");
+  }
+  for (size_t r = 0; r < size1(); ++r) {
+    if (r == row) {
+      continue;
+    }
+    addRowMultToRow(r, row, -(*this)(r, col) / (*this)(row, col));
+  }
+  multRow(row, 1 / (*this)(row, col));
+}
+
+std::string FixedMatrix::toString() const {
+  std::string ret;
+  ret += "\n";
+  for (size_t i = 0; i < size1(); ++i) {
+    ret += "[ ";
+    for (size_t j = 0; j < size2(); ++j) {
+      ret += (*this)(i, j).str() + "\t";
+    }
+    ret += "]\n";
+  }
+  return ret;
+}
+
+}  // namespace bilp
+}  // namespace tile
+}  // namespace vertexai
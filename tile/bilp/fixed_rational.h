@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include "tile/math/bignum.h"
+
+namespace vertexai {
+namespace tile {
+namespace bilp {
+
+#if defined(__SIZEOF_INT128__)
+typedef __int128 WideInt;
+#else
+typedef boost::multiprecision::int128_t WideInt;
+#endif
+
+// A rational number whose numerator and denominator fit in 64 bits.
+//
+// The ILP solver first runs each problem using these, since the systems built
+// from Tile contractions almost always have small coefficients.  Intermediate
+// values are computed in 128 bits and then reduced; any result which doesn't
+// fit throws FixedRational::Overflow, upon which the solver restarts the
+// problem using math::Rational.
+class FixedRational {
+ public:
+  struct Overflow : std::overflow_error {
+    Overflow() : std::overflow_error{"FixedRational overflow"} {}
+  };
+
+  FixedRational() {}
+  // clang-format off
+  //cppcheck-suppress noExplicitConstructor  // NOLINT
+  FixedRational(std::int64_t value) : num_{Check(value)} {}  // NOLINT
+  // clang-format on
+  explicit FixedRational(const math::Rational& value);
+
+  std::int64_t numerator() const { return num_; }
+  std::int64_t denominator() const { return den_; }
+  math::Rational ToRational() const { return math::Rational(num_, den_); }
+  std::string str() const;
+
+  FixedRational operator-() const { return FixedRational{-num_, den_}; }
+  FixedRational& operator+=(const FixedRational& rhs) { return *this = *this + rhs; }
+  FixedRational& operator-=(const FixedRational& rhs) { return *this = *this - rhs; }
+  FixedRational& operator*=(const FixedRational& rhs) { return *this = *this * rhs; }
+  FixedRational& operator/=(const FixedRational& rhs) { return *this = *this / rhs; }
+
+  friend FixedRational operator+(const FixedRational& lhs, const FixedRational& rhs) {
+    if (lhs.den_ == rhs.den_) {
+      return Make(WideInt(lhs.num_) + rhs.num_, lhs.den_);
+    }
+    return Make(WideInt(lhs.num_) * rhs.den_ + WideInt(rhs.num_) * lhs.den_, WideInt(lhs.den_) * rhs.den_);
+  }
+
+  friend FixedRational operator-(const FixedRational& lhs, const FixedRational& rhs) { return lhs + -rhs; }
+
+  friend FixedRational operator*(const FixedRational& lhs, const FixedRational& rhs) {
+    return Make(WideInt(lhs.num_) * rhs.num_, WideInt(lhs.den_) * rhs.den_);
+  }
+
+  friend FixedRational operator/(const FixedRational& lhs, const FixedRational& rhs) {
+    if (rhs.num_ == 0) {
+      // Let the bignum path report the error.
+      throw Overflow{};
+    }
+    return Make(WideInt(lhs.num_) * rhs.den_, WideInt(lhs.den_) * rhs.num_);
+  }
+
+  // Values are always reduced, so equal values have equal representations.
+  friend bool operator==(const FixedRational& lhs, const FixedRational& rhs) {
+    return lhs.num_ == rhs.num_ && lhs.den_ == rhs.den_;
+  }
+  friend bool operator!=(const FixedRational& lhs, const FixedRational& rhs) { return !(lhs == rhs); }
+  friend bool operator<(const FixedRational& lhs, const FixedRational& rhs) {
+    return WideInt(lhs.num_) * rhs.den_ < WideInt(rhs.num_) * lhs.den_;
+  }
+  friend bool operator>(const FixedRational& lhs, const FixedRational& rhs) { return rhs < lhs; }
+  friend bool operator<=(const FixedRational& lhs, const FixedRational& rhs) { return !(rhs < lhs); }
+  friend bool operator>=(const FixedRational& lhs, const FixedRational& rhs) { return !(lhs < rhs); }
+
+  // The greatest integer less than or equal to x.  N.B. This is only found by argument-dependent lookup, so that
+  // Floor of an integer (e.g. in code using both this namespace and math) isn't ambiguous.
+  friend FixedRational Floor(const FixedRational& x);
+
+ private:
+  FixedRational(std::int64_t num, std::int64_t den) : num_{num}, den_{den} {}
+
+  // N.B. INT64_MIN is excluded, so that negation can't overflow, and so that
+  // the product of two values always fits in 127 bits.
+  static std::int64_t Check(WideInt value) {
+    if (value < -INT64_MAX || INT64_MAX < value) {
+      throw Overflow{};
+    }
+    return static_cast<std::int64_t>(value);
+  }
+
+  static WideInt Gcd(WideInt a, WideInt b) {
+    while (b != 0) {
+      WideInt t = a % b;
+      a = b;
+      b = t;
+    }
+    return a;
+  }
+
+  // Builds the reduced form of num / den, for den != 0.
+  static FixedRational Make(WideInt num, WideInt den) {
+    if (den < 0) {
+      num = -num;
+      den = -den;
+    }
+    if (den != 1) {
+      WideInt gcd = Gcd(num < 0 ? WideInt(-num) : num, den);
+      if (gcd > 1) {
+        num /= gcd;
+        den /= gcd;
+      }
+    }
+    return FixedRational{Check(num), Check(den)};
+  }
+
+  std::int64_t num_ = 0;
+  std::int64_t den_ = 1;
+};
+
+using math::Floor;
+
+inline std::ostream& operator<<(std::ostream& os, const FixedRational& x) { return os << x.str(); }
+
+inline math::Rational ToRational(const FixedRational& x) { return x.ToRational(); }
+inline math::Rational ToRational(const math::Rational& x) { return x; }
+
+// A dense matrix of FixedRationals, providing the row operations the simplex
+// tableau uses from math::Matrix.
+class FixedMatrix {
+ public:
+  typedef FixedRational value_type;
+  typedef std::size_t size_type;
+
+  FixedMatrix() {}
+  FixedMatrix(size_type size1, size_type size2) : size1_{size1}, size2_{size2}, data_(size1 * size2) {}
+
+  size_type size1() const { return size1_; }
+  size_type size2() const { return size2_; }
+  FixedRational& operator()(size_type i, size_type j) { return data_[i * size2_ + j]; }
+  const FixedRational& operator()(size_type i, size_type j) const { return data_[i * size2_ + j]; }
+
+  void multRow(size_t r, const FixedRational& multiplier);
+  void addRowMultToRow(size_t dest_row, size_t src_row, const FixedRational& multiplier);
+  void makePivotAt(size_t row, size_t col);
+  std::string toString() const;
+
+ private:
+  size_type size1_ = 0;
+  size_type size2_ = 0;
+  std::vector<FixedRational> data_;
+};
+
+}  // namespace bilp
+}  // namespace tile
+}  // namespace vertexai
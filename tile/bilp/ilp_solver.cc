@@ -1,11 +1,30 @@
 #include "tile/bilp/ilp_solver.h"
 
+#include <memory>
+#include <set>
+
+#include "tile/base/lru_cache.h"
+
 namespace vertexai {
 namespace tile {
 namespace bilp {
 
 using namespace math;  // NOLINT
 
+namespace {
+
+typedef std::map<Polynomial<Rational>, ILPResult> BatchResults;
+
+// The maximum number of distinct problems whose batch_solve results are kept.
+constexpr std::size_t kBatchCacheSize = 4096;
+
+ShardedLruCache<std::string, std::shared_ptr<const BatchResults>>& BatchCache() {
+  static ShardedLruCache<std::string, std::shared_ptr<const BatchResults>> cache{kBatchCacheSize};
+  return cache;
+}
+
+}  // namespace
+
 std::map<std::string, Rational> ILPSolver::reportSolution() const {
   std::vector<Rational> sym_soln = getSymbolicSolution();
   std::map<std::string, Rational> soln;
@@ -22,8 +41,39 @@ std::map<std::string, Rational> ILPSolver::reportSolution() const {
 
 std::map<Polynomial<Rational>, ILPResult> ILPSolver::batch_solve(const std::vector<RangeConstraint>& constraints,
                                                                  const std::vector<Polynomial<Rational>>& objectives) {
-  // Solve a batch of ILP problems, all with the same constraints but different objectives
-  Tableau t = makeStandardFormTableau(constraints);
+  // The same contraction shapes produce the same problems many times over.
+  // The constraints are keyed in the caller's order, since their order
+  // determines the tableau and hence which optimum is reported when there are
+  // several; the objectives are solved independently of one another, so they
+  // are keyed as a set.
+  std::set<Polynomial<Rational>> sorted_objectives(objectives.begin(), objectives.end());
+  std::string key = throw_infeasible ? "throw\n" : "nothrow\n";
+  for (const RangeConstraint& c : constraints) {
+    key += to_string(c) + "\n";
+  }
+  key += "minimize\n";
+  for (const Polynomial<Rational>& obj : sorted_objectives) {
+    key += obj.toString() + "\n";
+  }
+
+  std::shared_ptr<const BatchResults> results = BatchCache().Lookup(key, [&]() {
+    // Solve a batch of ILP problems, all with the same constraints but different objectives
+    std::vector<Polynomial<Rational>> unique_objectives(sorted_objectives.begin(), sorted_objectives.end());
+    Tableau t = makeStandardFormTableau(constraints);
+    try {
+      return std::make_shared<const BatchResults>(batch_solve(FixedTableau(t), unique_objectives));
+    } catch (const FixedRational::Overflow&) {
+      IVLOG(3, "ILPSolver::batch_solve overflowed fixed-width rationals; retrying with bignums");
+      return std::make_shared<const BatchResults>(batch_solve(t, unique_objectives));
+    }
+  });
+  return *results;
+}
+
+template <typename M>
+std::map<Polynomial<Rational>, ILPResult> ILPSolver::batch_solve(BasicTableau<M> t,
+                                                                 const std::vector<Polynomial<Rational>>& objectives) {
+  typedef typename BasicTableau<M>::Number Number;
   if (!t.convertToCanonicalForm()) {
     throw std::runtime_error("Unable to run ILPSolver::batch_solve: Feasible region empty.");
   }
@@ -36,16 +86,16 @@ std::map<Polynomial<Rational>, ILPResult> ILPSolver::batch_solve(const std::vect
     var_names_ = t.varNames();
 
     // Copy tableau for manipulation specific to the objective
-    Tableau specific_t = t;
+    BasicTableau<M> specific_t = t;
 
     // Set first row based on objective
     specific_t.mat()(0, 0) = 1;
     for (size_t i = 0; i < t.varNames().size(); ++i) {
       std::string var = t.varNames()[i];
       if (var.substr(var.size() - 4, 4) == "_pos") {
-        specific_t.mat()(0, i + 1) = -obj[var.substr(1, var.size() - 5)];
+        specific_t.mat()(0, i + 1) = Number(-obj[var.substr(1, var.size() - 5)]);
       } else if (var.substr(var.size() - 4, 4) == "_neg") {
-        specific_t.mat()(0, i + 1) = obj[var.substr(1, var.size() - 5)];
+        specific_t.mat()(0, i + 1) = Number(obj[var.substr(1, var.size() - 5)]);
       } else {
         // Do nothing: We're on a slack variable or other artificially added variable
       }
@@ -69,10 +119,17 @@ ILPResult ILPSolver::solve(const std::vector<RangeConstraint>& constraints, cons
     IVLOG(2, msg.str());
   }
   Tableau t = makeStandardFormTableau(constraints, objective);
-  return solve(t);
+  try {
+    FixedTableau fixed_t(t);
+    return solve(fixed_t);
+  } catch (const FixedRational::Overflow&) {
+    IVLOG(3, "ILPSolver::solve overflowed fixed-width rationals; retrying with bignums");
+    return solve(t);
+  }
 }
 
-ILPResult ILPSolver::solve(Tableau& tableau, bool already_canonical) {
+template <typename M>
+ILPResult ILPSolver::solve(BasicTableau<M>& tableau, bool already_canonical) {
   clean();
   var_names_ = tableau.varNames();
   IVLOG(5, "Starting ILPSolver with tableau " << tableau.mat().toString());
@@ -86,7 +143,9 @@ ILPResult ILPSolver::solve(Tableau& tableau, bool already_canonical) {
   return ILPResult(reportObjective(), reportSolution());
 }
 
-void ILPSolver::solve_step(Tableau& tableau, bool already_canonical) {
+template <typename M>
+void ILPSolver::solve_step(BasicTableau<M>& tableau, bool already_canonical) {
+  typedef typename BasicTableau<M>::Number Number;
   // Check feasible region exists for this subproblem
   if (!tableau.makeOptimal(already_canonical)) {
     // Feasible region empty (or unbounded), no solution from this branch
@@ -95,16 +154,16 @@ void ILPSolver::solve_step(Tableau& tableau, bool already_canonical) {
   }
 
   // Check the LP Relaxation objective value
-  Rational obj_val = tableau.reportObjectiveValue();
+  Number obj_val = tableau.reportObjectiveValue();
 
   // Check if this solution is integral
-  std::vector<Rational> soln = tableau.getSymbolicSolution();
+  std::vector<Number> soln = tableau.getSymbolicSolution();
 
   // Find the greatest fractional part
-  Rational greatest_fractional = 0;
+  Number greatest_fractional = 0;
   size_t greatest_fractional_row = 0;
   for (size_t i = 1; i < tableau.mat().size1(); ++i) {
-    Rational frac = tableau.mat()(i, tableau.mat().size2() - 1) - Floor(tableau.mat()(i, tableau.mat().size2() - 1));
+    Number frac = tableau.mat()(i, tableau.mat().size2() - 1) - Floor(tableau.mat()(i, tableau.mat().size2() - 1));
     if (frac > greatest_fractional) {
       greatest_fractional = frac;
       greatest_fractional_row = i;
@@ -125,8 +184,11 @@ void ILPSolver::solve_step(Tableau& tableau, bool already_canonical) {
       IVLOG(6, "  from tableau:" << tableau.mat().toString());
     }
     feasible_found = true;
-    best_objective = obj_val;
-    best_solution = soln;
+    best_objective = ToRational(obj_val);
+    best_solution.clear();
+    for (const Number& value : soln) {
+      best_solution.emplace_back(ToRational(value));
+    }
   } else {
     // This is a non-integer solution; cut
     if (VLOG_IS_ON(5)) {
@@ -142,19 +204,18 @@ void ILPSolver::solve_step(Tableau& tableau, bool already_canonical) {
     }
 
     IVLOG(5, "Requesting Gomory cut at row " << greatest_fractional_row << " with value " << greatest_fractional);
-    Tableau with_cut = addGomoryCut(tableau, greatest_fractional_row);
+    BasicTableau<M> with_cut = addGomoryCut(tableau, greatest_fractional_row);
     IVLOG(6, "Adding Gomory cut yielded: " << with_cut.mat().toString());
     solve_step(with_cut);
   }
 }
 
-Tableau ILPSolver::addGomoryCut(const Tableau& t, size_t row) {
+template <typename M>
+BasicTableau<M> ILPSolver::addGomoryCut(const BasicTableau<M>& t, size_t row) {
   IVLOG(6, "Adding Gomory cut along row " << row);
-  Tableau ret(t.mat().size1() + 1, t.mat().size2() + 1, t.varNames(), &t.getOpposites());
-  project(ret.mat(), range(0, t.mat().size1()), range(0, t.mat().size2() - 1)) =
-      project(t.mat(), range(0, t.mat().size1()), range(0, t.mat().size2() - 1));
-  project(ret.mat(), range(0, t.mat().size1()), range(t.mat().size2(), t.mat().size2() + 1)) =
-      project(t.mat(), range(0, t.mat().size1()), range(t.mat().size2() - 1, t.mat().size2()));
+  BasicTableau<M> ret(t.mat().size1() + 1, t.mat().size2() + 1, t.varNames(), &t.getOpposites());
+  CopyBlock(t.mat(), 0, 0, &ret.mat(), 0, 0, t.mat().size1(), t.mat().size2() - 1);
+  CopyBlock(t.mat(), 0, t.mat().size2() - 1, &ret.mat(), 0, t.mat().size2(), t.mat().size1(), 1);
   // Note: Assumes the uninitialized column was set to all 0s, which appears to
   // be an undocumented feature of ublas.
   for (size_t j = 0; j < t.mat().size2() - 1; ++j) {
@@ -270,6 +331,9 @@ void ILPSolver::clean() {
   var_names_.clear();
 }
 
+template ILPResult ILPSolver::solve(Tableau& tableau, bool already_canonical);
+template ILPResult ILPSolver::solve(FixedTableau& tableau, bool already_canonical);
+
 }  // namespace bilp
 }  // namespace tile
 }  // namespace vertexai
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "tile/bilp/tableau.h"
@@ -30,7 +31,9 @@ class ILPSolver {
   // every variable and every constraint value being an integer)
   ILPResult solve(const std::vector<math::RangeConstraint>& constraints,
                   const math::Polynomial<math::Rational> objective);
-  // Returns a solution for each objective, all subject to the same constraints
+  // Returns a solution for each objective, all subject to the same constraints.
+  // Results are memoized process-wide by the problem; a memoized result is the
+  // one an uncached solve of the same constraints, in the same order, reports.
   std::map<math::Polynomial<math::Rational>, ILPResult> batch_solve(
       const std::vector<math::RangeConstraint>& constraints,
       const std::vector<math::Polynomial<math::Rational>>& objectives);
@@ -42,6 +45,7 @@ class ILPSolver {
   FRIEND_TEST(BilpTest, SimpleOptimizeTest);
   FRIEND_TEST(BilpTest, OptimizeTest2D);
   FRIEND_TEST(BilpTest, TrivialILPTest);
+  FRIEND_TEST(BilpTest, BatchSolveTieBreakTest);
   bool feasible_found = false;
   bool throw_infeasible = true;
   math::Rational best_objective = 0;
@@ -49,7 +53,12 @@ class ILPSolver {
   std::vector<std::string> var_names_;
 
   // Solves a tableau representing an ILP problem
-  ILPResult solve(Tableau& tableau, bool already_canonical = false);  // NOLINT(runtime/references)
+  template <typename M>
+  ILPResult solve(BasicTableau<M>& tableau, bool already_canonical = false);  // NOLINT(runtime/references)
+  // Solves each objective subject to the constraints represented by a standard form tableau
+  template <typename M>
+  std::map<math::Polynomial<math::Rational>, ILPResult> batch_solve(
+      BasicTableau<M> tableau, const std::vector<math::Polynomial<math::Rational>>& objectives);
   // Reports the minimized value of the objective for last solved problem
   math::Rational reportObjective() const { return best_objective; }
   // Reports the variable values minimizing the objective for last solved problem
@@ -68,11 +77,13 @@ class ILPSolver {
       const math::Polynomial<math::Rational> objective = math::Polynomial<math::Rational>());
   // Add an additional constraint that reduces the real feasible region but that
   // leaves the integral feasible region unchanged
-  Tableau addGomoryCut(const Tableau& t, size_t row);
+  template <typename M>
+  BasicTableau<M> addGomoryCut(const BasicTableau<M>& t, size_t row);
 
   // Perform one step of the solve algorithm (i.e. either find an integer feasible
   // solution, or find a noninteger feasible solution, add a cut, and iterate)
-  void solve_step(Tableau& tableau, bool already_canonical = false);  // NOLINT(runtime/references)
+  template <typename M>
+  void solve_step(BasicTableau<M>& tableau, bool already_canonical = false);  // NOLINT(runtime/references)
 };
 
 }  // namespace bilp
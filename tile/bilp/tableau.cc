@@ -6,7 +6,9 @@ namespace bilp {
 
 using namespace math;  // NOLINT
 
-Tableau::Tableau(const Matrix& m, const std::vector<std::string>& var_names, const std::vector<size_t>* opposites)
+template <typename M>
+BasicTableau<M>::BasicTableau(const M& m, const std::vector<std::string>& var_names,
+                              const std::vector<size_t>* opposites)
     : matrix_(m), var_names_(var_names), opposites_(var_names.size(), 0) {
   if (opposites) {
     opposites_ = *opposites;
@@ -15,8 +17,9 @@ Tableau::Tableau(const Matrix& m, const std::vector<std::string>& var_names, con
   }
 }
 
-Tableau::Tableau(Matrix::size_type size1, Matrix::size_type size2, const std::vector<std::string>& var_names,
-                 const std::vector<size_t>* opposites)
+template <typename M>
+BasicTableau<M>::BasicTableau(typename M::size_type size1, typename M::size_type size2,
+                              const std::vector<std::string>& var_names, const std::vector<size_t>* opposites)
     : matrix_(size1, size2), var_names_(var_names), opposites_(var_names.size(), 0) {
   if (opposites) {
     opposites_ = *opposites;
@@ -25,11 +28,32 @@ Tableau::Tableau(Matrix::size_type size1, Matrix::size_type size2, const std::ve
   }
 }
 
-RowToColLookup Tableau::basicVars() const { return basic_vars_; }
+template <typename M>
+template <typename Other>
+BasicTableau<M>::BasicTableau(const BasicTableau<Other>& other)
+    : matrix_(other.mat().size1(), other.mat().size2()),
+      var_names_(other.varNames()),
+      basic_vars_(other.basicVars()),
+      opposites_(other.getOpposites()) {
+  for (size_t i = 0; i < matrix_.size1(); ++i) {
+    for (size_t j = 0; j < matrix_.size2(); ++j) {
+      matrix_(i, j) = Number(other.mat()(i, j));
+    }
+  }
+}
+
+template <typename M>
+RowToColLookup BasicTableau<M>::basicVars() const {
+  return basic_vars_;
+}
 
-std::vector<std::string> Tableau::varNames() const { return var_names_; }
+template <typename M>
+std::vector<std::string> BasicTableau<M>::varNames() const {
+  return var_names_;
+}
 
-void Tableau::buildOppositesFromNames() {
+template <typename M>
+void BasicTableau<M>::buildOppositesFromNames() {
   for (size_t i = 0; i < var_names_.size(); ++i) {
     if (var_names_[i].substr(var_names_[i].length() - 4, 4) == "_pos" && var_names_[i][0] == '_') {
       for (size_t j = i + 1; j < var_names_.size(); ++j) {
@@ -51,8 +75,9 @@ void Tableau::buildOppositesFromNames() {
   }
 }
 
-bool Tableau::convertToCanonicalForm() {
-  Tableau phase1(mat().size1(), mat().size2() + mat().size1(), var_names_, &opposites_);
+template <typename M>
+bool BasicTableau<M>::convertToCanonicalForm() {
+  BasicTableau phase1(mat().size1(), mat().size2() + mat().size1(), var_names_, &opposites_);
   phase1.mat()(0, 0) = 1;
 
   // Put the size1() - 1 artificial variables in columns 1 through size1() - 1
@@ -62,8 +87,7 @@ bool Tableau::convertToCanonicalForm() {
   }
 
   // Copy in original tableau (minus objective row)
-  project(phase1.mat(), range(1, phase1.mat().size1()), range(mat().size1(), phase1.mat().size2())) =
-      project(mat(), range(1, mat().size1()), range(0, mat().size2()));
+  CopyBlock(mat(), 1, 0, &phase1.mat(), 1, mat().size1(), mat().size1() - 1, mat().size2());
 
   phase1.selectBasicVars();
   phase1.priceOut();
@@ -71,7 +95,7 @@ bool Tableau::convertToCanonicalForm() {
     throw std::runtime_error(
         "Unable to convert LP tableau to canonical form, likely due to unbounded feasible region.");
   }
-  Rational optimum = phase1.mat()(0, phase1.mat().size2() - 1);
+  Number optimum = phase1.mat()(0, phase1.mat().size2() - 1);
   if (optimum == 0) {
     // Ensure no artificial variables remain basic
     bool has_artificial_basic = true;  // Test at least once
@@ -98,8 +122,7 @@ bool Tableau::convertToCanonicalForm() {
     }
 
     // Set current tableau to found canonical form
-    project(mat(), range(1, mat().size1()), range(0, mat().size2())) =
-        project(phase1.mat(), range(1, phase1.mat().size1()), range(mat().size1(), phase1.mat().size2()));
+    CopyBlock(phase1.mat(), 1, mat().size1(), &mat(), 1, 0, mat().size1() - 1, mat().size2());
 
     // Set basic variables
     selectBasicVars();
@@ -115,7 +138,8 @@ bool Tableau::convertToCanonicalForm() {
   }
 }
 
-bool Tableau::makeOptimal(bool already_canonical) {
+template <typename M>
+bool BasicTableau<M>::makeOptimal(bool already_canonical) {
   // Convert to an equivalent tableau giving optimal real solution
   if (!already_canonical) {
     if (!convertToCanonicalForm()) {
@@ -125,7 +149,7 @@ bool Tableau::makeOptimal(bool already_canonical) {
   }
 
   // Select pivot col
-  Rational max_obj_coeff = 0;  // If the max is <= 0, we're done, so feel free to start there
+  Number max_obj_coeff = 0;  // If the max is <= 0, we're done, so feel free to start there
   size_t max_obj_col = 0;      // 0 is not a valid column, so ok to start at this
 
   std::set<size_t> nonbasic_cols;
@@ -137,7 +161,7 @@ bool Tableau::makeOptimal(bool already_canonical) {
   }
   for (const size_t& j : nonbasic_cols) {
     // Skipping the first and last columns which aren't variables
-    Rational curr_coeff = mat()(0, j);
+    Number curr_coeff = mat()(0, j);
     if (max_obj_coeff < curr_coeff) {
       max_obj_coeff = curr_coeff;
       max_obj_col = j;
@@ -149,7 +173,7 @@ bool Tableau::makeOptimal(bool already_canonical) {
   }
 
   // Select pivot row
-  Rational min_pivot_ratio = 0;  // Will separately initialize when first used
+  Number min_pivot_ratio = 0;  // Will separately initialize when first used
   size_t min_pivot_row = 0;      // 0 is not a valid row, so ok to start at this
   for (size_t i = 1; i < mat().size1(); ++i) {
     // Skipping the first row which isn't a constraint
@@ -159,7 +183,7 @@ bool Tableau::makeOptimal(bool already_canonical) {
         min_pivot_row = i;
         min_pivot_ratio = mat()(i, mat().size2() - 1) / mat()(i, max_obj_col);
       } else {
-        Rational ratio = mat()(i, mat().size2() - 1) / mat()(i, max_obj_col);
+        Number ratio = mat()(i, mat().size2() - 1) / mat()(i, max_obj_col);
         if (ratio < min_pivot_ratio) {
           min_pivot_row = i;
           min_pivot_ratio = ratio;
@@ -178,7 +202,8 @@ bool Tableau::makeOptimal(bool already_canonical) {
   return makeOptimal(true);
 }
 
-void Tableau::selectBasicVars() {
+template <typename M>
+void BasicTableau<M>::selectBasicVars() {
   // Makes basic_vars_ a map pointing from each row (other than 1st) to the basic var column for it
   basic_vars_ = RowToColLookup();  // Start from scratch
   if (mat().size1() - 1 == 0) {
@@ -193,7 +218,7 @@ void Tableau::selectBasicVars() {
     bool is_basic = true;
     for (size_t i = 1; i < mat().size1(); ++i) {
       // Ok if objective is nonzero, but will need to price out later, so start at 1
-      Rational entry = mat()(i, j);
+      Number entry = mat()(i, j);
       if (entry == 1) {
         if (row_with_1 == 0) {
           row_with_1 = i;
@@ -231,14 +256,16 @@ void Tableau::selectBasicVars() {
                            std::to_string(mat().size1() - 1) + ").");
 }
 
-void Tableau::priceOut() {
+template <typename M>
+void BasicTableau<M>::priceOut() {
   for (const auto& kvp : basic_vars_) {
     mat().addRowMultToRow(0, kvp.first, -mat()(0, kvp.second) / mat()(kvp.first, kvp.second));
   }
 }
 
-std::vector<Rational> Tableau::getSymbolicSolution() const {
-  std::vector<Rational> soln(var_names_.size(), 0);
+template <typename M>
+std::vector<typename M::value_type> BasicTableau<M>::getSymbolicSolution() const {
+  std::vector<Number> soln(var_names_.size(), 0);
   for (const auto& kvp : basic_vars_) {
     if (kvp.second <= var_names_.size()) {
       soln[kvp.second - 1] = mat()(kvp.first, mat().size2() - 1);
@@ -247,7 +274,14 @@ std::vector<Rational> Tableau::getSymbolicSolution() const {
   return soln;
 }
 
-Rational Tableau::reportObjectiveValue() const { return mat()(0, mat().size2() - 1); }
+template <typename M>
+typename M::value_type BasicTableau<M>::reportObjectiveValue() const {
+  return mat()(0, mat().size2() - 1);
+}
+
+template class BasicTableau<Matrix>;
+template class BasicTableau<FixedMatrix>;
+template BasicTableau<FixedMatrix>::BasicTableau(const BasicTableau<Matrix>& other);
 
 }  // namespace bilp
 }  // namespace tile
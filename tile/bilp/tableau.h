@@ -9,6 +9,7 @@
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 #include <boost/numeric/ublas/vector.hpp>
 
+#include "tile/bilp/fixed_rational.h"
 #include "tile/math/matrix.h"
 
 namespace vertexai {
@@ -19,18 +20,36 @@ using boost::numeric::ublas::range;
 
 typedef std::map<size_t, size_t> RowToColLookup;
 
-class Tableau {
+// Copies the rows x cols block of src at (src_row, src_col) into dest at (dest_row, dest_col)
+template <typename M>
+void CopyBlock(const M& src, size_t src_row, size_t src_col, M* dest, size_t dest_row, size_t dest_col, size_t rows,
+               size_t cols) {
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      (*dest)(dest_row + i, dest_col + j) = src(src_row + i, src_col + j);
+    }
+  }
+}
+
+// A simplex tableau over a matrix type M, which is either math::Matrix or
+// FixedMatrix (for the solver's fixed-width fast path).
+template <typename M>
+class BasicTableau {
  public:
+  typedef typename M::value_type Number;
+
   // Construct a Tableau initialized to a matrix
-  Tableau(const math::Matrix& m, const std::vector<std::string>& var_names,
-          const std::vector<size_t>* opposites = nullptr);
+  BasicTableau(const M& m, const std::vector<std::string>& var_names, const std::vector<size_t>* opposites = nullptr);
   // Construct an empty Tableau of dimension size1 x size2
-  Tableau(math::Matrix::size_type size1, math::Matrix::size_type size2, const std::vector<std::string>& var_names,
-          const std::vector<size_t>* opposites = nullptr);
+  BasicTableau(typename M::size_type size1, typename M::size_type size2, const std::vector<std::string>& var_names,
+               const std::vector<size_t>* opposites = nullptr);
+  // Construct a copy of a Tableau over another number type; throws FixedRational::Overflow if an entry doesn't fit
+  template <typename Other>
+  explicit BasicTableau(const BasicTableau<Other>& other);
   // Accessors
   // Don't use resize or swap on mat(); the other parts of Tableau won't recognize this and will fail
-  const math::Matrix& mat() const { return matrix_; }
-  math::Matrix& mat() { return matrix_; }
+  const M& mat() const { return matrix_; }
+  M& mat() { return matrix_; }
   RowToColLookup basicVars() const;
   std::vector<std::string> varNames() const;
   const std::vector<size_t>& getOpposites() const { return opposites_; }
@@ -50,12 +69,12 @@ class Tableau {
   // Solution reporting functions. These report based on the current state of the
   // tableau, so if it hasn't been solved they are likely meaningless
   // Returns the coefficients of the solution in the order of varNames()
-  std::vector<math::Rational> getSymbolicSolution() const;
+  std::vector<Number> getSymbolicSolution() const;
   // Returns the minimal value the objective can take in the feasible region
-  math::Rational reportObjectiveValue() const;
+  Number reportObjectiveValue() const;
 
  protected:
-  math::Matrix matrix_;
+  M matrix_;
 
  private:
   std::vector<std::string> var_names_;
@@ -65,6 +84,12 @@ class Tableau {
   void buildOppositesFromNames();
 };
 
+typedef BasicTableau<math::Matrix> Tableau;
+typedef BasicTableau<FixedMatrix> FixedTableau;
+
+extern template class BasicTableau<math::Matrix>;
+extern template class BasicTableau<FixedMatrix>;
+
 }  // namespace bilp
 }  // namespace tile
 }  // namespace vertexai
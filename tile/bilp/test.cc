@@ -1,6 +1,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 #include "tile/bilp/ilp_solver.h"
 #include "tile/math/bignum.h"
 
@@ -180,6 +182,85 @@ TEST(BilpTest, Subdivision1D) {
   EXPECT_EQ(res[-Polynomial<Rational>("k_0")].obj_val, -2);
 }
 
+TEST(BilpTest, FixedRationalTest) {
+  FixedRational a = FixedRational(Rational(3, 4));
+  FixedRational b = FixedRational(Rational(-5, 6));
+  EXPECT_EQ((a + b).ToRational(), Rational(-1, 12));
+  EXPECT_EQ((a * b).ToRational(), Rational(-5, 8));
+  EXPECT_EQ((a / b).ToRational(), Rational(-9, 10));
+  EXPECT_EQ(Floor(b), -1);
+  EXPECT_LT(b, a);
+
+  FixedRational big = INT64_MAX;
+  EXPECT_THROW(big + 1, FixedRational::Overflow);
+  EXPECT_THROW(big * 2, FixedRational::Overflow);
+  EXPECT_THROW(FixedRational(Rational(1, 3) / INT64_MAX), FixedRational::Overflow);
+}
+
+TEST(BilpTest, OverflowFallbackTest) {
+  // The optimal objective value doesn't fit in 64 bits, so this must be
+  // solved on the bignum path.
+  std::vector<RangeConstraint> constraints;
+  constraints.emplace_back(Polynomial<Rational>("x") + 5, 10);
+  constraints.emplace_back(3 * Polynomial<Rational>("x") + Polynomial<Rational>("y"), 7);
+  Polynomial<Rational> obj = Rational(INT64_MAX) * (Polynomial<Rational>("x") + Polynomial<Rational>("y"));
+  ILPSolver solver;
+  ILPResult res = solver.solve(constraints, obj);
+
+  EXPECT_EQ(res.soln["x"], 4);
+  EXPECT_EQ(res.soln["y"], -12);
+  EXPECT_EQ(res.obj_val, -8 * Rational(INT64_MAX));
+
+  std::map<Polynomial<Rational>, ILPResult> batch = solver.batch_solve(constraints, {obj});
+  EXPECT_EQ(batch[obj].obj_val, -8 * Rational(INT64_MAX));
+}
+
+TEST(BilpTest, BatchSolveReorderedTest) {
+  std::vector<RangeConstraint> constraints;
+  constraints.emplace_back(Polynomial<Rational>("i_0") + 2 * Polynomial<Rational>("k_0"), 5);
+  constraints.emplace_back(Polynomial<Rational>("i_0"), 2);
+  constraints.emplace_back(Polynomial<Rational>("i_0") + 2 * Polynomial<Rational>("i_1"), 70);
+  std::vector<Polynomial<Rational>> objectives{-Polynomial<Rational>("i_1"), Polynomial<Rational>("k_0")};
+  ILPSolver solver;
+  std::map<Polynomial<Rational>, ILPResult> res = solver.batch_solve(constraints, objectives);
+
+  // The same problem, stated in a different order (with a repeated constraint)
+  std::vector<RangeConstraint> reordered{constraints[2], constraints[1], constraints[0], constraints[1]};
+  std::vector<Polynomial<Rational>> reordered_objectives{objectives[1], objectives[0]};
+  std::map<Polynomial<Rational>, ILPResult> res2 = solver.batch_solve(reordered, reordered_objectives);
+
+  ASSERT_EQ(res.size(), 2u);
+  ASSERT_EQ(res2.size(), 2u);
+  for (const auto& obj : objectives) {
+    EXPECT_EQ(res[obj].obj_val, res2[obj].obj_val);
+  }
+  EXPECT_EQ(res[-Polynomial<Rational>("i_1")].obj_val, -34);
+  EXPECT_EQ(res[Polynomial<Rational>("k_0")].obj_val, 0);
+}
+
+TEST(BilpTest, BatchSolveTieBreakTest) {
+  // Every split of x + y = 3 is optimal; the memoized result must be the one
+  // an uncached solve reports, whichever order the constraints come in.
+  Polynomial<Rational> x("x"), y("y");
+  std::vector<RangeConstraint> constraints{{x, 4}, {y, 4}, {x + y, 4}};
+  Polynomial<Rational> obj = -x - y;
+  std::sort(constraints.begin(), constraints.end(),
+            [](const RangeConstraint& a, const RangeConstraint& b) { return to_string(a) < to_string(b); });
+  do {
+    ILPSolver uncached;
+    ILPResult expected = uncached.batch_solve(uncached.makeStandardFormTableau(constraints), {obj})[obj];
+    EXPECT_EQ(expected.obj_val, -3);
+    for (int i = 0; i < 2; ++i) {
+      ILPSolver solver;
+      ILPResult res = solver.batch_solve(constraints, {obj, obj})[obj];
+      EXPECT_EQ(res.obj_val, expected.obj_val);
+      EXPECT_EQ(res.soln, expected.soln);
+    }
+  } while (std::next_permutation(
+      constraints.begin(), constraints.end(),
+      [](const RangeConstraint& a, const RangeConstraint& b) { return to_string(a) < to_string(b); }));
+}
+
 TEST(MilpTest, RandomConstraintsTest) {
   const int varSize = 8;
   for (size_t test_count = 0; test_count < 20; ++test_count) {
@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "base/util/lookup.h"
+#include "tile/codegen/parallel.h"
 #include "tile/stripe/stripe.h"
 
 namespace vertexai {
@@ -99,6 +100,7 @@ void RunOnBlocksRecurse(const AliasMap& map, stripe::Block* block, const stripe:
                         bool rec_func) {
   bool run_func = block->has_tags(reqs) || reqs.count("all") > 0;
   if (run_func) {
+    block->mark_dirty();
     func(map, block);
   }
   if (!run_func || rec_func) {
@@ -119,6 +121,50 @@ void RunOnBlocks(stripe::Block* root, const stripe::Tags& reqs, const F& func, b
   RunOnBlocksRecurse(root_map, root, reqs, func, rec_func);
 }
 
+// The AliasMap depth down to which RunOnBlocksParallel processes sibling blocks
+// concurrently: the program block (depth 1) and its main block (depth 2), so
+// that the kernels within main run in parallel.
+constexpr size_t kParallelBlockDepth = 2;
+
+template <typename F>
+void RunOnBlocksParallelRecurse(const AliasMap& map, stripe::Block* block, const stripe::Tags& reqs, const F& func,
+                                bool rec_func) {
+  if (kParallelBlockDepth < map.depth()) {
+    RunOnBlocksRecurse(map, block, reqs, func, rec_func);
+    return;
+  }
+  bool run_func = block->has_tags(reqs) || reqs.count("all") > 0;
+  if (run_func) {
+    block->mark_dirty();
+    func(map, block);
+  }
+  if (!run_func || rec_func) {
+    std::vector<stripe::Block*> inners;
+    for (auto& stmt : block->stmts) {
+      auto inner = stripe::Block::Downcast(stmt);
+      if (inner) {
+        inners.push_back(inner.get());
+      }
+    }
+    ParallelFor(inners.size(), [&](size_t i) {
+      AliasMap inner_map(map, inners[i]);
+      RunOnBlocksParallelRecurse(inner_map, inners[i], reqs, func, rec_func);
+    });
+  }
+}
+
+// Like RunOnBlocks, but sibling blocks near the root are processed on the
+// codegen thread pool, each with its own AliasMap.  This is only for passes
+// whose func reads and modifies nothing outside the subtree of the block it's
+// given (other than through the AliasMap), and which is safe to call from
+// several threads at once.
+template <typename F>
+void RunOnBlocksParallel(stripe::Block* root, const stripe::Tags& reqs, const F& func, bool rec_func = false) {
+  AliasMap base;
+  AliasMap root_map(base, root);
+  RunOnBlocksParallelRecurse(root_map, root, reqs, func, rec_func);
+}
+
 std::ostream& operator<<(std::ostream& os, const AliasInfo& ai);
 std::ostream& operator<<(std::ostream& os, const Extent& extent);
 
@@ -3,11 +3,15 @@
 #include "tile/codegen/autotile.h"
 
 #include <algorithm>
+#include <atomic>
+#include <sstream>
 
 #include "base/util/logging.h"
 #include "base/util/stream_container.h"
 #include "base/util/throw.h"
+#include "tile/base/lru_cache.h"
 #include "tile/codegen/alias.h"
+#include "tile/codegen/parallel.h"
 #include "tile/codegen/tile.h"
 #include "tile/math/util.h"
 #include "tile/stripe/stripe.h"
@@ -326,6 +330,8 @@ boost::optional<TileResult> PickBestTile(const Block& block, bool only_po2, bool
     cost = it->first;
     tile = it->second;
     state.todo.erase(*it);
+    // Gather the unexplored neighbors of this tile, then cost them in parallel
+    std::vector<Tile> candidates;
     for (size_t i = 0; i < block.idxs.size(); i++) {
       if (!model.IndexFilter(block, block.idxs[i])) {
         continue;
@@ -350,20 +356,93 @@ boost::optional<TileResult> PickBestTile(const Block& block, bool only_po2, bool
         tile.set(i, prev.size + 1, block.idxs[i].range);
       }
       if (!state.found_tiles.count(tile)) {
-        cost = model.ComputeCost(block, tile);
-        state.AddTile(tile, cost);
+        candidates.push_back(tile);
       }
       tile.dims[i] = prev;
     }
+    std::vector<Cost> costs(candidates.size(), Cost::Stop);
+    ParallelFor(candidates.size(), [&](size_t i) { costs[i] = model.ComputeCost(block, candidates[i]); });
+    // Record the results in order, so the search is independent of thread timing
+    for (size_t i = 0; i < candidates.size(); i++) {
+      cost = costs[i];
+      state.AddTile(candidates[i], cost);
+    }
   }
   return state.best_so_far;
 }
 
+// Tile search results, shared by all blocks with the same signature.
+typedef ShardedLruCache<std::string, boost::optional<TileResult>> TileSearchCache;
+
+constexpr std::size_t kTileSearchCacheSize = 4096;
+
+TileSearchCache* SearchCache() {
+  static TileSearchCache cache{kTileSearchCacheSize};
+  return &cache;
+}
+
+// Returns a key capturing everything the tile search over a block depends on:
+// the index names and ranges, and the direction, location, access and shape of
+// each refinement.  Refinement names don't affect the search, so blocks which
+// differ only in the buffers they touch share a signature.
+std::string BlockSignature(const Block& block) {
+  std::ostringstream os;
+  for (const auto& idx : block.idxs) {
+    os << idx.name << ":" << idx.range << " ";
+  }
+  std::vector<std::string> refs;
+  for (const auto& ref : block.refs) {
+    std::ostringstream ref_os;
+    ref_os << "\n" << static_cast<int>(ref.dir) << " " << ref.location << " " << StreamContainer(ref.access) << " "
+           << ref.interior_shape << " " << ref.interior_shape.codec;
+    refs.emplace_back(ref_os.str());
+  }
+  std::sort(refs.begin(), refs.end());
+  for (const auto& ref : refs) {
+    os << ref;
+  }
+  return os.str();
+}
+
+// Counts tile search memo lookups over one pass application.
+struct SearchStats {
+  std::atomic<size_t> lookups{0};
+  std::atomic<size_t> hits{0};
+};
+
+// Runs PickBestTile, or reuses the result of an earlier search over a block with
+// the same signature.  The prefix identifies the cost model and its options.
+template <typename CostModel>
+boost::optional<TileResult> MemoizedPickBestTile(const std::string& prefix, SearchStats* stats, const Block& block,
+                                                 bool only_po2, bool only_even, bool only_multiple_of_32, bool is_fast,
+                                                 const CostModel& model) {
+  bool searched = false;
+  auto result = SearchCache()->Lookup(prefix + BlockSignature(block), [&]() {
+    searched = true;
+    return PickBestTile(block, only_po2, only_even, only_multiple_of_32, is_fast, model);
+  });
+  stats->lookups++;
+  if (!searched) {
+    stats->hits++;
+    IVLOG(3, "Autotile> PickBestTile> block: " << block.name << " reused an earlier search");
+  }
+  return result;
+}
+
+void LogSearchStats(const char* pass, const SearchStats& stats) {
+  if (stats.lookups) {
+    IVLOG(1, pass << "> tile search memo: " << stats.hits << " hits / " << stats.lookups << " lookups ("
+                  << 100 * stats.hits / stats.lookups << "%)");
+  }
+}
+
 }  // namespace
 
 void AutotilePass::Apply(Block* root) const {
   auto reqs = FromProto(options_.reqs());
-  RunOnBlocks(root, reqs, [this](const AliasMap& map, Block* block) {
+  std::string prefix = "autotile\n" + options_.SerializeAsString() + "\n";
+  SearchStats stats;
+  RunOnBlocksParallel(root, reqs, [&](const AliasMap& map, Block* block) {
     if (block->has_tag("cache")) {
       for (const auto& ref : block->refs) {
         if (IsWriteDir(ref.dir) && ref.location.devs[0].name == "REGISTER") {
@@ -373,8 +452,8 @@ void AutotilePass::Apply(Block* root) const {
       }
     }
     ComputeDensityCostModel model(*block, options_);
-    auto result = PickBestTile(*block, options_.only_po2(), options_.only_even(), options_.only_multiple_of_32(),
-                               options_.fast(), model);
+    auto result = MemoizedPickBestTile(prefix, &stats, *block, options_.only_po2(), options_.only_even(),
+                                       options_.only_multiple_of_32(), options_.fast(), model);
     if (result) {
       IVLOG(2, "Autotile> block: " << block->name << ", tile: " << result->tile << ", cost: " << result->cost);
       const TileShape& tiling_shape = options_.flip() ? result->tile.counts() : result->tile.sizes();
@@ -397,13 +476,17 @@ void AutotilePass::Apply(Block* root) const {
       LOG(WARNING) << "Autotile> block: " << block->name << " was NOT split; unable to find a valid tiling";
     }
   });
+  LogSearchStats("Autotile", stats);
 }
 
 void PartitionComputePass::Apply(stripe::Block* root) const {
   auto reqs = FromProto(options_.reqs());
-  RunOnBlocks(root, reqs, [this](const AliasMap& map, Block* block) {
+  std::string prefix = "partition\n" + options_.SerializeAsString() + "\n";
+  SearchStats stats;
+  RunOnBlocksParallel(root, reqs, [&](const AliasMap& map, Block* block) {
     PartitionComputeCostModel model(*block, options_);
-    auto result = PickBestTile(*block, false, false, options_.only_multiple_of_32(), false, model);
+    auto result =
+        MemoizedPickBestTile(prefix, &stats, *block, false, false, options_.only_multiple_of_32(), false, model);
     if (result) {
       IVLOG(2, "PartitionCompute> block: " << block->name                 //
                                            << ", tile: " << result->tile  //
@@ -425,6 +508,7 @@ void PartitionComputePass::Apply(stripe::Block* root) const {
       }
     }
   });
+  LogSearchStats("PartitionCompute", stats);
 }
 
 namespace {
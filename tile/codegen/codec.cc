@@ -19,6 +19,7 @@ void AssignCodec(Block* block, const Tags& datatypes, const std::string& codec)
     if (datatypes.count(ref_type)) {
       IVLOG(2, "    ref: " << ref.into());
       ref.mut().interior_shape.codec = codec;
+      block->mark_dirty();
     }
   }
   for (auto stmt : block->stmts) {
@@ -13,7 +13,11 @@ namespace tile {
 namespace codegen {
 
 // A CompilePass applies an arbitrary transformation to a Stripe
-// program, rewriting it in place.
+// program, rewriting it in place.  Passes report what they rewrote by
+// marking the affected blocks dirty (see stripe::Block::mark_dirty); blocks
+// handed to a pass by RunOnBlocks are marked automatically.  Unless strict
+// validation is requested, only dirty subtrees are revalidated after the
+// pass runs; dumps always cover the whole program.
 class CompilePass {
  public:
   virtual ~CompilePass() {}
@@ -19,7 +19,7 @@ static void EvaluatePolynomial(const Polynomial<int64_t> orig_poly, const AliasM
   Polynomial<int64_t> poly = orig_poly.sym_eval(alias_map.idx_sources());
   int64_t min = poly.constant();
   int64_t max = poly.constant();
-  const std::map<std::string, int64_t>& var_map = poly.getMap();
+  const auto& var_map = poly.getMap();
   const std::map<std::string, uint64_t>& idx_ranges = alias_map.idx_ranges();
 
   for (const auto& kvp : var_map) {
@@ -111,8 +111,8 @@ void LightCstrReduction(const AliasMap& alias_map, Block* block, const proto::Li
 
 static Polynomial<Rational> PolynomialIntToRational(const Polynomial<int64_t>& src) {
   Polynomial<Rational> dest;
-  const std::map<std::string, int64_t>& src_map = src.getMap();
-  std::map<std::string, Rational>& dest_map = dest.mutateMap();
+  const auto& src_map = src.getMap();
+  auto& dest_map = dest.mutateMap();
   for (const auto& element : src_map) {
     dest_map.emplace(element.first, Rational(element.second));
   }
@@ -29,13 +29,17 @@ void RunOnBlocksRecurseBackward(const AliasMap& map, stripe::Block* block, const
     }
     // Remove all statements tagged "removed"
     if (block->stmts.size() > 0) {
-      block->stmts.erase(
+      auto removed =
           std::remove_if(block->stmts.begin(), block->stmts.end(),  //
-                         [](const std::shared_ptr<stripe::Statement>& stmt) { return stmt.get()->has_tag("removed"); }),
-          block->stmts.end());
+                         [](const std::shared_ptr<stripe::Statement>& stmt) { return stmt.get()->has_tag("removed"); });
+      if (removed != block->stmts.end()) {
+        block->stmts.erase(removed, block->stmts.end());
+        block->mark_dirty();
+      }
     }
   }
   if (run_func) {
+    block->mark_dirty();
     func(map, block);
   }
 }
@@ -2,6 +2,18 @@
 
 #include "tile/codegen/driver.h"
 
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include <google/protobuf/util/json_util.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+
 #include <boost/format.hpp>
 
 #include "base/config/config.h"
@@ -40,24 +52,119 @@ void DumpProgram(const Block& program,            //
   }
 }
 
-void ValidateBlock(Block* root) {
-  RunOnBlocks(  //
-      root, {},
-      [&](auto map, auto block) {
-        for (const auto& ref : block->refs) {
-          if (ref.dir == RefDir::None && !ref.from.empty()) {
-            throw_with_trace(std::runtime_error(
-                str(boost::format("ref.dir == RefDir::None && !ref.from.empty(). ref: %1% in block: %2%") % ref.into() %
-                    block->name)));
-          }
-          if (ref.from.empty() && ref.dir != RefDir::None) {
-            throw_with_trace(std::runtime_error(
-                str(boost::format("ref.from.empty() && ref.dir != RefDir::None. ref: %1% in block: %2%") % ref.into() %
-                    block->name)));
-          }
-        }
-      },
-      true);
+void ValidateRefs(const Block& block) {
+  for (const auto& ref : block.refs) {
+    if (ref.dir == RefDir::None && !ref.from.empty()) {
+      throw_with_trace(std::runtime_error(
+          str(boost::format("ref.dir == RefDir::None && !ref.from.empty(). ref: %1% in block: %2%") % ref.into() %
+              block.name)));
+    }
+    if (ref.from.empty() && ref.dir != RefDir::None) {
+      throw_with_trace(std::runtime_error(
+          str(boost::format("ref.from.empty() && ref.dir != RefDir::None. ref: %1% in block: %2%") % ref.into() %
+              block.name)));
+    }
+  }
+}
+
+// Validates every block in the subtree, marking them clean.  Building each
+// inner block's AliasMap checks its refinements' sources and access
+// dimensions, and evaluates its index affines.  Returns the number of blocks
+// validated.
+size_t ValidateBlock(const AliasMap& map, Block* block) {
+  ValidateRefs(*block);
+  block->clear_dirty();
+  size_t validated = 1;
+  for (const auto& stmt : block->stmts) {
+    auto inner = Block::Downcast(stmt);
+    if (inner) {
+      AliasMap inner_map(map, inner.get());
+      validated += ValidateBlock(inner_map, inner.get());
+    }
+  }
+  return validated;
+}
+
+// A block's AliasMap, built on first use, so that only the ancestors of dirty
+// blocks have their maps built.
+class LazyAliasMap {
+ public:
+  LazyAliasMap(const LazyAliasMap* outer, Block* block) : outer_{outer}, block_{block} {}
+
+  const AliasMap& get() const {
+    if (!map_) {
+      map_ = std::make_unique<AliasMap>(outer_ ? outer_->get() : base_, block_);
+    }
+    return *map_;
+  }
+
+ private:
+  AliasMap base_;
+  const LazyAliasMap* outer_;
+  Block* block_;
+  mutable std::unique_ptr<AliasMap> map_;
+};
+
+// Validates the dirty subtrees within the block.  Returns the number of blocks
+// validated.
+size_t ValidateDirtyBlocks(const LazyAliasMap& map, Block* block) {
+  if (block->is_dirty()) {
+    return ValidateBlock(map.get(), block);
+  }
+  size_t validated = 0;
+  for (const auto& stmt : block->stmts) {
+    auto inner = Block::Downcast(stmt);
+    if (inner) {
+      LazyAliasMap inner_map(&map, inner.get());
+      validated += ValidateDirtyBlocks(inner_map, inner.get());
+    }
+  }
+  return validated;
+}
+
+void AddProgramSize(const Block& block, proto::ProgramSize* size) {
+  size->set_blocks(size->blocks() + 1);
+  size->set_stmts(size->stmts() + block.stmts.size());
+  size->set_refs(size->refs() + block.refs.size());
+  for (const auto& stmt : block.stmts) {
+    auto inner = Block::Downcast(stmt);
+    if (inner) {
+      AddProgramSize(*inner, size);
+    }
+  }
+}
+
+proto::ProgramSize ProgramSize(const Block& block) {
+  proto::ProgramSize size;
+  AddProgramSize(block, &size);
+  return size;
+}
+
+// Returns the peak resident set size of the process so far, or 0 if unknown.
+uint64_t PeakRSSBytes() {
+#ifdef _WIN32
+  return 0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage)) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss;  // Reported in bytes
+#else
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // Reported in KiB
+#endif
+#endif
+}
+
+void WriteProfile(const proto::OptimizeProfile& profile, const boost::filesystem::path& path) {
+  google::protobuf::util::JsonPrintOptions options;
+  options.add_whitespace = true;
+  options.preserve_proto_field_names = true;
+  std::string json;
+  google::protobuf::util::MessageToJsonString(profile, &json, options);
+  std::ofstream fout(path.string());
+  fout << json;
 }
 
 class ConfigsRegistry {
@@ -86,8 +193,17 @@ class ConfigsRegistry {
 }  // namespace
 
 void Optimize(Block* block, const Passes& passes, const OptimizeOptions& options) {
+  using Clock = std::chrono::steady_clock;
+  bool profiling = options.ctx.is_logging_events() || !options.profile_path.empty() || VLOG_IS_ON(1);
+  context::Activity optimize_activity{options.ctx, "tile::codegen::Optimize"};
+  proto::OptimizeProfile profile;
+  auto optimize_start = Clock::now();
   size_t counter = 0;
   DumpProgram(*block, options, "initial", counter++);
+  proto::ProgramSize size;
+  if (profiling) {
+    size = ProgramSize(*block);
+  }
   for (const auto& pass : passes) {
     IVLOG(1, "Optimization Pass " << pass.name());
     std::unique_ptr<CompilePass> compile_pass =
@@ -96,9 +212,53 @@ void Optimize(Block* block, const Passes& passes, const OptimizeOptions& options
       throw_with_trace(std::runtime_error(
           str(boost::format("Unsupported pass: %1% -> %2%") % pass.name() % pass.pass().type_url())));
     }
+    context::Activity pass_activity{optimize_activity.ctx(), "tile::codegen::Pass"};
+    uint64_t peak_rss = profiling ? PeakRSSBytes() : 0;
+    auto pass_start = Clock::now();
     compile_pass->Apply(block);
+    auto pass_end = Clock::now();
     DumpProgram(*block, options, pass.name(), counter++);
-    ValidateBlock(block);
+    auto validate_start = Clock::now();
+    size_t validated_blocks = 0;
+    if (options.strict_validation) {
+      AliasMap base;
+      AliasMap root_map(base, block);
+      validated_blocks = ValidateBlock(root_map, block);
+    } else {
+      validated_blocks = ValidateDirtyBlocks(LazyAliasMap{nullptr, block}, block);
+    }
+    auto validate_end = Clock::now();
+    if (profiling) {
+      auto* pass_profile = profile.add_passes();
+      pass_profile->set_name(pass.name());
+      pass_profile->set_type_url(pass.pass().type_url());
+      context::StdDurationToProto(pass_profile->mutable_duration(), pass_end - pass_start);
+      context::StdDurationToProto(pass_profile->mutable_validate_duration(), validate_end - validate_start);
+      pass_profile->set_validated_blocks(validated_blocks);
+      *pass_profile->mutable_size_before() = size;
+      size = ProgramSize(*block);
+      *pass_profile->mutable_size_after() = size;
+      uint64_t new_peak_rss = PeakRSSBytes();
+      pass_profile->set_peak_rss_bytes(new_peak_rss);
+      pass_profile->set_peak_rss_growth_bytes(new_peak_rss - std::min(peak_rss, new_peak_rss));
+      pass_activity.AddMetadata(*pass_profile);
+      using Millis = std::chrono::duration<double, std::milli>;
+      double pass_ms = Millis(pass_end - pass_start).count();
+      double validate_ms = Millis(validate_end - validate_start).count();
+      const auto& before = pass_profile->size_before();
+      IVLOG(1, "  " << pass.name() << ": " << pass_ms << " ms, " << validate_ms << " ms validating "
+                    << validated_blocks << " blocks"
+                    << "; blocks: " << before.blocks() << " -> " << size.blocks()  //
+                    << ", stmts: " << before.stmts() << " -> " << size.stmts()     //
+                    << ", refs: " << before.refs() << " -> " << size.refs());
+    }
+  }
+  if (profiling) {
+    context::StdDurationToProto(profile.mutable_duration(), Clock::now() - optimize_start);
+    optimize_activity.AddMetadata(profile);
+    if (!options.profile_path.empty()) {
+      WriteProfile(profile, options.profile_path);
+    }
   }
 }
 
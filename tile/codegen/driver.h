@@ -6,6 +6,7 @@
 
 #include <boost/filesystem.hpp>
 
+#include "base/context/context.h"
 #include "tile/codegen/codegen.pb.h"
 #include "tile/stripe/stripe.h"
 
@@ -17,6 +18,16 @@ struct OptimizeOptions {
   bool dump_passes = false;
   bool dump_code = false;
   boost::filesystem::path dbg_dir;
+  // Each pass is logged as a "tile::codegen::Pass" activity, with a PassProfile
+  // as its metadata, when this context is logging events.
+  context::Context ctx;
+  // If non-empty, an OptimizeProfile is written here as JSON.
+  boost::filesystem::path profile_path;
+  // Validates the entire program after every pass, rather than only the
+  // subtrees the pass marked dirty.  Either way, validation builds the AliasMap
+  // of every block it checks (and of their ancestors).  Useful when debugging a
+  // pass that may not be reporting its modifications.
+  bool strict_validation = false;
 };
 
 using Passes = google::protobuf::RepeatedPtrField<proto::Pass>;
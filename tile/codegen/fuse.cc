@@ -516,6 +516,7 @@ void FusionInner(const AliasMap& scope, Block* block, FusionStrategy* strategy)
         IVLOG(3, "Fusion denied by strategy");
         break;
       }
+      block->mark_dirty();
       // Do the appropriate refactors
       auto refactor1 = FusionRefactor(*block1, plan->remap_a, plan->tile_a, plan->a_interleave);
       auto refactor2 = FusionRefactor(*block2, plan->remap_b, plan->tile_b, plan->b_interleave);
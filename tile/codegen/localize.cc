@@ -115,7 +115,7 @@ void LocalizeBlockPass(const AliasMap& scope, Block* block, const std::set<std::
 void LocalizePass::Apply(stripe::Block* root) const {
   auto reqs = stripe::FromProto(options_.reqs());
   auto ref_reqs = stripe::FromProto(options_.ref_reqs());
-  RunOnBlocks(root, reqs, [&](const AliasMap& map, stripe::Block* block) {  //
+  RunOnBlocksParallel(root, reqs, [&](const AliasMap& map, stripe::Block* block) {  //
     LocalizeBlockPass(map, block, ref_reqs);
   });
 }
@@ -142,7 +142,7 @@ void LocateInnerBlock(Block* block, const Tags& inner_tags, const Location& loc,
 void LocateMemoryPass::Apply(Block* root) const {
   auto reqs = FromProto(options_.reqs());
   auto loc = stripe::FromProto(options_.loc());
-  RunOnBlocks(root, reqs, [&loc, this](const AliasMap& map, Block* block) {
+  RunOnBlocksParallel(root, reqs, [&loc, this](const AliasMap& map, Block* block) {
     for (auto& ref : block->refs) {
       if (ref.dir == RefDir::None) {
         auto* ref_loc = &ref.mut().location;
@@ -160,7 +160,7 @@ void LocateMemoryPass::Apply(Block* root) const {
 void LocateBlockPass::Apply(Block* root) const {
   auto reqs = FromProto(options_.reqs());
   auto loc = stripe::FromProto(options_.loc());
-  RunOnBlocks(root, reqs, [&loc, this](const AliasMap& map, Block* block) {  //
+  RunOnBlocksParallel(root, reqs, [&loc, this](const AliasMap& map, Block* block) {  //
     auto* block_loc = &block->location;
     if (options_.append_devs()) {
       block_loc->devs.insert(block_loc->devs.end(), loc.devs.begin(), loc.devs.end());
@@ -174,7 +174,7 @@ void LocateInnerBlockPass::Apply(Block* root) const {
   auto reqs = FromProto(options_.reqs());
   auto inner_reqs = FromProto(options_.inner_reqs());
   auto loc = stripe::FromProto(options_.loc());
-  RunOnBlocks(root, reqs, [&](const AliasMap& map, Block* block) {  //
+  RunOnBlocksParallel(root, reqs, [&](const AliasMap& map, Block* block) {  //
     LocateInnerBlock(block, inner_reqs, loc, options_);
   });
 }
@@ -29,6 +29,7 @@ void MemRebasePass::Apply(stripe::Block* root) const {
         }
       }
       ref.mut().offset = offset.eval(vars);
+      block->mark_dirty();
     }
 
     for (auto& stmt : block->stmts) {
@@ -70,6 +70,7 @@ void PackagePass::Apply(stripe::Block* root) const {
 
       // Replace the subblock with the package.
       stmt = std::move(pkg);
+      outer->mark_dirty();
     }
   }
 }
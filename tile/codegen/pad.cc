@@ -34,6 +34,7 @@ void CollectRefDefine(stripe::Block* block, RefDefineMap* ref_def_map) {
         ref_it->mut().set_tag("rewrite");
         RefDefine ref_def = {ref_it->into(), block, it};
         ref_def_map->emplace(ref_it->into(), ref_def);
+        block->mark_dirty();
       }
     }
   }
@@ -69,6 +70,7 @@ static void CopyRefinement(const RefDefineMap& ref_def_map,  //
   block->set_tag("kernel");
   block->name = "kernel_" + std::to_string(ref_def.block->stmts.size()) + "(" + old_ref.into() + ")";
   ref_def.block->stmts.insert(++after, block);
+  ref_def.block->mark_dirty();
 }
 
 void ComputeExtents(Block* block, const AliasMap& map, Extents* extents) {
@@ -245,6 +247,7 @@ void Pad(Block* block, const AliasMap& map, const RefDefineMap& ref_def_map) {
                            old_ref.offset, old_ref.bank_dim, old_ref.cache_unit);
         tmp_ref.set_tag("rewrite");
         ref_def.block->refs.insert(tmp_ref);
+        ref_def.block->mark_dirty();
       }
       auto old_ref_it = ref_def.block->ref_by_into(tmp_ref_name);
       CopyRefinement(ref_def_map, *old_ref_it, *ref_it, pad_sizes.at(name));
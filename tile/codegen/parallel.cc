@@ -0,0 +1,84 @@
+// Copyright 2018, Intel Corporation
+
+#include "tile/codegen/parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <boost/asio/post.hpp>
+
+#include "base/util/thread_pool.h"
+
+namespace vertexai {
+namespace tile {
+namespace codegen {
+
+namespace {
+
+std::size_t ThreadCount() { return std::max<std::size_t>(1, std::thread::hardware_concurrency()); }
+
+struct ParallelForState {
+  ParallelForState(std::size_t count_, const std::function<void(std::size_t)>& fn_)
+      : count{count_}, fn{&fn_}, remaining{count_} {}
+
+  // Runs calls until none remain unclaimed.  A helper which starts after the
+  // loop has finished claims nothing, and so never touches fn.
+  void Work() {
+    for (;;) {
+      std::size_t idx = next.fetch_add(1, std::memory_order_relaxed);
+      if (count <= idx) {
+        return;
+      }
+      try {
+        (*fn)(idx);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock{mu};
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+      if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        done.set_value();
+      }
+    }
+  }
+
+  std::size_t count;
+  const std::function<void(std::size_t)>* fn;
+  std::atomic<std::size_t> next{0};
+  std::atomic<std::size_t> remaining;
+  std::promise<void> done;
+  std::mutex mu;
+  std::exception_ptr error;
+};
+
+}  // namespace
+
+void ParallelFor(std::size_t count, const std::function<void(std::size_t)>& fn) {
+  if (count <= 1) {
+    for (std::size_t idx = 0; idx < count; ++idx) {
+      fn(idx);
+    }
+    return;
+  }
+  auto state = std::make_shared<ParallelForState>(count, fn);
+  auto done = state->done.get_future();
+  std::size_t helpers = std::min(count, ThreadCount()) - 1;
+  for (std::size_t idx = 0; idx < helpers; ++idx) {
+    boost::asio::post(*SharedThreadPool(), [state]() { state->Work(); });
+  }
+  state->Work();
+  done.wait();
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+}
+
+}  // namespace codegen
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,24 @@
+// Copyright 2018, Intel Corporation
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace vertexai {
+namespace tile {
+namespace codegen {
+
+// Invokes fn(i) for each i in [0, count), spreading the calls across the
+// calling thread and the process-wide SharedThreadPool.  Returns once
+// every call has completed; if any call throws, the first exception is
+// rethrown on the calling thread.
+//
+// The calling thread claims work alongside the pool, so ParallelFor never
+// waits for a pool thread to become available, and may safely be used from
+// within another ParallelFor.
+void ParallelFor(std::size_t count, const std::function<void(std::size_t)>& fn);
+
+}  // namespace codegen
+}  // namespace tile
+}  // namespace vertexai
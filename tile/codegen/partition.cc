@@ -354,6 +354,7 @@ void CollectBankInfo(std::map<std::string, BankInfo>* bank_infos,  //
   bank_info.banked_shape.resize_dim(bank_info.dim_pos, part_size);
   bank_info.num_banks = options.num_parts();
   base_ref->bank_dim = BankDimension{bank_info.dim_pos};
+  big_alias.base_block->mark_dirty();
 }
 
 }  // namespace
@@ -592,6 +592,8 @@ static void RegisterCacheRecurse(Block* parent, Block* block,  //
                                  const Tags& reqs,             //
                                  const RegisterPassOptions& opt) {
   if (block->has_tags(reqs)) {
+    // The cache is built from the parent's refinements and statements.
+    parent->mark_dirty();
     BlocksForRegisterCache(parent, block, opt);
   } else {
     for (auto& stmt : block->stmts) {
@@ -163,6 +163,7 @@ void ReorderBlocksPass::Apply(Block* root) const {
     }
   }
   main_block->stmts = done;
+  main_block->mark_dirty();
 }
 
 namespace {
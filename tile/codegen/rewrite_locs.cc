@@ -16,7 +16,8 @@ struct Rewrite {
   std::vector<stripe::Device> target;
 };
 
-void RewriteLocation(stripe::Location* loc, const std::vector<Rewrite>& rewrites) {
+// Returns true if one of the rewrites applied to the location.
+bool RewriteLocation(stripe::Location* loc, const std::vector<Rewrite>& rewrites) {
   for (auto& rewrite : rewrites) {
     auto loc_it = loc->devs.begin();
     auto rew_it = rewrite.prefix.begin();
@@ -26,9 +27,10 @@ void RewriteLocation(stripe::Location* loc, const std::vector<Rewrite>& rewrites
       std::vector<stripe::Device> target = rewrite.target;
       std::copy(loc_it, loc->devs.end(), std::back_inserter(target));
       std::swap(loc->devs, target);
-      break;
+      return true;
     }
   }
+  return false;
 }
 
 }  // namespace
@@ -46,10 +48,14 @@ void RewriteLocationsPass::Apply(stripe::Block* root) const {
     stripe::Block* block = todo.front();
     todo.pop();
 
-    RewriteLocation(&block->location, rewrites);
+    if (RewriteLocation(&block->location, rewrites)) {
+      block->mark_dirty();
+    }
 
     for (auto& ref : block->refs) {
-      RewriteLocation(&ref.mut().location, rewrites);
+      if (RewriteLocation(&ref.mut().location, rewrites)) {
+        block->mark_dirty();
+      }
     }
 
     for (auto& stmt : block->stmts) {
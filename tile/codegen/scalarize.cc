@@ -108,7 +108,7 @@ void Scalarize(Block* block, bool recursive) {
 
 void ScalarizePass::Apply(stripe::Block* root) const {
   auto reqs = stripe::FromProto(options_.reqs());
-  RunOnBlocks(root, reqs, [](const AliasMap& map, stripe::Block* block) {  //
+  RunOnBlocksParallel(root, reqs, [](const AliasMap& map, stripe::Block* block) {  //
     Scalarize(block, true);
   });
 }
@@ -6,6 +6,8 @@
 #include "base/util/lookup.h"
 #include "base/util/stream_container.h"
 #include "base/util/throw.h"
+#include "tile/codegen/alias.h"
+#include "tile/codegen/parallel.h"
 #include "tile/codegen/tile.h"
 #include "tile/math/util.h"
 #include "tile/stripe/stripe.h"
@@ -233,11 +235,21 @@ void ApplyRefTags(Block* block, const StencilMatch& match, const StencilPassOpti
   }
 }
 
-void StencilPassRecurse(Block* block, const StencilPassOptions& options) {
+// Blocks are independent of their siblings, so the children of blocks near the
+// root (depth counts from 1 at the program block) are processed in parallel.
+void StencilPassRecurse(Block* block, const StencilPassOptions& options, size_t depth) {
+  std::vector<Block*> inners;
   for (auto stmt : block->stmts) {
     auto inner = Block::Downcast(stmt);
     if (inner) {
-      StencilPassRecurse(inner.get(), options);
+      inners.push_back(inner.get());
+    }
+  }
+  if (depth <= kParallelBlockDepth) {
+    ParallelFor(inners.size(), [&](size_t i) { StencilPassRecurse(inners[i], options, depth + 1); });
+  } else {
+    for (auto* inner : inners) {
+      StencilPassRecurse(inner, options, depth + 1);
     }
   }
   if (block->has_tags(options.reqs)) {
@@ -245,6 +257,7 @@ void StencilPassRecurse(Block* block, const StencilPassOptions& options) {
     if (!match) {
       return;
     }
+    block->mark_dirty();
     ApplyRefTags(block, *match, options);
     TileShape tile;
     for (const auto& idx : match->idxs) {
@@ -275,7 +288,7 @@ void StencilPass::Apply(Block* block) const {
   for (const auto& output_set : options_.outputs_set()) {
     sopts.set_outputs.emplace_back(FromProto(output_set.tags()));
   }
-  StencilPassRecurse(block, sopts);
+  StencilPassRecurse(block, sopts, 1);
 }
 
 std::ostream& operator<<(std::ostream& os, const StencilIndexMatch& idx) {
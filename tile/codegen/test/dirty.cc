@@ -0,0 +1,150 @@
+// Copyright 2018, Intel Corp.
+
+#include <gmock/gmock.h>
+
+#include <stdexcept>
+
+#include "base/proto/proto.h"
+#include "tile/codegen/alias.h"
+#include "tile/codegen/codegen.pb.h"
+#include "tile/codegen/driver.h"
+#include "tile/codegen/partition.h"
+#include "tile/lang/gen_stripe.h"
+#include "tile/stripe/stripe.h"
+
+namespace vertexai {
+namespace tile {
+namespace codegen {
+namespace test {
+
+using namespace stripe;  // NOLINT
+
+static std::shared_ptr<Program> GenerateAdd() {
+  lang::RunInfo runinfo;
+  runinfo.program_name = "add";
+  runinfo.code = "function (A, B) -> (C) { C = A + B; }";
+  runinfo.input_shapes.emplace("A", SimpleShape(DataType::FLOAT32, {4, 4}));
+  runinfo.input_shapes.emplace("B", SimpleShape(DataType::FLOAT32, {4, 4}));
+  runinfo.output_shapes.emplace("C", SimpleShape(DataType::FLOAT32, {4, 4}));
+  return GenerateStripe(runinfo);
+}
+
+// A pass that rewrites nothing, since no block carries the tag it requires.
+static proto::Stage GenerateNoopStage() {
+  return ParseProtoText<proto::Stage>(R"(
+    passes: [
+      {
+        name: "noop"
+        pass: {
+          [type.vertex.ai/vertexai.tile.codegen.proto.ComputeDepsPass] {
+            reqs: ["no_such_tag"]
+          }
+        }
+      }
+    ]
+  )");
+}
+
+static void ClearDirty(Block* block) {
+  block->clear_dirty();
+  for (const auto& stmt : block->stmts) {
+    auto inner = Block::Downcast(stmt);
+    if (inner) {
+      ClearDirty(inner.get());
+    }
+  }
+}
+
+// Counts the banked refinements in the subtree, expecting each to be in a
+// dirty block.
+static size_t CheckBankedRefsDirty(const Block& block) {
+  size_t banked = 0;
+  for (const auto& ref : block.refs) {
+    if (ref.bank_dim) {
+      EXPECT_TRUE(block.is_dirty()) << "banked ref " << ref.into() << " in clean block " << block.name;
+      banked++;
+    }
+  }
+  for (const auto& stmt : block.stmts) {
+    auto inner = Block::Downcast(stmt);
+    if (inner) {
+      banked += CheckBankedRefsDirty(*inner);
+    }
+  }
+  return banked;
+}
+
+TEST(DirtyTracking, NewAndCopiedBlocksAreDirty) {
+  Block block;
+  EXPECT_TRUE(block.is_dirty());
+  block.clear_dirty();
+  EXPECT_FALSE(block.is_dirty());
+  Block copy{block};
+  EXPECT_TRUE(copy.is_dirty());
+  EXPECT_FALSE(block.is_dirty());
+  copy.clear_dirty();
+  copy = block;
+  EXPECT_TRUE(copy.is_dirty());
+}
+
+TEST(DirtyTracking, RunOnBlocksMarksVisitedBlocks) {
+  auto program = GenerateAdd();
+  auto main = program->entry->SubBlock(0);
+  auto kernel = main->SubBlock(0);
+  ClearDirty(program->entry.get());
+  RunOnBlocks(program->entry.get(), {"kernel"}, [](const AliasMap& map, Block* block) {});
+  EXPECT_FALSE(program->entry->is_dirty());
+  EXPECT_FALSE(main->is_dirty());
+  EXPECT_TRUE(kernel->is_dirty());
+}
+
+TEST(DirtyTracking, OptimizeValidatesDirtySubtrees) {
+  auto program = GenerateAdd();
+  auto kernel = program->entry->SubBlock(0)->SubBlock(0);
+  auto stage = GenerateNoopStage();
+
+  // Break one of the kernel's refinements.  Unless the kernel is dirty, the
+  // breakage goes unnoticed, since the pass doesn't touch it.
+  kernel->ref_outs()[0]->dir = RefDir::None;
+  ClearDirty(program->entry.get());
+
+  OptimizeOptions options;
+  EXPECT_NO_THROW(Optimize(program->entry.get(), stage.passes(), options));
+
+  kernel->mark_dirty();
+  EXPECT_THROW(Optimize(program->entry.get(), stage.passes(), options), std::runtime_error);
+
+  ClearDirty(program->entry.get());
+  options.strict_validation = true;
+  EXPECT_THROW(Optimize(program->entry.get(), stage.passes(), options), std::runtime_error);
+}
+
+TEST(DirtyTracking, PassesMarkModifiedAncestors) {
+  // Memory partitioning runs on the kernels, but banks the buffers they
+  // refine, which belong to the program's root block.
+  auto program = GenerateAdd();
+  ClearDirty(program->entry.get());
+  proto::PartitionMemoryPass options;
+  options.add_reqs("kernel");
+  options.set_num_parts(2);
+  PartitionMemoryPass{options}.Apply(program->entry.get());
+  EXPECT_GT(CheckBankedRefsDirty(*program->entry), 0);
+}
+
+TEST(DirtyTracking, DirtySubtreesAreAliasChecked) {
+  auto program = GenerateAdd();
+  auto kernel = program->entry->SubBlock(0)->SubBlock(0);
+  auto stage = GenerateNoopStage();
+
+  // Give one of the kernel's refinements an access that doesn't match its
+  // source's dimensions, which only building the kernel's AliasMap detects.
+  kernel->ref_ins()[0]->access.pop_back();
+  ClearDirty(program->entry.get());
+  kernel->mark_dirty();
+  EXPECT_THROW(Optimize(program->entry.get(), stage.passes(), OptimizeOptions{}), std::runtime_error);
+}
+
+}  // namespace test
+}  // namespace codegen
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,46 @@
+// Copyright 2018, Intel Corp.
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "tile/codegen/parallel.h"
+
+namespace vertexai {
+namespace tile {
+namespace codegen {
+namespace test {
+
+TEST(ParallelFor, RunsEachIndexOnce) {
+  std::vector<std::atomic<int>> calls(1000);
+  ParallelFor(calls.size(), [&](size_t idx) { calls[idx]++; });
+  for (const auto& count : calls) {
+    EXPECT_EQ(count.load(), 1);
+  }
+}
+
+TEST(ParallelFor, Nested) {
+  std::atomic<size_t> total{0};
+  ParallelFor(64, [&](size_t) { ParallelFor(64, [&](size_t idx) { total += idx; }); });
+  EXPECT_EQ(total.load(), 64u * (63 * 64 / 2));
+}
+
+TEST(ParallelFor, PropagatesExceptions) {
+  std::atomic<size_t> calls{0};
+  EXPECT_THROW(ParallelFor(100,
+                           [&](size_t idx) {
+                             calls++;
+                             if (idx == 50) {
+                               throw std::runtime_error("failed");
+                             }
+                           }),
+               std::runtime_error);
+  EXPECT_EQ(calls.load(), 100u);
+}
+
+}  // namespace test
+}  // namespace codegen
+}  // namespace tile
+}  // namespace vertexai
@@ -291,8 +291,9 @@ bool ApplyTile(Block* outer, const TileShape& shape, bool elide_trivial, bool co
           auto& umap = unit.mutateMap();
           auto it = umap.find(tag);
           if (it != umap.end()) {
-            umap[inner_idx_name] = it->second;
+            auto unit_coeff = it->second;
             umap.erase(it);
+            umap[inner_idx_name] = unit_coeff;
           }
         }
       }
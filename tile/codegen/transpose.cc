@@ -102,6 +102,7 @@ void TransposePass::Apply(Block* root) const {
       IVLOG(3, "    old_ref: " << old_ref);
       IVLOG(3, "    new_ref: " << *base_ref);
       // Propagate the changes
+      usage.base_block->mark_dirty();
       FixupRefs(usage.base_block, base_ref->into());
     }
   }
@@ -290,6 +290,7 @@ void UnrollBlock(Block* outer,                     //
       }
     }
     outer->stmts.erase(it_stmt);
+    outer->mark_dirty();
     // Dependencies become invalid after a stmt is removed
     for (auto& stmt : outer->stmts) {
       stmt->deps.clear();
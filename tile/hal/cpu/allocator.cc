@@ -0,0 +1,153 @@
+// Copyright 2018 Intel Corporation.
+
+#include "tile/hal/cpu/allocator.h"
+
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#endif
+
+namespace vertexai {
+namespace tile {
+namespace hal {
+namespace cpu {
+
+constexpr std::size_t Allocator::kAlignment;
+constexpr std::size_t Allocator::kMapThreshold;
+constexpr std::size_t Allocator::kHugePageSize;
+
+Allocator::Allocator(std::size_t cache_limit) : cache_limit_{cache_limit} {}
+
+Allocator::~Allocator() {
+  for (auto& kvp : free_lists_) {
+    for (void* base : kvp.second) {
+      SystemFree(Block{base, kvp.first});
+    }
+  }
+}
+
+std::size_t Allocator::SizeClass(std::size_t size) {
+  if (size <= kAlignment) {
+    return kAlignment;
+  }
+  // Find the largest power of two below size, and round up to a quarter of it.
+  std::size_t pow2 = kAlignment;
+  while (pow2 * 2 < size) {
+    pow2 *= 2;
+  }
+  std::size_t step = pow2 / 4 < kAlignment ? kAlignment : pow2 / 4;
+  std::size_t capacity = (size + step - 1) / step * step;
+  if (kHugePageSize <= capacity) {
+    capacity = (capacity + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+  }
+  return capacity;
+}
+
+Allocator::Block Allocator::Allocate(std::size_t size) {
+  Block block{nullptr, SizeClass(size)};
+  {
+    std::lock_guard<std::mutex> lock{mu_};
+    auto it = free_lists_.find(block.capacity);
+    if (it != free_lists_.end() && it->second.size()) {
+      block.base = it->second.back();
+      it->second.pop_back();
+      cached_bytes_ -= block.capacity;
+      return block;
+    }
+  }
+  block.base = SystemAllocate(block.capacity);
+#ifndef _WIN32
+  block.zeroed = kMapThreshold <= block.capacity;
+#endif
+  return block;
+}
+
+void Allocator::Free(const Block& block) {
+  {
+    std::lock_guard<std::mutex> lock{mu_};
+    if (cached_bytes_ + block.capacity <= cache_limit_) {
+      free_lists_[block.capacity].push_back(block.base);
+      cached_bytes_ += block.capacity;
+      return;
+    }
+  }
+  SystemFree(block);
+}
+
+void Allocator::Release(const Block& block) { SystemFree(block); }
+
+std::size_t Allocator::cached_bytes() const {
+  std::lock_guard<std::mutex> lock{mu_};
+  return cached_bytes_;
+}
+
+void* Allocator::SystemAllocate(std::size_t capacity) {
+#ifdef _WIN32
+  void* base = _aligned_malloc(capacity, kAlignment);
+  if (!base) {
+    throw std::bad_alloc{};
+  }
+  return base;
+#else
+  if (capacity < kMapThreshold) {
+    void* base = nullptr;
+    if (posix_memalign(&base, kAlignment, capacity)) {
+      throw std::bad_alloc{};
+    }
+    return base;
+  }
+  void* base = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) {
+    throw std::bad_alloc{};
+  }
+#ifdef MADV_HUGEPAGE
+  if (kHugePageSize <= capacity) {
+    // Advisory only; if transparent huge pages are disabled, this has no effect.
+    madvise(base, capacity, MADV_HUGEPAGE);
+  }
+#endif
+  return base;
+#endif
+}
+
+void Allocator::SystemFree(const Block& block) {
+#ifdef _WIN32
+  _aligned_free(block.base);
+#else
+  if (block.capacity < kMapThreshold) {
+    free(block.base);
+  } else {
+    munmap(block.base, block.capacity);
+  }
+#endif
+}
+
+std::uint64_t Allocator::PhysicalMemorySize() {
+#ifdef _WIN32
+  MEMORYSTATUSEX status;
+  status.dwLength = sizeof(status);
+  if (!GlobalMemoryStatusEx(&status)) {
+    return 0;
+  }
+  return status.ullTotalPhys;
+#else
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long page_size = sysconf(_SC_PAGESIZE);
+  if (pages <= 0 || page_size <= 0) {
+    return 0;
+  }
+  return static_cast<std::uint64_t>(pages) * static_cast<std::uint64_t>(page_size);
+#endif
+}
+
+}  // namespace cpu
+}  // namespace hal
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,87 @@
+// Copyright 2018 Intel Corporation.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace vertexai {
+namespace tile {
+namespace hal {
+namespace cpu {
+
+// Allocator provides the host memory backing CPU arenas.
+//
+// Requests are rounded up to a size class.  There are four classes per power of
+// two, which wastes less than a quarter of the request; blocks of a huge page or
+// more are then rounded up to a whole number of huge pages, which can waste up
+// to one more huge page.  Blocks returned with Free are kept on per-class free
+// lists for reuse, up to a limit on the total number of cached bytes.  Every block is aligned to kAlignment, which is
+// enough for any vector load the CPU backend emits.
+//
+// Large blocks are mapped directly from the OS, and on Linux are marked as
+// eligible for transparent huge pages.  The allocator never initializes block
+// contents: newly mapped pages are placed on the NUMA node of the thread that
+// first touches them, so leaving them untouched lets the kernel worker that
+// writes a tensor determine where it lives.
+//
+// The allocator is internally synchronized.
+class Allocator final {
+ public:
+  // The alignment of every block: a cache line, and the width of an AVX-512 register.
+  static constexpr std::size_t kAlignment = 64;
+
+  // Blocks at least this large are mapped directly from the OS.
+  static constexpr std::size_t kMapThreshold = 256 * 1024;
+
+  // Blocks at least this large are rounded up to, and advised as, huge pages.
+  static constexpr std::size_t kHugePageSize = 2 * 1024 * 1024;
+
+  struct Block {
+    void* base;
+    std::size_t capacity;
+    bool zeroed = false;  // Set if the block is freshly mapped, and therefore all zeros
+  };
+
+  explicit Allocator(std::size_t cache_limit);
+  ~Allocator();
+
+  Allocator(const Allocator&) = delete;
+  Allocator& operator=(const Allocator&) = delete;
+
+  // Returns an uninitialized block of at least size bytes.
+  Block Allocate(std::size_t size);
+
+  // Returns a block to the allocator, caching it for reuse if it fits within the cache limit.
+  void Free(const Block& block);
+
+  // Returns a block directly to the OS, for blocks whose reuse is managed elsewhere.
+  void Release(const Block& block);
+
+  // The number of bytes held on the free lists.
+  std::size_t cached_bytes() const;
+
+  // The capacity of the block used to satisfy a request for size bytes.
+  static std::size_t SizeClass(std::size_t size);
+
+  // The host's physical memory size, or zero if it cannot be determined.
+  static std::uint64_t PhysicalMemorySize();
+
+ private:
+  static void* SystemAllocate(std::size_t capacity);
+  static void SystemFree(const Block& block);
+
+  const std::size_t cache_limit_;
+  mutable std::mutex mu_;
+  std::unordered_map<std::size_t, std::vector<void*>> free_lists_;
+  std::size_t cached_bytes_ = 0;
+};
+
+}  // namespace cpu
+}  // namespace hal
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,97 @@
+// Copyright 2018 Intel Corporation.
+
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "tile/hal/cpu/allocator.h"
+#include "tile/hal/cpu/arena.h"
+#include "tile/hal/cpu/buffer.h"
+
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Le;
+
+namespace vertexai {
+namespace tile {
+namespace hal {
+namespace cpu {
+namespace {
+
+TEST(AllocatorTest, SizeClassesBoundWaste) {
+  EXPECT_THAT(Allocator::SizeClass(0), Eq(Allocator::kAlignment));
+  EXPECT_THAT(Allocator::SizeClass(1), Eq(Allocator::kAlignment));
+  EXPECT_THAT(Allocator::SizeClass(65), Eq(128u));
+  EXPECT_THAT(Allocator::SizeClass(1000), Eq(1024u));
+  EXPECT_THAT(Allocator::SizeClass(1025), Eq(1280u));
+  EXPECT_THAT(Allocator::SizeClass(3 * Allocator::kHugePageSize - 1), Eq(3 * Allocator::kHugePageSize));
+  for (std::size_t size = 1; size < (64 << 20); size = size * 3 / 2 + 1) {
+    auto capacity = Allocator::SizeClass(size);
+    EXPECT_THAT(capacity, Ge(size));
+    EXPECT_THAT(capacity % Allocator::kAlignment, Eq(0u));
+    if (size < Allocator::kHugePageSize) {
+      EXPECT_THAT(capacity, Le(size + size / 4 + Allocator::kAlignment));
+    }
+  }
+}
+
+TEST(AllocatorTest, AllocationsAreAlignedAndWritable) {
+  Allocator allocator{0};
+  for (std::size_t size : {std::size_t(1), std::size_t(4096), Allocator::kMapThreshold, 5 * Allocator::kHugePageSize}) {
+    auto block = allocator.Allocate(size);
+    EXPECT_THAT(reinterpret_cast<std::uintptr_t>(block.base) % Allocator::kAlignment, Eq(0u));
+    EXPECT_THAT(block.capacity, Ge(size));
+    std::memset(block.base, 0xA5, block.capacity);
+    allocator.Free(block);
+  }
+  EXPECT_THAT(allocator.cached_bytes(), Eq(0u));
+}
+
+TEST(AllocatorTest, FreedBlocksAreReusedWithinTheCacheLimit) {
+  Allocator allocator{4096};
+  auto first = allocator.Allocate(1000);
+  allocator.Free(first);
+  EXPECT_THAT(allocator.cached_bytes(), Eq(first.capacity));
+  auto second = allocator.Allocate(900);
+  EXPECT_THAT(second.base, Eq(first.base));
+  EXPECT_THAT(allocator.cached_bytes(), Eq(0u));
+
+  // A block that doesn't fit within the cache limit is released.
+  auto large = allocator.Allocate(8192);
+  allocator.Free(large);
+  EXPECT_THAT(allocator.cached_bytes(), Eq(0u));
+  allocator.Free(second);
+}
+
+TEST(AllocatorTest, ReleasedBlocksAreNotCached) {
+  Allocator allocator{1 << 20};
+  allocator.Release(allocator.Allocate(1000));
+  EXPECT_THAT(allocator.cached_bytes(), Eq(0u));
+}
+
+TEST(AllocatorTest, UserVisibleArenasAreZeroed) {
+  auto allocator = std::make_shared<Allocator>(1 << 20);
+  for (std::size_t size : {std::size_t(1000), Allocator::kMapThreshold}) {
+    // Dirty a block, and return it to the free list for the next arena to reuse.
+    auto block = allocator->Allocate(size);
+    std::memset(block.base, 0xA5, block.capacity);
+    allocator->Free(block);
+
+    auto buffer = Buffer::Downcast(std::make_shared<Arena>(allocator, size, true)->MakeBuffer(0, size));
+    EXPECT_THAT(buffer->base(), Eq(block.base));
+    const char* data = static_cast<const char*>(buffer->base());
+    EXPECT_THAT(std::count(data, data + size, 0), Eq(static_cast<std::ptrdiff_t>(size)));
+  }
+}
+
+TEST(AllocatorTest, PhysicalMemorySizeIsKnown) { EXPECT_THAT(Allocator::PhysicalMemorySize(), Ge(1u << 20)); }
+
+}  // namespace
+}  // namespace cpu
+}  // namespace hal
+}  // namespace tile
+}  // namespace vertexai
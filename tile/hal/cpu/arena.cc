@@ -2,6 +2,9 @@
 
 #include "tile/hal/cpu/arena.h"
 
+#include <cstring>
+#include <utility>
+
 #include "base/util/error.h"
 #include "tile/hal/cpu/buffer.h"
 
@@ -10,13 +13,26 @@ namespace tile {
 namespace hal {
 namespace cpu {
 
-Arena::Arena(std::uint64_t size) { mem_.resize(size, '\0'); }
+Arena::Arena(std::shared_ptr<Allocator> allocator, std::uint64_t size, bool user_visible)
+    : allocator_{std::move(allocator)}, block_(allocator_->Allocate(size)), size_{size}, user_visible_{user_visible} {
+  if (user_visible_ && !block_.zeroed) {
+    std::memset(block_.base, 0, size_);
+  }
+}
+
+Arena::~Arena() {
+  if (user_visible_) {
+    allocator_->Free(block_);
+  } else {
+    allocator_->Release(block_);
+  }
+}
 
 std::shared_ptr<hal::Buffer> Arena::MakeBuffer(std::uint64_t offset, std::uint64_t size) {
-  if (mem_.size() < offset || mem_.size() < size || mem_.size() < (offset + size)) {
+  if (size_ < offset || size_ < size || size_ < (offset + size)) {
     throw error::OutOfRange{"Requesting memory outside arena bounds"};
   }
-  return std::make_shared<Buffer>(shared_from_this(), mem_.data() + offset, size);
+  return std::make_shared<Buffer>(shared_from_this(), static_cast<char*>(block_.base) + offset, size);
 }
 
 }  // namespace cpu
@@ -3,23 +3,37 @@
 #pragma once
 
 #include <memory>
-#include <vector>
 
 #include "tile/base/hal.h"
+#include "tile/hal/cpu/allocator.h"
 
 namespace vertexai {
 namespace tile {
 namespace hal {
 namespace cpu {
 
+// An Arena is a block of host memory obtained from an Allocator, and returned to it when the arena (and every buffer
+// made from it) is released.
+//
+// A user-visible arena backs a buffer the caller may read before any kernel writes it, so it's zero-initialized (fresh
+// pages already are), and its block is cached by the allocator when freed.
+//
+// Other arenas are owned by the scheduler, and are not zero-initialized: kernels write every element of their outputs,
+// and the scheduler inserts explicit zeroing kernels (lang::KernelType::kZero) for any buffer that is read before it's
+// fully written.  Skipping the initialization also leaves fresh pages to be placed by the first kernel worker that
+// writes them.  Their reuse is managed by the platform's MemCache, so their blocks go straight back to the OS.
 class Arena : public hal::Arena, public std::enable_shared_from_this<Arena> {
  public:
-  explicit Arena(std::uint64_t size);
+  Arena(std::shared_ptr<Allocator> allocator, std::uint64_t size, bool user_visible);
+  ~Arena();
 
   std::shared_ptr<hal::Buffer> MakeBuffer(std::uint64_t offset, std::uint64_t size) final;
 
  private:
-  std::vector<char> mem_;
+  std::shared_ptr<Allocator> allocator_;
+  Allocator::Block block_;
+  std::uint64_t size_;
+  bool user_visible_;
 };
 
 }  // namespace cpu
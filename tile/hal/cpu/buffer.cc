@@ -21,8 +21,8 @@ std::shared_ptr<Buffer> Buffer::Downcast(const std::shared_ptr<hal::Buffer>& buf
   return buf;
 }
 
-Buffer::Buffer(std::shared_ptr<Arena> arena, void* base, std::uint64_t size)
-    : size_{size}, base_{base}, arena_{std::move(arena)} {}
+Buffer::Buffer(std::shared_ptr<void> owner, void* base, std::uint64_t size)
+    : size_{size}, base_{base}, owner_{std::move(owner)} {}
 
 boost::future<void*> Buffer::MapCurrent(const std::vector<std::shared_ptr<hal::Event>>& deps) { return Sync(deps); }
 
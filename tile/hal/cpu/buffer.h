@@ -15,7 +15,9 @@ namespace cpu {
 
 class Buffer : public hal::Buffer {
  public:
-  Buffer(std::shared_ptr<Arena> arena, void* base, std::uint64_t size);
+  // The owner keeps the buffer's memory alive: the arena it was made from, or
+  // for imported host memory, an object which releases it.
+  Buffer(std::shared_ptr<void> owner, void* base, std::uint64_t size);
 
   boost::future<void*> MapCurrent(const std::vector<std::shared_ptr<hal::Event>>& deps) final;
   boost::future<void*> MapDiscard(const std::vector<std::shared_ptr<hal::Event>>& deps) final;
@@ -31,7 +33,7 @@ class Buffer : public hal::Buffer {
 
   const std::uint64_t size_;
   void* base_ = nullptr;
-  std::shared_ptr<Arena> arena_;
+  std::shared_ptr<void> owner_;
 };
 
 }  // namespace cpu
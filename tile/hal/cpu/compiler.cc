@@ -5,18 +5,26 @@
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 
 #include <exception>
+#include <iomanip>
 #include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "base/util/env.h"
+#include "base/util/error.h"
 #include "base/util/logging.h"
+#include "base/util/thread_pool.h"
 #include "tile/hal/cpu/emitllvm.h"
 #include "tile/hal/cpu/executable.h"
+#include "tile/hal/cpu/grid_scheduler.h"
 #include "tile/hal/cpu/library.h"
+#include "tile/hal/cpu/object_cache.h"
 #include "tile/hal/cpu/runtime.h"
+#include "tile/lang/fnv1a64.h"
 #include "tile/lang/semprinter.h"
 
 namespace vertexai {
@@ -24,66 +32,177 @@ namespace tile {
 namespace hal {
 namespace cpu {
 
-Compiler::Compiler() {}
+namespace fs = boost::filesystem;
 
-boost::future<std::unique_ptr<hal::Library>> Compiler::Build(const context::Context& ctx,
-                                                             const std::vector<lang::KernelInfo>& kernel_info,
-                                                             const hal::proto::HardwareSettings&) {
+namespace {
+
+void InitializeLLVM() {
   static std::once_flag init_once;
-  static std::shared_ptr<llvm::LLVMContext> llvm_ctx;
   std::call_once(init_once, []() {
     LLVMInitializeNativeTarget();
     LLVMLinkInMCJIT();
     LLVMInitializeNativeAsmPrinter();
     LLVMInitializeNativeAsmParser();
-    llvm_ctx = std::make_shared<llvm::LLVMContext>();
   });
+}
+
+// Computes the cache key for a kernel: its semtree, together with everything
+// else that affects the generated machine code.
+std::string CacheKey(const lang::KernelInfo& ki) {
+  std::stringstream ss;
+  ss << Library::TargetKey() << '\n' << ki.kname << '\n' << sem::Print(*ki.kfunc).str();
+  return ss.str();
+}
+
+// Computes the name of a kernel's file in the cache directory: a hash of its
+// cache key.  Entries record their full key, so hash collisions are detected.
+fs::path CachePath(const fs::path& cache_dir, const std::string& key) {
+  std::stringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << fnv1a64::hash(key.c_str()) << ".o";
+  return cache_dir / name.str();
+}
+
+// Returns the on-disk object cache directory, or an empty path if there isn't one.
+fs::path CacheDir() {
+  fs::path cache_dir;
+  auto env_cache = env::Get("PLAIDML_CPU_CACHE");
+  if (env_cache.length()) {
+    VLOG(1) << "Using CPU kernel cache directory: " << env_cache;
+    cache_dir = env_cache;
+    if (!is_directory(cache_dir)) {
+      cache_dir.clear();
+    }
+  }
+  return cache_dir;
+}
+
+}  // namespace
+
+boost::future<std::unique_ptr<hal::Library>> Compiler::Build(const context::Context& ctx,
+                                                             const std::vector<lang::KernelInfo>& kernel_info,
+                                                             const hal::proto::HardwareSettings&) {
+  InitializeLLVM();
 
   if (!kernel_info.size()) {
     return boost::make_ready_future(std::unique_ptr<hal::Library>{
-        std::make_unique<cpu::Library>(llvm_ctx, std::vector<std::shared_ptr<llvm::ExecutionEngine>>{}, kernel_info)});
+        std::make_unique<cpu::Library>(std::vector<std::shared_ptr<llvm::ExecutionEngine>>{}, kernel_info)});
   }
-  std::vector<std::shared_ptr<llvm::ExecutionEngine>> engines;
-  for (const auto& ki : kernel_info) {
-    BuildKernel(ki, llvm_ctx.get(), &engines);
+
+  context::Activity activity{ctx, "tile::hal::cpu::Build"};
+
+  auto cache_dir = CacheDir();
+
+  // Each kernel is compiled in its own LLVMContext, which lets us build
+  // kernels concurrently; failures are collected and rethrown on this thread.
+  std::vector<std::shared_ptr<llvm::ExecutionEngine>> engines(kernel_info.size());
+  std::vector<std::exception_ptr> errors(kernel_info.size());
+  GridScheduler::Run(SharedThreadPool(), kernel_info.size(), std::thread::hardware_concurrency(),
+                     [&](std::size_t begin, std::size_t end) {
+                       for (std::size_t idx = begin; idx < end; ++idx) {
+                         try {
+                           engines[idx] = BuildKernel(kernel_info[idx], cache_dir, nullptr);
+                         } catch (...) {
+                           errors[idx] = std::current_exception();
+                         }
+                       }
+                     });
+  for (const auto& err : errors) {
+    if (err) {
+      std::rethrow_exception(err);
+    }
   }
-  std::unique_ptr<hal::Library> lib(new cpu::Library(llvm_ctx, engines, kernel_info));
+  std::unique_ptr<hal::Library> lib(new cpu::Library(engines, kernel_info));
   return boost::make_ready_future<>(std::move(lib));
 }
 
-void Compiler::BuildKernel(const lang::KernelInfo& ki, llvm::LLVMContext* context,
-                           std::vector<std::shared_ptr<llvm::ExecutionEngine>>* engines) {
-  if (VLOG_IS_ON(4)) {
-    sem::Print debug_emit(*ki.kfunc);
-    VLOG(4) << "Compiling kernel:\n" << debug_emit.str();
+std::shared_ptr<llvm::ExecutionEngine> Compiler::BuildKernel(const lang::KernelInfo& ki, const fs::path& cache_dir,
+                                                             std::string* object) {
+  assert(ki.kfunc);
+  auto context = std::make_shared<llvm::LLVMContext>();
+  std::unique_ptr<KernelObjectCache> cache;
+  std::unique_ptr<llvm::Module> module;
+  if (cache_dir.empty()) {
+    if (object) {
+      cache = std::make_unique<KernelObjectCache>();
+    }
+  } else {
+    auto key = CacheKey(ki);
+    cache = std::make_unique<KernelObjectCache>(CachePath(cache_dir, key), std::move(key));
   }
 
-  // Generate LLVM IR for the kernel.
-  Emit emit(*context);
-  assert(ki.kfunc);
-  ki.kfunc->Accept(emit);
-  // Generate an invoker function wrapping the kernel params: we will pass in
-  // a pointer to an array of buffer pointers, and it will extract the members.
-  // This way we can use a single C function pointer invocation for all kernels.
-  GenerateInvoker(ki, emit.result().get());
-  if (VLOG_IS_ON(4)) {
-    VLOG(4) << "Generated IR:\n" << emit.str();
+  if (cache && cache->has_object()) {
+    // The cached object supplies all of the kernel's code; MCJIT only needs a
+    // module to hang it on.
+    module = std::make_unique<llvm::Module>(ki.kname, *context);
+  } else {
+    if (VLOG_IS_ON(4)) {
+      sem::Print debug_emit(*ki.kfunc);
+      VLOG(4) << "Compiling kernel:\n" << debug_emit.str();
+    }
+
+    // Generate LLVM IR for the kernel.
+    Emit emit(*context);
+    ki.kfunc->Accept(emit);
+    // Generate an invoker function wrapping the kernel params: we will pass in
+    // a pointer to an array of buffer pointers, and it will extract the members.
+    // This way we can use a single C function pointer invocation for all kernels.
+    GenerateInvoker(ki, emit.result().get());
+    if (VLOG_IS_ON(4)) {
+      VLOG(4) << "Generated IR:\n" << emit.str();
+    }
+    module = std::move(emit.result());
+  }
+
+  auto engine = MakeEngine(std::move(context), std::move(module), cache.get());
+  if (object) {
+    *object = cache->object();
+  }
+  return engine;
+}
+
+std::string Compiler::CompileObject(const lang::KernelInfo& ki) {
+  InitializeLLVM();
+  std::string object;
+  BuildKernel(ki, CacheDir(), &object);
+  return object;
+}
+
+std::shared_ptr<llvm::ExecutionEngine> Compiler::LoadKernel(const std::string& kname, std::string object) {
+  InitializeLLVM();
+
+  // As with a cached kernel, the object supplies all of the kernel's code.
+  if (!KernelObjectCache::IsValidObject(object)) {
+    throw error::DataLoss{"Serialized CPU kernel " + kname + " is not a valid object"};
   }
+  auto context = std::make_shared<llvm::LLVMContext>();
+  auto module = std::make_unique<llvm::Module>(kname, *context);
+  KernelObjectCache cache;
+  cache.set_object(std::move(object));
+  return MakeEngine(std::move(context), std::move(module), &cache);
+}
+
+std::shared_ptr<llvm::ExecutionEngine> Compiler::MakeEngine(std::shared_ptr<llvm::LLVMContext> context,
+                                                            std::unique_ptr<llvm::Module> module,
+                                                            llvm::ObjectCache* cache) {
   // Compile the IR into executable code.
   std::string errStr;
   std::unique_ptr<llvm::LegacyJITSymbolResolver> rez(new Runtime);
-  llvm::ExecutionEngine* ee = llvm::EngineBuilder(std::move(emit.result()))
+  llvm::ExecutionEngine* ee = llvm::EngineBuilder(std::move(module))
                                   .setErrorStr(&errStr)
                                   .setEngineKind(llvm::EngineKind::JIT)
                                   .setVerifyModules(true)
                                   .setSymbolResolver(std::move(rez))
                                   .create();
-  if (ee) {
-    ee->finalizeObject();
-    engines->emplace_back(ee);
-  } else {
-    std::cerr << "Failed to create ExecutionEngine: " << errStr << std::endl;
+  if (!ee) {
+    throw std::runtime_error("Failed to create ExecutionEngine: " + errStr);
   }
+  ee->setObjectCache(cache);
+  ee->finalizeObject();
+  ee->setObjectCache(nullptr);
+
+  // The engine's module belongs to the context, so the context must outlive
+  // the engine; the deleter holds the last reference to it.
+  return std::shared_ptr<llvm::ExecutionEngine>(ee, [context](llvm::ExecutionEngine* engine) { delete engine; });
 }
 
 void Compiler::GenerateInvoker(const lang::KernelInfo& ki, llvm::Module* module) {
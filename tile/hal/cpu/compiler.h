@@ -3,14 +3,18 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <vector>
 
+#include <boost/filesystem.hpp>
+
 #include "tile/base/hal.h"
 
 namespace llvm {
 class ExecutionEngine;
 class LLVMContext;
 class Module;
+class ObjectCache;
 }  // namespace llvm
 
 namespace vertexai {
@@ -20,16 +24,30 @@ namespace cpu {
 
 class Compiler final : public hal::Compiler {
  public:
-  Compiler();
 
   boost::future<std::unique_ptr<hal::Library>> Build(const context::Context& ctx,
                                                      const std::vector<lang::KernelInfo>& kernels,
                                                      const hal::proto::HardwareSettings& /* settings */) final;
 
+  // Compiles a kernel's object code, for serialization.  Build doesn't retain its kernels' object code, since it's
+  // rarely needed; with the on-disk object cache enabled, this usually just reads it back.
+  static std::string CompileObject(const lang::KernelInfo& ki);
+
+  // Creates an execution engine for a kernel from object code produced by CompileObject.  Throws error::DataLoss if
+  // the object code isn't a valid object.
+  static std::shared_ptr<llvm::ExecutionEngine> LoadKernel(const std::string& kname, std::string object);
+
  private:
-  void BuildKernel(const lang::KernelInfo&, llvm::LLVMContext* llvm_ctx,
-                   std::vector<std::shared_ptr<llvm::ExecutionEngine>>* engines);
-  void GenerateInvoker(const lang::KernelInfo&, llvm::Module*);
+  // Builds a single kernel in its own LLVMContext, storing its object code in *object if object is non-null.  If
+  // cache_dir is non-empty, machine code is loaded from (or saved to) the on-disk object cache there.
+  static std::shared_ptr<llvm::ExecutionEngine> BuildKernel(const lang::KernelInfo&,
+                                                            const boost::filesystem::path& cache_dir,
+                                                            std::string* object);
+  static void GenerateInvoker(const lang::KernelInfo&, llvm::Module*);
+
+  static std::shared_ptr<llvm::ExecutionEngine> MakeEngine(std::shared_ptr<llvm::LLVMContext> context,
+                                                           std::unique_ptr<llvm::Module> module,
+                                                           llvm::ObjectCache* cache);
 };
 
 }  // namespace cpu
@@ -4,18 +4,15 @@
 
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 
-#include <algorithm>
-#include <condition_variable>
-#include <mutex>
-#include <thread>
 #include <utility>
 
-#include <boost/asio.hpp>
-#include <boost/asio/thread_pool.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "base/util/error.h"
+#include "base/util/thread_pool.h"
 #include "tile/hal/cpu/buffer.h"
 #include "tile/hal/cpu/event.h"
+#include "tile/hal/cpu/grid_scheduler.h"
 #include "tile/hal/cpu/runtime.h"
 
 namespace vertexai {
@@ -35,10 +32,8 @@ const size_t physical_cores_ = boost::thread::physical_concurrency();
 
 }  // namespace
 
-Executable::Executable(std::shared_ptr<llvm::LLVMContext> llvm_ctx,
-                       std::vector<std::shared_ptr<llvm::ExecutionEngine>> engines, std::vector<lang::KernelInfo> kis,
-                       std::shared_ptr<boost::asio::thread_pool> thread_pool)
-    : llvm_context_{llvm_ctx}, engines_{engines}, kis_(kis), thread_pool_(thread_pool) {}
+Executable::Executable(std::vector<std::shared_ptr<llvm::ExecutionEngine>> engines, std::vector<lang::KernelInfo> kis)
+    : engines_{engines}, kis_(kis) {}
 
 std::shared_ptr<hal::Event> Executable::Run(const context::Context& ctx, std::size_t kidx,
                                             const std::vector<std::shared_ptr<hal::Buffer>>& params,
@@ -48,7 +43,7 @@ std::shared_ptr<hal::Event> Executable::Run(const context::Context& ctx, std::si
   std::vector<std::shared_ptr<hal::Buffer>> param_refs{params};
   auto deps = Event::WaitFor(dependencies);
   auto evt = deps.then([params = std::move(param_refs), act = std::move(activity), engine = engines_[kidx],
-                        invoker_name = InvokerName(kis_[kidx].kname), thread_pool = thread_pool_,
+                        invoker_name = InvokerName(kis_[kidx].kname),
                         gwork = kis_[kidx].gwork](decltype(deps) future) -> std::shared_ptr<hal::Result> {
     future.get();
     auto start = std::chrono::high_resolution_clock::now();
@@ -61,40 +56,29 @@ std::shared_ptr<hal::Event> Executable::Run(const context::Context& ctx, std::si
     void* argvec = args.data();
     uint64_t entrypoint = engine->getFunctionAddress(invoker_name);
     // Iterate through the grid coordinates specified for this kernel, invoking
-    // the kernel function once for each. We'll create one thread per core and
-    // run one loop in each thread, staggering kernel invocations accordingly.
+    // the kernel function once for each. The grid is split into contiguous
+    // chunks which are balanced across one worker per core; within a chunk, we
+    // step the grid index incrementally rather than recomputing it.
     size_t iterations = gwork[0] * gwork[1] * gwork[2];
     lang::GridSize denom = {{gwork[2] * gwork[1], gwork[2], 1}};
-    size_t threads = std::min(iterations, physical_cores_);
-
-    // The condition variable will guard the completion count. Each worker
-    // will increment the completion count, and we'll wait until it reaches
-    // the number of threads before returning.
-    std::mutex mutex;
-    std::condition_variable cv;
-    size_t completed = 0;
-
-    for (size_t offset = 0; offset < threads; ++offset) {
-      boost::asio::post(*thread_pool, [=, &mutex, &cv, &completed]() {
-        for (size_t i = offset; i < iterations; i += threads) {
-          lang::GridSize index;
-          index[0] = i / denom[0] % gwork[0];
-          index[1] = i / denom[1] % gwork[1];
-          index[2] = i / denom[2] % gwork[2];
-          ((void (*)(void*, lang::GridSize*))entrypoint)(argvec, &index);
-        }
-        {
-          std::unique_lock<std::mutex> lock{mutex};
-          if (++completed == threads) {
-            cv.notify_all();
+    auto kernel = reinterpret_cast<void (*)(void*, lang::GridSize*)>(entrypoint);
+
+    GridScheduler::Run(SharedThreadPool(), iterations, physical_cores_, [&](size_t begin, size_t end) {
+      lang::GridSize index;
+      index[0] = begin / denom[0] % gwork[0];
+      index[1] = begin / denom[1] % gwork[1];
+      index[2] = begin / denom[2] % gwork[2];
+      for (size_t i = begin; i < end; ++i) {
+        kernel(argvec, &index);
+        if (++index[2] == gwork[2]) {
+          index[2] = 0;
+          if (++index[1] == gwork[1]) {
+            index[1] = 0;
+            ++index[0];
           }
         }
-      });
-    }
-    {
-      std::unique_lock<std::mutex> lock{mutex};
-      cv.wait(lock, [&]() { return threads <= completed; });
-    }
+      }
+    });
 
     return std::make_shared<Result>(act.ctx(), "tile::hal::cpu::Executing", start,
                                     std::chrono::high_resolution_clock::now());
@@ -7,13 +7,10 @@
 #include <string>
 #include <vector>
 
-#include <boost/asio/thread_pool.hpp>
-
 #include "tile/base/hal.h"
 
 namespace llvm {
 class ExecutionEngine;
-class LLVMContext;
 }  // namespace llvm
 
 namespace vertexai {
@@ -23,9 +20,7 @@ namespace cpu {
 
 class Executable final : public hal::Executable {
  public:
-  Executable(std::shared_ptr<llvm::LLVMContext> llvm_context,
-             std::vector<std::shared_ptr<llvm::ExecutionEngine>> engines, std::vector<lang::KernelInfo> kis,
-             std::shared_ptr<boost::asio::thread_pool> thread_pool);
+  Executable(std::vector<std::shared_ptr<llvm::ExecutionEngine>> engines, std::vector<lang::KernelInfo> kis);
   virtual ~Executable();
 
   std::shared_ptr<hal::Event> Run(const context::Context& ctx, std::size_t kidx,
@@ -36,10 +31,8 @@ class Executable final : public hal::Executable {
   static std::string InvokerName(std::string kname);
 
  private:
-  std::shared_ptr<llvm::LLVMContext> llvm_context_;
   std::vector<std::shared_ptr<llvm::ExecutionEngine>> engines_;
   std::vector<lang::KernelInfo> kis_;
-  std::shared_ptr<boost::asio::thread_pool> thread_pool_;
 };
 
 }  // namespace cpu
@@ -74,7 +74,7 @@ hal::proto::HardwareInfo GetHardwareInfo() {
 
 }  // namespace
 
-Executor::Executor() : info_{GetHardwareInfo()}, memory_{new Memory()}, thread_pool_{new boost::asio::thread_pool} {}
+Executor::Executor() : info_{GetHardwareInfo()}, memory_{new Memory()} {}
 
 std::shared_ptr<hal::Event> Executor::Copy(const context::Context& ctx, const std::shared_ptr<hal::Buffer>& from,
                                            std::size_t from_offset, const std::shared_ptr<hal::Buffer>& to,
@@ -103,7 +103,7 @@ std::shared_ptr<hal::Event> Executor::Copy(const context::Context& ctx, const st
 
 boost::future<std::unique_ptr<hal::Executable>> Executor::Prepare(hal::Library* library) {
   auto lib = Library::Downcast(library);
-  auto k = std::make_unique<cpu::Executable>(lib->llvm_context(), lib->engines(), lib->kernels(), thread_pool_);
+  auto k = std::make_unique<cpu::Executable>(lib->engines(), lib->kernels());
   return boost::make_ready_future(std::unique_ptr<hal::Executable>(std::move(k)));
 }
 
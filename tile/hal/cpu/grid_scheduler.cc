@@ -0,0 +1,133 @@
+// Copyright 2018 Intel Corporation.
+
+#include "tile/hal/cpu/grid_scheduler.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <boost/asio.hpp>
+
+namespace vertexai {
+namespace tile {
+namespace hal {
+namespace cpu {
+namespace {
+
+// A run of chunks is packed into a single word: the begin index in the high
+// half, the end index in the low half.
+std::uint64_t PackRun(std::uint64_t begin, std::uint64_t end) { return (begin << 32) | end; }
+std::uint64_t RunBegin(std::uint64_t run) { return run >> 32; }
+std::uint64_t RunEnd(std::uint64_t run) { return run & 0xFFFFFFFF; }
+
+}  // namespace
+
+struct GridScheduler::State {
+  State(const ChunkFunction& fn_, std::size_t items_, std::size_t workers_)
+      : fn{fn_}, items{items_}, workers{workers_}, runs(workers_), remaining{items_} {
+    chunk_size = std::max<std::size_t>(1, items / (workers * kChunksPerWorker));
+    std::size_t chunks = (items + chunk_size - 1) / chunk_size;
+    for (std::size_t w = 0; w < workers; ++w) {
+      runs[w].store(PackRun(w * chunks / workers, (w + 1) * chunks / workers), std::memory_order_relaxed);
+    }
+  }
+
+  // Pops the first chunk from the worker's own run.
+  bool Pop(std::size_t worker, std::size_t* chunk) {
+    auto& run = runs[worker];
+    std::uint64_t cur = run.load(std::memory_order_acquire);
+    for (;;) {
+      auto begin = RunBegin(cur);
+      auto end = RunEnd(cur);
+      if (end <= begin) {
+        return false;
+      }
+      if (run.compare_exchange_weak(cur, PackRun(begin + 1, end), std::memory_order_acq_rel)) {
+        *chunk = begin;
+        return true;
+      }
+    }
+  }
+
+  // Steals the back half of the victim's run.
+  bool Steal(std::size_t victim, std::uint64_t* stolen) {
+    auto& run = runs[victim];
+    std::uint64_t cur = run.load(std::memory_order_acquire);
+    for (;;) {
+      auto begin = RunBegin(cur);
+      auto end = RunEnd(cur);
+      if (end <= begin) {
+        return false;
+      }
+      auto split = end - (end - begin + 1) / 2;
+      if (run.compare_exchange_weak(cur, PackRun(begin, split), std::memory_order_acq_rel)) {
+        *stolen = PackRun(split, end);
+        return true;
+      }
+    }
+  }
+
+  void Execute(std::size_t chunk) {
+    std::size_t begin = chunk * chunk_size;
+    std::size_t end = std::min(items, begin + chunk_size);
+    fn(begin, end);
+    std::size_t count = end - begin;
+    if (remaining.fetch_sub(count, std::memory_order_acq_rel) == count) {
+      done.set_value();
+    }
+  }
+
+  ChunkFunction fn;
+  std::size_t items;
+  std::size_t workers;
+  std::size_t chunk_size;
+  std::vector<std::atomic<std::uint64_t>> runs;
+  std::atomic<std::size_t> remaining;
+  std::promise<void> done;
+};
+
+void GridScheduler::Run(boost::asio::thread_pool* thread_pool, std::size_t items, std::size_t workers,
+                        const ChunkFunction& fn) {
+  if (!items) {
+    return;
+  }
+  workers = std::max<std::size_t>(1, std::min(workers, items));
+  if (workers == 1) {
+    fn(0, items);
+    return;
+  }
+  auto state = std::make_shared<State>(fn, items, workers);
+  auto done = state->done.get_future();
+  for (std::size_t w = 1; w < workers; ++w) {
+    boost::asio::post(*thread_pool, [state, w]() { Work(state, w); });
+  }
+  Work(state, 0);
+  done.wait();
+}
+
+void GridScheduler::Work(const std::shared_ptr<State>& state, std::size_t worker) {
+  for (;;) {
+    std::size_t chunk;
+    while (state->Pop(worker, &chunk)) {
+      state->Execute(chunk);
+    }
+    // Our own run is empty, so no other worker can modify it; we may install a
+    // stolen run with a plain store.
+    bool stole = false;
+    for (std::size_t offset = 1; offset < state->workers; ++offset) {
+      std::uint64_t stolen;
+      if (state->Steal((worker + offset) % state->workers, &stolen)) {
+        state->runs[worker].store(stolen, std::memory_order_release);
+        stole = true;
+        break;
+      }
+    }
+    if (!stole) {
+      return;
+    }
+  }
+}
+
+}  // namespace cpu
+}  // namespace hal
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,57 @@
+// Copyright 2018 Intel Corporation.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <boost/asio/thread_pool.hpp>
+
+namespace vertexai {
+namespace tile {
+namespace hal {
+namespace cpu {
+
+// GridScheduler distributes a linear range of work items across a thread pool.
+//
+// The range is cut into contiguous chunks, and each worker starts out owning
+// an equal, contiguous run of those chunks.  A worker pops chunks from the
+// front of its own run; when its run is exhausted, it steals the back half of
+// some other worker's remaining run.  This keeps neighbouring work items on
+// the same thread (which is good for the cache) while still balancing skewed
+// workloads, where some chunks take much longer than others.
+//
+// Each run is a single 64-bit word (the begin and end chunk indices), updated
+// with compare-and-swap, so neither popping nor stealing takes a lock.
+// Completion is tracked by an atomic countdown of unfinished work items; the
+// worker that retires the last item releases the caller.
+class GridScheduler final {
+ public:
+  // The chunk function is called with a half-open [begin, end) range of work
+  // item indices.
+  using ChunkFunction = std::function<void(std::size_t begin, std::size_t end)>;
+
+  // Runs fn over [0, items) using up to `workers` workers.  The calling thread
+  // participates as one of the workers; the remaining workers are posted to
+  // the thread pool.  Returns once every work item has been processed.
+  static void Run(boost::asio::thread_pool* thread_pool, std::size_t items, std::size_t workers,
+                  const ChunkFunction& fn);
+
+  // The number of chunks each worker is initially assigned.  More chunks means
+  // finer-grained balancing at the cost of more scheduling operations.
+  static constexpr std::size_t kChunksPerWorker = 8;
+
+ private:
+  struct State;
+
+  static void Work(const std::shared_ptr<State>& state, std::size_t worker);
+};
+
+}  // namespace cpu
+}  // namespace hal
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,78 @@
+// Copyright 2018 Intel Corporation.
+
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+#include <boost/asio.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "base/util/logging.h"
+#include "testing/benchmark.h"
+#include "tile/hal/cpu/grid_scheduler.h"
+
+namespace vertexai {
+namespace tile {
+namespace hal {
+namespace cpu {
+namespace {
+
+// Burns a deterministic amount of CPU; the volatile keeps it from being optimized away.
+void Spin(std::size_t iterations) {
+  volatile std::size_t sink = 0;
+  for (std::size_t i = 0; i < iterations; ++i) {
+    sink = sink + i;
+  }
+}
+
+// Models an imbalanced grid: the last eighth of the work items (the "edge
+// tiles") are much more expensive than the rest.
+std::size_t ItemCost(std::size_t item, std::size_t items) { return item < items - items / 8 ? 2000 : 40000; }
+
+// The dispatch strategy GridScheduler replaced: a fixed stride per thread.
+void RunStrided(boost::asio::thread_pool* pool, std::size_t items, std::size_t threads) {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::size_t completed = 0;
+  for (std::size_t offset = 0; offset < threads; ++offset) {
+    boost::asio::post(*pool, [=, &mutex, &cv, &completed]() {
+      for (std::size_t i = offset; i < items; i += threads) {
+        Spin(ItemCost(i, items));
+      }
+      std::unique_lock<std::mutex> lock{mutex};
+      if (++completed == threads) {
+        cv.notify_all();
+      }
+    });
+  }
+  std::unique_lock<std::mutex> lock{mutex};
+  cv.wait(lock, [&]() { return threads <= completed; });
+}
+
+TEST(GridSchedulerBenchmark, ImbalancedGrid) {
+  const std::size_t items = 4096;
+  const std::size_t kWarmup = 1;
+  const std::size_t kIterations = 5;
+  const std::size_t threads = std::max<std::size_t>(2, boost::thread::physical_concurrency());
+  boost::asio::thread_pool pool;
+
+  auto strided = testing::MeanTime(kWarmup, kIterations, [&](std::size_t) { RunStrided(&pool, items, threads); });
+  auto stealing = testing::MeanTime(kWarmup, kIterations, [&](std::size_t) {
+    GridScheduler::Run(&pool, items, threads, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        Spin(ItemCost(i, items));
+      }
+    });
+  });
+
+  LOG(INFO) << "Imbalanced grid of " << items << " items on " << threads << " threads: strided=" << strided.count()
+            << "us work-stealing=" << stealing.count() << "us speedup=" << strided / stealing;
+}
+
+}  // namespace
+}  // namespace cpu
+}  // namespace hal
+}  // namespace tile
+}  // namespace vertexai
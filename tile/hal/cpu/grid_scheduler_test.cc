@@ -0,0 +1,54 @@
+// Copyright 2018 Intel Corporation.
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "tile/hal/cpu/grid_scheduler.h"
+
+using ::testing::Each;
+using ::testing::Eq;
+using ::testing::Values;
+
+namespace vertexai {
+namespace tile {
+namespace hal {
+namespace cpu {
+namespace {
+
+class GridSchedulerTest : public ::testing::TestWithParam<std::size_t> {
+ protected:
+  boost::asio::thread_pool pool_;
+};
+
+TEST_P(GridSchedulerTest, VisitsEachItemOnce) {
+  const std::size_t workers = 4;
+  std::size_t items = GetParam();
+  std::vector<std::atomic<int>> visits(items);
+  for (auto& v : visits) {
+    v = 0;
+  }
+  GridScheduler::Run(&pool_, items, workers, [&](std::size_t begin, std::size_t end) {
+    ASSERT_LE(begin, end);
+    ASSERT_LE(end, items);
+    for (std::size_t i = begin; i < end; ++i) {
+      ++visits[i];
+    }
+  });
+  std::vector<int> counts;
+  for (auto& v : visits) {
+    counts.push_back(v);
+  }
+  EXPECT_THAT(counts, Each(Eq(1)));
+}
+
+INSTANTIATE_TEST_CASE_P(Sizes, GridSchedulerTest, Values(0, 1, 3, 4, 31, 1000, 65537));
+
+}  // namespace
+}  // namespace cpu
+}  // namespace hal
+}  // namespace tile
+}  // namespace vertexai
@@ -2,31 +2,76 @@
 
 #include "tile/hal/cpu/library.h"
 
+#include <llvm/Config/llvm-config.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/Support/Host.h>
+
 #include <utility>
 
 #include "base/util/error.h"
+#include "tile/hal/cpu/compiler.h"
+#include "tile/hal/cpu/serialize.h"
 
 namespace vertexai {
 namespace tile {
 namespace hal {
 namespace cpu {
 
+namespace {
+
+constexpr char kLibraryName[] = "serialized CPU library";
+
+}  // namespace
+
 Library* Library::Downcast(hal::Library* library) {
   Library* exe = dynamic_cast<Library*>(library);
   return exe;
 }
 
-Library::Library(std::shared_ptr<llvm::LLVMContext> context,
-                 const std::vector<std::shared_ptr<llvm::ExecutionEngine>>& engines,
-                 const std::vector<lang::KernelInfo>& kernels)
-    : context_{context}, engines_{engines}, kernels_{kernels} {}
+Library::Library(const std::vector<std::shared_ptr<llvm::ExecutionEngine>>& engines,
+                 const std::vector<lang::KernelInfo>& kernels, std::vector<std::string> objects)
+    : engines_{engines}, kernels_{kernels}, objects_{std::move(objects)} {}
+
+Library::~Library() {}
+
+std::string Library::Serialize() {
+  std::string result;
+  AppendString(&result, TargetKey());
+  AppendString(&result, std::to_string(kernels_.size()));
+  for (std::size_t kidx = 0; kidx < kernels_.size(); ++kidx) {
+    std::string object;
+    if (kidx < objects_.size()) {
+      object = objects_[kidx];
+    } else if (kernels_[kidx].kfunc) {
+      object = Compiler::CompileObject(kernels_[kidx]);
+    }
+    if (object.empty()) {
+      return std::string{};
+    }
+    AppendString(&result, kernels_[kidx].kname);
+    AppendString(&result, object);
+  }
+  return result;
+}
+
+std::vector<std::pair<std::string, std::string>> Library::Parse(const std::string& serialized) {
+  std::size_t pos = 0;
+  if (ReadString(serialized, &pos, kLibraryName) != TargetKey()) {
+    throw error::Unavailable{"Serialized CPU library was compiled for a different target"};
+  }
+  std::size_t count = std::stoull(ReadString(serialized, &pos, kLibraryName));
+  std::vector<std::pair<std::string, std::string>> kernels;
+  for (std::size_t kidx = 0; kidx < count; ++kidx) {
+    auto kname = ReadString(serialized, &pos, kLibraryName);
+    auto object = ReadString(serialized, &pos, kLibraryName);
+    kernels.emplace_back(std::move(kname), std::move(object));
+  }
+  return kernels;
+}
 
-Library::~Library() {
-  // release all of the ExecutionEngine instances first, before the LLVMContext,
-  // because each ExecutionEngine is associated with an llvm::Module, and
-  // modules must not outlive their LLVMContext.
-  engines_.clear();
+std::string Library::TargetKey() {
+  return std::string{LLVM_VERSION_STRING} + '\n' + llvm::sys::getProcessTriple() + '\n' +
+         llvm::sys::getHostCPUName().str();
 }
 
 }  // namespace cpu
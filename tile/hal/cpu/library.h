@@ -4,6 +4,7 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "tile/base/hal.h"
@@ -11,7 +12,6 @@
 
 namespace llvm {
 class ExecutionEngine;
-class LLVMContext;
 }  // namespace llvm
 
 namespace vertexai {
@@ -23,21 +23,30 @@ class Library final : public hal::Library {
  public:
   static Library* Downcast(hal::Library* library);
 
-  Library(std::shared_ptr<llvm::LLVMContext> context,
-          const std::vector<std::shared_ptr<llvm::ExecutionEngine>>& engines,
-          const std::vector<lang::KernelInfo>& kernels);
+  // The objects are the kernels' object code, if it's already at hand (i.e. when the library is itself being loaded
+  // from a serialized library); otherwise, it's compiled when the library is serialized.
+  Library(const std::vector<std::shared_ptr<llvm::ExecutionEngine>>& engines,
+          const std::vector<lang::KernelInfo>& kernels, std::vector<std::string> objects = {});
   virtual ~Library();
 
-  std::string Serialize() final { return ""; }
+  // Serializes the library as the target it was compiled for, followed by each kernel's name and object code.
+  // Returns an empty string if any kernel's object code is unavailable.
+  std::string Serialize() final;
+
+  // Parses a serialized library into its kernels' names and object code.  Throws error::Unavailable if the library
+  // was compiled for a different target.
+  static std::vector<std::pair<std::string, std::string>> Parse(const std::string& serialized);
+
+  // Identifies the target that kernels are compiled for.
+  static std::string TargetKey();
 
-  std::shared_ptr<llvm::LLVMContext> llvm_context() { return context_; }
   const std::vector<std::shared_ptr<llvm::ExecutionEngine>>& engines() { return engines_; }
   const std::vector<lang::KernelInfo>& kernels() { return kernels_; }
 
  private:
-  std::shared_ptr<llvm::LLVMContext> context_;
   std::vector<std::shared_ptr<llvm::ExecutionEngine>> engines_;
   std::vector<lang::KernelInfo> kernels_;
+  std::vector<std::string> objects_;
 };
 
 }  // namespace cpu
@@ -0,0 +1,45 @@
+// Copyright 2017-2018 Intel Corporation.
+
+#include "tile/hal/cpu/loader.h"
+
+#include <utility>
+
+#include "base/util/error.h"
+#include "tile/hal/cpu/compiler.h"
+#include "tile/hal/cpu/library.h"
+
+namespace vertexai {
+namespace tile {
+namespace hal {
+namespace cpu {
+
+boost::future<std::unique_ptr<hal::Library>> Loader::Deserialize(const context::Context& ctx,
+                                                                 const std::string& serialized_executable,
+                                                                 const std::vector<lang::KernelInfo>& kernel_info) {
+  context::Activity activity{ctx, "tile::hal::cpu::Deserialize"};
+
+  auto kernels = Library::Parse(serialized_executable);
+  if (kernels.size() != kernel_info.size()) {
+    throw error::InvalidArgument{"Serialized CPU library has " + std::to_string(kernels.size()) +
+                                 " kernels; expected " + std::to_string(kernel_info.size())};
+  }
+
+  std::vector<std::shared_ptr<llvm::ExecutionEngine>> engines;
+  std::vector<std::string> objects;
+  for (std::size_t kidx = 0; kidx < kernels.size(); ++kidx) {
+    if (kernels[kidx].first != kernel_info[kidx].kname) {
+      throw error::InvalidArgument{"Serialized CPU library kernel " + kernels[kidx].first +
+                                   " doesn't match kernel " + kernel_info[kidx].kname};
+    }
+    engines.emplace_back(Compiler::LoadKernel(kernels[kidx].first, kernels[kidx].second));
+    objects.emplace_back(std::move(kernels[kidx].second));
+  }
+
+  std::unique_ptr<hal::Library> lib(new cpu::Library(engines, kernel_info, std::move(objects)));
+  return boost::make_ready_future<>(std::move(lib));
+}
+
+}  // namespace cpu
+}  // namespace hal
+}  // namespace tile
+}  // namespace vertexai
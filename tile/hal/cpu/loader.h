@@ -0,0 +1,28 @@
+// Copyright 2017-2018 Intel Corporation.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tile/base/hal.h"
+
+namespace vertexai {
+namespace tile {
+namespace hal {
+namespace cpu {
+
+// Loader restores libraries serialized by cpu::Library::Serialize, loading the kernels' object code without
+// regenerating or recompiling it.
+class Loader final : public hal::Loader {
+ public:
+  boost::future<std::unique_ptr<hal::Library>> Deserialize(const context::Context& ctx,
+                                                           const std::string& serialized_executable,
+                                                           const std::vector<lang::KernelInfo>& kernel_info) final;
+};
+
+}  // namespace cpu
+}  // namespace hal
+}  // namespace tile
+}  // namespace vertexai
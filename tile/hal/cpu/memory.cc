@@ -2,8 +2,12 @@
 
 #include "tile/hal/cpu/memory.h"
 
+#include <cstdint>
+#include <ratio>
+#include <string>
 #include <utility>
 
+#include "base/util/error.h"
 #include "tile/hal/cpu/arena.h"
 #include "tile/hal/cpu/buffer.h"
 
@@ -11,13 +15,43 @@ namespace vertexai {
 namespace tile {
 namespace hal {
 namespace cpu {
+namespace {
+
+std::uint64_t GetSizeGoal() {
+  std::uint64_t size = Allocator::PhysicalMemorySize();
+  if (!size) {
+    // The physical memory size is unavailable; assume a reasonably-sized host.
+    return 16 * std::giga::num;
+  }
+  return size;
+}
+
+}  // namespace
+
+// Only standalone buffers are cached by the allocator, up to an eighth of the size goal; arenas are cached by the
+// platform's MemCache under its own budget, so no freed memory is held by both.
+Memory::Memory() : size_goal_{GetSizeGoal()}, allocator_{std::make_shared<Allocator>(size_goal_ / 8)} {}
 
 std::shared_ptr<hal::Buffer> Memory::MakeBuffer(std::uint64_t size, BufferAccessMask /* access */) {
-  return std::make_shared<Arena>(size)->MakeBuffer(0, size);
+  return std::make_shared<Arena>(allocator_, size, true)->MakeBuffer(0, size);
 }
 
 std::shared_ptr<hal::Arena> Memory::MakeArena(std::uint64_t size, BufferAccessMask /* access */) {
-  return std::make_shared<Arena>(size);
+  return std::make_shared<Arena>(allocator_, size, false);
+}
+
+std::shared_ptr<hal::Buffer> Memory::ImportHostBuffer(void* base, std::uint64_t size, std::function<void()> release) {
+  // Kernels may use aligned vector accesses, so imported memory needs the same alignment as arena memory.
+  if (!base || reinterpret_cast<std::uintptr_t>(base) % Allocator::kAlignment) {
+    throw error::InvalidArgument{"Host memory must be aligned to " + std::to_string(Allocator::kAlignment) +
+                                 " bytes to be used in place"};
+  }
+  std::shared_ptr<void> owner{base, [release = std::move(release)](void*) {
+                                if (release) {
+                                  release();
+                                }
+                              }};
+  return std::make_shared<Buffer>(std::move(owner), base, size);
 }
 
 }  // namespace cpu
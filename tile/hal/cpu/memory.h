@@ -5,9 +5,9 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
-#include <ratio>
 
 #include "tile/base/hal.h"
+#include "tile/hal/cpu/allocator.h"
 
 namespace vertexai {
 namespace tile {
@@ -16,17 +16,19 @@ namespace cpu {
 
 class Memory final : public hal::Memory {
  public:
-  Memory() {}
+  Memory();
 
-  std::uint64_t size_goal() const final {
-    // TODO: Actually query the system physical memory size.
-    return 16 * std::giga::num;
-  }
+  std::uint64_t size_goal() const final { return size_goal_; }
   BufferAccessMask AllowedAccesses() const final { return BufferAccessMask::ALL; }
-  std::size_t ArenaBufferAlignment() const final { return alignof(long double); /* TODO: Use std::max_align_t */ }
+  std::size_t ArenaBufferAlignment() const final { return Allocator::kAlignment; }
 
   std::shared_ptr<hal::Buffer> MakeBuffer(std::uint64_t size, BufferAccessMask access) final;
   std::shared_ptr<hal::Arena> MakeArena(std::uint64_t size, BufferAccessMask access) final;
+  std::shared_ptr<hal::Buffer> ImportHostBuffer(void* base, std::uint64_t size, std::function<void()> release) final;
+
+ private:
+  const std::uint64_t size_goal_;
+  std::shared_ptr<Allocator> allocator_;
 };
 
 }  // namespace cpu
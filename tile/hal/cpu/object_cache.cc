@@ -0,0 +1,98 @@
+// Copyright 2018 Intel Corporation.
+
+#include "tile/hal/cpu/object_cache.h"
+
+#include <llvm/IR/Module.h>
+#include <llvm/Object/ObjectFile.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <exception>
+#include <utility>
+
+#include "base/util/error.h"
+#include "base/util/file.h"
+#include "base/util/logging.h"
+#include "tile/hal/cpu/serialize.h"
+
+namespace vertexai {
+namespace tile {
+namespace hal {
+namespace cpu {
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// A cache file holds the magic, the key, and the object, each preceded by its size.
+constexpr char kMagic[] = "PlaidML CPU kernel object v1";
+constexpr char kEntryName[] = "CPU kernel object cache entry";
+
+}  // namespace
+
+KernelObjectCache::KernelObjectCache(fs::path path, std::string key) : path_{std::move(path)}, key_{std::move(key)} {
+  if (!fs::is_regular_file(path_)) {
+    return;
+  }
+  try {
+    auto entry = ReadFile(path_, true);
+    std::size_t pos = 0;
+    if (ReadString(entry, &pos, kEntryName) != kMagic) {
+      throw error::DataLoss{"Not a CPU kernel object cache entry"};
+    }
+    if (ReadString(entry, &pos, kEntryName) != key_) {
+      VLOG(1) << "CPU kernel object cache entry " << path_ << " is for a different kernel";
+      return;
+    }
+    auto object = ReadString(entry, &pos, kEntryName);
+    if (pos != entry.size() || !IsValidObject(object)) {
+      throw error::DataLoss{"Corrupt CPU kernel object cache entry"};
+    }
+    VLOG(1) << "Reading CPU kernel object from cache: " << path_;
+    object_ = std::move(object);
+  } catch (const std::exception& ex) {
+    LOG(WARNING) << "Unable to read CPU kernel object cache entry " << path_ << ": " << ex.what();
+  }
+}
+
+bool KernelObjectCache::IsValidObject(const std::string& object) {
+  auto parsed = llvm::object::ObjectFile::createObjectFile(llvm::MemoryBufferRef{object, "kernel"});
+  if (!parsed) {
+    llvm::consumeError(parsed.takeError());
+    return false;
+  }
+  return true;
+}
+
+void KernelObjectCache::notifyObjectCompiled(const llvm::Module* /* module */, llvm::MemoryBufferRef obj) {
+  object_.assign(obj.getBufferStart(), obj.getBufferSize());
+  if (path_.empty()) {
+    return;
+  }
+  // Write to a unique temporary file and rename it into place, so that
+  // concurrent processes sharing the cache never observe a partial object.
+  VLOG(1) << "Writing CPU kernel object to cache: " << path_;
+  try {
+    std::string entry;
+    AppendString(&entry, kMagic);
+    AppendString(&entry, key_);
+    AppendString(&entry, object_);
+    fs::path tmp_path = path_;
+    tmp_path += fs::unique_path(".%%%%-%%%%-%%%%.tmp");
+    WriteFile(tmp_path, entry, true);
+    fs::rename(tmp_path, path_);
+  } catch (const std::exception& ex) {
+    LOG(WARNING) << "Unable to write CPU kernel object cache entry " << path_ << ": " << ex.what();
+  }
+}
+
+std::unique_ptr<llvm::MemoryBuffer> KernelObjectCache::getObject(const llvm::Module* module) {
+  if (object_.empty()) {
+    return nullptr;
+  }
+  return llvm::MemoryBuffer::getMemBufferCopy(object_, module->getModuleIdentifier());
+}
+
+}  // namespace cpu
+}  // namespace hal
+}  // namespace tile
+}  // namespace vertexai
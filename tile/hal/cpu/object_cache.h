@@ -0,0 +1,49 @@
+// Copyright 2018 Intel Corporation.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <llvm/ExecutionEngine/ObjectCache.h>
+
+#include <boost/filesystem.hpp>
+
+namespace vertexai {
+namespace tile {
+namespace hal {
+namespace cpu {
+
+// An llvm::ObjectCache for a single kernel module.  It captures the kernel's object code when the kernel is compiled,
+// so that the kernel can be serialized, and it may be backed by a file in the on-disk cache directory.  A cached
+// object (if any) is read up front, so that the caller knows whether code generation can be skipped entirely.
+//
+// Cache files are named by a hash of the kernel's key, so a file may hold a different kernel's object; each file
+// therefore records the full key it was written for, and a file whose key doesn't match, or which can't be parsed,
+// is treated as a miss (and replaced once the kernel's been compiled).
+class KernelObjectCache final : public llvm::ObjectCache {
+ public:
+  KernelObjectCache() = default;
+  KernelObjectCache(boost::filesystem::path path, std::string key);
+
+  // Returns true if the supplied bytes are a loadable object file.
+  static bool IsValidObject(const std::string& object);
+
+  bool has_object() const { return !object_.empty(); }
+  const std::string& object() const { return object_; }
+  void set_object(std::string object) { object_ = std::move(object); }
+
+  void notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef obj) final;
+  std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) final;
+
+ private:
+  boost::filesystem::path path_;
+  std::string key_;
+  std::string object_;
+};
+
+}  // namespace cpu
+}  // namespace hal
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,161 @@
+// Copyright 2018 Intel Corporation.
+
+#include <gmock/gmock.h>
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/ExecutionEngine/MCJIT.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/TargetSelect.h>
+
+#include <memory>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "base/util/file.h"
+#include "tile/hal/cpu/object_cache.h"
+
+using ::testing::Eq;
+using ::testing::Ne;
+
+namespace vertexai {
+namespace tile {
+namespace hal {
+namespace cpu {
+namespace {
+
+namespace fs = boost::filesystem;
+
+class KernelObjectCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() final {
+    LLVMInitializeNativeTarget();
+    LLVMLinkInMCJIT();
+    LLVMInitializeNativeAsmPrinter();
+    dir_ = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(dir_);
+    path_ = dir_ / "kernel.o";
+  }
+
+  void TearDown() final { fs::remove_all(dir_); }
+
+  // Compiles a trivial kernel using the supplied cache, returning the number of objects the compiler produced (zero
+  // if the kernel was loaded from the cache).
+  int Compile(KernelObjectCache* cache) {
+    llvm::LLVMContext context;
+    auto module = std::make_unique<llvm::Module>("kernel", context);
+    auto* function = llvm::Function::Create(llvm::FunctionType::get(llvm::Type::getVoidTy(context), false),
+                                            llvm::Function::ExternalLinkage, "kernel", module.get());
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(context, "block", function));
+    builder.CreateRetVoid();
+
+    CountingCache counting{cache};
+    std::string err;
+    std::unique_ptr<llvm::ExecutionEngine> engine{
+        llvm::EngineBuilder(std::move(module)).setErrorStr(&err).setEngineKind(llvm::EngineKind::JIT).create()};
+    if (!engine) {
+      ADD_FAILURE() << "Failed to create ExecutionEngine: " << err;
+      return -1;
+    }
+    engine->setObjectCache(&counting);
+    engine->finalizeObject();
+    EXPECT_THAT(engine->getFunctionAddress("kernel"), Ne(0u));
+    return counting.compiled;
+  }
+
+  fs::path dir_;
+  fs::path path_;
+
+ private:
+  // Counts the objects the compiler produces, forwarding everything to the cache under test.
+  struct CountingCache final : llvm::ObjectCache {
+    explicit CountingCache(KernelObjectCache* cache) : cache{cache} {}
+
+    void notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef obj) final {
+      compiled++;
+      cache->notifyObjectCompiled(module, obj);
+    }
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) final {
+      return cache->getObject(module);
+    }
+
+    KernelObjectCache* cache;
+    int compiled = 0;
+  };
+};
+
+TEST_F(KernelObjectCacheTest, MissCompilesAndWritesEntry) {
+  KernelObjectCache cache{path_, "key"};
+  EXPECT_FALSE(cache.has_object());
+  EXPECT_THAT(Compile(&cache), Eq(1));
+  EXPECT_TRUE(cache.has_object());
+  EXPECT_TRUE(KernelObjectCache::IsValidObject(cache.object()));
+  EXPECT_TRUE(fs::is_regular_file(path_));
+}
+
+TEST_F(KernelObjectCacheTest, HitSkipsCompilation) {
+  std::string object;
+  {
+    KernelObjectCache cache{path_, "key"};
+    Compile(&cache);
+    object = cache.object();
+  }
+  KernelObjectCache cache{path_, "key"};
+  ASSERT_TRUE(cache.has_object());
+  EXPECT_THAT(cache.object(), Eq(object));
+  EXPECT_THAT(Compile(&cache), Eq(0));
+}
+
+TEST_F(KernelObjectCacheTest, EntryForAnotherKeyIsAMiss) {
+  {
+    KernelObjectCache cache{path_, "key"};
+    Compile(&cache);
+  }
+  // As if another kernel's key hashed to the same file.
+  KernelObjectCache other{path_, "other key"};
+  EXPECT_FALSE(other.has_object());
+  EXPECT_THAT(Compile(&other), Eq(1));
+
+  // The entry now belongs to the other kernel.
+  EXPECT_TRUE(KernelObjectCache(path_, "other key").has_object());
+  EXPECT_FALSE(KernelObjectCache(path_, "key").has_object());
+}
+
+TEST_F(KernelObjectCacheTest, CorruptEntriesAreMisses) {
+  std::size_t object_size;
+  {
+    KernelObjectCache cache{path_, "key"};
+    Compile(&cache);
+    object_size = cache.object().size();
+  }
+  auto entry = ReadFile(path_, true);
+
+  // Truncated
+  WriteFile(path_, entry.substr(0, entry.size() / 2), true);
+  EXPECT_FALSE(KernelObjectCache(path_, "key").has_object());
+
+  // Trailing garbage
+  WriteFile(path_, entry + "garbage", true);
+  EXPECT_FALSE(KernelObjectCache(path_, "key").has_object());
+
+  // An intact entry whose object isn't an object file
+  std::string corrupt = entry;
+  corrupt.replace(entry.size() - object_size, 4, "junk");
+  WriteFile(path_, corrupt, true);
+  EXPECT_FALSE(KernelObjectCache(path_, "key").has_object());
+
+  // Not a cache entry at all
+  WriteFile(path_, "garbage", true);
+  EXPECT_FALSE(KernelObjectCache(path_, "key").has_object());
+
+  // A corrupt entry is replaced once the kernel's been compiled.
+  KernelObjectCache cache{path_, "key"};
+  EXPECT_THAT(Compile(&cache), Eq(1));
+  EXPECT_TRUE(KernelObjectCache(path_, "key").has_object());
+}
+
+}  // namespace
+}  // namespace cpu
+}  // namespace hal
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,43 @@
+// Copyright 2018 Intel Corporation.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "base/util/error.h"
+
+namespace vertexai {
+namespace tile {
+namespace hal {
+namespace cpu {
+
+// Appends a string to a serialized blob, preceded by its size.
+inline void AppendString(std::string* out, const std::string& value) {
+  std::uint64_t size = value.size();
+  out->append(reinterpret_cast<const char*>(&size), sizeof(size));
+  out->append(value);
+}
+
+// Reads a string written by AppendString at *pos, advancing *pos past it.
+// Throws error::DataLoss, naming what was being read, if the blob is truncated.
+inline std::string ReadString(const std::string& in, std::size_t* pos, const char* what) {
+  std::uint64_t size;
+  if (in.size() - *pos < sizeof(size)) {
+    throw error::DataLoss{std::string{"Truncated "} + what};
+  }
+  std::memcpy(&size, in.data() + *pos, sizeof(size));
+  *pos += sizeof(size);
+  if (in.size() - *pos < size) {
+    throw error::DataLoss{std::string{"Truncated "} + what};
+  }
+  std::string value = in.substr(*pos, size);
+  *pos += size;
+  return value;
+}
+
+}  // namespace cpu
+}  // namespace hal
+}  // namespace tile
+}  // namespace vertexai
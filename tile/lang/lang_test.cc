@@ -1,4 +1,13 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
 #include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
 
 #include "tile/base/shape.h"
 #include "tile/lang/bound.h"
@@ -17,11 +26,14 @@
 #include "tile/lang/semtree.h"
 #include "tile/lang/sym_poly.h"
 #include "tile/lang/symbolic.h"
+#include "tile/lang/tile_cache.h"
+#include "tile/lang/tile_model.h"
 #include "tile/lang/tile_opt.h"
 #include "tile/lang/type.h"
 #include "tile/math/matrix.h"
 
 #include "base/util/catch.h"
+#include "base/util/file.h"
 #include "base/util/logging.h"
 
 namespace vertexai {
@@ -114,6 +126,250 @@ TEST_CASE("Optimization of Matrix Multiply", "[mat_opt][opt]") {
   REQUIRE(it->first == best_score);
 }
 
+TEST_CASE("Optimization is shared by equivalent contractions", "[mat_opt][opt]") {
+  Parser p;
+  std::vector<TensorShape> shapes = {SimpleShape(DataType::FLOAT32, {256, 512}),
+                                     SimpleShape(DataType::FLOAT32, {256, 128}),
+                                     SimpleShape(DataType::FLOAT32, {128, 512})};
+  FlatContraction f1 = Flatten(p.ParseContraction("O[i,j] = +(A[i,k] * B[k,j])"), shapes);
+  FlatContraction f2 = Flatten(p.ParseContraction("C[m,n] = +(X[m,r] * Y[r,n])"), shapes);
+  auto out1 = TileOptimize(TestGPU(), f1, false);
+  auto out2 = TileOptimize(TestGPU(), f2, false);
+  REQUIRE(out1 == out2);
+  auto it = out1.rbegin();
+  REQUIRE(it->first == ComputeScore(TestGPU(), ComputeTileStats(TestGPU(), f2, it->second)));
+
+  // A search under different settings isn't answered by the earlier one.
+  auto settings = TestGPU();
+  settings.max_mem = 1024;
+  auto out3 = TileOptimize(settings, f1, false);
+  REQUIRE(out3 != out1);
+  for (const auto& kvp : out3) {
+    REQUIRE(kvp.first == ComputeScore(settings, ComputeTileStats(settings, f1, kvp.second)));
+  }
+}
+
+TEST_CASE("Calibrated tile model ranks by measured durations", "[mat_opt][opt]") {
+  Parser p;
+  std::vector<TensorShape> shapes = {SimpleShape(DataType::FLOAT32, {256, 512}),
+                                     SimpleShape(DataType::FLOAT32, {256, 128}),
+                                     SimpleShape(DataType::FLOAT32, {128, 512})};
+  FlatContraction f = Flatten(p.ParseContraction("O[i,j] = +(A[i,k] * B[k,j])"), shapes);
+
+  // Measure each of the tilings the cost function will consider with a synthetic clock under which memory traffic
+  // dominates, recording them in a tile cache as a tile scan would.  The clock is a product of powers of the stats,
+  // which the model is able to fit.
+  auto filename = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  auto model_filename = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  auto by_score = TileOptimize(TestGPU(), f, false);
+  {
+    TileCache cache(filename.string());
+    size_t count = 0;
+    for (auto it = by_score.rbegin(); it != by_score.rend() && 0 < it->first && count < 64; ++it, ++count) {
+      auto stats = ComputeTileStats(TestGPU(), f, it->second);
+      double bytes = stats.work_groups() * (stats.inner_loops() * stats.mem_read() + stats.mem_write());
+      double ops = stats.work_groups() * stats.operations();
+      cache.AddEntry("matmul", TestGPU(), it->second, std::llround(std::pow(bytes, 0.9) * std::pow(ops, 0.1)), &stats);
+    }
+  }
+  auto measurements = TileCache::ReadMeasurements(filename.string());
+  boost::filesystem::remove(filename);
+  REQUIRE(measurements.size() > 1);
+
+  std::vector<TileModel::Sample> samples;
+  std::map<std::vector<uint64_t>, int64_t> durations;
+  int64_t best_duration = std::numeric_limits<int64_t>::max();
+  for (const auto& m : measurements) {
+    REQUIRE(m.has_stats);
+    REQUIRE(m.stats.work_groups() == ComputeTileStats(TestGPU(), f, m.tile_size).work_groups());
+    samples.emplace_back(TileModel::Sample{m.stats, m.settings, static_cast<double>(m.duration)});
+    durations[m.tile_size] = m.duration;
+    best_duration = std::min(best_duration, m.duration);
+  }
+  TileModel::Fit(samples).Save(model_filename.string());
+  auto model = TileModel::Load(model_filename.string());
+  boost::filesystem::remove(model_filename);
+
+  auto options = model.CostFunction()("matmul", TestGPU(), f);
+  REQUIRE(options.size() == measurements.size());
+  auto chosen = std::min_element(options.begin(), options.end(), [](const TileOption& lhs, const TileOption& rhs) {
+    return lhs.kernel_cost < rhs.kernel_cost;
+  });
+  REQUIRE(durations.at(chosen->shape) == best_duration);
+}
+
+// A scratch directory for tile cache files, removed when the test completes.
+struct TileCacheDir {
+  TileCacheDir()
+      : path{boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()},
+        filename{(path / "tile_cache").string()} {
+    boost::filesystem::create_directories(path);
+  }
+  ~TileCacheDir() { boost::filesystem::remove_all(path); }
+
+  std::vector<std::string> Files() const {
+    std::vector<std::string> files;
+    for (const auto& entry : boost::filesystem::directory_iterator(path)) {
+      files.emplace_back(entry.path().filename().string());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+  }
+
+  boost::filesystem::path path;
+  std::string filename;
+};
+
+proto::PerfStats TestStats(uint64_t seed) {
+  proto::PerfStats stats;
+  stats.set_true_ops(seed);
+  stats.set_work_groups(seed + 1);
+  stats.set_threads_used(seed + 9);
+  return stats;
+}
+
+TEST_CASE("Tile cache round-trips measurements", "[tile_cache]") {
+  TileCacheDir dir;
+  {
+    TileCache cache(dir.filename);
+    auto stats = TestStats(100);
+    cache.AddEntry("matmul", TestGPU(), {4, 8, 16}, 1000, &stats);
+    cache.AddEntry("matmul", TestGPU(), {8, 8, 16}, 2000);
+    cache.AddEntry("conv", TestGPU(), {1, 2}, 3000, &stats);
+  }
+  TileCache cache(dir.filename);
+  REQUIRE(cache.GetDuration("matmul", TestGPU(), {4, 8, 16}) == 1000);
+  REQUIRE(cache.GetDuration("matmul", TestGPU(), {8, 8, 16}) == 2000);
+  REQUIRE(cache.GetDuration("conv", TestGPU(), {1, 2}) == 3000);
+  REQUIRE(cache.GetDuration("conv", TestGPU(), {2, 2}) == -1);
+  auto measurements = cache.Measurements();
+  REQUIRE(measurements.size() == 3);
+  for (const auto& m : measurements) {
+    REQUIRE(m.has_stats == (m.duration != 2000));
+    if (m.has_stats) {
+      REQUIRE(m.stats.SerializeAsString() == TestStats(100).SerializeAsString());
+    }
+  }
+}
+
+TEST_CASE("Tile cache ignores truncated and corrupt records", "[tile_cache]") {
+  TileCacheDir dir;
+  {
+    TileCache cache(dir.filename);
+    cache.AddEntry("first", TestGPU(), {4, 4}, 1000);
+  }
+  auto one_record = ReadFile(dir.filename, true);
+  {
+    TileCache cache(dir.filename);
+    cache.AddEntry("second", TestGPU(), {4, 4}, 2000);
+  }
+  auto two_records = ReadFile(dir.filename, true);
+
+  // A partial trailing record is dropped, and the file is rewritten so that later appends are readable.
+  WriteFile(dir.filename, two_records.substr(0, two_records.size() - 3), true);
+  {
+    TileCache cache(dir.filename);
+    REQUIRE(cache.GetDuration("first", TestGPU(), {4, 4}) == 1000);
+    REQUIRE(cache.GetDuration("second", TestGPU(), {4, 4}) == -1);
+    cache.AddEntry("third", TestGPU(), {4, 4}, 3000);
+  }
+  {
+    TileCache cache(dir.filename);
+    REQUIRE(cache.GetDuration("first", TestGPU(), {4, 4}) == 1000);
+    REQUIRE(cache.GetDuration("third", TestGPU(), {4, 4}) == 3000);
+  }
+
+  // A tile size count larger than the rest of the file is treated the same way, rather than trusted.
+  auto corrupt = two_records;
+  std::size_t dims_pos = one_record.size() + sizeof(uint32_t) + std::strlen("second") + 2 * sizeof(uint64_t) + 1;
+  uint32_t dims = std::numeric_limits<uint32_t>::max();
+  corrupt.replace(dims_pos, sizeof(dims), reinterpret_cast<const char*>(&dims), sizeof(dims));
+  WriteFile(dir.filename, corrupt, true);
+  {
+    TileCache cache(dir.filename);
+    REQUIRE(cache.GetDuration("first", TestGPU(), {4, 4}) == 1000);
+    REQUIRE(cache.GetDuration("second", TestGPU(), {4, 4}) == -1);
+  }
+  REQUIRE(ReadFile(dir.filename, true) == one_record);
+
+  // So is a record with an unexpected number of stats fields.
+  corrupt = two_records;
+  std::size_t fields_pos = dims_pos + sizeof(uint32_t) + 2 * sizeof(uint64_t) + sizeof(int64_t);
+  uint32_t fields = 1;
+  corrupt.replace(fields_pos, sizeof(fields), reinterpret_cast<const char*>(&fields), sizeof(fields));
+  corrupt.append(sizeof(uint64_t), '\0');
+  WriteFile(dir.filename, corrupt, true);
+  {
+    TileCache cache(dir.filename);
+    REQUIRE(cache.GetDuration("first", TestGPU(), {4, 4}) == 1000);
+    REQUIRE(cache.GetDuration("second", TestGPU(), {4, 4}) == -1);
+  }
+  REQUIRE(ReadFile(dir.filename, true) == one_record);
+}
+
+TEST_CASE("Tile cache leaves newer formats untouched", "[tile_cache]") {
+  TileCacheDir dir;
+  {
+    TileCache cache(dir.filename);
+    cache.AddEntry("matmul", TestGPU(), {4, 4}, 1000);
+  }
+  auto contents = ReadFile(dir.filename, true);
+  uint32_t version = TileCache::kFormatVersion + 1;
+  contents.replace(8, sizeof(version), reinterpret_cast<const char*>(&version), sizeof(version));
+  WriteFile(dir.filename, contents, true);
+  {
+    TileCache cache(dir.filename);
+    REQUIRE(cache.GetDuration("matmul", TestGPU(), {4, 4}) == -1);
+    cache.AddEntry("matmul", TestGPU(), {8, 8}, 2000);
+    REQUIRE(cache.GetDuration("matmul", TestGPU(), {8, 8}) == 2000);
+  }
+  REQUIRE(ReadFile(dir.filename, true) == contents);
+  REQUIRE_THROWS(TileCache::ReadMeasurements(dir.filename));
+}
+
+TEST_CASE("Tile cache compacts superseded records", "[tile_cache]") {
+  TileCacheDir dir;
+  {
+    TileCache cache(dir.filename);
+    cache.AddEntry("matmul", TestGPU(), {8, 8}, 500);
+    for (int64_t dur = 1; dur <= 10; ++dur) {
+      cache.AddEntry("matmul", TestGPU(), {4, 4}, dur);
+    }
+  }
+  auto size = boost::filesystem::file_size(dir.filename);
+  {
+    TileCache cache(dir.filename);
+    REQUIRE(cache.GetDuration("matmul", TestGPU(), {4, 4}) == 10);
+  }
+  REQUIRE(boost::filesystem::file_size(dir.filename) < size);
+  std::vector<std::string> files{"tile_cache", "tile_cache.lock"};
+  REQUIRE(dir.Files() == files);
+  TileCache cache(dir.filename);
+  REQUIRE(cache.GetDuration("matmul", TestGPU(), {4, 4}) == 10);
+  REQUIRE(cache.GetDuration("matmul", TestGPU(), {8, 8}) == 500);
+}
+
+TEST_CASE("Tile cache appends survive compaction by another process", "[tile_cache]") {
+  TileCacheDir dir;
+  TileCache early(dir.filename);
+  {
+    TileCache writer(dir.filename);
+    for (int64_t dur = 1; dur <= 10; ++dur) {
+      writer.AddEntry("matmul", TestGPU(), {4, 4}, dur);
+    }
+  }
+  auto size = boost::filesystem::file_size(dir.filename);
+  {
+    // This load compacts the file, replacing the one the earlier cache loaded.
+    TileCache compactor(dir.filename);
+  }
+  REQUIRE(boost::filesystem::file_size(dir.filename) < size);
+  early.AddEntry("conv", TestGPU(), {2, 2}, 3000);
+  TileCache cache(dir.filename);
+  REQUIRE(cache.GetDuration("matmul", TestGPU(), {4, 4}) == 10);
+  REQUIRE(cache.GetDuration("conv", TestGPU(), {2, 2}) == 3000);
+}
+
 TEST_CASE("Subdivision 1D input width 2**n", "[subdivision]") {
   const std::size_t kernelSize = 5;
 
@@ -1,12 +1,84 @@
 
 #include "tile/lang/tile_cache.h"
 
+#include <boost/interprocess/sync/file_lock.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
 #include "base/util/env.h"
+#include "base/util/file.h"
 #include "base/util/json_transfer.h"
+#include "base/util/logging.h"
 
 namespace vertexai {
 namespace tile {
 namespace lang {
+namespace {
+
+const char kMagic[8] = {'P', 'M', 'L', 'T', 'I', 'L', 'E', '\0'};
+
+template <typename T>
+void Append(std::string* out, const T& value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool Read(const std::string& in, std::size_t* pos, T* value) {
+  if (in.size() < *pos + sizeof(T)) {
+    return false;
+  }
+  std::memcpy(value, in.data() + *pos, sizeof(T));
+  *pos += sizeof(T);
+  return true;
+}
+
+// Opens the lock serializing the processes that share a cache file.  The cache file itself can't be locked, since
+// compaction replaces it, so a companion ".lock" file is locked instead.
+boost::interprocess::file_lock OpenFileLock(const std::string& filename) {
+  std::string lockname = filename + ".lock";
+  std::ofstream{lockname, std::ios::app};
+  return boost::interprocess::file_lock{lockname.c_str()};
+}
+
+std::string Header() {
+  std::string header(kMagic, sizeof(kMagic));
+  Append(&header, TileCache::kFormatVersion);
+  return header;
+}
+
+// PerfStats are stored as their fields, in field number order.
+constexpr std::uint32_t kStatsFields = 10;
+
+std::vector<uint64_t> EncodeStats(const proto::PerfStats& stats) {
+  return {stats.true_ops(),   stats.work_groups(), stats.inner_loops(), stats.shared_mem(), stats.out_regs(),
+          stats.mem_read(),   stats.mem_write(),   stats.operations(),  stats.rollups(),    stats.threads_used()};
+}
+
+proto::PerfStats DecodeStats(const std::vector<uint64_t>& fields) {
+  proto::PerfStats stats;
+  auto field = [&](std::size_t idx) { return idx < fields.size() ? fields[idx] : 0; };
+  stats.set_true_ops(field(0));
+  stats.set_work_groups(field(1));
+  stats.set_inner_loops(field(2));
+  stats.set_shared_mem(field(3));
+  stats.set_out_regs(field(4));
+  stats.set_mem_read(field(5));
+  stats.set_mem_write(field(6));
+  stats.set_operations(field(7));
+  stats.set_rollups(field(8));
+  stats.set_threads_used(field(9));
+  return stats;
+}
+
+}  // namespace
+
+constexpr std::uint32_t TileCache::kFormatVersion;
 
 TileCache::TileCache(const std::string& filename, bool use_env) {
   std::string openname = filename;
@@ -19,17 +91,16 @@ TileCache::TileCache(const std::string& filename, bool use_env) {
       return;
     }
   }
-  file_.exceptions(std::fstream::failbit | std::fstream::badbit);
-  file_.open(openname, std::fstream::in | std::fstream::out | std::fstream::app);
-  file_.seekp(0);
-  std::string line;
-  file_.exceptions(std::fstream::badbit);
-  while (std::getline(file_, line)) {
-    Entry e = inline_json_deserialize<Entry>(line);
-    AddEntry(e.key, e.subkey, e.value);
+  try {
+    Load(openname);
+  } catch (const std::exception& ex) {
+    // A cache that can't be used (e.g. one written by a newer version of the library, which mustn't be rewritten) is
+    // left alone; the process runs with an empty, in-memory cache.
+    LOG(WARNING) << "Not using tile cache file " << openname << ": " << ex.what();
+    cache_.clear();
+    format_ = Format::kBinary;
+    filename_.clear();
   }
-  file_.clear();
-  file_.exceptions(std::fstream::failbit | std::fstream::badbit);
 }
 
 TileCache* TileCache::Instance() {
@@ -37,22 +108,211 @@ TileCache* TileCache::Instance() {
   return &instance;
 }
 
+std::vector<TileCache::Measurement> TileCache::ReadMeasurements(const std::string& filename) {
+  TileCache cache;
+  cache.Parse(ReadFile(filename, true));
+  return cache.Measurements();
+}
+
+void TileCache::Load(const std::string& filename) {
+  auto file_lock = OpenFileLock(filename);
+  std::lock_guard<boost::interprocess::file_lock> lock{file_lock};
+
+  std::string contents;
+  {
+    std::ifstream probe(filename, std::ios::in | std::ios::binary);
+    if (probe.good()) {
+      contents = ReadFile(filename, true);
+    }
+  }
+  if (Parse(contents)) {
+    Compact(filename);
+  }
+  // Check that the file can be appended to; if not, the cache is kept in memory only.
+  std::ofstream file;
+  file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+  file.open(filename, std::ofstream::out | std::ofstream::app | std::ofstream::binary);
+  filename_ = filename;
+}
+
+// Loads the contents of a cache file, returning whether the file should be rewritten.
+bool TileCache::Parse(const std::string& contents) {
+  if (contents.empty()) {
+    return true;
+  }
+  if (contents.size() >= sizeof(kMagic) && std::memcmp(contents.data(), kMagic, sizeof(kMagic)) == 0) {
+    bool truncated = false;
+    bool outdated = false;
+    std::size_t records = LoadBinary(contents, &truncated, &outdated);
+    std::size_t live = 0;
+    for (const auto& kvp : cache_) {
+      live += kvp.second.times.size();
+    }
+    // Rewrite the file once most of it consists of superseded records, if it ends with a partial record (which
+    // would otherwise corrupt subsequent appends), or if it's in an older version of the format (which subsequent
+    // appends mustn't be mixed with).
+    return truncated || outdated || 2 * live < records;
+  }
+  format_ = Format::kJson;
+  LoadJson(contents);
+  return false;
+}
+
+void TileCache::LoadJson(const std::string& contents) {
+  std::istringstream in{contents};
+  std::string line;
+  while (std::getline(in, line)) {
+    Entry e = inline_json_deserialize<Entry>(line);
+    AddEntryLocked(e.key, e.subkey, e.value, {});
+  }
+}
+
+std::size_t TileCache::LoadBinary(const std::string& contents, bool* truncated, bool* outdated) {
+  std::size_t pos = sizeof(kMagic);
+  std::uint32_t version;
+  // Version 1 records lack the stats.
+  if (!Read(contents, &pos, &version) || version < 1 || kFormatVersion < version) {
+    throw std::runtime_error("Unsupported tile cache format version");
+  }
+  *outdated = version < kFormatVersion;
+  std::size_t records = 0;
+  std::size_t record_end = pos;
+  while (pos < contents.size()) {
+    // A truncated trailing record (e.g. from an interrupted writer) ends the log.
+    std::uint32_t key_size;
+    if (!Read(contents, &pos, &key_size) || contents.size() < pos + key_size) {
+      break;
+    }
+    std::string key = contents.substr(pos, key_size);
+    pos += key_size;
+    std::uint64_t threads;
+    std::uint8_t use_global;
+    std::uint64_t mem_width;
+    std::uint32_t dims;
+    // A count larger than the rest of the file can hold is a corrupt record, and is treated as truncation.
+    if (!Read(contents, &pos, &threads) || !Read(contents, &pos, &use_global) || !Read(contents, &pos, &mem_width) ||
+        !Read(contents, &pos, &dims) || (contents.size() - pos) / sizeof(std::uint64_t) < dims) {
+      break;
+    }
+    Subkey subkey;
+    subkey.settings.threads = threads;
+    subkey.settings.use_global = use_global;
+    subkey.settings.mem_width = mem_width;
+    subkey.tile_size.resize(dims);
+    for (auto& size : subkey.tile_size) {
+      Read(contents, &pos, &size);
+    }
+    std::int64_t dur;
+    if (!Read(contents, &pos, &dur)) {
+      break;
+    }
+    std::vector<uint64_t> stats;
+    if (version >= 2) {
+      // Records have either no stats or all of them; anything else is corrupt.
+      std::uint32_t fields;
+      if (!Read(contents, &pos, &fields) || (fields && fields != kStatsFields) ||
+          (contents.size() - pos) / sizeof(std::uint64_t) < fields) {
+        break;
+      }
+      stats.resize(fields);
+      for (auto& field : stats) {
+        Read(contents, &pos, &field);
+      }
+    }
+    AddEntryLocked(key, subkey, dur, std::move(stats));
+    ++records;
+    record_end = pos;
+  }
+  *truncated = record_end < contents.size();
+  if (*truncated) {
+    LOG(WARNING) << "Ignoring truncated tile cache record";
+  }
+  return records;
+}
+
+std::string TileCache::EncodeBinary(const Entry& e, const std::vector<uint64_t>& stats) {
+  std::string row;
+  Append(&row, static_cast<std::uint32_t>(e.key.size()));
+  row += e.key;
+  Append(&row, static_cast<std::uint64_t>(e.subkey.settings.threads));
+  Append(&row, static_cast<std::uint8_t>(e.subkey.settings.use_global));
+  Append(&row, static_cast<std::uint64_t>(e.subkey.settings.mem_width));
+  Append(&row, static_cast<std::uint32_t>(e.subkey.tile_size.size()));
+  for (auto size : e.subkey.tile_size) {
+    Append(&row, static_cast<std::uint64_t>(size));
+  }
+  Append(&row, static_cast<std::int64_t>(e.value));
+  Append(&row, static_cast<std::uint32_t>(stats.size()));
+  for (auto field : stats) {
+    Append(&row, static_cast<std::uint64_t>(field));
+  }
+  return row;
+}
+
+void TileCache::Compact(const std::string& filename) {
+  std::string contents = Header();
+  for (const auto& kvp : cache_) {
+    for (const auto& time : kvp.second.times) {
+      Entry e;
+      e.key = kvp.first;
+      e.subkey = time.first;
+      e.value = time.second;
+      auto stats = kvp.second.stats.find(time.first);
+      contents += EncodeBinary(e, stats == kvp.second.stats.end() ? std::vector<uint64_t>{} : stats->second);
+    }
+  }
+  // Replace the file atomically, so that concurrent readers see either the old or the new log.  The temporary file's
+  // name is unique, so that a process that doesn't hold the lock (e.g. one on another host) can't collide with it.
+  std::string tmpname = filename + ".tmp." + std::to_string(std::random_device{}());
+  WriteFile(tmpname, contents, true);
+  if (std::rename(tmpname.c_str(), filename.c_str())) {
+    std::remove(tmpname.c_str());
+    throw std::runtime_error("Unable to replace tile cache file " + filename);
+  }
+}
+
 void TileCache::AddEntry(const std::string& key, const DirectSettings& settings, const std::vector<uint64_t>& tile_size,
-                         int64_t dur) {
+                         int64_t dur, const proto::PerfStats* stats) {
   Entry e;
   e.key = key;
   e.subkey = Subkey(settings, tile_size);
   e.value = dur;
-  AddEntry(key, e.subkey, dur);
-  if (file_.is_open()) {
-    std::string row = json_serialize(e);
-    file_.write(row.data(), row.size());
-    file_.flush();
+  std::vector<uint64_t> fields;
+  if (stats) {
+    fields = EncodeStats(*stats);
+  }
+  std::lock_guard<std::mutex> lock{mu_};
+  AddEntryLocked(key, e.subkey, dur, fields);
+  Write(e, fields);
+}
+
+void TileCache::Write(const Entry& e, const std::vector<uint64_t>& stats) {
+  if (filename_.empty()) {
+    return;
+  }
+  std::string row;
+  if (format_ == Format::kJson) {
+    row = json_serialize(e);
+  } else {
+    row = EncodeBinary(e, stats);
+  }
+  // The file is reopened by name for each record, under the file lock, so that a record is never appended to a file
+  // that another process's compaction has already replaced.
+  try {
+    auto file_lock = OpenFileLock(filename_);
+    std::lock_guard<boost::interprocess::file_lock> lock{file_lock};
+    std::ofstream file;
+    file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+    file.open(filename_, std::ofstream::out | std::ofstream::app | std::ofstream::binary);
+    file.write(row.data(), row.size());
+  } catch (const std::exception& ex) {
+    LOG(WARNING) << "Unable to write to tile cache file " << filename_ << ": " << ex.what();
   }
 }
 
 int64_t TileCache::GetDuration(const std::string& key, const DirectSettings& settings,
                                const std::vector<uint64_t>& tile_size) {
+  std::lock_guard<std::mutex> lock{mu_};
   auto it = cache_.find(key);
   if (it == cache_.end()) {
     return -1;
@@ -64,9 +324,28 @@ int64_t TileCache::GetDuration(const std::string& key, const DirectSettings& set
   return it2->second;
 }
 
-void TileCache::AddEntry(const std::string& key, const Subkey& subkey, int64_t dur) {
+std::vector<TileCache::Measurement> TileCache::Measurements() {
+  std::vector<Measurement> result;
+  std::lock_guard<std::mutex> lock{mu_};
+  for (const auto& kvp : cache_) {
+    for (const auto& time : kvp.second.times) {
+      auto stats = kvp.second.stats.find(time.first);
+      bool has_stats = stats != kvp.second.stats.end();
+      result.emplace_back(Measurement{kvp.first, time.first.settings, time.first.tile_size, time.second, has_stats,
+                                      has_stats ? DecodeStats(stats->second) : proto::PerfStats{}});
+    }
+  }
+  return result;
+}
+
+void TileCache::AddEntryLocked(const std::string& key, const Subkey& subkey, int64_t dur, std::vector<uint64_t> stats) {
   PerFC& p = cache_[key];
   p.times[subkey] = dur;
+  if (stats.empty()) {
+    p.stats.erase(subkey);
+  } else {
+    p.stats[subkey] = std::move(stats);
+  }
   if (p.times.size() == 1 || p.times[p.best] > dur) {
     p.best = subkey;
   }
@@ -1,10 +1,10 @@
-
 #pragma once
 
-#include <fstream>
 #include <limits>
 #include <map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "base/util/transfer_object.h"
@@ -14,17 +14,52 @@ namespace vertexai {
 namespace tile {
 namespace lang {
 
+// TileCache records measured kernel durations from tile scanning, so that repeated scans of the same kernel (in this
+// process or, via the backing file, in later ones) can skip the measurement.
+//
+// The backing file is a compact, versioned binary log of (kernel key, settings, tile size, duration) records, each
+// with the PerfStats of the kernel's tiling when the caller supplied them; these let a cost model be calibrated
+// against the measurements (see tile_model.h).  It's read in full when the cache is constructed, into an in-memory
+// index by kernel key, and is compacted at that point once it accumulates enough superseded records, or if it's in an
+// older version of the format.  Files in the older JSON-lines format are still read and appended to, without stats.
+// A file that can't be read (e.g. one written in a newer version of the format) is logged and left untouched, and the
+// cache is kept in memory only.
+//
+// Since records are keyed by the hardware settings the kernel was generated for, a file may be shared between
+// processes, and between hosts with identical settings.  Every access to the file -- loading and compaction, and
+// each appended record -- holds an exclusive lock on a companion ".lock" file.  Compaction replaces the file by
+// renaming a new one over it, so records are appended by reopening the file by name under the lock, never through a
+// handle opened earlier.  A process sees the records other processes append only when it next loads the file.
+//
+// The cache is internally synchronized.
 class TileCache {
  public:
+  // A recorded duration, and the stats of the kernel's tiling if they were recorded.
+  struct Measurement {
+    std::string key;
+    DirectSettings settings;
+    std::vector<uint64_t> tile_size;
+    int64_t duration;
+    bool has_stats;
+    proto::PerfStats stats;
+  };
+
   // Construct a cache, if given a filename, use that for storage
   explicit TileCache(const std::string& filename = "", bool use_env = false);
   // Get the 'singlton' instance, loads for PLAIDML_TILE_CACHE if set
   static TileCache* Instance();
-  // Add a new entry with a duration
+  // Reads the measurements in a cache file, without modifying it
+  static std::vector<Measurement> ReadMeasurements(const std::string& filename);
+  // Add a new entry with a duration, and optionally the stats of the kernel's tiling
   void AddEntry(const std::string& key, const DirectSettings& settings, const std::vector<uint64_t>& tile_size,
-                int64_t dur);
+                int64_t dur, const proto::PerfStats* stats = nullptr);
   // Checks for an exact matching entry (to skip tile scan for repeats), or -1 if not found
   int64_t GetDuration(const std::string& key, const DirectSettings& settings, const std::vector<uint64_t>& tile_size);
+  // Returns every recorded duration
+  std::vector<Measurement> Measurements();
+
+  // The current version of the binary file format.
+  static constexpr std::uint32_t kFormatVersion = 2;
 
  private:
   struct Subkey {
@@ -58,13 +93,27 @@ class TileCache {
   struct PerFC {
     Subkey best;
     std::map<Subkey, int64_t> times;
+    // The PerfStats fields of each recorded tiling, in field number order.
+    std::map<Subkey, std::vector<uint64_t>> stats;
   };
 
-  void AddEntry(const std::string& key, const Subkey& subkey, int64_t dur);
+  enum class Format { kBinary, kJson };
+
+  void Load(const std::string& filename);
+  bool Parse(const std::string& contents);
+  void LoadJson(const std::string& contents);
+  std::size_t LoadBinary(const std::string& contents, bool* truncated, bool* outdated);
+  void Compact(const std::string& filename);
+  void Write(const Entry& entry, const std::vector<uint64_t>& stats);
+  static std::string EncodeBinary(const Entry& entry, const std::vector<uint64_t>& stats);
+  void AddEntryLocked(const std::string& key, const Subkey& subkey, int64_t dur, std::vector<uint64_t> stats);
+
+  std::mutex mu_;
 
-  std::map<const std::string, PerFC> cache_;
+  std::unordered_map<std::string, PerFC> cache_;
 
-  std::fstream file_;
+  Format format_ = Format::kBinary;
+  std::string filename_;  // The backing file, or empty if the cache is in memory only
 };
 
 }  // namespace lang
@@ -0,0 +1,145 @@
+#include "tile/lang/tile_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "base/util/file.h"
+#include "base/util/json_transfer.h"
+#include "base/util/logging.h"
+#include "tile/lang/tile_opt.h"
+
+namespace vertexai {
+namespace tile {
+namespace lang {
+
+namespace {
+
+// The features of a tiling.  Durations scale roughly multiplicatively with these, so they're taken on a log scale,
+// making the model a product of powers of them.
+std::vector<double> Features(const DirectSettings& settings, const proto::PerfStats& stats) {
+  auto log_of = [](double value) { return std::log1p(value); };
+  double work_groups = stats.work_groups();
+  double bytes = work_groups * (stats.inner_loops() * stats.mem_read() + stats.mem_write());
+  double threads = std::max<uint64_t>(settings.threads, 1);
+  return {
+      1.0,                                       // Bias
+      log_of(bytes),                             // Memory traffic
+      log_of(stats.true_ops()),                  // Useful work
+      log_of(work_groups * stats.operations()),  // Work done, including padding
+      log_of(work_groups),
+      log_of(stats.inner_loops()),
+      log_of(stats.shared_mem()),
+      log_of(stats.out_regs()),
+      log_of(stats.rollups()),
+      stats.threads_used() / threads,  // Thread utilization
+  };
+}
+
+// Solves the square system a * x = b in place by Gaussian elimination with partial pivoting.
+std::vector<double> Solve(std::vector<std::vector<double>> a, std::vector<double> b) {
+  std::size_t n = b.size();
+  for (std::size_t col = 0; col < n; ++col) {
+    std::size_t pivot = col;
+    for (std::size_t row = col + 1; row < n; ++row) {
+      if (std::abs(a[row][col]) > std::abs(a[pivot][col])) {
+        pivot = row;
+      }
+    }
+    if (a[pivot][col] == 0) {
+      throw std::runtime_error("Unable to fit tile model: singular system");
+    }
+    std::swap(a[col], a[pivot]);
+    std::swap(b[col], b[pivot]);
+    for (std::size_t row = col + 1; row < n; ++row) {
+      double factor = a[row][col] / a[col][col];
+      for (std::size_t k = col; k < n; ++k) {
+        a[row][k] -= factor * a[col][k];
+      }
+      b[row] -= factor * b[col];
+    }
+  }
+  std::vector<double> x(n);
+  for (std::size_t row = n; row-- > 0;) {
+    double sum = b[row];
+    for (std::size_t k = row + 1; k < n; ++k) {
+      sum -= a[row][k] * x[k];
+    }
+    x[row] = sum / a[row][row];
+  }
+  return x;
+}
+
+}  // namespace
+
+TileModel TileModel::Fit(const std::vector<Sample>& samples, double ridge) {
+  if (samples.empty()) {
+    throw std::runtime_error("Unable to fit tile model: no samples");
+  }
+  // Accumulate the normal equations, (X^T X + ridge * I) w = X^T y.  The bias isn't regularized.
+  std::vector<std::vector<double>> xtx(kFeatures, std::vector<double>(kFeatures));
+  std::vector<double> xty(kFeatures);
+  for (const auto& sample : samples) {
+    auto x = Features(sample.settings, sample.stats);
+    double y = std::log(std::max(sample.duration, 1.0));
+    for (std::size_t i = 0; i < kFeatures; ++i) {
+      for (std::size_t j = 0; j < kFeatures; ++j) {
+        xtx[i][j] += x[i] * x[j];
+      }
+      xty[i] += x[i] * y;
+    }
+  }
+  for (std::size_t i = 1; i < kFeatures; ++i) {
+    xtx[i][i] += ridge * samples.size();
+  }
+  TileModel model;
+  model.weights_ = Solve(std::move(xtx), std::move(xty));
+  return model;
+}
+
+TileModel TileModel::Load(const std::string& filename) {
+  auto model = inline_json_deserialize<TileModel>(ReadFile(filename));
+  if (model.weights_.size() != kFeatures) {
+    throw std::runtime_error("Invalid tile model: " + filename);
+  }
+  return model;
+}
+
+void TileModel::Save(const std::string& filename) const { WriteFile(filename, json_serialize(*this)); }
+
+double TileModel::Predict(const DirectSettings& settings, const proto::PerfStats& stats) const {
+  auto x = Features(settings, stats);
+  double log_duration = 0;
+  for (std::size_t i = 0; i < kFeatures; ++i) {
+    log_duration += weights_[i] * x[i];
+  }
+  return std::exp(log_duration);
+}
+
+TileCostFunction TileModel::CostFunction(std::size_t max_candidates) const {
+  TileModel model = *this;
+  return [model, max_candidates](const std::string& kname, const HardwareSettings& settings,
+                                 const FlatContraction& op) {
+    // Candidates that the analytic score rejects (by scoring them zero) exceed the hardware's limits, so they're
+    // never considered, unless there's nothing else to run.
+    auto by_score = TileOptimize(settings, op, false);
+    TileOptions options;
+    for (auto it = by_score.rbegin(); it != by_score.rend() && options.size() < max_candidates; ++it) {
+      if (it->first <= 0 && !options.empty()) {
+        break;
+      }
+      double cost = model.Predict(settings, ComputeTileStats(settings, op, it->second));
+      options.emplace_back(TileOption{"calibrated", it->second, cost, cost, cost});
+      if (it->first <= 0) {
+        break;
+      }
+    }
+    IVLOG(3, "Calibrated tile model ranked " << options.size() << " candidates for " << kname);
+    return options;
+  };
+}
+
+}  // namespace lang
+}  // namespace tile
+}  // namespace vertexai
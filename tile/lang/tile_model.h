@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "base/util/transfer_object.h"
+#include "tile/lang/generate.h"
+#include "tile/lang/lang.pb.h"
+
+namespace vertexai {
+namespace tile {
+namespace lang {
+
+// A tile cost model calibrated against measured kernel durations.
+//
+// The analytic score used by TileOptimize ranks tilings by a fixed formula over their PerfStats; this model instead
+// predicts a tiling's duration as a log-linear function of the same stats, with weights fit to the durations recorded
+// in a tile cache.  Registered as a TileCostFunction, it reranks the analytic search's candidates, so that the best
+// tiles are tried first (and, with a single tile trial, are the ones used).
+class TileModel {
+ public:
+  // A measured duration, and the stats of the tiling that produced it.
+  struct Sample {
+    proto::PerfStats stats;
+    DirectSettings settings;
+    double duration;
+  };
+
+  // The number of features the model is a function of.
+  static constexpr std::size_t kFeatures = 10;
+
+  // Fits a model to the given samples, using ridge regression on the log of their durations.
+  static TileModel Fit(const std::vector<Sample>& samples, double ridge = 1e-3);
+
+  // Loads a model from a file written by Save.
+  static TileModel Load(const std::string& filename);
+  void Save(const std::string& filename) const;
+
+  // Returns the predicted duration of a tiling, in the units of the training durations.
+  double Predict(const DirectSettings& settings, const proto::PerfStats& stats) const;
+
+  // Returns a cost function that ranks up to max_candidates of the analytic search's tiles by predicted duration.
+  TileCostFunction CostFunction(std::size_t max_candidates = 64) const;
+
+  const std::vector<double>& weights() const { return weights_; }
+
+  TRANSFER_OBJECT {
+    VERSION(0);
+    FIELD(weights_);
+  }
+
+ private:
+  std::vector<double> weights_;
+};
+
+}  // namespace lang
+}  // namespace tile
+}  // namespace vertexai
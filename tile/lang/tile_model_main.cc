@@ -0,0 +1,123 @@
+// Trains and evaluates calibrated tile cost models (see tile_model.h) from the measurements in tile cache files.
+//
+//   tile_model train MODEL CACHE...  Fits a model to the caches' measurements, and writes it to MODEL.
+//   tile_model eval MODEL CACHE...   Reports how well MODEL ranks the tilings measured for each of the caches' kernels.
+//
+// eval scores the model against exactly the measurements it's given; there's no held-out split.  Evaluating a model on
+// the caches it was trained on measures how well it fits them, not how well it generalizes: to estimate the latter,
+// train and evaluate on caches from different networks (or different runs).
+//
+// A trained model is used by setting PLAIDML_TILE_MODEL to its filename.
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "tile/lang/tile_cache.h"
+#include "tile/lang/tile_model.h"
+
+namespace vertexai {
+namespace tile {
+namespace lang {
+namespace {
+
+std::vector<TileCache::Measurement> ReadCaches(const std::vector<std::string>& filenames) {
+  std::vector<TileCache::Measurement> result;
+  for (const auto& filename : filenames) {
+    auto measurements = TileCache::ReadMeasurements(filename);
+    std::size_t with_stats = 0;
+    for (auto& measurement : measurements) {
+      if (measurement.has_stats) {
+        result.emplace_back(std::move(measurement));
+        with_stats++;
+      }
+    }
+    std::cout << filename << ": " << measurements.size() << " measurements, " << with_stats << " with stats"
+              << std::endl;
+  }
+  return result;
+}
+
+int Train(const std::string& model_filename, const std::vector<TileCache::Measurement>& measurements) {
+  std::vector<TileModel::Sample> samples;
+  for (const auto& measurement : measurements) {
+    samples.emplace_back(TileModel::Sample{measurement.stats, measurement.settings,
+                                           static_cast<double>(measurement.duration)});
+  }
+  auto model = TileModel::Fit(samples);
+  model.Save(model_filename);
+  std::cout << "Trained on " << samples.size() << " measurements; wrote " << model_filename << std::endl;
+  return 0;
+}
+
+// Scores the model's ranking of the given measurements (see the note on held-out data above).
+int Eval(const std::string& model_filename, const std::vector<TileCache::Measurement>& measurements) {
+  auto model = TileModel::Load(model_filename);
+
+  // The tilings measured for each kernel, on each hardware configuration, along with their predicted durations.
+  using Kernel = std::tuple<std::string, uint64_t, bool, uint64_t>;
+  std::map<Kernel, std::vector<std::pair<double, int64_t>>> kernels;
+  for (const auto& m : measurements) {
+    Kernel kernel{m.key, m.settings.threads, m.settings.use_global, m.settings.mem_width};
+    kernels[kernel].emplace_back(model.Predict(m.settings, m.stats), m.duration);
+  }
+
+  std::size_t count = 0;
+  std::size_t candidates = 0;
+  std::size_t top1 = 0;
+  std::size_t trials = 0;
+  double regret = 0;
+  for (auto& kvp : kernels) {
+    auto& tilings = kvp.second;
+    if (tilings.size() < 2) {
+      continue;
+    }
+    std::sort(tilings.begin(), tilings.end());
+    auto best = std::min_element(tilings.begin(), tilings.end(),
+                                 [](const auto& lhs, const auto& rhs) { return lhs.second < rhs.second; });
+    count++;
+    candidates += tilings.size();
+    top1 += tilings.front().second == best->second;
+    // The number of tilings that must be tried, in the model's order, to find the best one.
+    trials += std::distance(tilings.begin(), best) + 1;
+    regret += static_cast<double>(tilings.front().second) / std::max<int64_t>(best->second, 1) - 1;
+  }
+  if (!count) {
+    std::cout << "No kernels with more than one measured tiling" << std::endl;
+    return 1;
+  }
+  std::cout << "Kernels: " << count << std::endl;
+  std::cout << "Mean candidates per kernel: " << static_cast<double>(candidates) / count << std::endl;
+  std::cout << "Top-1 accuracy: " << 100.0 * top1 / count << "%" << std::endl;
+  std::cout << "Mean trials to find the best tiling: " << static_cast<double>(trials) / count << std::endl;
+  std::cout << "Mean regret of the top-ranked tiling: " << 100.0 * regret / count << "%" << std::endl;
+  return 0;
+}
+
+}  // namespace
+}  // namespace lang
+}  // namespace tile
+}  // namespace vertexai
+
+int main(int argc, char* argv[]) {
+  using namespace vertexai::tile::lang;  // NOLINT
+  if (argc < 4 || (std::string{argv[1]} != "train" && std::string{argv[1]} != "eval")) {
+    std::cerr << "Usage: " << argv[0] << " train|eval MODEL CACHE..." << std::endl;
+    return 2;
+  }
+  try {
+    std::string command = argv[1];
+    std::string model_filename = argv[2];
+    auto measurements = ReadCaches(std::vector<std::string>(argv + 3, argv + argc));
+    if (command == "train") {
+      return Train(model_filename, measurements);
+    }
+    return Eval(model_filename, measurements);
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+}
@@ -5,6 +5,9 @@
 #include <set>
 #include <utility>
 
+#include <boost/functional/hash.hpp>
+
+#include "tile/base/lru_cache.h"
 #include "tile/lang/out_plan.h"
 #include "tile/lang/read_plan.h"
 #include "tile/math/util.h"
@@ -15,6 +18,205 @@ namespace lang {
 
 using math::RoundUp;
 
+namespace {
+
+// The statistics of proto::PerfStats, as a plain struct, so that scoring each
+// candidate tile during the search doesn't allocate a message.
+struct TileStats {
+  uint64_t true_ops = 0;
+  uint64_t work_groups = 0;
+  uint64_t inner_loops = 0;
+  uint64_t shared_mem = 0;
+  uint64_t out_regs = 0;
+  uint64_t mem_read = 0;
+  uint64_t mem_write = 0;
+  uint64_t operations = 0;
+  uint64_t rollups = 0;
+  uint64_t threads_used = 0;
+};
+
+TileStats ComputeStats(const DirectSettings& settings, const FlatContraction& op, const std::vector<uint64_t>& tile) {
+  TileStats r;
+  IVLOG(4, "Computing cost for tile size: " << tile);
+  uint64_t sz = op.ranges.size();
+
+  OutPlan pout(op, tile, settings.threads, settings.mem_width / op.access[0].elem_size());
+  r.out_regs = pout.localSize() * op.access[0].elem_size();
+  r.mem_write = pout.outputs() * settings.mem_width * op.kernel_outputs.size();
+
+  for (size_t i = 1; i < op.access.size(); i++) {
+    const auto& a = op.access[i];
+    uint64_t mem_width = settings.mem_width / a.elem_size();
+    if (mem_width == 0) {
+      throw std::runtime_error("Memory width smaller than vector size");
+    }
+    ReadPlan mi(op.names, a.strides, tile, mem_width);
+    r.mem_read += mi.numLoads() * settings.mem_width;
+    if (!settings.use_global) {
+      r.shared_mem += mi.localSize() * a.elem_size();
+    }
+  }
+  for (const auto& op_input : op.post_op_inputs) {
+    // We read the post-op inputs during the output phase.
+    r.mem_read += pout.outputs() * byte_width(op_input.binding.shape.type);
+  }
+
+  std::uint64_t true_ops = 1;
+  std::uint64_t out_tiles = 1;
+  std::uint64_t all_tiles = 1;
+  std::uint64_t out_max_threads = 1;
+  std::uint64_t all_max_threads = 1;
+  for (size_t i = 0; i < sz; i++) {
+    true_ops *= op.ranges[i];
+    all_max_threads *= tile[i];
+    all_tiles *= RoundUp(op.ranges[i], tile[i]);
+    if (op.access[0].strides[i] != 0) {
+      out_max_threads *= tile[i];
+      out_tiles *= RoundUp(op.ranges[i], tile[i]);
+    }
+  }
+  true_ops *= (op.post_ops.size() + (op.generate_contraction ? 2 : 0));
+  r.work_groups = out_tiles;
+  r.inner_loops = all_tiles / out_tiles;
+  r.operations = std::min(settings.threads, all_max_threads);
+  r.true_ops = true_ops * op.agg_vec;
+  if (out_max_threads < r.operations) {
+    r.shared_mem += settings.threads * op.access[0].elem_size();
+  }
+  while (out_max_threads < r.operations) {
+    r.rollups++;
+    out_max_threads *= 2;
+  }
+  std::uint64_t output_threads = 1;
+  for (const auto& idx : pout.indexes()) {
+    output_threads *= idx.threads;
+  }
+  r.threads_used = std::max(r.operations, output_threads);
+  return r;
+}
+
+double Score(const HardwareSettings& settings, const TileStats& perf) {
+  IVLOG(4, "Compute score:"
+               << " to=" << perf.true_ops << " wg=" << perf.work_groups << " il=" << perf.inner_loops
+               << " sm=" << perf.shared_mem << " or=" << perf.out_regs << " mr=" << perf.mem_read
+               << " mw=" << perf.mem_write << " op=" << perf.operations << " rp=" << perf.rollups
+               << " tu=" << perf.threads_used);
+  if (perf.shared_mem > settings.max_mem) {
+    IVLOG(4, "  over memory");
+    return -1;
+  }
+  if (perf.out_regs > settings.max_regs) {
+    IVLOG(4, "  over regs");
+    return -1;
+  }
+  // Compute the logical amount memory io (ignoring OOB)
+  double bytes = perf.work_groups * (perf.inner_loops * perf.mem_read + perf.mem_write);
+  double flops_per_byte = perf.true_ops / bytes;
+  double roof = std::min(flops_per_byte, static_cast<double>(settings.goal_flops_per_byte));
+  double occupancy = std::min(perf.work_groups, settings.goal_groups);
+  double thread_ratio = perf.threads_used / static_cast<double>(settings.threads);
+  double roof_ratio = roof / static_cast<double>(settings.goal_flops_per_byte);
+  double occ_ratio = occupancy / static_cast<double>(settings.goal_groups);
+  double score = roof_ratio * occ_ratio * thread_ratio;
+  IVLOG(4, "  flops_per_byte=" << flops_per_byte << " occupancy=" << occupancy);
+  IVLOG(4, "  roof_ratio=" << roof_ratio << " occ_ratio=" << occ_ratio << " thread_ratio=" << thread_ratio
+                           << " score=" << score);
+  return score;
+}
+
+// A canonical signature of a tile search: everything ComputeStats and Score
+// read from the contraction and the hardware settings, and nothing else (in
+// particular, not the names of the contraction's indexes or tensors). Each
+// variable-length part is preceded by its length.
+std::vector<uint64_t> SearchSignature(const HardwareSettings& settings, const FlatContraction& op, bool fast) {
+  std::vector<uint64_t> sig{
+      fast,                      //
+      settings.threads,          //
+      settings.use_global,       //
+      settings.mem_width,        //
+      settings.max_mem,          //
+      settings.max_regs,         //
+      settings.goal_groups,      //
+      settings.goal_flops_per_byte,
+  };
+  sig.push_back(op.ranges.size());
+  sig.insert(sig.end(), op.ranges.begin(), op.ranges.end());
+  sig.push_back(op.access.size());
+  for (const auto& a : op.access) {
+    sig.push_back(a.elem_size());
+    sig.insert(sig.end(), a.strides.begin(), a.strides.end());
+  }
+  sig.push_back(op.post_op_inputs.size());
+  for (const auto& op_input : op.post_op_inputs) {
+    sig.push_back(byte_width(op_input.binding.shape.type));
+  }
+  sig.push_back(op.post_ops.size());
+  sig.push_back(op.generate_contraction);
+  sig.push_back(op.agg_vec);
+  sig.push_back(op.kernel_outputs.size());
+  return sig;
+}
+
+struct SignatureHash {
+  size_t operator()(const std::vector<uint64_t>& sig) const { return boost::hash_range(sig.begin(), sig.end()); }
+};
+
+// Networks repeat the same contraction shapes many times, so the results of
+// tile searches are kept for the life of the process in an LRU cache.
+typedef ShardedLruCache<std::vector<uint64_t>, std::multimap<double, std::vector<uint64_t>>, SignatureHash>
+    TileSearchCache;
+
+constexpr std::size_t kTileSearchCacheSize = 4096;
+
+TileSearchCache* SearchCache() {
+  static TileSearchCache cache{kTileSearchCacheSize};
+  return &cache;
+}
+
+// Searches for the best tiling of op, starting from all-ones and doubling one
+// index at a time.
+std::multimap<double, std::vector<uint64_t>> SearchTiles(const HardwareSettings& settings, const FlatContraction& op,
+                                                         bool fast) {
+  std::multimap<double, std::vector<uint64_t>> by_score;
+  size_t sz = op.ranges.size();
+
+  std::map<std::vector<uint64_t>, double> by_tile;
+  std::set<std::pair<double, std::vector<uint64_t>>> to_do;
+  IVLOG(3, "Computing optimal tile cost");
+  std::vector<uint64_t> tile(sz, 1);
+  double score = Score(settings, ComputeStats(settings, op, tile));
+  by_tile.emplace(tile, score);
+  by_score.emplace(score, tile);
+  to_do.emplace(score, tile);
+  while (!to_do.empty()) {
+    auto it = to_do.rbegin();
+    if (it->first < score && fast) {
+      break;
+    }
+    score = it->first;
+    tile = it->second;
+    to_do.erase(*it);
+    for (size_t i = 0; i < sz; i++) {
+      uint64_t prev = tile[i];
+      tile[i] = std::min(2 * tile[i], op.ranges[i]);
+      if (!by_tile.count(tile)) {
+        score = Score(settings, ComputeStats(settings, op, tile));
+        by_tile.emplace(tile, score);
+        by_score.emplace(score, tile);
+        if (score > 0) {
+          to_do.emplace(score, tile);
+        }
+      }
+      tile[i] = prev;
+    }
+  }
+  IVLOG(3, "  Final Tile: " << by_score.rbegin()->second);
+  IVLOG(3, "  Final Score: " << by_score.rbegin()->first);
+  return by_score;
+}
+
+}  // namespace
+
 FlatContraction Vectorize(const FlatContraction& iop, uint64_t vec_size) {  // NOLINT(runtime/references)
   size_t sz = iop.ranges.size();
   IVLOG(3, "Attempting vectorization");
@@ -137,141 +339,47 @@ FlatContraction Vectorize(const FlatContraction& iop, uint64_t vec_size) {  // N
 
 proto::PerfStats ComputeTileStats(const DirectSettings& settings, const FlatContraction& op,
                                   const std::vector<uint64_t>& tile) {
+  TileStats stats = ComputeStats(settings, op, tile);
   proto::PerfStats r;
-  IVLOG(4, "Computing cost for tile size: " << tile);
-  uint64_t sz = op.ranges.size();
-
-  OutPlan pout(op, tile, settings.threads, settings.mem_width / op.access[0].elem_size());
-  r.set_out_regs(pout.localSize() * op.access[0].elem_size());
-  r.set_mem_write(pout.outputs() * settings.mem_width * op.kernel_outputs.size());
-
-  std::uint64_t mem_read = 0;
-  std::uint64_t shared_mem = 0;
-
-  for (size_t i = 1; i < op.access.size(); i++) {
-    const auto& a = op.access[i];
-    uint64_t mem_width = settings.mem_width / a.elem_size();
-    if (mem_width == 0) {
-      throw std::runtime_error("Memory width smaller than vector size");
-    }
-    ReadPlan mi(op.names, a.strides, tile, mem_width);
-    mem_read += mi.numLoads() * settings.mem_width;
-    if (!settings.use_global) {
-      shared_mem += mi.localSize() * a.elem_size();
-    }
-  }
-  for (const auto& op_input : op.post_op_inputs) {
-    // We read the post-op inputs during the output phase.
-    mem_read += pout.outputs() * byte_width(op_input.binding.shape.type);
-  }
-
-  std::uint64_t rollups = 0;
-  std::uint64_t true_ops = 1;
-  std::uint64_t out_tiles = 1;
-  std::uint64_t all_tiles = 1;
-  std::uint64_t out_max_threads = 1;
-  std::uint64_t all_max_threads = 1;
-  for (size_t i = 0; i < sz; i++) {
-    true_ops *= op.ranges[i];
-    all_max_threads *= tile[i];
-    all_tiles *= RoundUp(op.ranges[i], tile[i]);
-    if (op.access[0].strides[i] != 0) {
-      out_max_threads *= tile[i];
-      out_tiles *= RoundUp(op.ranges[i], tile[i]);
-    }
-  }
-  true_ops *= (op.post_ops.size() + (op.generate_contraction ? 2 : 0));
-  r.set_work_groups(out_tiles);
-  r.set_inner_loops(all_tiles / out_tiles);
-  r.set_operations(std::min(settings.threads, all_max_threads));
-  true_ops *= op.agg_vec;
-  if (out_max_threads < r.operations()) {
-    shared_mem += settings.threads * op.access[0].elem_size();
-  }
-  while (out_max_threads < r.operations()) {
-    rollups++;
-    out_max_threads *= 2;
-  }
-  std::uint64_t output_threads = 1;
-  for (const auto& idx : pout.indexes()) {
-    output_threads *= idx.threads;
-  }
-  r.set_threads_used(std::max(r.operations(), output_threads));
-  r.set_mem_read(mem_read);
-  r.set_shared_mem(shared_mem);
-  r.set_true_ops(true_ops);
-  r.set_rollups(rollups);
-
+  r.set_true_ops(stats.true_ops);
+  r.set_work_groups(stats.work_groups);
+  r.set_inner_loops(stats.inner_loops);
+  r.set_shared_mem(stats.shared_mem);
+  r.set_out_regs(stats.out_regs);
+  r.set_mem_read(stats.mem_read);
+  r.set_mem_write(stats.mem_write);
+  r.set_operations(stats.operations);
+  r.set_rollups(stats.rollups);
+  r.set_threads_used(stats.threads_used);
   return r;
 }
 
 // Compute score from PerfStats
 double ComputeScore(const HardwareSettings& settings, const proto::PerfStats& perf) {
-  IVLOG(4, "Compute score:"
-               << " to=" << perf.true_ops() << " wg=" << perf.work_groups() << " il=" << perf.inner_loops()
-               << " sm=" << perf.shared_mem() << " or=" << perf.out_regs() << " mr=" << perf.mem_read()
-               << " mw=" << perf.mem_write() << " op=" << perf.operations() << " rp=" << perf.rollups()
-               << " tu=" << perf.threads_used());
-  if (perf.shared_mem() > settings.max_mem) {
-    IVLOG(4, "  over memory");
-    return -1;
-  }
-  if (perf.out_regs() > settings.max_regs) {
-    IVLOG(4, "  over regs");
-    return -1;
-  }
-  // Compute the logical amount memory io (ignoring OOB)
-  double bytes = perf.work_groups() * (perf.inner_loops() * perf.mem_read() + perf.mem_write());
-  double flops_per_byte = perf.true_ops() / bytes;
-  double roof = std::min(flops_per_byte, static_cast<double>(settings.goal_flops_per_byte));
-  double occupancy = std::min(perf.work_groups(), settings.goal_groups);
-  double thread_ratio = perf.threads_used() / static_cast<double>(settings.threads);
-  double roof_ratio = roof / static_cast<double>(settings.goal_flops_per_byte);
-  double occ_ratio = occupancy / static_cast<double>(settings.goal_groups);
-  double score = roof_ratio * occ_ratio * thread_ratio;
-  IVLOG(4, "  flops_per_byte=" << flops_per_byte << " occupancy=" << occupancy);
-  IVLOG(4, "  roof_ratio=" << roof_ratio << " occ_ratio=" << occ_ratio << " thread_ratio=" << thread_ratio
-                           << " score=" << score);
-  return score;
+  TileStats stats;
+  stats.true_ops = perf.true_ops();
+  stats.work_groups = perf.work_groups();
+  stats.inner_loops = perf.inner_loops();
+  stats.shared_mem = perf.shared_mem();
+  stats.out_regs = perf.out_regs();
+  stats.mem_read = perf.mem_read();
+  stats.mem_write = perf.mem_write();
+  stats.operations = perf.operations();
+  stats.rollups = perf.rollups();
+  stats.threads_used = perf.threads_used();
+  return Score(settings, stats);
 }
 
 std::multimap<double, std::vector<uint64_t>> TileOptimize(const HardwareSettings& settings, const FlatContraction& op,
                                                           bool fast) {
-  std::multimap<double, std::vector<uint64_t>> by_score;
-  size_t sz = op.ranges.size();
-
-  std::map<std::vector<uint64_t>, double> by_tile;
-  std::set<std::pair<double, std::vector<uint64_t>>> to_do;
-  IVLOG(3, "Computing optimal tile cost");
-  std::vector<uint64_t> tile(sz, 1);
-  double score = ComputeScore(settings, ComputeTileStats(settings, op, tile));
-  by_tile.emplace(tile, score);
-  by_score.emplace(score, tile);
-  to_do.emplace(score, tile);
-  while (!to_do.empty()) {
-    auto it = to_do.rbegin();
-    if (it->first < score && fast) {
-      break;
-    }
-    score = it->first;
-    tile = it->second;
-    to_do.erase(*it);
-    for (size_t i = 0; i < sz; i++) {
-      uint64_t prev = tile[i];
-      tile[i] = std::min(2 * tile[i], op.ranges[i]);
-      if (!by_tile.count(tile)) {
-        score = ComputeScore(settings, ComputeTileStats(settings, op, tile));
-        by_tile.emplace(tile, score);
-        by_score.emplace(score, tile);
-        if (score > 0) {
-          to_do.emplace(score, tile);
-        }
-      }
-      tile[i] = prev;
-    }
+  bool searched = false;
+  auto by_score = SearchCache()->Lookup(SearchSignature(settings, op, fast), [&]() {
+    searched = true;
+    return SearchTiles(settings, op, fast);
+  });
+  if (!searched) {
+    IVLOG(3, "Reusing optimal tile: " << by_score.rbegin()->second);
   }
-  IVLOG(3, "  Final Tile: " << by_score.rbegin()->second);
-  IVLOG(3, "  Final Score: " << by_score.rbegin()->first);
   return by_score;
 }
 
@@ -1,4 +1,8 @@
 
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "base/util/catch.h"
 #include "base/util/logging.h"
 #include "tile/math/basis.h"
@@ -118,6 +122,54 @@ TEST_CASE("Basic Polynomial<Rational> evaluation", "[]") {
   REQUIRE(r.eval({{"a0", 5}, {"a1", 9}}) == 33);
 }
 
+TEST_CASE("Polynomial<int64_t> terms", "[]") {
+  // Terms are kept in name order, regardless of the order of interning.
+  Polynomial<int64_t> z("z"), b("b"), aa("aa");
+  Polynomial<int64_t> p = 2 * z + b - 4 + aa;
+  REQUIRE(to_string(p) == "-4 + aa + b + 2*z");
+  REQUIRE(p.constant() == -4);
+  REQUIRE(p["z"] == 2);
+  REQUIRE(p["y"] == 0);
+  REQUIRE(p.getMap().count("b") == 1);
+  REQUIRE(p.getMap().begin()->first.empty());
+  REQUIRE(Symbol("b") == std::next(p.getMap().begin(), 2)->first);
+  REQUIRE((p - b).getMap().count("b") == 0);
+  REQUIRE(p - p == Polynomial<int64_t>());
+  REQUIRE(b + aa < b + z);
+  p.setConstant(0);
+  REQUIRE(p.isConstant() == false);
+  REQUIRE(to_string(p.partial_eval({{"z", 3}, {"aa", 1}})) == "7 + b");
+  p.substitute("b", z - aa);
+  REQUIRE(to_string(p) == "3*z");
+  p.mutateMap()["q"] = 5;
+  REQUIRE(to_string(p) == "5*q + 3*z");
+}
+
+TEST_CASE("Symbols interned concurrently", "[]") {
+  // Threads racing to intern the same names must all get the same symbols.
+  constexpr std::size_t kThreads = 8;
+  constexpr std::size_t kNames = 256;
+  std::vector<std::vector<Symbol>> interned(kThreads);
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&interned, t] {
+      for (std::size_t n = 0; n < kNames; ++n) {
+        interned[t].emplace_back("concurrent_" + std::to_string((n + t) % kNames));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (std::size_t t = 0; t < kThreads; ++t) {
+    for (std::size_t n = 0; n < kNames; ++n) {
+      Symbol sym = interned[t][n];
+      REQUIRE(sym == "concurrent_" + std::to_string((n + t) % kNames));
+      REQUIRE(sym == interned[0][(n + t) % kNames]);
+    }
+  }
+}
+
 TEST_CASE("HNFMatrix", "[hnf]") {
   Matrix m = MatrixLit({{0, Rational(1, 2)}, {Rational(1, 2), Rational(1, 2)}, {1, 0}});
   bool r = HermiteNormalForm(m);
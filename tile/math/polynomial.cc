@@ -1,5 +1,10 @@
 #include "tile/math/polynomial.h"
 
+#include <array>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+
 #include <boost/format.hpp>
 
 #include "base/util/lookup.h"
@@ -8,16 +13,76 @@ namespace vertexai {
 namespace tile {
 namespace math {
 
+namespace {
+
+// The table of interned names.  Interning an existing name, which is by far the
+// common case, takes only a shared lock on one shard, so concurrent compilations
+// don't serialize on symbol construction.
+//
+// N.B. The table only grows: a Symbol is a bare pointer into it, so no name can
+// be released.  It holds one copy of each distinct name the process has used;
+// index names come from a small, heavily reused vocabulary, so this stays small
+// in practice, but a process that keeps generating fresh names grows it without
+// bound.
+class SymbolTable {
+ public:
+  const std::string* Intern(const std::string& name) {
+    Shard& shard = shards_[std::hash<std::string>{}(name) % kShardCount];
+    {
+      std::shared_lock<std::shared_timed_mutex> lock{shard.mu};
+      auto it = shard.names.find(name);
+      if (it != shard.names.end()) {
+        return &*it;
+      }
+    }
+    std::lock_guard<std::shared_timed_mutex> lock{shard.mu};
+    return &*shard.names.insert(name).first;
+  }
+
+ private:
+  static constexpr std::size_t kShardCount = 16;
+
+  struct Shard {
+    std::shared_timed_mutex mu;
+    std::unordered_set<std::string> names;
+  };
+
+  std::array<Shard, kShardCount> shards_;
+};
+
+const std::string* Intern(const std::string& name) {
+  // N.B. The table is never destroyed, so that symbols held by static objects stay valid.
+  static SymbolTable* table = new SymbolTable;
+  return table->Intern(name);
+}
+
+const std::string* EmptyName() {
+  static const std::string* empty = Intern(std::string{});
+  return empty;
+}
+
+}  // namespace
+
+Symbol::Symbol() : name_{EmptyName()} {}
+
+Symbol::Symbol(const std::string& name) : name_{name.empty() ? EmptyName() : Intern(name)} {}
+
+Symbol::Symbol(const char* name) : name_{*name ? Intern(name) : EmptyName()} {}
+
 template <typename T>
 Polynomial<T>::Polynomial() {}
 
 template <typename T>
-Polynomial<T>::Polynomial(const T& c) : Polynomial<T>("", c) {}
+Polynomial<T>::Polynomial(const T& c) {
+  if (c) {
+    map_.push_back(Symbol{}, c);
+  }
+}
 
 template <typename T>
 Polynomial<T>::Polynomial(const std::string& i, const T& c) {
   if (c) {
-    map_[i] = c;
+    map_.push_back(Symbol{i}, c);
   }
 }
 
@@ -25,10 +90,13 @@ template <typename T>
 T Polynomial<T>::eval(const std::map<std::string, T>& values) const {
   T res = 0;
   for (const auto& kvp : map_) {
-    if (kvp.first == "") {
+    if (kvp.first.empty()) {
       res += kvp.second;
-    } else if (values.find(kvp.first) != values.end()) {
-      res += kvp.second * safe_at(values, kvp.first);
+      continue;
+    }
+    auto it = values.find(kvp.first);
+    if (it != values.end()) {
+      res += kvp.second * it->second;
     } else {
       throw std::runtime_error(
           str(boost::format("Failed to find value for %s, when evaluating %s") % kvp.first % toString()));
@@ -39,11 +107,15 @@ T Polynomial<T>::eval(const std::map<std::string, T>& values) const {
 
 template <typename T>
 Polynomial<T> Polynomial<T>::partial_eval(const std::map<std::string, T>& values) const {
-  Polynomial<T> r = *this;
+  Polynomial<T> r;
   T off = 0;
-  for (const auto& kvp : values) {
-    off += get(kvp.first) * kvp.second;
-    r.map_.erase(kvp.first);
+  for (const auto& kvp : map_) {
+    auto it = values.find(kvp.first);
+    if (it == values.end()) {
+      r.map_.push_back(kvp.first, kvp.second);
+    } else {
+      off += kvp.second * it->second;
+    }
   }
   r += off;
   return r;
@@ -59,23 +131,42 @@ T Polynomial<T>::operator[](const std::string& var) const {
 }
 
 template <typename T>
-const std::map<std::string, T>& Polynomial<T>::getMap() const {
+const SymbolMap<T>& Polynomial<T>::getMap() const {
   return map_;
 }
 
 template <typename T>
-std::map<std::string, T>& Polynomial<T>::mutateMap() {
+SymbolMap<T>& Polynomial<T>::mutateMap() {
   return map_;
 }
 
 template <typename T>
 Polynomial<T>& Polynomial<T>::operator+=(const Polynomial<T>& rhs) {
-  for (const auto& kvp : rhs.map_) {
-    T new_val = (map_[kvp.first] += kvp.second);
-    if (new_val == 0) {
-      map_.erase(kvp.first);
+  if (rhs.map_.empty()) {
+    return *this;
+  }
+  // Merge the two sorted term lists, dropping terms which cancel.
+  SymbolMap<T> result;
+  result.reserve(map_.size() + rhs.map_.size());
+  auto lit = map_.begin();
+  auto rit = rhs.map_.begin();
+  while (lit != map_.end() || rit != rhs.map_.end()) {
+    if (rit == rhs.map_.end() || (lit != map_.end() && lit->first < rit->first)) {
+      result.push_back(lit->first, lit->second);
+      ++lit;
+    } else if (lit == map_.end() || rit->first < lit->first) {
+      result.push_back(rit->first, rit->second);
+      ++rit;
+    } else {
+      T sum = lit->second + rit->second;
+      if (sum != 0) {
+        result.push_back(lit->first, sum);
+      }
+      ++lit;
+      ++rit;
     }
   }
+  map_ = std::move(result);
   return *this;
 }
 
@@ -91,12 +182,16 @@ bool Polynomial<T>::operator<(const Polynomial<T>& rhs) const {
 
 template <typename T>
 Polynomial<T>& Polynomial<T>::operator-=(const Polynomial<T>& rhs) {
-  return *this += -1 * rhs;
+  return *this += -rhs;
 }
 
 template <typename T>
 Polynomial<T> Polynomial<T>::operator-() const {
-  return -1 * (*this);
+  Polynomial<T> r = *this;
+  for (auto& kvp : r.map_) {
+    kvp.second = -kvp.second;
+  }
+  return r;
 }
 
 template <typename T>
@@ -118,28 +213,29 @@ Polynomial<T>& Polynomial<T>::operator/=(const T& rhs) {
 
 template <typename T>
 T Polynomial<T>::constant() const {
-  auto it = map_.find("");
-  return (it == map_.end() ? 0 : it->second);
+  // The constant term's empty name sorts before all others.
+  auto it = map_.begin();
+  return (it == map_.end() || !it->first.empty() ? 0 : it->second);
 }
 
 template <typename T>
 void Polynomial<T>::setConstant(T value) {
   if (value == T(0)) {
-    map_.erase("");
+    map_.erase(Symbol{});
   } else {
-    map_[""] = value;
+    map_[Symbol{}] = value;
   }
 }
 
 template <typename T>
 T Polynomial<T>::tryDivide(const Polynomial<T>& p, bool ignoreConst) const {
   auto it = p.map_.begin();
-  if (ignoreConst && it != p.map_.end() && it->first == "") {
+  if (ignoreConst && it != p.map_.end() && it->first.empty()) {
     it++;
   }
   T val = 0;
   for (const auto& kvp : map_) {
-    if (ignoreConst && kvp.first == "") {
+    if (ignoreConst && kvp.first.empty()) {
       continue;
     }
     if (it == p.map_.end() || it->first != kvp.first) {
@@ -160,12 +256,13 @@ T Polynomial<T>::tryDivide(const Polynomial<T>& p, bool ignoreConst) const {
 
 template <typename T>
 void Polynomial<T>::substitute(const std::string& var, const Polynomial<T>& replacement) {
-  if (map_.count(var) == 0) {
+  auto it = map_.find(var);
+  if (it == map_.end()) {
     // If var isn't in this polynomial, nothing needs to be done
     return;
   }
-  T coeff = safe_at(map_, var);
-  map_.erase(var);
+  T coeff = it->second;
+  map_.erase(it);
   (*this) += coeff * replacement;
 }
 
@@ -175,12 +272,14 @@ void Polynomial<T>::substitute(const std::map<std::string, Polynomial<T>>& repla
   for (const auto& name_value : map_) {
     auto replacement = replacements.find(name_value.first);
     if (replacement == replacements.end()) {
-      result += Polynomial{name_value.first, name_value.second};
+      Polynomial term;
+      term.map_.push_back(name_value.first, name_value.second);
+      result += term;
       continue;
     }
     result += replacement->second * name_value.second;
   }
-  map_.swap(result.map_);
+  map_ = std::move(result.map_);
 }
 
 template <typename T>
@@ -195,7 +294,7 @@ Polynomial<T> Polynomial<T>::sym_eval(const std::map<std::string, Polynomial> va
     if (kvp.first.empty()) {
       out += Polynomial<T>(kvp.second);
     } else {
-      out += safe_at(values, kvp.first) * kvp.second;
+      out += safe_at(values, kvp.first.str()) * kvp.second;
     }
   }
   return out;
@@ -205,7 +304,7 @@ template <typename T>
 std::string Polynomial<T>::GetNonzeroIndex() const {
   // Returns a nonconstant nonzero index, if one exists; otherwise returns empty string
   for (const auto& kvp : map_) {
-    if (!(kvp.first.empty()) && kvp.second != 0) return kvp.first;
+    if (!(kvp.first.empty()) && kvp.second != 0) return kvp.first.str();
   }
 
   // No nonconstant index has a nonzero coefficient
@@ -246,9 +345,9 @@ std::string Polynomial<T>::toString() const {
       }
     }
     auto value = abs_value(kvp.second);
-    if (value != 1 || kvp.first == "") {
+    if (value != 1 || kvp.first.empty()) {
       ss << value;
-      if (kvp.first != "") {
+      if (!kvp.first.empty()) {
         ss << "*";
       }
     }
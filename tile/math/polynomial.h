@@ -1,12 +1,17 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cstring>
 #include <map>
+#include <ostream>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <boost/container/small_vector.hpp>
 #include <boost/operators.hpp>
 
 #include "base/util/logging.h"
@@ -16,6 +21,148 @@ namespace vertexai {
 namespace tile {
 namespace math {
 
+// An interned index name.  All symbols with the same name share one copy of
+// it, so copying a symbol is free and comparing two symbols for equality is a
+// pointer comparison.  The empty symbol names a polynomial's constant term.
+class Symbol {
+ public:
+  Symbol();  // The empty symbol
+  // clang-format off
+  //cppcheck-suppress noExplicitConstructor  // NOLINT
+  Symbol(const std::string& name);  // NOLINT
+  //cppcheck-suppress noExplicitConstructor  // NOLINT
+  Symbol(const char* name);  // NOLINT
+  // clang-format on
+
+  const std::string& str() const { return *name_; }
+  operator const std::string&() const { return *name_; }  // NOLINT
+  const char* c_str() const { return name_->c_str(); }
+  bool empty() const { return name_->empty(); }
+  std::size_t size() const { return name_->size(); }
+
+  // N.B. The operators are only found by argument-dependent lookup, so they don't hide others in scope.
+  friend bool operator==(Symbol lhs, Symbol rhs) { return lhs.name_ == rhs.name_; }
+  friend bool operator!=(Symbol lhs, Symbol rhs) { return lhs.name_ != rhs.name_; }
+  // Symbols are ordered by name, so that iteration order doesn't depend on the order of interning.
+  friend bool operator<(Symbol lhs, Symbol rhs) { return lhs.name_ != rhs.name_ && *lhs.name_ < *rhs.name_; }
+  friend bool operator==(Symbol lhs, const std::string& rhs) { return *lhs.name_ == rhs; }
+  friend bool operator==(const std::string& lhs, Symbol rhs) { return lhs == *rhs.name_; }
+  friend bool operator==(Symbol lhs, const char* rhs) { return *lhs.name_ == rhs; }
+  friend bool operator!=(Symbol lhs, const std::string& rhs) { return *lhs.name_ != rhs; }
+  friend bool operator!=(const std::string& lhs, Symbol rhs) { return lhs != *rhs.name_; }
+  friend bool operator!=(Symbol lhs, const char* rhs) { return *lhs.name_ != rhs; }
+  friend std::string operator+(const std::string& lhs, Symbol rhs) { return lhs + *rhs.name_; }
+  friend std::string operator+(Symbol lhs, const std::string& rhs) { return *lhs.name_ + rhs; }
+  friend std::string operator+(const char* lhs, Symbol rhs) { return lhs + *rhs.name_; }
+  friend std::string operator+(Symbol lhs, const char* rhs) { return *lhs.name_ + rhs; }
+  friend std::ostream& operator<<(std::ostream& os, Symbol sym) { return os << *sym.name_; }
+
+ private:
+  const std::string* name_;
+};
+
+// The terms of a Polynomial: a map from symbol to coefficient, kept as a
+// vector sorted by symbol name.  Most polynomials have only a few terms, which
+// are stored inline, so building and combining them doesn't allocate.  The
+// interface is the subset of std::map's that polynomials' users need.
+template <typename T>
+class SymbolMap : boost::totally_ordered<SymbolMap<T>> {
+ public:
+  using key_type = Symbol;
+  using mapped_type = T;
+  using value_type = std::pair<Symbol, T>;
+  using Storage = boost::container::small_vector<value_type, 4>;
+  using iterator = typename Storage::iterator;
+  using const_iterator = typename Storage::const_iterator;
+  using size_type = std::size_t;
+
+  iterator begin() { return terms_.begin(); }
+  iterator end() { return terms_.end(); }
+  const_iterator begin() const { return terms_.begin(); }
+  const_iterator end() const { return terms_.end(); }
+  size_type size() const { return terms_.size(); }
+  bool empty() const { return terms_.empty(); }
+  void clear() { terms_.clear(); }
+  void reserve(size_type size) { terms_.reserve(size); }
+
+  iterator find(Symbol key) { return begin() + (Find(key) - terms_.cbegin()); }
+  const_iterator find(Symbol key) const { return Find(key); }
+  iterator find(const std::string& key) { return begin() + (Find(key) - terms_.cbegin()); }
+  const_iterator find(const std::string& key) const { return Find(key); }
+  iterator find(const char* key) { return find(std::string{key}); }
+  const_iterator find(const char* key) const { return find(std::string{key}); }
+
+  template <typename K>
+  size_type count(const K& key) const {
+    return find(key) == end() ? 0 : 1;
+  }
+
+  template <typename K>
+  const T& at(const K& key) const {
+    auto it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("SymbolMap::at");
+    }
+    return it->second;
+  }
+
+  template <typename K>
+  T& at(const K& key) {
+    auto it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("SymbolMap::at");
+    }
+    return it->second;
+  }
+
+  T& operator[](Symbol key) { return emplace(key, T()).first->second; }
+
+  std::pair<iterator, bool> emplace(Symbol key, const T& value) {
+    auto it = LowerBound(key);
+    if (it != end() && it->first == key) {
+      return std::make_pair(it, false);
+    }
+    return std::make_pair(terms_.emplace(it, key, value), true);
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) { return emplace(value.first, value.second); }
+
+  iterator erase(iterator pos) { return terms_.erase(pos); }
+  iterator erase(const_iterator pos) { return terms_.erase(pos); }
+
+  template <typename K>
+  size_type erase(const K& key) {
+    auto it = find(key);
+    if (it == end()) {
+      return 0;
+    }
+    terms_.erase(it);
+    return 1;
+  }
+
+  // Appends a term whose symbol follows all of the map's current symbols.
+  void push_back(Symbol key, const T& value) { terms_.emplace_back(key, value); }
+
+  bool operator==(const SymbolMap& rhs) const { return terms_ == rhs.terms_; }
+  bool operator<(const SymbolMap& rhs) const { return terms_ < rhs.terms_; }
+
+ private:
+  iterator LowerBound(Symbol key) {
+    return std::lower_bound(begin(), end(), key, [](const value_type& term, Symbol key) { return term.first < key; });
+  }
+
+  const_iterator Find(Symbol key) const {
+    // Most maps are small enough that a linear scan comparing pointers beats a binary search comparing strings.
+    return std::find_if(terms_.begin(), terms_.end(), [key](const value_type& term) { return term.first == key; });
+  }
+
+  const_iterator Find(const std::string& key) const {
+    return std::find_if(terms_.begin(), terms_.end(), [&key](const value_type& term) { return term.first == key; });
+  }
+
+  Storage terms_;
+};
+
 // A linear Polynomial<Rational> of Rational coefficients
 template <typename T>
 class Polynomial : boost::additive<Polynomial<T>>,
@@ -32,8 +179,8 @@ class Polynomial : boost::additive<Polynomial<T>>,
   Polynomial(const std::string& i, const T& c = 1);  // Monomial  // NOLINT
   // clang-format on
   T operator[](const std::string& var) const;      // Quick coefficent access
-  const std::map<std::string, T>& getMap() const;  // Get inner map
-  std::map<std::string, T>& mutateMap();           // Get inner map for editing
+  const SymbolMap<T>& getMap() const;              // Get inner map
+  SymbolMap<T>& mutateMap();                       // Get inner map for editing
   bool operator==(const Polynomial& rhs) const;    // Equality
   bool operator<(const Polynomial& rhs) const;     // Lexigraphical order
   Polynomial& operator+=(const Polynomial& rhs);   // Addition
@@ -41,7 +188,7 @@ class Polynomial : boost::additive<Polynomial<T>>,
   Polynomial operator-() const;                    // Unary minus
   Polynomial& operator*=(const T& rhs);            // Multiplication by a T
   Polynomial& operator/=(const T& rhs);            // Division by a rations
-  bool isConstant() const { return map_.size() == 0 || (map_.size() == 1 && map_.find("") != map_.end()); }
+  bool isConstant() const { return map_.size() == 0 || (map_.size() == 1 && map_.begin()->first.empty()); }
   T constant() const;         // Get the constant part of the Polynomial<T>
   void setConstant(T value);  // Set the constant part of the Polynomial<T> to value
   T eval(const std::map<std::string, T>& values) const;
@@ -67,7 +214,7 @@ class Polynomial : boost::additive<Polynomial<T>>,
  private:
   // Map from index -> coefficient
   // Constant offset is a coefficent of empty string
-  std::map<std::string, T> map_;
+  SymbolMap<T> map_;
 };
 
 extern template class Polynomial<Rational>;
@@ -2,6 +2,7 @@
 
 #include "tile/platform/local_machine/buffer.h"
 
+#include <set>
 #include <utility>
 
 #include "base/util/error.h"
@@ -24,19 +25,43 @@ std::shared_ptr<Buffer> Buffer::Downcast(const std::shared_ptr<tile::Buffer>& bu
 }
 
 Buffer::Buffer(const std::shared_ptr<DevInfo>& devinfo, const std::shared_ptr<MemStrategy>& mem_strategy,
-               std::shared_ptr<MemChunk> chunk)
-    : devinfo_{devinfo}, mem_strategy_{mem_strategy}, size_{chunk->size()}, chunk_{std::move(chunk)} {}
+               std::shared_ptr<MemChunk> chunk, bool pinned)
+    : devinfo_{devinfo}, mem_strategy_{mem_strategy}, size_{chunk->size()}, pinned_{pinned}, chunk_{std::move(chunk)} {}
 
 Buffer::Buffer(const std::shared_ptr<DevInfo>& devinfo, const std::shared_ptr<MemStrategy>& mem_strategy,
                std::uint64_t size)
     : devinfo_{devinfo}, mem_strategy_{mem_strategy}, size_{size} {}
 
 boost::future<std::unique_ptr<View>> Buffer::MapCurrent(const context::Context& ctx) {
+  auto pending = pending_launch();
+  if (pending.valid()) {
+    if (!pending.is_ready()) {
+      context::Context ctx_copy{ctx};
+      return pending
+          .then([self = shared_from_this(), ctx = std::move(ctx_copy)](boost::shared_future<void> launch) {
+            launch.get();
+            self->EnsureChunk(ctx);
+            return self->chunk()->MapCurrent(ctx);
+          })
+          .unwrap();
+    }
+    pending.get();
+  }
   EnsureChunk(ctx);
   return chunk()->MapCurrent(ctx);
 }
 
 std::unique_ptr<View> Buffer::MapDiscard(const context::Context& ctx) {
+  auto pending = pending_launch();
+  if (pending.valid()) {
+    // The contents are being discarded, so the outcome of the launch doesn't matter -- only that it has happened,
+    // so that it can't remap the buffer out from under the caller.
+    pending.wait();
+    std::lock_guard<std::mutex> lock{mu_};
+    if (pending_launch_.valid() && pending_launch_.is_ready()) {
+      pending_launch_ = boost::shared_future<void>{};
+    }
+  }
   EnsureChunk(ctx);
   return chunk()->MapDiscard(ctx);
 }
@@ -48,7 +73,14 @@ void Buffer::RemapTo(std::shared_ptr<MemChunk> chunk) {
     throw std::runtime_error("The requested buffer remapping required a change in buffer size");
   }
   std::lock_guard<std::mutex> lock{mu_};
+  if (pinned_ && chunk_ != chunk) {
+    throw std::runtime_error("The requested buffer remapping would move a pinned buffer");
+  }
   chunk_ = std::move(chunk);
+  if (pending_launch_.valid() && pending_launch_.is_ready()) {
+    // A successful launch supersedes any earlier failed one.
+    pending_launch_ = boost::shared_future<void>{};
+  }
 }
 
 void Buffer::EnsureChunk(const context::Context& ctx) {
@@ -58,6 +90,55 @@ void Buffer::EnsureChunk(const context::Context& ctx) {
   }
 }
 
+std::vector<boost::shared_future<void>> Buffer::RegisterRun(const std::vector<std::shared_ptr<Buffer>>& inputs,
+                                                            const std::vector<std::shared_ptr<Buffer>>& outputs,
+                                                            bool defer, const boost::shared_future<void>& launch) {
+  std::set<Buffer*> outputs_set;
+  for (const auto& buffer : outputs) {
+    outputs_set.insert(buffer.get());
+  }
+  std::set<Buffer*> buffers{outputs_set};
+  for (const auto& buffer : inputs) {
+    buffers.insert(buffer.get());
+  }
+  std::vector<std::unique_lock<std::mutex>> locks;
+  for (Buffer* buffer : buffers) {
+    locks.emplace_back(buffer->mu_);
+  }
+
+  std::vector<boost::shared_future<void>> waits;
+  for (Buffer* buffer : buffers) {
+    const auto& pending = buffer->pending_launch_;
+    if (pending.valid() && !pending.is_ready()) {
+      waits.push_back(pending);
+    }
+  }
+  if (waits.empty() && !defer) {
+    return waits;
+  }
+  for (Buffer* buffer : buffers) {
+    auto previous = std::move(buffer->pending_launch_);
+    if (outputs_set.count(buffer)) {
+      buffer->pending_launch_ = launch;
+    } else if (previous.valid() && (!previous.is_ready() || previous.has_exception())) {
+      buffer->pending_launch_ = launch
+                                    .then([previous](boost::shared_future<void>) {
+                                      // The run waits for its inputs' previous launches, so this doesn't block.
+                                      previous.get();
+                                    })
+                                    .share();
+    } else {
+      buffer->pending_launch_ = launch.then([](boost::shared_future<void>) {}).share();
+    }
+  }
+  return waits;
+}
+
+boost::shared_future<void> Buffer::pending_launch() const {
+  std::lock_guard<std::mutex> lock{mu_};
+  return pending_launch_;
+}
+
 }  // namespace local_machine
 }  // namespace tile
 }  // namespace vertexai
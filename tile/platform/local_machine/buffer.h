@@ -4,6 +4,7 @@
 
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #include "tile/platform/local_machine/devinfo.h"
 #include "tile/platform/local_machine/mem_chunk.h"
@@ -23,12 +24,15 @@ class Buffer : public tile::Buffer, public std::enable_shared_from_this<Buffer>
   static std::shared_ptr<Buffer> Downcast(const std::shared_ptr<tile::Buffer>& buffer,
                                           const std::shared_ptr<DevInfo>& devinfo);
 
+  // A pinned buffer always refers to the supplied chunk; program outputs are written to it in place, rather than to
+  // a new chunk.
   Buffer(const std::shared_ptr<DevInfo>& devinfo, const std::shared_ptr<MemStrategy>& mem_strategy,
-         std::shared_ptr<MemChunk> chunk);
+         std::shared_ptr<MemChunk> chunk, bool pinned = false);
 
   Buffer(const std::shared_ptr<DevInfo>& devinfo, const std::shared_ptr<MemStrategy>& mem_strategy, std::uint64_t size);
 
   const std::shared_ptr<DevInfo>& devinfo() const { return devinfo_; }
+  bool pinned() const { return pinned_; }
 
   std::shared_ptr<MemChunk> chunk() const {
     std::lock_guard<std::mutex> lock{mu_};
@@ -43,12 +47,30 @@ class Buffer : public tile::Buffer, public std::enable_shared_from_this<Buffer>
   void RemapTo(std::shared_ptr<MemChunk> chunk);
   void EnsureChunk(const context::Context& ctx);
 
+  // Registers a run of a program on its buffers, returning the pending launches it must wait for.  Each buffer's
+  // pending launch is read and replaced under the buffer's lock, and the buffers are locked together (in a consistent
+  // order), so that concurrent runs sharing buffers each see the other's registration, or neither.
+  //
+  // If any of the buffers has a launch still pending, or if defer is set, the run is deferred until launch: until
+  // then, mapping any of its buffers waits for it.  Each output's pending launch becomes launch, so that if the run
+  // fails, mapping the output's current contents fails with the run's error.  Each input's becomes ready once the run
+  // has launched, but carries the failure of the input's previous pending launch, if any -- the run doesn't change
+  // its inputs' contents, so only a failure to write them matters.  A buffer that's both an input and an output is
+  // treated as an output.  Otherwise, nothing is changed, and the returned vector is empty.
+  static std::vector<boost::shared_future<void>> RegisterRun(const std::vector<std::shared_ptr<Buffer>>& inputs,
+                                                             const std::vector<std::shared_ptr<Buffer>>& outputs,
+                                                             bool defer, const boost::shared_future<void>& launch);
+
+  boost::shared_future<void> pending_launch() const;
+
  private:
   const std::shared_ptr<DevInfo> devinfo_;
   const std::shared_ptr<MemStrategy> mem_strategy_;
   const std::uint64_t size_;
+  const bool pinned_ = false;
   mutable std::mutex mu_;
   std::shared_ptr<MemChunk> chunk_;
+  boost::shared_future<void> pending_launch_;
 };
 
 }  // namespace local_machine
@@ -32,6 +32,7 @@ class DirectMemChunk final : public MemChunk {
  public:
   DirectMemChunk(const context::Context& ctx, const std::shared_ptr<DevInfo>& devinfo, std::uint64_t size,
                  hal::Memory* source);
+  DirectMemChunk(const std::shared_ptr<DevInfo>& devinfo, std::uint64_t size, std::shared_ptr<hal::Buffer> mem);
 
   // Buffer implementation
   boost::future<std::unique_ptr<View>> MapCurrent(const context::Context& ctx) final;
@@ -72,6 +73,10 @@ DirectMemChunk::DirectMemChunk(const context::Context& ctx, const std::shared_pt
   mem_ = source->MakeBuffer(size_, hal::BufferAccessMask::ALL);
 }
 
+DirectMemChunk::DirectMemChunk(const std::shared_ptr<DevInfo>& devinfo, std::uint64_t size,
+                               std::shared_ptr<hal::Buffer> mem)
+    : size_{size}, devinfo_{devinfo}, deps_{std::make_shared<MemDeps>()}, mem_{std::move(mem)} {}
+
 boost::future<std::unique_ptr<View>> DirectMemChunk::MapCurrent(const context::Context& ctx) {
   context::Context ctx_copy{ctx};
   std::vector<std::shared_ptr<hal::Event>> deps;
@@ -103,6 +108,11 @@ std::shared_ptr<MemChunk> DirectMemStrategy::MakeChunk(const context::Context& c
   return std::make_shared<DirectMemChunk>(ctx, devinfo_, size, source_);
 }
 
+std::shared_ptr<MemChunk> DirectMemStrategy::ImportHostChunk(const context::Context& ctx, void* base,
+                                                             std::uint64_t size, std::function<void()> release) const {
+  return std::make_shared<DirectMemChunk>(devinfo_, size, source_->ImportHostBuffer(base, size, std::move(release)));
+}
+
 }  // namespace local_machine
 }  // namespace tile
 }  // namespace vertexai
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 
 #include "tile/platform/local_machine/devinfo.h"
@@ -17,6 +18,8 @@ class DirectMemStrategy final : public MemStrategy {
   DirectMemStrategy(const std::shared_ptr<DevInfo>& devinfo, hal::Memory* source);
 
   std::shared_ptr<MemChunk> MakeChunk(const context::Context& ctx, std::uint64_t size) const final;
+  std::shared_ptr<MemChunk> ImportHostChunk(const context::Context& ctx, void* base, std::uint64_t size,
+                                            std::function<void()> release) const final;
 
  private:
   std::shared_ptr<DevInfo> devinfo_;
@@ -2,26 +2,214 @@
 
 #include "tile/platform/local_machine/mem_cache.h"
 
+#include <algorithm>
+#include <exception>
 #include <utility>
 
+#include "base/util/error.h"
+#include "base/util/logging.h"
+#include "base/util/perf_counter.h"
+
 namespace vertexai {
 namespace tile {
 namespace local_machine {
+namespace {
+
+PerfCounter hits_counter("mem_cache_hits");
+PerfCounter misses_counter("mem_cache_misses");
+PerfCounter bytes_cached_counter("mem_cache_bytes_cached");
+PerfCounter bytes_wasted_counter("mem_cache_bytes_wasted");
+
+std::uint64_t RoundUp(std::uint64_t size, std::uint64_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+MemCache::MemCache(hal::Memory* source, std::uint64_t budget)
+    : source_{source}, budget_{budget}, alignment_{std::max<std::uint64_t>(1, source->ArenaBufferAlignment())} {}
+
+std::uint64_t MemCache::SizeClass(std::uint64_t size, std::uint64_t alignment) {
+  size = RoundUp(std::max<std::uint64_t>(size, 1), alignment);
+  std::uint64_t pow2 = 1;
+  while (pow2 * 2 < size) {
+    pow2 *= 2;
+  }
+  return RoundUp(size, std::max(alignment, RoundUp(pow2 / 4, alignment)));
+}
+
+MemCache::Block MemCache::Alloc(std::uint64_t size) {
+  Block block;
+  if (TryAllocCached(size, &block)) {
+    hits_counter.inc();
+  } else {
+    misses_counter.inc();
+    std::uint64_t capacity = SizeClass(size, alignment_);
+    try {
+      block = AllocSource(capacity);
+    } catch (const std::exception& ex) {
+      if (!cached_bytes()) {
+        throw;
+      }
+      IVLOG(1, "MemCache: allocation of " << capacity << " bytes failed (" << ex.what() << "); trimming cache");
+      Trim(0);
+      block = AllocSource(capacity);
+    }
+    std::lock_guard<std::mutex> lock{mu_};
+    live_bytes_ += block.capacity;
+    if (block.arena) {
+      arenas_.emplace(block.arena.get(), ArenaInfo{block.capacity, {}});
+    }
+  }
+  block.size = size;
+  if (block.arena) {
+    block.buffer = block.arena->MakeBuffer(block.offset, size);
+  }
+  bytes_wasted_counter.add(block.capacity - size);
+  return block;
+}
+
+bool MemCache::TryAllocCached(std::uint64_t size, Block* block) {
+  std::lock_guard<std::mutex> lock{mu_};
+  auto it = index_.lower_bound(size);
+  if (it == index_.end()) {
+    return false;
+  }
+  std::uint64_t capacity = it->first;
+  bool split = it->second->block.arena && 2 * size <= capacity;
+  if (!split && capacity / 4 < capacity - size) {
+    // The best fit would waste too much memory.
+    return false;
+  }
+  *block = Remove(it->second);
+  if (split) {
+    std::uint64_t used = RoundUp(std::max<std::uint64_t>(size, 1), alignment_);
+    if (used < block->capacity) {
+      Block rest;
+      rest.arena = block->arena;
+      rest.offset = block->offset + used;
+      rest.capacity = block->capacity - used;
+      block->capacity = used;
+      Insert(std::move(rest));
+    }
+  }
+  live_bytes_ += block->capacity;
+  return true;
+}
+
+MemCache::Block MemCache::AllocSource(std::uint64_t capacity) {
+  Block block;
+  block.capacity = capacity;
+  bool use_arenas;
+  {
+    std::lock_guard<std::mutex> lock{mu_};
+    use_arenas = use_arenas_;
+  }
+  if (use_arenas) {
+    try {
+      block.arena = source_->MakeArena(capacity, hal::BufferAccessMask::DEVICE_RW);
+      return block;
+    } catch (const error::Unimplemented&) {
+      std::lock_guard<std::mutex> lock{mu_};
+      use_arenas_ = false;
+    }
+  }
+  block.buffer = source_->MakeBuffer(capacity, hal::BufferAccessMask::DEVICE_RW);
+  return block;
+}
 
-std::shared_ptr<hal::Buffer> MemCache::TryAlloc(std::size_t size) {
+void MemCache::Free(Block block) {
+  bytes_wasted_counter.add(-static_cast<std::int64_t>(block.capacity - block.size));
+  if (block.arena) {
+    // The buffer is only a view of the arena; a later allocation will make its own.
+    block.buffer.reset();
+  }
+  std::vector<Block> evicted;
   std::lock_guard<std::mutex> lock{mu_};
-  auto& l = mem_[size];
-  if (l.size()) {
-    std::shared_ptr<hal::Buffer> result{std::move(l.top())};
-    l.pop();
-    return result;
+  live_bytes_ -= block.capacity;
+  Insert(std::move(block));
+  if (budget_ < live_bytes_ + cached_bytes_) {
+    TrimLocked(live_bytes_ < budget_ ? budget_ - live_bytes_ : 0, &evicted);
   }
-  return std::shared_ptr<hal::Buffer>{};
 }
 
-void MemCache::Free(std::size_t size, std::shared_ptr<hal::Buffer> mem) {
+void MemCache::Trim(std::uint64_t target) {
+  std::vector<Block> evicted;
+  std::lock_guard<std::mutex> lock{mu_};
+  TrimLocked(target, &evicted);
+}
+
+std::uint64_t MemCache::cached_bytes() const {
   std::lock_guard<std::mutex> lock{mu_};
-  mem_[size].push(std::move(mem));
+  return cached_bytes_;
+}
+
+std::uint64_t MemCache::resident_bytes() const {
+  std::lock_guard<std::mutex> lock{mu_};
+  return live_bytes_ + cached_bytes_;
+}
+
+void MemCache::Insert(Block block) {
+  ArenaInfo* arena_info = nullptr;
+  if (block.arena) {
+    // Merge the block with the cached ranges on either side of it.
+    arena_info = &arenas_.at(block.arena.get());
+    auto& cached = arena_info->cached;
+    auto next = cached.lower_bound(block.offset);
+    if (next != cached.end() && next->first == block.offset + block.capacity) {
+      block.capacity += Remove(next->second).capacity;
+    }
+    auto prev = cached.lower_bound(block.offset);
+    if (prev != cached.begin() && std::prev(prev)->first + std::prev(prev)->second->block.capacity == block.offset) {
+      Block merged = Remove(std::prev(prev)->second);
+      block.offset = merged.offset;
+      block.capacity += merged.capacity;
+    }
+  }
+  cached_bytes_ += block.capacity;
+  bytes_cached_counter.add(block.capacity);
+  std::uint64_t capacity = block.capacity;
+  std::uint64_t offset = block.offset;
+  auto it = lru_.emplace(lru_.begin(), Entry{std::move(block), index_.end()});
+  it->index_ent = index_.emplace(capacity, it);
+  if (arena_info) {
+    arena_info->cached.emplace(offset, it);
+  }
+}
+
+MemCache::Block MemCache::Remove(Lru::iterator it) {
+  Block block = std::move(it->block);
+  index_.erase(it->index_ent);
+  lru_.erase(it);
+  if (block.arena) {
+    arenas_.at(block.arena.get()).cached.erase(block.offset);
+  }
+  cached_bytes_ -= block.capacity;
+  bytes_cached_counter.add(-static_cast<std::int64_t>(block.capacity));
+  return block;
+}
+
+bool MemCache::IsWhole(const Block& block) const {
+  return !block.arena || (block.offset == 0 && block.capacity == arenas_.at(block.arena.get()).capacity);
+}
+
+void MemCache::TrimLocked(std::uint64_t target, std::vector<Block>* evicted) {
+  // N.B. The evicted blocks are released by the caller after the lock is dropped, since releasing device memory may be
+  // slow.
+  auto it = lru_.end();
+  while (target < cached_bytes_ && it != lru_.begin()) {
+    auto entry = std::prev(it);
+    if (!IsWhole(entry->block)) {
+      // Part of an arena that's still in use; releasing it wouldn't free any memory.
+      it = entry;
+      continue;
+    }
+    Block block = Remove(entry);
+    if (block.arena) {
+      arenas_.erase(block.arena.get());
+    }
+    evicted->emplace_back(std::move(block));
+  }
 }
 
 }  // namespace local_machine
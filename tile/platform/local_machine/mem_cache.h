@@ -3,10 +3,12 @@
 #pragma once
 
 #include <cstdint>
+#include <list>
+#include <map>
 #include <memory>
 #include <mutex>
-#include <stack>
 #include <unordered_map>
+#include <vector>
 
 #include "tile/base/hal.h"
 
@@ -15,14 +17,85 @@ namespace tile {
 namespace local_machine {
 
 // Caches device memory allocations.
+//
+// Freed blocks are kept in a best-fit index: an allocation is served by the smallest cached block that's large enough
+// and wastes at most a quarter of its capacity.  New blocks are rounded up to one of four size classes per power of
+// two, so that requests of slightly different sizes can share blocks.
+//
+// When the source memory supports arenas, blocks are arena ranges, and a cached block at least twice the size of a
+// request is split: the request is served from the front of the block, and the remainder stays cached.  Freed ranges
+// are merged with their cached neighbours, so an arena whose ranges have all been freed is again a single block.
+//
+// The cache aims to hold at most `budget` bytes (in use plus cached); freeing a block past the budget evicts the least
+// recently freed blocks.  Only whole blocks are evicted -- the cached ranges of an arena that's partly in use hold no
+// memory of their own -- so the cache can exceed its budget while fragmented arenas are in use.  If the source memory
+// fails an allocation, the cache is emptied and the allocation retried.
+//
+// The cache is internally synchronized.  Activity is reported through the mem_cache_* PerfCounters.
 class MemCache {
  public:
-  std::shared_ptr<hal::Buffer> TryAlloc(std::size_t size);
-  void Free(std::size_t size, std::shared_ptr<hal::Buffer>);
+  // A block of memory allocated through the cache.
+  struct Block {
+    std::shared_ptr<hal::Buffer> buffer;  // Exactly covers the requested size, if the source supports arenas
+    std::shared_ptr<hal::Arena> arena;    // The arena containing the block, if the source supports arenas
+    std::uint64_t offset = 0;             // The block's offset within the arena
+    std::uint64_t capacity = 0;           // The block's size
+    std::uint64_t size = 0;               // The requested size
+  };
+
+  MemCache(hal::Memory* source, std::uint64_t budget);
+
+  // Allocates a block of at least size bytes, from the cache if possible.
+  Block Alloc(std::uint64_t size);
+
+  // Returns a block to the cache.
+  void Free(Block block);
+
+  // Evicts the least recently freed blocks until at most target bytes are cached.
+  void Trim(std::uint64_t target);
+
+  // The number of bytes held in freed blocks.
+  std::uint64_t cached_bytes() const;
+
+  // The number of bytes allocated from the source memory and not yet released.
+  std::uint64_t resident_bytes() const;
+
+  // The capacity of a newly-allocated block serving a request for size bytes.
+  static std::uint64_t SizeClass(std::uint64_t size, std::uint64_t alignment);
 
  private:
-  std::mutex mu_;
-  std::unordered_map<std::size_t, std::stack<std::shared_ptr<hal::Buffer>>> mem_;
+  struct Entry;
+  using Lru = std::list<Entry>;
+  using Index = std::multimap<std::uint64_t, Lru::iterator>;
+
+  struct Entry {
+    Block block;
+    Index::iterator index_ent;
+  };
+
+  struct ArenaInfo {
+    std::uint64_t capacity;
+    std::map<std::uint64_t, Lru::iterator> cached;  // The arena's cached ranges, by offset
+  };
+
+  bool TryAllocCached(std::uint64_t size, Block* block);
+  Block AllocSource(std::uint64_t capacity);
+  void Insert(Block block);
+  Block Remove(Lru::iterator it);
+  bool IsWhole(const Block& block) const;
+  void TrimLocked(std::uint64_t target, std::vector<Block>* evicted);
+
+  hal::Memory* source_;
+  const std::uint64_t budget_;
+  const std::uint64_t alignment_;
+
+  mutable std::mutex mu_;
+  bool use_arenas_ = true;
+  Lru lru_;      // Cached blocks, most recently freed first
+  Index index_;  // Cached blocks, by capacity
+  std::unordered_map<const hal::Arena*, ArenaInfo> arenas_;
+  std::uint64_t cached_bytes_ = 0;
+  std::uint64_t live_bytes_ = 0;
 };
 
 }  // namespace local_machine
@@ -0,0 +1,217 @@
+// Copyright 2018 Intel Corporation.
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/util/error.h"
+#include "tile/platform/local_machine/mem_cache.h"
+
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::IsNull;
+using ::testing::Le;
+using ::testing::NotNull;
+
+namespace vertexai {
+namespace tile {
+namespace local_machine {
+namespace {
+
+class FakeBuffer final : public hal::Buffer {
+ public:
+  FakeBuffer(std::uint64_t offset, std::uint64_t size) : offset_{offset}, size_{size} {}
+
+  boost::future<void*> MapCurrent(const std::vector<std::shared_ptr<hal::Event>>& deps) final {
+    throw error::Unimplemented{"FakeBuffer::MapCurrent"};
+  }
+  boost::future<void*> MapDiscard(const std::vector<std::shared_ptr<hal::Event>>& deps) final {
+    throw error::Unimplemented{"FakeBuffer::MapDiscard"};
+  }
+  std::shared_ptr<hal::Event> Unmap(const context::Context& ctx) final {
+    throw error::Unimplemented{"FakeBuffer::Unmap"};
+  }
+
+  std::uint64_t offset() const { return offset_; }
+  std::uint64_t size() const { return size_; }
+
+ private:
+  std::uint64_t offset_;
+  std::uint64_t size_;
+};
+
+class FakeArena final : public hal::Arena {
+ public:
+  std::shared_ptr<hal::Buffer> MakeBuffer(std::uint64_t offset, std::uint64_t size) final {
+    return std::make_shared<FakeBuffer>(offset, size);
+  }
+};
+
+// A memory that counts the bytes it has allocated, and the bytes still resident (allocated and not yet released).
+class FakeMemory final : public hal::Memory {
+ public:
+  explicit FakeMemory(bool arenas) : arenas_{arenas} {}
+
+  std::uint64_t size_goal() const final { return std::giga::num; }
+  hal::BufferAccessMask AllowedAccesses() const final { return hal::BufferAccessMask::ALL; }
+  std::size_t ArenaBufferAlignment() const final { return 64; }
+
+  std::shared_ptr<hal::Buffer> MakeBuffer(std::uint64_t size, hal::BufferAccessMask access) final {
+    allocated += size;
+    resident += size;
+    return std::shared_ptr<hal::Buffer>(new FakeBuffer(0, size), [this, size](hal::Buffer* buffer) {
+      resident -= size;
+      delete buffer;
+    });
+  }
+
+  std::shared_ptr<hal::Arena> MakeArena(std::uint64_t size, hal::BufferAccessMask access) final {
+    if (!arenas_) {
+      throw error::Unimplemented{"FakeMemory::MakeArena"};
+    }
+    allocated += size;
+    resident += size;
+    return std::shared_ptr<hal::Arena>(new FakeArena(), [this, size](hal::Arena* arena) {
+      resident -= size;
+      delete arena;
+    });
+  }
+
+  std::uint64_t allocated = 0;
+  std::uint64_t resident = 0;
+
+ private:
+  bool arenas_;
+};
+
+TEST(MemCacheTest, SizeClassesBoundWaste) {
+  EXPECT_THAT(MemCache::SizeClass(0, 64), Eq(64u));
+  EXPECT_THAT(MemCache::SizeClass(1000, 64), Eq(1024u));
+  EXPECT_THAT(MemCache::SizeClass(4097, 64), Eq(5120u));
+  for (std::uint64_t size = 1; size < (1 << 30); size = size * 3 / 2 + 1) {
+    auto capacity = MemCache::SizeClass(size, 64);
+    EXPECT_THAT(capacity, Ge(size));
+    EXPECT_THAT(capacity % 64, Eq(0u));
+    EXPECT_THAT(capacity, Le(size + size / 4 + 64));
+  }
+}
+
+TEST(MemCacheTest, ReusesBestFit) {
+  FakeMemory memory{false};
+  MemCache cache{&memory, std::giga::num};
+  auto small = cache.Alloc(1000);
+  auto large = cache.Alloc(4000);
+  auto small_buffer = small.buffer.get();
+  cache.Free(std::move(large));
+  cache.Free(std::move(small));
+  // A slightly smaller request reuses the small block, rather than the large one.
+  auto block = cache.Alloc(990);
+  EXPECT_THAT(block.buffer.get(), Eq(small_buffer));
+  EXPECT_THAT(memory.allocated, Eq(1024u + 4096u));
+  // A request much smaller than any cached block is a miss.
+  auto tiny = cache.Alloc(100);
+  EXPECT_THAT(memory.allocated, Eq(1024u + 4096u + 128u));
+  cache.Free(std::move(block));
+  cache.Free(std::move(tiny));
+}
+
+TEST(MemCacheTest, SplitsArenaBlocks) {
+  FakeMemory memory{true};
+  MemCache cache{&memory, std::giga::num};
+  cache.Free(cache.Alloc(4096));
+  auto first = cache.Alloc(1000);
+  auto second = cache.Alloc(1000);
+  EXPECT_THAT(memory.allocated, Eq(4096u));
+  EXPECT_THAT(first.arena, Eq(second.arena));
+  auto first_buffer = std::static_pointer_cast<FakeBuffer>(first.buffer);
+  auto second_buffer = std::static_pointer_cast<FakeBuffer>(second.buffer);
+  EXPECT_THAT(first_buffer->size(), Eq(1000u));
+  EXPECT_THAT(second_buffer->offset(), Ge(first_buffer->offset() + 1000));
+  cache.Free(std::move(first));
+  cache.Free(std::move(second));
+}
+
+TEST(MemCacheTest, CoalescesArenaRanges) {
+  FakeMemory memory{true};
+  MemCache cache{&memory, std::giga::num};
+  cache.Free(cache.Alloc(4096));
+  auto first = cache.Alloc(1000);
+  auto second = cache.Alloc(1000);
+  cache.Free(std::move(first));
+  cache.Free(std::move(second));
+  // The freed ranges are merged back into the whole arena, which can serve a request larger than either range.
+  auto whole = cache.Alloc(4000);
+  EXPECT_THAT(memory.allocated, Eq(4096u));
+  EXPECT_THAT(std::static_pointer_cast<FakeBuffer>(whole.buffer)->offset(), Eq(0u));
+  cache.Free(std::move(whole));
+}
+
+TEST(MemCacheTest, TrimsOnlyWholeArenas) {
+  FakeMemory memory{true};
+  MemCache cache{&memory, std::giga::num};
+  cache.Free(cache.Alloc(4096));
+  auto block = cache.Alloc(1000);
+  // The arena's remainder can't be released while part of the arena is in use.
+  cache.Trim(0);
+  EXPECT_THAT(memory.resident, Eq(4096u));
+  EXPECT_THAT(cache.resident_bytes(), Eq(4096u));
+  cache.Free(std::move(block));
+  cache.Trim(0);
+  EXPECT_THAT(memory.resident, Eq(0u));
+  EXPECT_THAT(cache.resident_bytes(), Eq(0u));
+}
+
+TEST(MemCacheTest, FragmentedArenasStayWithinBudget) {
+  constexpr std::uint64_t kBudget = 64 * 1024;
+  FakeMemory memory{true};
+  MemCache cache{&memory, kBudget};
+  for (int run = 0; run < 200; ++run) {
+    // Allocate blocks of varying sizes, splitting the cached arenas, and free them in a different order.
+    std::vector<MemCache::Block> blocks;
+    for (int idx = 0; idx < 8; ++idx) {
+      blocks.emplace_back(cache.Alloc(1000 + ((run * 7 + idx * 13) % 29) * (run % 3 + 1) * 250));
+      EXPECT_THAT(cache.resident_bytes(), Eq(memory.resident));
+    }
+    for (int idx = 0; idx < 8; ++idx) {
+      cache.Free(std::move(blocks[(idx * 5 + run) % 8]));
+      EXPECT_THAT(cache.resident_bytes(), Eq(memory.resident));
+    }
+    EXPECT_THAT(memory.resident, Le(kBudget));
+  }
+  EXPECT_THAT(cache.cached_bytes(), Eq(memory.resident));
+  cache.Trim(0);
+  EXPECT_THAT(memory.resident, Eq(0u));
+}
+
+TEST(MemCacheTest, StaysWithinBudget) {
+  FakeMemory memory{false};
+  MemCache cache{&memory, 64 * 1024};
+  for (std::uint64_t size = 1000; size < 200000; size += 1000) {
+    cache.Free(cache.Alloc(size));
+    EXPECT_THAT(cache.cached_bytes(), Le(64u * 1024u));
+  }
+  cache.Trim(0);
+  EXPECT_THAT(cache.cached_bytes(), Eq(0u));
+}
+
+TEST(MemCacheTest, BoundsGrowthWithVaryingSizes) {
+  // Activation sizes that differ slightly between runs should share blocks.
+  FakeMemory memory{false};
+  MemCache cache{&memory, std::giga::num};
+  for (int run = 0; run < 100; ++run) {
+    std::vector<MemCache::Block> blocks;
+    for (std::uint64_t base : {100000, 200000, 300000}) {
+      blocks.emplace_back(cache.Alloc(base + (run % 10) * 100));
+    }
+    for (auto& block : blocks) {
+      cache.Free(std::move(block));
+    }
+  }
+  EXPECT_THAT(memory.allocated, Le(2u * (100000 + 200000 + 300000)));
+}
+
+}  // namespace
+}  // namespace local_machine
+}  // namespace tile
+}  // namespace vertexai
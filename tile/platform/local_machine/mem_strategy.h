@@ -2,9 +2,11 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 
 #include "base/context/context.h"
+#include "base/util/error.h"
 #include "tile/platform/local_machine/mem_chunk.h"
 
 namespace vertexai {
@@ -18,6 +20,14 @@ class MemStrategy {
 
   // Allocates a memory object for kernels to use.
   virtual std::shared_ptr<MemChunk> MakeChunk(const context::Context& ctx, std::uint64_t size) const = 0;
+
+  // Makes a memory object for kernels to use that directly uses existing host memory; see
+  // hal::Memory::ImportHostBuffer.
+  virtual std::shared_ptr<MemChunk> ImportHostChunk(const context::Context& /* ctx */, void* /* base */,
+                                                    std::uint64_t /* size */,
+                                                    std::function<void()> /* release */) const {
+    throw error::Unimplemented{"This memory strategy cannot use host memory in place"};
+  }
 };
 
 }  // namespace local_machine
@@ -17,6 +17,7 @@
 #include "base/util/type_url.h"
 #include "tile/hal/util/selector.h"
 #include "tile/hal/util/settings.h"
+#include "tile/lang/tile_model.h"
 #include "tile/platform/local_machine/block_placer.h"
 #include "tile/platform/local_machine/buffer.h"
 #include "tile/platform/local_machine/direct_mem_strategy.h"
@@ -78,6 +79,12 @@ Platform::Platform(const context::Context& ctx, const proto::Platform& config) {
     LOG(INFO) << "Press any key after attaching a debugger to pid: " << boost::this_process::get_id();
     std::getchar();
   }
+  if (env.count("PLAIDML_TILE_MODEL")) {
+    // Rank tilings by a cost model calibrated against measured kernel durations (see tile_model.h).
+    auto filename = env["PLAIDML_TILE_MODEL"].to_string();
+    LOG(INFO) << "Using calibrated tile model: " << filename;
+    RegisterCostModel(lang::TileModel::Load(filename).CostFunction());
+  }
 
   for (auto& item : FactoryRegistrar<hal::Driver>::Instance()->Factories()) {
     try {
@@ -151,12 +158,46 @@ std::shared_ptr<tile::Buffer> Platform::MakeBuffer(const context::Context& ctx,
   return std::make_shared<Buffer>(platform_dev.devinfo, platform_dev.mem_strategy, size);
 }
 
+std::shared_ptr<tile::Buffer> Platform::ImportHostBuffer(const context::Context& ctx, const std::string& device_id,
+                                                         void* base, std::uint64_t size,
+                                                         std::function<void()> release) {
+  auto& platform_dev = LookupDevice(device_id);
+  auto chunk = platform_dev.mem_strategy->ImportHostChunk(ctx, base, size, std::move(release));
+  return std::make_shared<Buffer>(platform_dev.devinfo, platform_dev.mem_strategy, std::move(chunk), true);
+}
+
 std::unique_ptr<tile::Program> Platform::MakeProgram(const context::Context& ctx, const tile::proto::Program& program) {
   auto& platform_dev = LookupDevice(program.dev_id());
   return std::make_unique<Program>(ctx, program, platform_dev.devinfo, platform_dev.scheduler,
                                    platform_dev.mem_strategy,
                                    std::make_shared<TmpMemStrategy>(platform_dev.devinfo, platform_dev.tmp_mem_source),
-                                   platform_dev.tmp_mem_source, tile_optimizer_);
+                                   tile_optimizer_);
+}
+
+std::string Platform::SerializeProgram(const context::Context& ctx, tile::Program* program) {
+  auto* local_program = dynamic_cast<Program*>(program);
+  if (!local_program) {
+    return std::string{};
+  }
+  return local_program->Serialize();
+}
+
+std::unique_ptr<tile::Program> Platform::DeserializeProgram(const context::Context& ctx,
+                                                            const tile::proto::Program& program,
+                                                            const std::string& serialized) {
+  proto::SerializedProgram pb;
+  if (!pb.ParseFromString(serialized)) {
+    throw error::DataLoss{"Unable to parse serialized program"};
+  }
+  auto& platform_dev = LookupDevice(program.dev_id());
+  if (pb.device_key() != DeviceKey(*platform_dev.devinfo)) {
+    VLOG(1) << "Serialized program was compiled for a different device configuration";
+    return nullptr;
+  }
+  return std::make_unique<Program>(ctx, program, pb, platform_dev.devinfo, platform_dev.scheduler,
+                                   platform_dev.mem_strategy,
+                                   std::make_shared<TmpMemStrategy>(platform_dev.devinfo, platform_dev.tmp_mem_source),
+                                   tile_optimizer_);
 }
 
 void _fill_device(const Platform::PlatformDev& pdev, tile::proto::Device* dev) {
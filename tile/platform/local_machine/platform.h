@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <set>
 #include <string>
@@ -38,8 +39,16 @@ class Platform : public tile::Platform {
   std::shared_ptr<tile::Buffer> MakeBuffer(const context::Context& ctx, const std::string& device_id,
                                            std::uint64_t size) final;
 
+  std::shared_ptr<tile::Buffer> ImportHostBuffer(const context::Context& ctx, const std::string& device_id, void* base,
+                                                 std::uint64_t size, std::function<void()> release) final;
+
   std::unique_ptr<tile::Program> MakeProgram(const context::Context& ctx, const tile::proto::Program& program) final;
 
+  std::string SerializeProgram(const context::Context& ctx, tile::Program* program) final;
+
+  std::unique_ptr<tile::Program> DeserializeProgram(const context::Context& ctx, const tile::proto::Program& program,
+                                                    const std::string& serialized) final;
+
   void ListDevices(const context::Context& ctx, const tile::proto::ListDevicesRequest& request,
                    tile::proto::ListDevicesResponse* response) final;
 
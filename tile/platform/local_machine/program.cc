@@ -3,9 +3,13 @@
 #include "tile/platform/local_machine/program.h"
 
 #include <algorithm>
+#include <deque>
 #include <forward_list>
+#include <iomanip>
 #include <numeric>
 #include <set>
+#include <sstream>
+#include <thread>
 #include <unordered_set>
 #include <utility>
 
@@ -13,6 +17,7 @@
 #include "base/util/error.h"
 #include "base/util/perf_counter.h"
 #include "tile/hal/util/settings.h"
+#include "tile/lang/fnv1a64.h"
 #include "tile/lang/parser.h"
 #include "tile/lang/tile_cache.h"
 #include "tile/ocl_exec/stripe_gen.h"
@@ -27,6 +32,8 @@ namespace {
 
 static PerfCounter pre_scan_time("pre_scan_time");
 static PerfCounter post_scan_time("post_scan_time");
+static PerfCounter programs_compiled("programs_compiled");
+static PerfCounter programs_restored("programs_restored");
 
 void AllocateBuffers(const std::vector<std::string>& names, const ShapeMap& types, hal::Memory* memory,
                      std::vector<std::shared_ptr<hal::Buffer>>* buffers) {
@@ -36,7 +43,34 @@ void AllocateBuffers(const std::vector<std::string>& names, const ShapeMap& type
   }
 }
 
-int64_t TryKernel(const context::Context& ctx, const lang::KernelInfo& ki,
+struct TrialBuild {
+  std::unique_ptr<hal::Library> library;
+  std::unique_ptr<hal::Executable> executable;
+};
+
+struct ScanParams {
+  size_t trials = 1;
+  size_t trial_runs = 1;
+  double early_stop_margin = 0;
+  size_t parallel_builds = 1;
+};
+
+// Starts building a trial kernel in the background.  Kernels whose timing is already cached aren't built.
+boost::future<TrialBuild> StartTrialBuild(const context::Context& ctx, const lang::KernelInfo* ki,
+                                          const DevInfo* devinfo) {
+  if (lang::TileCache::Instance()->GetDuration(ki->key, ki->settings, ki->tile.shape) >= 0) {
+    return boost::make_ready_future(TrialBuild{});
+  }
+  return boost::async(boost::launch::async, [ctx, ki, devinfo]() {
+    auto& device = *devinfo->dev;
+    TrialBuild build;
+    build.library = device.compiler()->Build(ctx, {*ki}, devinfo->settings).get();
+    build.executable = device.executor()->Prepare(build.library.get()).get();
+    return build;
+  });
+}
+
+int64_t TryKernel(const context::Context& ctx, const lang::KernelInfo& ki, boost::future<TrialBuild> build,
                   const std::vector<std::shared_ptr<hal::Buffer>>& buffers, const DevInfo& devinfo, size_t trial_runs) {
   // Check in cache, and early return if found
   int64_t cached_time = lang::TileCache::Instance()->GetDuration(ki.key, ki.settings, ki.tile.shape);
@@ -49,13 +83,16 @@ int64_t TryKernel(const context::Context& ctx, const lang::KernelInfo& ki,
   try {
     // Prep to do a real run
     auto& device = *devinfo.dev;
-    auto library = device.compiler()->Build(ctx, {ki}, devinfo.settings).get();
-    auto executable = device.executor()->Prepare(library.get()).get();
+    auto trial = build.get();
+    if (!trial.executable) {
+      // The kernel was cached by a concurrent scan after its build was skipped.
+      return lang::TileCache::Instance()->GetDuration(ki.key, ki.settings, ki.tile.shape);
+    }
     int64_t best_time = std::numeric_limits<int64_t>::max();
 
     // Run trial_runs number of times, picking minimum time
     for (size_t i = 0; i < trial_runs; i++) {
-      auto evt = executable->Run(ctx, 0, buffers, {}, true);
+      auto evt = trial.executable->Run(ctx, 0, buffers, {}, true);
       device.executor()->Flush();
       auto result = evt->GetFuture().get();
       int64_t time = result->GetDuration().count();
@@ -63,7 +100,8 @@ int64_t TryKernel(const context::Context& ctx, const lang::KernelInfo& ki,
     }
 
     // Save in cache and return
-    lang::TileCache::Instance()->AddEntry(ki.key, ki.settings, ki.tile.shape, best_time);
+    lang::TileCache::Instance()->AddEntry(ki.key, ki.settings, ki.tile.shape, best_time,
+                                          ki.info.has_perf_stats() ? &ki.info.perf_stats() : nullptr);
     return best_time;
   } catch (const std::exception& ex) {
     LOG(ERROR) << "Skipping kernel failure: " << ex.what();
@@ -73,16 +111,87 @@ int64_t TryKernel(const context::Context& ctx, const lang::KernelInfo& ki,
   return std::numeric_limits<int64_t>::max();
 }
 
-lang::KernelList CompileProgram(const tile::proto::Program& program, const DevInfo& devinfo,
-                                const lang::TileOptimizer& optimizer) {
-  IVLOG(2, "Compiling: " << program.code());
-  size_t tile_trials = 1;
-  size_t trial_runs = 1;
-  if (program.has_tile_scanning_params()) {
-    tile_trials = program.tile_scanning_params().max_trials();
-    trial_runs = program.tile_scanning_params().max_trial_runs();
+// Scans the candidate tilings of a kernel, replacing the kernel with the fastest one.  Candidates are compiled in
+// the background, up to params.parallel_builds ahead of the one being timed, so that compilation overlaps timing.
+void ScanKernel(const context::Context& ctx, lang::KernelInfo* ki,
+                const std::vector<std::shared_ptr<hal::Buffer>>& buffers, const DevInfo& devinfo,
+                const ScanParams& params) {
+  std::vector<lang::KernelInfo> candidates;
+  std::swap(candidates, ki->candidates);
+
+  // Trial 0 is the heuristically chosen kernel.
+  std::vector<const lang::KernelInfo*> trials{ki};
+  for (const auto& candidate : candidates) {
+    trials.push_back(&candidate);
   }
 
+  // The pipeline holds the build of the trial being timed, followed by the builds started ahead of it.
+  std::deque<boost::future<TrialBuild>> builds;
+  size_t next_build = 0;
+  auto fill_pipeline = [&]() {
+    while (next_build < trials.size() && builds.size() < params.parallel_builds + 1) {
+      builds.emplace_back(StartTrialBuild(ctx, trials[next_build++], &devinfo));
+    }
+  };
+
+  size_t best_num = 0;
+  int64_t heuristic_time = 0;
+  int64_t best_time = 0;
+  for (size_t cur_num = 0; cur_num < trials.size(); ++cur_num) {
+    fill_pipeline();
+    auto build = std::move(builds.front());
+    builds.pop_front();
+    int64_t time = TryKernel(ctx, *trials[cur_num], std::move(build), buffers, devinfo, params.trial_runs);
+    if (cur_num == 0) {
+      heuristic_time = best_time = time;
+      pre_scan_time.add(time);
+    } else if (time < best_time) {
+      best_time = time;
+      best_num = cur_num;
+    }
+    if (best_num && 0 < params.early_stop_margin &&
+        best_time <= static_cast<double>(heuristic_time) * (1.0 - params.early_stop_margin)) {
+      IVLOG(1, "  stopping scan after " << cur_num + 1 << " of " << trials.size() << " trials");
+      break;
+    }
+  }
+
+  // Wait out any builds still in flight; they refer to the candidates.
+  for (auto& build : builds) {
+    build.wait();
+  }
+  builds.clear();
+
+  if (best_num) {
+    *ki = std::move(candidates[best_num - 1]);
+  }
+  post_scan_time.add(best_time);
+  IVLOG(1, "  best: " << double(best_time) / 1e9 << ", index: " << best_num);
+  IVLOG(1, "  pre_scan_time: " << double(pre_scan_time.get()) / 1e9
+                               << ", post_scan_time: " << double(post_scan_time.get()) / 1e9);
+}
+
+ScanParams GetScanParams(const tile::proto::Program& program, bool tile_scan, const DevInfo& devinfo) {
+  ScanParams scan;
+  if (tile_scan && program.has_tile_scanning_params()) {
+    const auto& params = program.tile_scanning_params();
+    scan.trials = params.max_trials();
+    scan.trial_runs = params.max_trial_runs();
+    scan.early_stop_margin = params.early_stop_margin();
+    scan.parallel_builds = params.max_parallel_builds();
+    if (devinfo.dev->executor()->info().type() == hal::proto::HardwareType::CPU) {
+      // Builds would compete with the kernel being timed for the same cores, skewing its measurement.
+      scan.parallel_builds = 0;
+    } else if (!scan.parallel_builds) {
+      scan.parallel_builds = std::max(1u, std::thread::hardware_concurrency());
+    }
+  }
+  return scan;
+}
+
+lang::KernelList CompileProgram(const tile::proto::Program& program, const DevInfo& devinfo,
+                                const lang::TileOptimizer& optimizer, const ScanParams& scan) {
+  IVLOG(2, "Compiling: " << program.code());
   context::Context ctx;
   lang::Parser parser;
   auto parsed = parser.Parse(program.code());
@@ -105,8 +214,8 @@ lang::KernelList CompileProgram(const tile::proto::Program& program, const DevIn
   }
 
   auto settings = hal::settings::ToHardwareSettings(devinfo.settings);
-  auto kernel_list = lang::GenerateProgram(parsed, inputs, outputs, settings, optimizer, program.id(), tile_trials);
-  if (tile_trials == 1) {
+  auto kernel_list = lang::GenerateProgram(parsed, inputs, outputs, settings, optimizer, program.id(), scan.trials);
+  if (scan.trials == 1) {
     return kernel_list;
   }
 
@@ -131,87 +240,302 @@ lang::KernelList CompileProgram(const tile::proto::Program& program, const DevIn
     AllocateBuffers(ki.outputs, kernel_list.types, memory, &buffers);
     AllocateBuffers(ki.inputs, kernel_list.types, memory, &buffers);
 
-    std::vector<lang::KernelInfo> candidates;
-    std::swap(candidates, ki.candidates);
-
-    size_t cur_num = 0;
-    size_t best_num = 0;
-    uint64_t best_time = TryKernel(ctx, ki, buffers, devinfo, trial_runs);
-    pre_scan_time.add(best_time);
-    for (const auto& candidate : candidates) {
-      cur_num++;
-      uint64_t time = TryKernel(ctx, candidate, buffers, devinfo, trial_runs);
-      if (time < best_time) {
-        best_time = time;
-        ki = candidate;
-        best_num = cur_num;
+    ScanKernel(ctx, &ki, buffers, devinfo, scan);
+  }
+
+  return kernel_list;
+}
+
+// Regenerates a serialized program's kernels, choosing the serialized tiling for each kernel instead of scanning.
+lang::KernelList RestoreKernels(const tile::proto::Program& program, const DevInfo& devinfo,
+                                const lang::TileOptimizer& optimizer, const proto::SerializedProgram& serialized) {
+  lang::Parser parser;
+  auto parsed = parser.Parse(program.code());
+  auto inputs = FromProto(program.inputs());
+  auto outputs = FromProto(program.outputs());
+  auto settings = hal::settings::ToHardwareSettings(devinfo.settings);
+  auto kernel_list = lang::GenerateProgram(parsed, inputs, outputs, settings, optimizer, program.id(),
+                                           std::max<std::size_t>(1, serialized.tile_trials()));
+  if (kernel_list.kernels.size() != static_cast<std::size_t>(serialized.kernels_size())) {
+    throw error::DataLoss{"Serialized program has " + std::to_string(serialized.kernels_size()) +
+                          " kernels; expected " + std::to_string(kernel_list.kernels.size())};
+  }
+
+  for (std::size_t kidx = 0; kidx < kernel_list.kernels.size(); ++kidx) {
+    auto& ki = kernel_list.kernels[kidx];
+    const auto& kpb = serialized.kernels(kidx);
+    TileShape tile_shape{kpb.tile_shape().begin(), kpb.tile_shape().end()};
+    if (ki.tile.shape != tile_shape) {
+      auto it = std::find_if(ki.candidates.begin(), ki.candidates.end(),
+                             [&](const lang::KernelInfo& candidate) { return candidate.tile.shape == tile_shape; });
+      if (it == ki.candidates.end()) {
+        throw error::DataLoss{"Serialized kernel " + kpb.kname() + " has no matching tiling"};
       }
+      lang::KernelInfo chosen = std::move(*it);
+      ki = std::move(chosen);
     }
-    post_scan_time.add(best_time);
-    IVLOG(1, "  best: " << double(best_time) / 1e9 << ", index: " << best_num);
-    IVLOG(1, "  pre_scan_time: " << double(pre_scan_time.get()) / 1e9
-                                 << ", post_scan_time: " << double(post_scan_time.get()) / 1e9);
+    ki.candidates.clear();
   }
 
   return kernel_list;
 }
 
+bool RequiresTileScan(const tile::proto::Program& program) {
+  return program.has_tile_scanning_params() && 1 < program.tile_scanning_params().max_trials();
+}
+
 }  // namespace
 
 Program::Program(const context::Context& ctx, const tile::proto::Program& program,
                  const std::shared_ptr<DevInfo>& devinfo, const std::shared_ptr<Scheduler>& scheduler,
                  const std::shared_ptr<MemStrategy>& output_mem_strategy,
-                 const std::shared_ptr<MemStrategy>& tmp_mem_strategy, hal::Memory* tmp_memory,
-                 const lang::TileOptimizer& optimizer)
-    : devinfo_{devinfo}, output_mem_strategy_{output_mem_strategy}, tmp_mem_strategy_{tmp_mem_strategy} {
-  // TODO: Make this path asynchronous.
-  // Asynchronous programming is a little tricky in this case, since if we compile asynchronously, the
-  // compilation may not be complete when we're first asked to run a program, which means we'd need to save the run
-  // request and mark the output buffers somehow to indicate that they're not just not ready due to hal events, they're
-  // not ready due to compilation futures (which can't be waited on simultaneously).  There's a relatively
-  // straightforward dataflow-ish way to describe the resulting system, but it's more complicated than just
-  // compiling everything synchronously, so we just do everything synchronously for now.
-
+                 const std::shared_ptr<MemStrategy>& tmp_mem_strategy, const lang::TileOptimizer& optimizer)
+    : devinfo_{devinfo},
+      scheduler_{scheduler},
+      output_mem_strategy_{output_mem_strategy},
+      tmp_mem_strategy_{tmp_mem_strategy},
+      optimizer_{optimizer} {
   if (!devinfo->dev->compiler() || !devinfo->dev->executor()) {
     // TODO: Implement a mechanism for providing a pre-compiled program.
     throw error::Unavailable{"The requested device is unavailable for running Tile programs"};
   }
 
+  if (env::Get("PLAIDML_ASYNC_COMPILE") != "1") {
+    Install(Compile(ctx, program, true));
+    return;
+  }
+
+  // Compile asynchronously.  Runs requested before compilation completes are chained onto compiling_ (see Run), and
+  // their output buffers are marked so that mapping them waits for the deferred launch.
+  context::Context ctx_copy{ctx};
+  compiling_ = boost::async(boost::launch::async, [this, ctx = ctx_copy, program]() {
+                 Install(Compile(ctx, program, false));
+               }).share();
+
+  if (RequiresTileScan(program)) {
+    // Start with the heuristically chosen kernels, and swap in the scanned kernels once scanning is complete.
+    scanning_ = compiling_
+                    .then(boost::launch::async,
+                          [this, ctx = ctx_copy, program](boost::shared_future<void> compiled) {
+                            compiled.get();
+                            try {
+                              Install(Compile(ctx, program, true));
+                            } catch (const std::exception& ex) {
+                              LOG(ERROR) << "Tile scanning failed; keeping heuristic kernels: " << ex.what();
+                            }
+                          })
+                    .share();
+  }
+}
+
+Program::Program(const context::Context& ctx, const tile::proto::Program& program,
+                 const proto::SerializedProgram& serialized, const std::shared_ptr<DevInfo>& devinfo,
+                 const std::shared_ptr<Scheduler>& scheduler, const std::shared_ptr<MemStrategy>& output_mem_strategy,
+                 const std::shared_ptr<MemStrategy>& tmp_mem_strategy, const lang::TileOptimizer& optimizer)
+    : devinfo_{devinfo},
+      scheduler_{scheduler},
+      output_mem_strategy_{output_mem_strategy},
+      tmp_mem_strategy_{tmp_mem_strategy},
+      optimizer_{optimizer} {
+  if (!devinfo->dev->compiler() || !devinfo->dev->executor()) {
+    throw error::Unavailable{"The requested device is unavailable for running Tile programs"};
+  }
+  Install(Restore(ctx, program, serialized));
+}
+
+Program::~Program() {
+  std::vector<boost::shared_future<void>> waits;
+  {
+    std::lock_guard<std::mutex> lock{mu_};
+    waits = deferred_;
+  }
+  if (compiling_.valid()) {
+    waits.push_back(compiling_);
+  }
+  if (scanning_.valid()) {
+    waits.push_back(scanning_);
+  }
+  for (const auto& wait : waits) {
+    wait.wait();
+  }
+}
+
+std::shared_ptr<const Program::Compiled> Program::compiled() const {
+  std::lock_guard<std::mutex> lock{mu_};
+  return compiled_;
+}
+
+void Program::Install(std::shared_ptr<const Compiled> compiled) {
+  std::lock_guard<std::mutex> lock{mu_};
+  compiled_ = std::move(compiled);
+}
+
+std::string Program::Serialize() {
+  if (compiling_.valid()) {
+    compiling_.get();
+  }
+  if (scanning_.valid()) {
+    scanning_.wait();
+  }
+  auto compiled = this->compiled();
+  if (!compiled || !compiled->serializable) {
+    return std::string{};
+  }
+
+  proto::SerializedProgram pb;
+  pb.set_device_key(DeviceKey(*devinfo_));
+  pb.set_tile_trials(compiled->tile_trials);
+  for (const auto& ki : compiled->kernel_list.kernels) {
+    auto* kpb = pb.add_kernels();
+    kpb->set_kname(ki.kname);
+    for (auto size : ki.tile.shape) {
+      kpb->add_tile_shape(size);
+    }
+  }
+  schedule::ScheduleToProto(pb.mutable_schedule(), compiled->schedule);
+  if (devinfo_->dev->loader() && compiled->library) {
+    pb.set_library(compiled->library->Serialize());
+  }
+  return pb.SerializeAsString();
+}
+
+std::shared_ptr<const Program::Compiled> Program::Compile(const context::Context& ctx,
+                                                          const tile::proto::Program& program, bool tile_scan) {
   context::Activity activity{ctx, "tile::local_machine::Compile"};
 
-  kernel_list_ = CompileProgram(program, *devinfo_.get(), optimizer);
+  auto compiled = std::make_shared<Compiled>();
+  auto scan = GetScanParams(program, tile_scan, *devinfo_);
+  compiled->tile_trials = scan.trials;
+  compiled->serializable = env::Get("USE_STRIPE") != "1";
+  compiled->kernel_list = CompileProgram(program, *devinfo_.get(), optimizer_, scan);
+
+  compiled->library =
+      devinfo_->dev->compiler()->Build(activity.ctx(), compiled->kernel_list.kernels, devinfo_->settings).get();
+  compiled->schedule = scheduler_->BuildSchedule(program, compiled->kernel_list);
+
+  Finish(&activity, program, compiled.get());
+  programs_compiled.inc();
+  return compiled;
+}
+
+std::shared_ptr<const Program::Compiled> Program::Restore(const context::Context& ctx,
+                                                          const tile::proto::Program& program,
+                                                          const proto::SerializedProgram& serialized) {
+  context::Activity activity{ctx, "tile::local_machine::Restore"};
+
+  auto compiled = std::make_shared<Compiled>();
+  compiled->tile_trials = serialized.tile_trials();
+  compiled->kernel_list = RestoreKernels(program, *devinfo_.get(), optimizer_, serialized);
+  compiled->schedule = schedule::ScheduleFromProto(serialized.schedule());
 
-  auto lib = devinfo_->dev->compiler()->Build(activity.ctx(), kernel_list_.kernels, devinfo_->settings).get();
-  executable_ = devinfo_->dev->executor()->Prepare(lib.get()).get();
-  schedule_ = scheduler->BuildSchedule(program, kernel_list_);
+  auto* loader = devinfo_->dev->loader();
+  if (loader && serialized.library().size()) {
+    // The library's kernels are named as they were when the program was serialized.
+    for (std::size_t kidx = 0; kidx < compiled->kernel_list.kernels.size(); ++kidx) {
+      compiled->kernel_list.kernels[kidx].kname = serialized.kernels(kidx).kname();
+    }
+    compiled->library = loader->Deserialize(activity.ctx(), serialized.library(), compiled->kernel_list.kernels).get();
+  } else {
+    compiled->library =
+        devinfo_->dev->compiler()->Build(activity.ctx(), compiled->kernel_list.kernels, devinfo_->settings).get();
+  }
+
+  Finish(&activity, program, compiled.get());
+  programs_restored.inc();
+  return compiled;
+}
+
+void Program::Finish(context::Activity* activity, const tile::proto::Program& program, Compiled* compiled) {
+  compiled->executable = devinfo_->dev->executor()->Prepare(compiled->library.get()).get();
 
-  if (activity.ctx().is_logging_events()) {
+  if (activity->ctx().is_logging_events()) {
     hal::proto::CompilationInfo cinfo;
-    for (auto kernel : kernel_list_.kernels) {
+    for (auto kernel : compiled->kernel_list.kernels) {
       (*cinfo.mutable_kernels())[kernel.kname] = kernel.info;
     }
-    SummarizeSchedule(&cinfo, program, kernel_list_, schedule_);
-    *(cinfo.mutable_program()) = std::move(program);
-    activity.AddMetadata(cinfo);
+    SummarizeSchedule(&cinfo, program, compiled->kernel_list, compiled->schedule);
+    *(cinfo.mutable_program()) = program;
+    activity->AddMetadata(cinfo);
     schedule::proto::Schedule sched_pb;
-    schedule::ScheduleToProto(&sched_pb, schedule_);
-    for (auto kernel : kernel_list_.kernels) {
+    schedule::ScheduleToProto(&sched_pb, compiled->schedule);
+    for (auto kernel : compiled->kernel_list.kernels) {
       sched_pb.add_knames(kernel.kname);
     }
-    activity.AddMetadata(sched_pb);
+    activity->AddMetadata(sched_pb);
   }
 
-  ValidateSchedule(program, kernel_list_, schedule_);
+  ValidateSchedule(program, compiled->kernel_list, compiled->schedule);
 }
 
 boost::future<void> Program::Run(const context::Context& ctx,
                                  std::map<std::string, std::shared_ptr<tile::Buffer>> inputs,
                                  std::map<std::string, std::shared_ptr<tile::Buffer>> outputs) {
+  auto compiled = this->compiled();
+
+  // A run must also wait for deferred runs that are going to produce (or consume) its buffers.
+  std::vector<std::shared_ptr<Buffer>> input_buffers;
+  std::vector<std::shared_ptr<Buffer>> output_buffers;
+  for (const auto& kvp : inputs) {
+    input_buffers.emplace_back(Buffer::Downcast(kvp.second, devinfo_));
+  }
+  for (const auto& kvp : outputs) {
+    output_buffers.emplace_back(Buffer::Downcast(kvp.second, devinfo_));
+  }
+  auto launched = std::make_shared<boost::promise<void>>();
+  boost::shared_future<void> launched_future = launched->get_future().share();
+  auto waits = Buffer::RegisterRun(input_buffers, output_buffers, !compiled, launched_future);
+  if (!compiled) {
+    waits.push_back(compiling_);
+  }
+
+  if (waits.empty()) {
+    return Launch(ctx, compiled, std::move(inputs), std::move(outputs));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{mu_};
+    deferred_.erase(std::remove_if(deferred_.begin(), deferred_.end(),
+                                   [](const boost::shared_future<void>& launch) { return launch.is_ready(); }),
+                    deferred_.end());
+    deferred_.emplace_back(launched_future);
+  }
+
+  IVLOG(1, "Deferring run of program " << this << " until its dependencies are ready");
+  context::Context ctx_copy{ctx};
+  auto ready = boost::when_all(waits.begin(), waits.end());
+  return ready
+      .then([this, ctx = std::move(ctx_copy), inputs = std::move(inputs), outputs = std::move(outputs),
+             launched](decltype(ready) fut) mutable {
+        try {
+          for (auto& wait : fut.get()) {
+            wait.get();
+          }
+          auto done = Launch(ctx, this->compiled(), std::move(inputs), std::move(outputs));
+          launched->set_value();
+          return done;
+        } catch (...) {
+          launched->set_exception(std::current_exception());
+          throw;
+        }
+      })
+      .unwrap();
+}
+
+boost::future<void> Program::Launch(const context::Context& ctx, const std::shared_ptr<const Compiled>& compiled,
+                                    std::map<std::string, std::shared_ptr<tile::Buffer>> inputs,
+                                    std::map<std::string, std::shared_ptr<tile::Buffer>> outputs) {
   std::map<std::string, std::shared_ptr<tile::Buffer>> rewrite_outputs;
   for (auto kvp : outputs) {
-    rewrite_outputs.emplace(kernel_list_.var_rewrites.Lookup(kvp.first), std::move(kvp.second));
+    rewrite_outputs.emplace(compiled->kernel_list.var_rewrites.Lookup(kvp.first), std::move(kvp.second));
   }
-  return RunRequest::Run(ctx, this, std::move(inputs), std::move(rewrite_outputs));
+  return RunRequest::Run(ctx, this, compiled, std::move(inputs), std::move(rewrite_outputs));
+}
+
+std::string DeviceKey(const DevInfo& devinfo) {
+  std::string config = devinfo.dev->description() + '\n' + devinfo.settings.ShortDebugString();
+  std::stringstream key;
+  key << std::hex << std::setw(16) << std::setfill('0') << fnv1a64::hash(config.c_str());
+  return key.str();
 }
 
 }  // namespace local_machine
@@ -5,14 +5,17 @@
 #include <cstddef>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "tile/base/buffer.h"
 #include "tile/base/program.h"
 #include "tile/base/schedule.h"
 #include "tile/platform/local_machine/devinfo.h"
+#include "tile/platform/local_machine/local_machine.pb.h"
 #include "tile/platform/local_machine/mem_strategy.h"
 #include "tile/platform/local_machine/scheduler.h"
 #include "tile/proto/tile.pb.h"
@@ -23,10 +26,33 @@ namespace local_machine {
 
 class Program final : public tile::Program {
  public:
+  // The compiled form of a program.  A program's compiled form may be replaced while the program is in use (e.g. when
+  // background tile scanning finds better kernels), so each run holds a reference to the form it was launched with.
+  struct Compiled {
+    lang::KernelList kernel_list;
+    schedule::Schedule schedule;
+    std::unique_ptr<hal::Library> library;
+    std::unique_ptr<hal::Executable> executable;
+    std::size_t tile_trials = 1;  // The number of tile scanning trials the kernels were generated with
+    bool serializable = true;
+  };
+
+  // If PLAIDML_ASYNC_COMPILE is set to 1, the program is compiled in the background: the constructor returns
+  // immediately, and runs requested before compilation completes are launched once it does.  If tile scanning was
+  // requested, the program is first compiled with the heuristically chosen kernels, and the scanned kernels are
+  // swapped in when scanning completes.
   Program(const context::Context& ctx, const tile::proto::Program& program, const std::shared_ptr<DevInfo>& devinfo,
           const std::shared_ptr<Scheduler>& scheduler, const std::shared_ptr<MemStrategy>& output_mem_strategy,
-          const std::shared_ptr<MemStrategy>& tmp_mem_strategy, hal::Memory* tmp_memory,
-          const lang::TileOptimizer& optimizer);
+          const std::shared_ptr<MemStrategy>& tmp_mem_strategy, const lang::TileOptimizer& optimizer);
+
+  // Restores a program from its serialized compiled form (see Serialize).  The kernels are regenerated with the
+  // serialized tilings instead of being scanned, and the device library is loaded instead of being compiled when the
+  // device supports it.  The serialized program must have been produced for this device configuration.
+  Program(const context::Context& ctx, const tile::proto::Program& program, const proto::SerializedProgram& serialized,
+          const std::shared_ptr<DevInfo>& devinfo, const std::shared_ptr<Scheduler>& scheduler,
+          const std::shared_ptr<MemStrategy>& output_mem_strategy,
+          const std::shared_ptr<MemStrategy>& tmp_mem_strategy, const lang::TileOptimizer& optimizer);
+  ~Program();
 
   boost::future<void> Run(const context::Context& ctx, std::map<std::string, std::shared_ptr<tile::Buffer>> inputs,
                           std::map<std::string, std::shared_ptr<tile::Buffer>> outputs) final;
@@ -34,19 +60,41 @@ class Program final : public tile::Program {
   const std::shared_ptr<DevInfo>& devinfo() const { return devinfo_; }
   const std::shared_ptr<MemStrategy>& output_mem_strategy() const { return output_mem_strategy_; }
   const std::shared_ptr<MemStrategy>& tmp_mem_strategy() const { return tmp_mem_strategy_; }
-  const schedule::Schedule& schedule() const { return schedule_; }
-  const lang::KernelList& kernel_list() const { return kernel_list_; }
-  const std::unique_ptr<hal::Executable>& executable() const { return executable_; }
+
+  // Returns the program's current compiled form, or nullptr if the program has not finished compiling.
+  std::shared_ptr<const Compiled> compiled() const;
+
+  // Serializes the program's compiled form, waiting for compilation and tile scanning to complete.  Returns an empty
+  // string if the program can't be serialized.
+  std::string Serialize();
 
  private:
+  std::shared_ptr<const Compiled> Compile(const context::Context& ctx, const tile::proto::Program& program,
+                                          bool tile_scan);
+  std::shared_ptr<const Compiled> Restore(const context::Context& ctx, const tile::proto::Program& program,
+                                          const proto::SerializedProgram& serialized);
+  void Finish(context::Activity* activity, const tile::proto::Program& program, Compiled* compiled);
+  void Install(std::shared_ptr<const Compiled> compiled);
+  boost::future<void> Launch(const context::Context& ctx, const std::shared_ptr<const Compiled>& compiled,
+                             std::map<std::string, std::shared_ptr<tile::Buffer>> inputs,
+                             std::map<std::string, std::shared_ptr<tile::Buffer>> outputs);
+
   std::shared_ptr<DevInfo> devinfo_;
+  std::shared_ptr<Scheduler> scheduler_;
   std::shared_ptr<MemStrategy> output_mem_strategy_;
   std::shared_ptr<MemStrategy> tmp_mem_strategy_;
-  lang::KernelList kernel_list_;
-  schedule::Schedule schedule_;
-  std::unique_ptr<hal::Executable> executable_;
+  const lang::TileOptimizer& optimizer_;
+
+  mutable std::mutex mu_;
+  std::shared_ptr<const Compiled> compiled_;
+  boost::shared_future<void> compiling_;                 // Ready once the first compiled form is installed
+  boost::shared_future<void> scanning_;                  // Ready once background tile scanning is complete
+  std::vector<boost::shared_future<void>> deferred_;     // Launches of runs waiting on compilation or inputs
 };
 
+// Returns a key identifying a device's configuration, for matching serialized programs to devices.
+std::string DeviceKey(const DevInfo& devinfo);
+
 }  // namespace local_machine
 }  // namespace tile
 }  // namespace vertexai
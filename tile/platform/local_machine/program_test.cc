@@ -0,0 +1,498 @@
+// Copyright 2018 Intel Corporation.
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ratio>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "base/util/env.h"
+#include "base/util/error.h"
+#include "tile/base/shape.h"
+#include "tile/lang/generate.h"
+#include "tile/platform/local_machine/buffer.h"
+#include "tile/platform/local_machine/direct_mem_strategy.h"
+#include "tile/platform/local_machine/fifo_scheduler.h"
+#include "tile/platform/local_machine/program.h"
+
+using ::testing::Each;
+using ::testing::Eq;
+using ::testing::Gt;
+using ::testing::IsEmpty;
+using ::testing::Ne;
+using ::testing::Not;
+using ::testing::NotNull;
+
+namespace vertexai {
+namespace tile {
+namespace local_machine {
+namespace {
+
+// A fake HAL: memory is host memory, and running a kernel only records which library the kernel came from.
+
+class FakeResult final : public hal::Result {
+ public:
+  std::chrono::high_resolution_clock::duration GetDuration() const final { return std::chrono::milliseconds{1}; }
+  void LogStatistics() const final {}
+};
+
+class FakeEvent final : public hal::Event {
+ public:
+  FakeEvent() : future_{boost::make_ready_future(std::shared_ptr<hal::Result>{std::make_shared<FakeResult>()})} {}
+
+  boost::shared_future<std::shared_ptr<hal::Result>> GetFuture() final { return future_; }
+
+ private:
+  boost::shared_future<std::shared_ptr<hal::Result>> future_;
+};
+
+class FakeBuffer final : public hal::Buffer {
+ public:
+  explicit FakeBuffer(std::uint64_t size) : data_(size) {}
+
+  boost::future<void*> MapCurrent(const std::vector<std::shared_ptr<hal::Event>>& deps) final {
+    return boost::make_ready_future(static_cast<void*>(data_.data()));
+  }
+  boost::future<void*> MapDiscard(const std::vector<std::shared_ptr<hal::Event>>& deps) final {
+    return boost::make_ready_future(static_cast<void*>(data_.data()));
+  }
+  std::shared_ptr<hal::Event> Unmap(const context::Context& ctx) final { return std::make_shared<FakeEvent>(); }
+
+  char* data() { return data_.data(); }
+
+ private:
+  std::vector<char> data_;
+};
+
+class FakeMemory final : public hal::Memory {
+ public:
+  std::uint64_t size_goal() const final { return std::giga::num; }
+  hal::BufferAccessMask AllowedAccesses() const final { return hal::BufferAccessMask::ALL; }
+  std::size_t ArenaBufferAlignment() const final { return 64; }
+  std::shared_ptr<hal::Buffer> MakeBuffer(std::uint64_t size, hal::BufferAccessMask access) final {
+    return std::make_shared<FakeBuffer>(size);
+  }
+  std::shared_ptr<hal::Arena> MakeArena(std::uint64_t size, hal::BufferAccessMask access) final {
+    throw error::Unimplemented{"FakeMemory::MakeArena"};
+  }
+};
+
+// The libraries the fake compiler has built, by id, and whether each is still alive.
+class LibraryLog {
+ public:
+  int Add() {
+    std::lock_guard<std::mutex> lock{mu_};
+    alive_.push_back(true);
+    return alive_.size() - 1;
+  }
+
+  void Remove(int id) {
+    std::lock_guard<std::mutex> lock{mu_};
+    alive_[id] = false;
+  }
+
+  bool alive(int id) const {
+    std::lock_guard<std::mutex> lock{mu_};
+    return alive_[id];
+  }
+
+ private:
+  mutable std::mutex mu_;
+  std::vector<bool> alive_;
+};
+
+class FakeLibrary final : public hal::Library {
+ public:
+  FakeLibrary(std::shared_ptr<LibraryLog> log, std::size_t kernel_count)
+      : log_{std::move(log)}, id_{log_->Add()}, kernel_count_{kernel_count} {}
+  ~FakeLibrary() { log_->Remove(id_); }
+
+  std::string Serialize() final { return std::string{}; }
+
+  int id() const { return id_; }
+  std::size_t kernel_count() const { return kernel_count_; }
+
+ private:
+  std::shared_ptr<LibraryLog> log_;
+  int id_;
+  std::size_t kernel_count_;
+};
+
+// The kernels run on each thread, as (library id, kernel index) pairs.
+class RunLog {
+ public:
+  void Add(int library, std::size_t kidx) {
+    std::lock_guard<std::mutex> lock{mu_};
+    runs_[std::this_thread::get_id()].emplace_back(library, kidx);
+  }
+
+  // Returns (and forgets) the kernels run on the calling thread.
+  std::vector<std::pair<int, std::size_t>> Take() {
+    std::lock_guard<std::mutex> lock{mu_};
+    auto runs = std::move(runs_[std::this_thread::get_id()]);
+    runs_.erase(std::this_thread::get_id());
+    return runs;
+  }
+
+ private:
+  std::mutex mu_;
+  std::map<std::thread::id, std::vector<std::pair<int, std::size_t>>> runs_;
+};
+
+class FakeExecutable final : public hal::Executable {
+ public:
+  FakeExecutable(std::shared_ptr<LibraryLog> libraries, std::shared_ptr<RunLog> runs, const FakeLibrary* library)
+      : libraries_{std::move(libraries)}, runs_{std::move(runs)}, library_{library->id()},
+        kernel_count_{library->kernel_count()} {}
+
+  std::shared_ptr<hal::Event> Run(const context::Context& ctx, std::size_t kernel_index,
+                                  const std::vector<std::shared_ptr<hal::Buffer>>& params,
+                                  const std::vector<std::shared_ptr<hal::Event>>& dependencies,
+                                  bool enable_profiling) final {
+    if (!libraries_->alive(library_)) {
+      throw std::logic_error{"Ran a kernel from a library that's been destroyed"};
+    }
+    if (kernel_count_ <= kernel_index) {
+      throw std::logic_error{"Ran a kernel that isn't in the library"};
+    }
+    runs_->Add(library_, kernel_index);
+    return std::make_shared<FakeEvent>();
+  }
+
+ private:
+  std::shared_ptr<LibraryLog> libraries_;
+  std::shared_ptr<RunLog> runs_;
+  int library_;
+  std::size_t kernel_count_;
+};
+
+// A compiler whose builds can be held at a gate: builds after the first gate_after wait for the gate to open.  Builds
+// fail once fail_after builds have been started.
+class FakeCompiler final : public hal::Compiler {
+ public:
+  FakeCompiler(std::shared_ptr<LibraryLog> libraries, std::size_t gate_after, std::size_t fail_after)
+      : libraries_{std::move(libraries)},
+        gate_after_{gate_after},
+        fail_after_{fail_after},
+        gate_future_{gate_.get_future().share()} {}
+
+  boost::future<std::unique_ptr<hal::Library>> Build(const context::Context& ctx,
+                                                     const std::vector<lang::KernelInfo>& kernels,
+                                                     const hal::proto::HardwareSettings& settings) final {
+    auto build = builds_++;
+    if (gate_after_ <= build) {
+      gate_future_.wait();
+    }
+    if (fail_after_ <= build) {
+      throw error::Internal{"Fake build failure"};
+    }
+    return boost::make_ready_future(
+        std::unique_ptr<hal::Library>{std::make_unique<FakeLibrary>(libraries_, kernels.size())});
+  }
+
+  void Open() { gate_.set_value(); }
+  std::size_t builds() const { return builds_; }
+
+ private:
+  std::shared_ptr<LibraryLog> libraries_;
+  std::size_t gate_after_;
+  std::size_t fail_after_;
+  std::atomic<std::size_t> builds_{0};
+  boost::promise<void> gate_;
+  boost::shared_future<void> gate_future_;
+};
+
+class FakeExecutor final : public hal::Executor {
+ public:
+  FakeExecutor(std::shared_ptr<LibraryLog> libraries, std::shared_ptr<RunLog> runs)
+      : libraries_{std::move(libraries)}, runs_{std::move(runs)} {
+    info_.set_type(hal::proto::HardwareType::GPU);
+    info_.set_name("Fake");
+  }
+
+  const hal::proto::HardwareInfo& info() final { return info_; }
+  hal::Memory* device_memory() final { return nullptr; }
+  hal::Memory* shared_memory() final { return &memory_; }
+  bool is_synchronous() const final { return true; }
+
+  std::shared_ptr<hal::Event> Copy(const context::Context& ctx, const std::shared_ptr<hal::Buffer>& from,
+                                   std::size_t from_offset, const std::shared_ptr<hal::Buffer>& to,
+                                   std::size_t to_offset, std::size_t length,
+                                   const std::vector<std::shared_ptr<hal::Event>>& dependencies) final {
+    std::memcpy(std::static_pointer_cast<FakeBuffer>(to)->data() + to_offset,
+                std::static_pointer_cast<FakeBuffer>(from)->data() + from_offset, length);
+    return std::make_shared<FakeEvent>();
+  }
+
+  boost::future<std::unique_ptr<hal::Executable>> Prepare(hal::Library* library) final {
+    return boost::make_ready_future(std::unique_ptr<hal::Executable>{
+        std::make_unique<FakeExecutable>(libraries_, runs_, static_cast<FakeLibrary*>(library))});
+  }
+
+  boost::future<std::vector<std::shared_ptr<hal::Result>>> WaitFor(
+      const std::vector<std::shared_ptr<hal::Event>>& events) final {
+    std::vector<std::shared_ptr<hal::Result>> results;
+    for (const auto& event : events) {
+      results.emplace_back(event->GetFuture().get());
+    }
+    return boost::make_ready_future(std::move(results));
+  }
+
+  void Flush() final {}
+
+  hal::Memory* memory() { return &memory_; }
+
+ private:
+  std::shared_ptr<LibraryLog> libraries_;
+  std::shared_ptr<RunLog> runs_;
+  hal::proto::HardwareInfo info_;
+  FakeMemory memory_;
+};
+
+class FakeDevice final : public hal::Device {
+ public:
+  FakeDevice(std::unique_ptr<FakeCompiler> compiler, std::unique_ptr<FakeExecutor> executor)
+      : compiler_{std::move(compiler)}, executor_{std::move(executor)} {}
+
+  void Initialize(const hal::proto::HardwareSettings& settings) final {}
+  std::string description() final { return "Fake device"; }
+  hal::Compiler* compiler() final { return compiler_.get(); }
+  hal::Loader* loader() final { return nullptr; }
+  const std::unordered_map<std::string, std::unique_ptr<hal::Loader>>& il_loader_map() final { return il_loaders_; }
+  hal::Executor* executor() final { return executor_.get(); }
+
+  FakeCompiler* fake_compiler() { return compiler_.get(); }
+  FakeExecutor* fake_executor() { return executor_.get(); }
+
+ private:
+  std::unique_ptr<FakeCompiler> compiler_;
+  std::unique_ptr<FakeExecutor> executor_;
+  std::unordered_map<std::string, std::unique_ptr<hal::Loader>> il_loaders_;
+};
+
+class FakeDeviceSet final : public hal::DeviceSet {
+ public:
+  explicit FakeDeviceSet(std::shared_ptr<hal::Device> device) : devices_{std::move(device)} {}
+
+  const std::vector<std::shared_ptr<hal::Device>>& devices() final { return devices_; }
+  hal::Memory* host_memory() final { return &memory_; }
+
+ private:
+  std::vector<std::shared_ptr<hal::Device>> devices_;
+  FakeMemory memory_;
+};
+
+// Two dependent contractions, so that each run launches more than one kernel.
+constexpr char kCode[] = R"(
+  function (A[M, K], B[K, N]) -> (D) {
+    C[m, n : M, N] = +(A[m, k] * B[k, n]);
+    D[m, n : M, N] = +(C[m, k] * B[k, n]);
+  }
+)";
+
+class ProgramTest : public ::testing::Test {
+ protected:
+  void SetUp() final { env::Set("PLAIDML_ASYNC_COMPILE", "1"); }
+  void TearDown() final { env::Set("PLAIDML_ASYNC_COMPILE", "0"); }
+
+  // Sets up a fake device whose builds are gated and fail as described by FakeCompiler.
+  void MakeDevice(std::size_t gate_after, std::size_t fail_after = SIZE_MAX) {
+    libraries_ = std::make_shared<LibraryLog>();
+    runs_ = std::make_shared<RunLog>();
+    auto device = std::make_shared<FakeDevice>(std::make_unique<FakeCompiler>(libraries_, gate_after, fail_after),
+                                               std::make_unique<FakeExecutor>(libraries_, runs_));
+    compiler_ = device->fake_compiler();
+    auto devset = std::make_shared<FakeDeviceSet>(device);
+
+    hal::proto::HardwareSettings settings;
+    settings.set_threads(256);
+    settings.set_vec_size(1);
+    settings.set_mem_width(32);
+    settings.set_max_mem(18 * 1024);
+    settings.set_max_regs(18 * 1024);
+    settings.set_goal_groups(20);
+    settings.set_goal_flops_per_byte(20);
+    for (int i = 0; i < 3; ++i) {
+      settings.add_dim_sizes(1024);
+    }
+    devinfo_ = std::make_shared<DevInfo>(DevInfo{devset, device, settings});
+    mem_strategy_ = std::make_shared<DirectMemStrategy>(devinfo_, device->fake_executor()->memory());
+    scheduler_ = std::make_shared<fifo_scheduler::FifoScheduler>(64, std::giga::num, settings);
+  }
+
+  std::unique_ptr<Program> MakeProgram(std::size_t max_trials = 1) {
+    tile::proto::Program program;
+    program.set_id("program_test");
+    program.set_code(kCode);
+    for (const char* name : {"A", "B"}) {
+      *(*program.mutable_inputs())[name].mutable_shape() = IntoProto(SimpleShape(DataType::FLOAT32, {64, 64}));
+    }
+    *(*program.mutable_outputs())["D"].mutable_shape() = IntoProto(SimpleShape(DataType::FLOAT32, {64, 64}));
+    if (1 < max_trials) {
+      auto* params = program.mutable_tile_scanning_params();
+      params->set_max_trials(max_trials);
+      params->set_max_trial_runs(1);
+    }
+    return std::make_unique<Program>(context::Context{}, program, devinfo_, scheduler_, mem_strategy_, mem_strategy_,
+                                      optimizer_);
+  }
+
+  std::shared_ptr<tile::Buffer> MakeBuffer() {
+    return std::make_shared<Buffer>(devinfo_, mem_strategy_, 64 * 64 * sizeof(float));
+  }
+
+  // Runs the program on fresh buffers, returning the run's future and its output.
+  boost::future<void> Run(Program* program, std::shared_ptr<tile::Buffer>* output) {
+    *output = MakeBuffer();
+    return program->Run(context::Context{}, {{"A", MakeBuffer()}, {"B", MakeBuffer()}}, {{"D", *output}});
+  }
+
+  // Runs the program synchronously, returning the libraries its kernels came from.
+  std::vector<int> RunAndGetLibraries(Program* program) {
+    std::shared_ptr<tile::Buffer> output;
+    Run(program, &output).get();
+    std::vector<int> libraries;
+    for (const auto& run : runs_->Take()) {
+      libraries.push_back(run.first);
+    }
+    return libraries;
+  }
+
+  lang::TileOptimizer optimizer_;
+  std::shared_ptr<LibraryLog> libraries_;
+  std::shared_ptr<RunLog> runs_;
+  FakeCompiler* compiler_ = nullptr;
+  std::shared_ptr<DevInfo> devinfo_;
+  std::shared_ptr<MemStrategy> mem_strategy_;
+  std::shared_ptr<Scheduler> scheduler_;
+};
+
+TEST_F(ProgramTest, RunBeforeCompilationCompletesIsDeferred) {
+  MakeDevice(0);
+  auto program = MakeProgram();
+  EXPECT_THAT(program->compiled(), Eq(nullptr));
+
+  std::shared_ptr<tile::Buffer> output;
+  auto done = Run(program.get(), &output);
+  auto view = output->MapCurrent(context::Context{});
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  EXPECT_FALSE(done.is_ready());
+  EXPECT_FALSE(view.is_ready());
+
+  compiler_->Open();
+  done.get();
+  EXPECT_THAT(view.get(), NotNull());
+  ASSERT_THAT(program->compiled(), NotNull());
+  EXPECT_THAT(program->compiled()->kernel_list.kernels.size(), Gt(1));
+}
+
+TEST_F(ProgramTest, RunsDuringSwapUseOneCompiledForm) {
+  // The heuristic build completes; the scanning builds wait at the gate.
+  MakeDevice(1);
+  auto program = MakeProgram(4);
+  std::shared_ptr<tile::Buffer> output;
+  Run(program.get(), &output).get();
+  runs_->Take();
+
+  auto heuristic = program->compiled();
+  ASSERT_THAT(heuristic, NotNull());
+  auto heuristic_libraries = RunAndGetLibraries(program.get());
+  ASSERT_THAT(heuristic_libraries.size(), Eq(heuristic->kernel_list.kernels.size()));
+  EXPECT_THAT(heuristic_libraries, Each(Eq(heuristic_libraries[0])));
+
+  // Run continuously while the scanned kernels are swapped in; each run must use a single compiled form.
+  std::atomic<bool> swapped{false};
+  std::vector<std::vector<int>> run_libraries;
+  std::thread runner{[&]() {
+    bool done = false;
+    while (!done) {
+      done = swapped;
+      run_libraries.emplace_back(RunAndGetLibraries(program.get()));
+    }
+  }};
+  compiler_->Open();
+  program->Serialize();  // Waits for scanning to complete
+  swapped = true;
+  runner.join();
+
+  auto scanned = program->compiled();
+  ASSERT_THAT(scanned, Ne(heuristic));
+  std::vector<int> firsts;
+  for (const auto& libraries : run_libraries) {
+    ASSERT_THAT(libraries, Not(IsEmpty()));
+    EXPECT_THAT(libraries, Each(Eq(libraries[0])));
+    firsts.push_back(libraries[0]);
+  }
+  heuristic.reset();
+
+  // Runs started after the swap use the scanned kernels, and the heuristic library is released.
+  auto scanned_libraries = RunAndGetLibraries(program.get());
+  ASSERT_THAT(scanned_libraries, Not(IsEmpty()));
+  EXPECT_THAT(scanned_libraries, Each(Ne(heuristic_libraries[0])));
+  EXPECT_THAT(firsts.back(), Eq(scanned_libraries[0]));
+  EXPECT_FALSE(libraries_->alive(heuristic_libraries[0]));
+}
+
+TEST_F(ProgramTest, CompilationFailurePropagates) {
+  MakeDevice(0, 0);
+  auto program = MakeProgram();
+
+  std::shared_ptr<tile::Buffer> output;
+  auto done = Run(program.get(), &output);
+  auto view = output->MapCurrent(context::Context{});
+  compiler_->Open();
+  EXPECT_THROW(done.get(), error::Internal);
+  EXPECT_THROW(view.get(), error::Internal);
+  EXPECT_THROW(program->Serialize(), error::Internal);
+  EXPECT_THAT(program->compiled(), Eq(nullptr));
+
+  // Runs requested after the failure fail the same way.
+  EXPECT_THROW(Run(program.get(), &output).get(), error::Internal);
+  EXPECT_THAT(runs_->Take(), IsEmpty());
+}
+
+TEST_F(ProgramTest, FailedDeferredRunLeavesInputsReadable) {
+  MakeDevice(0, 0);
+  auto program = MakeProgram();
+
+  auto input = MakeBuffer();
+  auto output = MakeBuffer();
+  auto done = program->Run(context::Context{}, {{"A", input}, {"B", MakeBuffer()}}, {{"D", output}});
+  compiler_->Open();
+  EXPECT_THROW(done.get(), error::Internal);
+  EXPECT_THROW(output->MapCurrent(context::Context{}).get(), error::Internal);
+
+  // The run never wrote its inputs, so they remain readable -- repeatedly.
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_THAT(input->MapCurrent(context::Context{}).get(), NotNull());
+  }
+}
+
+TEST_F(ProgramTest, FailedDeferredWriteFailsLaterReads) {
+  MakeDevice(0, 0);
+  auto program = MakeProgram();
+
+  // The second run reads the first run's output; neither can launch until compilation (which fails) completes.
+  std::shared_ptr<tile::Buffer> written;
+  auto first = Run(program.get(), &written);
+  auto second = program->Run(context::Context{}, {{"A", written}, {"B", MakeBuffer()}}, {{"D", MakeBuffer()}});
+  compiler_->Open();
+  EXPECT_THROW(first.get(), error::Internal);
+  EXPECT_THROW(second.get(), error::Internal);
+
+  // The buffer was never written, so reading it reports the writer's failure, rather than stale contents.
+  EXPECT_THROW(written->MapCurrent(context::Context{}).get(), error::Internal);
+}
+
+}  // namespace
+}  // namespace local_machine
+}  // namespace tile
+}  // namespace vertexai
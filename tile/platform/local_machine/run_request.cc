@@ -15,10 +15,10 @@ namespace {
 boost::future<std::vector<std::shared_ptr<hal::Result>>> RunSchedule(const context::Context& ctx, RunRequest* req,
                                                                      Shim* shim) {
   std::vector<std::shared_ptr<hal::Event>> deps;
-  deps.resize(req->program()->schedule().steps.size());
+  deps.resize(req->compiled().schedule.steps.size());
   std::unordered_set<std::shared_ptr<hal::Event>> dep_set;
 
-  for (const auto& step : req->program()->schedule().steps) {
+  for (const auto& step : req->compiled().schedule.steps) {
     IVLOG(2, "Queueing s" << step.idx << ": " << step);
     std::vector<std::shared_ptr<hal::Event>> current_deps;
     std::vector<std::shared_ptr<hal::Buffer>> current_params;
@@ -50,7 +50,7 @@ boost::future<std::vector<std::shared_ptr<hal::Result>>> RunSchedule(const conte
       case schedule::Step::Tag::kRun:
         // NOTE: VLOG_IS_ON(1) is needed here because LogResults depends on profiling
         // being enabled in order to print durations.
-        event = req->program()->executable()->Run(ctx, step.kidx, current_params, current_deps,
+        event = req->compiled().executable->Run(ctx, step.kidx, current_params, current_deps,
                                                   ctx.is_logging_events() || VLOG_IS_ON(1));
         break;
       case schedule::Step::Tag::kCopy:
@@ -108,15 +108,17 @@ boost::future<std::vector<std::shared_ptr<hal::Result>>> RunSchedule(const conte
 }  // namespace
 
 boost::future<void> RunRequest::Run(const context::Context& ctx, const Program* program,
+                                    std::shared_ptr<const Program::Compiled> compiled,
                                     std::map<std::string, std::shared_ptr<tile::Buffer>> inputs,
                                     std::map<std::string, std::shared_ptr<tile::Buffer>> outputs) {
   LogRequest(program, inputs, outputs);
 
-  RunRequest req{program};
+  RunRequest req{program, std::move(compiled)};
 
   context::Activity running{ctx, "tile::local_machine::Program::Run"};
   boost::future<void> complete;
-  auto shim = std::make_unique<Shim>(running.ctx(), program, std::move(inputs), std::move(outputs));
+  auto shim =
+      std::make_unique<Shim>(running.ctx(), program, req.compiled(), std::move(inputs), std::move(outputs));
 
   {
     context::Activity queueing{running.ctx(), "tile::local_machine::Program::Enqueue"};
@@ -135,10 +137,11 @@ boost::future<void> RunRequest::Run(const context::Context& ctx, const Program*
     complete = req.LogResults(queueing.ctx(), std::move(results));
   }
 
-  // Keep the shim and activity referenced until the program is complete.
+  // Keep the shim, compiled program, and activity referenced until the program is complete.
   // N.B. It's important to keep the shim referenced because it's the thing that's actually holding
   // onto all of our chunk references; if those go away, unfortunate things happen.
-  return complete.then([shim = std::move(shim), running = std::move(running)](decltype(complete) fut) { fut.get(); });
+  return complete.then([shim = std::move(shim), compiled = std::move(req.compiled_),
+                        running = std::move(running)](decltype(complete) fut) { fut.get(); });
 }
 
 void RunRequest::LogRequest(const Program* program, const std::map<std::string, std::shared_ptr<tile::Buffer>>& inputs,
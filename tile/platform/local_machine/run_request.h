@@ -5,6 +5,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/context/context.h"
@@ -21,12 +22,14 @@ namespace local_machine {
 class RunRequest {
  public:
   static boost::future<void> Run(const context::Context& ctx, const Program* program,
+                                 std::shared_ptr<const Program::Compiled> compiled,
                                  std::map<std::string, std::shared_ptr<tile::Buffer>> inputs,
                                  std::map<std::string, std::shared_ptr<tile::Buffer>> outputs);
 
   void AddProgramDoneDep(const std::shared_ptr<hal::Event>& event);
 
   const Program* program() const { return program_; }
+  const Program::Compiled& compiled() const { return *compiled_; }
 
  private:
   struct KernelLogInfo {
@@ -36,7 +39,8 @@ class RunRequest {
     std::size_t tot_flops;
   };
 
-  explicit RunRequest(const Program* program) : program_{program} {}
+  RunRequest(const Program* program, std::shared_ptr<const Program::Compiled> compiled)
+      : program_{program}, compiled_{std::move(compiled)} {}
 
   static void LogRequest(const Program* program, const std::map<std::string, std::shared_ptr<tile::Buffer>>& inputs,
                          const std::map<std::string, std::shared_ptr<tile::Buffer>>& outputs);
@@ -45,6 +49,7 @@ class RunRequest {
                                  boost::future<std::vector<std::shared_ptr<hal::Result>>> results);
 
   const Program* program_;
+  std::shared_ptr<const Program::Compiled> compiled_;
 };
 
 }  // namespace local_machine
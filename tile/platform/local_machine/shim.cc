@@ -12,15 +12,35 @@ namespace tile {
 namespace local_machine {
 namespace {
 
-// Builds a memory allocation map for a particular program run.
+// Throws if a pinned output's chunk is bound to any of the run's other inputs or outputs, since the program would then
+// read or write the memory it's writing the output to.
+void CheckPinnedOutput(const Program* program, const std::string& name, const std::shared_ptr<MemChunk>& chunk,
+                       const std::map<std::string, std::shared_ptr<tile::Buffer>>& inputs,
+                       const std::map<std::string, std::shared_ptr<tile::Buffer>>& outputs) {
+  for (const auto& kvp : inputs) {
+    if (Buffer::Downcast(kvp.second, program->devinfo())->chunk() == chunk) {
+      throw error::Unimplemented{"Program output " + name + " is written to host memory in place, and cannot use " +
+                                 "the same buffer as program input " + kvp.first};
+    }
+  }
+  for (const auto& kvp : outputs) {
+    if (kvp.first != name && Buffer::Downcast(kvp.second, program->devinfo())->chunk() == chunk) {
+      throw error::Unimplemented{"Program output " + name + " is written to host memory in place, and cannot use " +
+                                 "the same buffer as program output " + kvp.first};
+    }
+  }
+}
+
+// Builds a memory allocation map for a particular program run, noting the chunks that belong to pinned buffers.
 std::pair<std::vector<std::shared_ptr<MemChunk>>, std::list<Shim::AliasUpdate>> BuildChunkMap(
-    const context::Context& ctx, const Program* program,
+    const context::Context& ctx, const Program* program, const Program::Compiled& compiled,
     const std::map<std::string, std::shared_ptr<tile::Buffer>>& inputs,
-    const std::map<std::string, std::shared_ptr<tile::Buffer>>& outputs) {
+    const std::map<std::string, std::shared_ptr<tile::Buffer>>& outputs,
+    std::unordered_set<const MemChunk*>* pinned_chunks) {
   std::vector<std::shared_ptr<MemChunk>> chunk_infos;
   std::list<Shim::AliasUpdate> updates;
-  chunk_infos.reserve(program->schedule().allocs.size());
-  for (const auto& alloc : program->schedule().allocs) {
+  chunk_infos.reserve(compiled.schedule.allocs.size());
+  for (const auto& alloc : compiled.schedule.allocs) {
     std::shared_ptr<MemChunk> chunk;
     if (alloc.is_input()) {
       // This is a program input.  If the input has a chunk, we have to use it --
@@ -35,6 +55,9 @@ std::pair<std::vector<std::shared_ptr<MemChunk>>, std::list<Shim::AliasUpdate>>
       std::shared_ptr<Buffer> input_buffer = Buffer::Downcast(iit->second, program->devinfo());
       input_buffer->EnsureChunk(ctx);
       chunk = input_buffer->chunk();
+      if (input_buffer->pinned()) {
+        pinned_chunks->insert(chunk.get());
+      }
 
       if (alloc.is_output()) {
         // The chunk is also being used as a program output; the corresponding output buffer
@@ -45,6 +68,10 @@ std::pair<std::vector<std::shared_ptr<MemChunk>>, std::list<Shim::AliasUpdate>>
           throw error::NotFound{"Missing program output: " + alloc.output};
         }
         std::shared_ptr<Buffer> output_buffer = Buffer::Downcast(oit->second, program->devinfo());
+        if (output_buffer->pinned() && output_buffer->chunk() != chunk) {
+          throw error::Unimplemented{"Program output " + alloc.output +
+                                     " aliases an input, and cannot be written to a buffer using host memory in place"};
+        }
         updates.emplace_back(Shim::AliasUpdate{std::move(output_buffer), chunk});
       }
     } else if (alloc.is_output()) {
@@ -56,8 +83,16 @@ std::pair<std::vector<std::shared_ptr<MemChunk>>, std::list<Shim::AliasUpdate>>
         throw error::NotFound{"Missing program output: " + alloc.output};
       }
       std::shared_ptr<Buffer> output_buffer = Buffer::Downcast(oit->second, program->devinfo());
-      chunk = program->output_mem_strategy()->MakeChunk(ctx, output_buffer->size());
-      updates.emplace_back(Shim::AliasUpdate{std::move(output_buffer), chunk});
+      if (output_buffer->pinned()) {
+        // The output is written in place; the program's memory dependencies order the writes after any pending
+        // accesses of the buffer's current contents.
+        chunk = output_buffer->chunk();
+        CheckPinnedOutput(program, alloc.output, chunk, inputs, outputs);
+        pinned_chunks->insert(chunk.get());
+      } else {
+        chunk = program->output_mem_strategy()->MakeChunk(ctx, output_buffer->size());
+        updates.emplace_back(Shim::AliasUpdate{std::move(output_buffer), chunk});
+      }
     } else {
       // This is neither a program input nor a program output; the alloc is purely internal
       // to the program.  Make a temporary buffer for it.
@@ -71,10 +106,10 @@ std::pair<std::vector<std::shared_ptr<MemChunk>>, std::list<Shim::AliasUpdate>>
 
 }  // namespace
 
-Shim::Shim(const context::Context& ctx, const Program* program,
+Shim::Shim(const context::Context& ctx, const Program* program, const Program::Compiled& compiled,
            std::map<std::string, std::shared_ptr<tile::Buffer>> inputs,
            std::map<std::string, std::shared_ptr<tile::Buffer>> outputs) {
-  std::tie(chunk_infos_, updates_) = BuildChunkMap(ctx, program, inputs, outputs);
+  std::tie(chunk_infos_, updates_) = BuildChunkMap(ctx, program, compiled, inputs, outputs, &pinned_chunks_);
 }
 
 std::shared_ptr<MemChunk> Shim::LookupAlloc(std::size_t /* sidx */, schedule::Alloc* alloc) const {
@@ -82,9 +117,12 @@ std::shared_ptr<MemChunk> Shim::LookupAlloc(std::size_t /* sidx */, schedule::Al
 }
 
 void Shim::SetLaunchException(std::exception_ptr ep) const noexcept {
-  // Any error in the launch poisons all output buffers.
+  // Any error in the launch poisons all output buffers.  Pinned buffers are the caller's memory, and keep working;
+  // their contents are unspecified after a failed launch.
   for (const auto& chunk : chunk_infos_) {
-    chunk->deps()->Poison(ep);
+    if (!pinned_chunks_.count(chunk.get())) {
+      chunk->deps()->Poison(ep);
+    }
   }
 }
 
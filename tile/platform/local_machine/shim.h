@@ -7,6 +7,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "base/context/context.h"
@@ -32,7 +33,8 @@ class Shim {
 
   // Construct the Shim.  This should be done at the start of queueing
   // the program's steps.
-  Shim(const context::Context& ctx, const Program* program, std::map<std::string, std::shared_ptr<tile::Buffer>> inputs,
+  Shim(const context::Context& ctx, const Program* program, const Program::Compiled& compiled,
+       std::map<std::string, std::shared_ptr<tile::Buffer>> inputs,
        std::map<std::string, std::shared_ptr<tile::Buffer>> outputs);
 
   // Destroys the Shim.  Note that this does not apply side-effects;
@@ -52,6 +54,7 @@ class Shim {
  private:
   std::vector<std::shared_ptr<MemChunk>> chunk_infos_;
   std::list<AliasUpdate> updates_;
+  std::unordered_set<const MemChunk*> pinned_chunks_;
 };
 
 }  // namespace local_machine
@@ -13,7 +13,7 @@ namespace {
 // A MemChunk implementation that frees its underlying memory to a MemCache when the chunk is deleted.
 class TmpMemChunk final : public MemChunk {
  public:
-  TmpMemChunk(std::uint64_t size, const std::shared_ptr<MemCache>& mem_cache, std::shared_ptr<hal::Buffer> hal_buffer);
+  TmpMemChunk(std::uint64_t size, const std::shared_ptr<MemCache>& mem_cache, MemCache::Block block);
   virtual ~TmpMemChunk();
 
   std::uint64_t size() const final;
@@ -25,15 +25,14 @@ class TmpMemChunk final : public MemChunk {
  private:
   std::uint64_t size_;
   std::shared_ptr<MemCache> mem_cache_;
-  std::shared_ptr<hal::Buffer> hal_buffer_;
+  MemCache::Block block_;
   std::shared_ptr<MemDeps> deps_;
 };
 
-TmpMemChunk::TmpMemChunk(std::uint64_t size, const std::shared_ptr<MemCache>& mem_cache,
-                         std::shared_ptr<hal::Buffer> hal_buffer)
-    : size_{size}, mem_cache_{mem_cache}, hal_buffer_{hal_buffer}, deps_{std::make_shared<MemDeps>()} {}
+TmpMemChunk::TmpMemChunk(std::uint64_t size, const std::shared_ptr<MemCache>& mem_cache, MemCache::Block block)
+    : size_{size}, mem_cache_{mem_cache}, block_{std::move(block)}, deps_{std::make_shared<MemDeps>()} {}
 
-TmpMemChunk::~TmpMemChunk() { mem_cache_->Free(size_, std::move(hal_buffer_)); }
+TmpMemChunk::~TmpMemChunk() { mem_cache_->Free(std::move(block_)); }
 
 std::uint64_t TmpMemChunk::size() const { return size_; }
 
@@ -47,24 +46,22 @@ std::unique_ptr<View> TmpMemChunk::MapDiscard(const context::Context& ctx) {
 
 std::shared_ptr<MemDeps> TmpMemChunk::deps() { return deps_; }
 
-std::shared_ptr<hal::Buffer> TmpMemChunk::hal_buffer() { return hal_buffer_; }
+std::shared_ptr<hal::Buffer> TmpMemChunk::hal_buffer() { return block_.buffer; }
 
 }  // namespace
 
 TmpMemStrategy::TmpMemStrategy(const std::shared_ptr<DevInfo>& devinfo, hal::Memory* source)
-    : devinfo_{devinfo}, source_{source}, cache_{std::make_shared<MemCache>()} {
+    : devinfo_{devinfo}, source_{source} {
   if (!source_) {
     throw std::logic_error{"The temporary memory management strategy requires memory"};
   }
+  // The size goal is all of the memory the device is willing to use (for host memory, the machine's physical memory),
+  // so a cache allowed to grow to it would never give anything back; temporaries get a quarter of it.
+  cache_ = std::make_shared<MemCache>(source_, source_->size_goal() / 4);
 }
 
 std::shared_ptr<MemChunk> TmpMemStrategy::MakeChunk(const context::Context& ctx, std::uint64_t size) const {
-  auto hal_buffer = cache_->TryAlloc(size);
-  if (!hal_buffer) {
-    auto buffer = source_->MakeBuffer(size, hal::BufferAccessMask::DEVICE_RW);
-    hal_buffer = buffer;
-  }
-  return std::make_shared<TmpMemChunk>(size, cache_, std::move(hal_buffer));
+  return std::make_shared<TmpMemChunk>(size, cache_, cache_->Alloc(size));
 }
 
 }  // namespace local_machine
@@ -30,7 +30,11 @@ Program::Program(const context::Context& ctx, const tile::proto::Program& progra
       !out_dir.empty(),    // dump_passes
       false,               // dump_code
       out_dir / "passes",  // dbg_dir
+      ctx,                 // ctx
   };
+  if (!out_dir.empty()) {
+    options.profile_path = out_dir / "profile.json";
+  }
   const auto& cfgs = targets::GetConfigs();
   const auto& cfg = cfgs.configs().at("cpu");
   const auto& stage = cfg.stages().at("default");
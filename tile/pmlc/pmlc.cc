@@ -63,6 +63,8 @@ bool App::parse(int argc, char* argv[]) {
       ("int8", "treat all datatypes as int8")                                             //
       ("internal", "input specifies an internally defined network")                       //
       ("dump-passes", "dump passes")                                                      //
+      ("profile", "write a per-pass optimization profile to profile.json")                //
+      ("strict-validation", "validate the whole program after every pass")                //
 #ifdef ENABLE_LLVM_BITCODE
       ("llvm", "enable LLVM bitcode output")  //
 #endif
@@ -141,6 +143,12 @@ std::shared_ptr<Program> Main() {
     options.dump_passes = true;
     options.dbg_dir = out_dir / "passes";
   }
+  if (app->args.count("profile")) {
+    options.profile_path = out_dir / "profile.json";
+  }
+  if (app->args.count("strict-validation")) {
+    options.strict_validation = true;
+  }
   return DefaultStage(*app, input_path, out_dir, stage, options);
 }
 
@@ -2,6 +2,7 @@
 
 #include "tile/stripe/stripe.h"
 
+#include <atomic>
 #include <regex>
 #include <sstream>
 
@@ -28,7 +29,7 @@ const char* Intrinsic::ADD = "add";
 const char* Intrinsic::EQ = "cmp_eq";
 const char* Intrinsic::COND = "cond";
 
-const Taggable::Impl* Accessor::impl(const Taggable& taggable) { return taggable.impl_.get(); }
+const Taggable::Impl* Accessor::impl(const Taggable& taggable) { return &taggable.impl(); }
 
 namespace {
 
@@ -239,39 +240,66 @@ class CodecRegistry {
 
 }  // namespace
 
-Taggable::Taggable() : impl_(new Impl()) {}
+Taggable::Taggable() = default;
 
 Taggable::~Taggable() = default;
 
-Taggable::Taggable(const Taggable& rhs) { set_attrs(rhs); }
+Taggable::Taggable(const Taggable& rhs) : impl_{rhs.impl_} {}
+
+Taggable::Taggable(Taggable&& rhs) noexcept = default;
 
 Taggable& Taggable::operator=(const Taggable& rhs) {
   set_attrs(rhs);
   return *this;
 }
 
-void Taggable::set_tag(const std::string& tag) { impl_->attrs.emplace(tag, Void{}); }
+Taggable& Taggable::operator=(Taggable&& rhs) noexcept = default;
+
+const Taggable::Impl& Taggable::impl() const {
+  static const Impl empty;
+  return impl_ ? *impl_ : empty;
+}
+
+Taggable::Impl* Taggable::mutable_impl() {
+  if (!impl_) {
+    impl_ = std::make_shared<Impl>();
+  } else if (impl_.use_count() > 1) {
+    impl_ = std::make_shared<Impl>(*impl_);
+  } else {
+    // Another owner may have just dropped its reference from another thread;
+    // make sure its reads of the attributes happen before our writes.
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+  return impl_.get();
+}
+
+void Taggable::set_tag(const std::string& tag) { set_attr(tag); }
 
 void Taggable::add_tags(const Tags& to_add) {
   for (const auto& tag : to_add) {
-    impl_->attrs.emplace(tag, Void{});
+    set_attr(tag);
   }
 }
 
-void Taggable::clear_tags() { impl_->attrs.clear(); }
+void Taggable::clear_tags() { impl_.reset(); }
 
-void Taggable::remove_tag(const std::string& tag) { impl_->attrs.erase(tag); }
+void Taggable::remove_tag(const std::string& tag) {
+  if (has_attr(tag)) {
+    mutable_impl()->attrs.erase(tag);
+  }
+}
 
 void Taggable::set_tags(const Tags& tags) {
-  impl_->attrs.clear();
+  clear_tags();
   add_tags(tags);
 }
 
-bool Taggable::has_tag(const std::string& tag) const { return impl_->attrs.count(tag); }
+bool Taggable::has_tag(const std::string& tag) const { return has_attr(tag); }
 
 bool Taggable::has_tags(const Tags& to_find) const {
+  const auto& attrs = impl().attrs;
   for (const auto& tag : to_find) {
-    if (impl_->attrs.count(tag) == 0) {
+    if (attrs.count(tag) == 0) {
       return false;
     }
   }
@@ -279,45 +307,86 @@ bool Taggable::has_tags(const Tags& to_find) const {
 }
 
 bool Taggable::has_any_tags(const Tags& to_find) const {
+  const auto& attrs = impl().attrs;
   for (const auto& tag : to_find) {
-    if (impl_->attrs.count(tag) == 1) {
+    if (attrs.count(tag) == 1) {
       return true;
     }
   }
   return false;
 }
 
-void Taggable::set_attr(const std::string& name) { impl_->attrs.emplace(name, Void{}); }
+void Taggable::set_attr(const std::string& name) {
+  if (!has_attr(name)) {
+    mutable_impl()->attrs.emplace(name, Void{});
+  }
+}
 
-void Taggable::set_attr(const std::string& name, bool value) { impl_->attrs.emplace(name, value); }
+void Taggable::set_attr(const std::string& name, bool value) {
+  if (!has_attr(name)) {
+    mutable_impl()->attrs.emplace(name, value);
+  }
+}
 
-void Taggable::set_attr(const std::string& name, int64_t value) { impl_->attrs.emplace(name, value); }
+void Taggable::set_attr(const std::string& name, int64_t value) {
+  if (!has_attr(name)) {
+    mutable_impl()->attrs.emplace(name, value);
+  }
+}
 
-void Taggable::set_attr(const std::string& name, double value) { impl_->attrs.emplace(name, value); }
+void Taggable::set_attr(const std::string& name, double value) {
+  if (!has_attr(name)) {
+    mutable_impl()->attrs.emplace(name, value);
+  }
+}
 
-void Taggable::set_attr(const std::string& name, const std::string& value) { impl_->attrs.emplace(name, value); }
+void Taggable::set_attr(const std::string& name, const std::string& value) {
+  if (!has_attr(name)) {
+    mutable_impl()->attrs.emplace(name, value);
+  }
+}
 
-void Taggable::set_attr(const std::string& name, const Any& value) { impl_->attrs.emplace(name, value); }
+void Taggable::set_attr(const std::string& name, const Any& value) {
+  if (!has_attr(name)) {
+    mutable_impl()->attrs.emplace(name, value);
+  }
+}
 
-bool Taggable::has_attr(const std::string& name) const { return impl_->attrs.count(name); }
+bool Taggable::has_attr(const std::string& name) const { return impl().attrs.count(name); }
 
 void Taggable::set_attrs(const Taggable& rhs) {
   if (this != &rhs) {
-    impl_.reset(new Impl(*rhs.impl_));
+    impl_ = rhs.impl_;
   }
 }
 
-bool Taggable::get_attr_bool(const std::string& name) const { return boost::get<bool>(impl_->attrs[name]); }
+namespace {
+
+// Looks up an attribute; missing attributes read as Void, so that retrieving
+// them as any other type throws boost::bad_get.
+const AttrValue& GetAttr(const std::map<std::string, AttrValue>& attrs, const std::string& name) {
+  static const AttrValue missing;
+  auto it = attrs.find(name);
+  return it == attrs.end() ? missing : it->second;
+}
+
+}  // namespace
+
+bool Taggable::get_attr_bool(const std::string& name) const { return boost::get<bool>(GetAttr(impl().attrs, name)); }
 
-int64_t Taggable::get_attr_int(const std::string& name) const { return boost::get<int64_t>(impl_->attrs[name]); }
+int64_t Taggable::get_attr_int(const std::string& name) const {
+  return boost::get<int64_t>(GetAttr(impl().attrs, name));
+}
 
-double Taggable::get_attr_float(const std::string& name) const { return boost::get<double>(impl_->attrs[name]); }
+double Taggable::get_attr_float(const std::string& name) const {
+  return boost::get<double>(GetAttr(impl().attrs, name));
+}
 
 std::string Taggable::get_attr_str(const std::string& name) const {
-  return boost::get<std::string>(impl_->attrs[name]);
+  return boost::get<std::string>(GetAttr(impl().attrs, name));
 }
 
-Any Taggable::get_attr_any(const std::string& name) const { return boost::get<Any>(impl_->attrs[name]); }
+Any Taggable::get_attr_any(const std::string& name) const { return boost::get<Any>(GetAttr(impl().attrs, name)); }
 
 bool Taggable::get_attr_bool(const std::string& name, bool def) const {
   return has_attr(name) ? get_attr_bool(name) : def;
@@ -727,11 +796,12 @@ Location RealizeLocation(const Location& loc, const Block& block) {
     for (auto& unit : dev.units) {
       std::map<std::string, Affine> tag_map;
       for (const auto& name_coeff : unit.getMap()) {
-        if (name_coeff.first.size() && name_coeff.first[0] == '#') {
-          auto tag = name_coeff.first.substr(1);
+        const std::string& name = name_coeff.first;
+        if (name.size() && name[0] == '#') {
+          auto tag = name.substr(1);
           for (const auto& idx : block.idxs) {
             if (idx.has_tag(tag)) {
-              tag_map[name_coeff.first] = idx.name;
+              tag_map[name] = idx.name;
               break;
             }
           }
@@ -824,41 +894,47 @@ Location PartialEval(const Location& loc, const std::map<std::string, std::int64
   return result;
 }
 
-class CloneVisitor : RewriteStmtVisitor {
- public:
-  explicit CloneVisitor(int depth) : depth_(depth) {}
-  Load* Visit(const Load& x) { return new Load(x); }
-  Store* Visit(const Store& x) { return new Store(x); }
-  LoadIndex* Visit(const LoadIndex& x) { return new LoadIndex(x); }
-  Constant* Visit(const Constant& x) { return new Constant(x); }
-  Special* Visit(const Special& x) { return new Special(x); }
-  Intrinsic* Visit(const Intrinsic& x) { return new Intrinsic(x); }
-  Block* Visit(const Block& x) {
-    auto ret = new Block(x);
-    if (depth_ == 0) {
-      return ret;
-    }
-    depth_--;
-    std::unordered_map<Statement*, StatementIt> dep_map;  // src-block ptr -> clone-block StatementIt
-    for (StatementIt sit = ret->stmts.begin(); sit != ret->stmts.end(); ++sit) {
-      Statement* clone = (*sit)->Accept(this);
-      for (auto& dit : clone->deps) {
-        dit = dep_map.at(dit->get());
-      }
-      dep_map[sit->get()] = sit;
-      sit->reset(clone);
-    }
-    depth_++;
-    return ret;
+namespace {
+
+// Clones a statement, allocating each copy together with its control block.
+// Blocks are cloned down to the given depth (-1 for the entire subtree).
+std::shared_ptr<Statement> CloneStatement(const Statement& stmt, int depth) {
+  switch (stmt.kind()) {
+    case StmtKind::Load:
+      return std::make_shared<Load>(static_cast<const Load&>(stmt));
+    case StmtKind::Store:
+      return std::make_shared<Store>(static_cast<const Store&>(stmt));
+    case StmtKind::Constant:
+      return std::make_shared<Constant>(static_cast<const Constant&>(stmt));
+    case StmtKind::LoadIndex:
+      return std::make_shared<LoadIndex>(static_cast<const LoadIndex&>(stmt));
+    case StmtKind::Special:
+      return std::make_shared<Special>(static_cast<const Special&>(stmt));
+    case StmtKind::Intrinsic:
+      return std::make_shared<Intrinsic>(static_cast<const Intrinsic&>(stmt));
+    case StmtKind::Block:
+      return CloneBlock(static_cast<const Block&>(stmt), depth);
   }
+  throw_with_trace(std::runtime_error("Unknown statement kind"));
+}
 
- private:
-  int depth_;
-};
+}  // namespace
 
 std::shared_ptr<Block> CloneBlock(const Block& orig, int depth) {
-  CloneVisitor visitor(depth);
-  return std::shared_ptr<Block>(visitor.Visit(orig));
+  auto ret = std::make_shared<Block>(orig);
+  if (depth == 0) {
+    return ret;
+  }
+  std::unordered_map<Statement*, StatementIt> dep_map;  // src-block ptr -> clone-block StatementIt
+  for (StatementIt sit = ret->stmts.begin(); sit != ret->stmts.end(); ++sit) {
+    auto clone = CloneStatement(**sit, depth - 1);
+    for (auto& dit : clone->deps) {
+      dit = dep_map.at(dit->get());
+    }
+    dep_map[sit->get()] = sit;
+    *sit = std::move(clone);
+  }
+  return ret;
 }
 
 const Index* Block::idx_by_name(const std::string& name) const {
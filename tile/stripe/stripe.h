@@ -78,7 +78,12 @@ using StatementIt = StatementList::iterator;
 
 using Tags = std::set<std::string>;
 
-// Generic properties used by optimization passes
+// Generic properties used by optimization passes.
+//
+// Attributes are copy-on-write: copying a Taggable (as cloning a block does
+// for every statement, refinement, and index within it) shares the
+// attribute map, which is only duplicated when one of the copies is
+// modified.  A Taggable with no attributes doesn't allocate.
 class Taggable {
   friend struct Accessor;
 
@@ -88,9 +93,11 @@ class Taggable {
  public:
   // Copy constructor
   Taggable(const Taggable& rhs);
+  Taggable(Taggable&& rhs) noexcept;
 
   // Copy assignment
   Taggable& operator=(const Taggable& rhs);
+  Taggable& operator=(Taggable&& rhs) noexcept;
 
   ~Taggable();
 
@@ -126,7 +133,9 @@ class Taggable {
 
  private:
   struct Impl;
-  std::unique_ptr<Impl> impl_;
+  const Impl& impl() const;
+  Impl* mutable_impl();
+  std::shared_ptr<Impl> impl_;
 };
 
 class Codec {
@@ -455,6 +464,27 @@ struct Block : Statement {
     }
     return Block::Downcast(*it);
   }
+
+  // Dirty tracking: a dirty block is one where it, or anything beneath it, may
+  // have changed since the optimizer last validated it.  Newly created and
+  // copied blocks start out dirty, and RunOnBlocks marks each block it hands
+  // to a pass; passes that rewrite blocks by other means must mark them.
+  void mark_dirty() { dirty_.value = true; }
+  void clear_dirty() { dirty_.value = false; }
+  bool is_dirty() const { return dirty_.value; }
+
+ private:
+  struct DirtyFlag {
+    DirtyFlag() = default;
+    DirtyFlag(const DirtyFlag&) {}
+    DirtyFlag& operator=(const DirtyFlag&) {
+      value = true;
+      return *this;
+    }
+    bool value = true;
+  };
+
+  DirtyFlag dirty_;
 };
 
 struct Buffer {
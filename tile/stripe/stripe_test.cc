@@ -3,6 +3,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <boost/variant/get.hpp>
+
 #include "tile/stripe/stripe.h"
 
 using ::testing::Combine;
@@ -93,6 +95,53 @@ TEST_P(StripeLocThrowTest, ParserThrows) {
 INSTANTIATE_TEST_CASE_P(InvalidPatterns, StripeLocThrowTest,
                         Values("foo[1, *  ]qux/bar", "foo[1, florp ]/bar", "foo[1, 2* ]/bar"));
 
+TEST(StripeTaggable, CopiesAreIndependent) {
+  Index idx{"i", 4};
+  idx.set_tag("a");
+  idx.set_attr("n", int64_t{1});
+
+  Index copy = idx;
+  EXPECT_TRUE(copy.has_tag("a"));
+  EXPECT_THAT(copy.get_attr_int("n"), Eq(1));
+
+  copy.set_tag("b");
+  copy.remove_tag("a");
+  EXPECT_TRUE(idx.has_tag("a"));
+  EXPECT_FALSE(idx.has_tag("b"));
+  EXPECT_FALSE(copy.has_tag("a"));
+  EXPECT_TRUE(copy.has_tag("b"));
+
+  idx.clear_tags();
+  EXPECT_FALSE(idx.has_attr("n"));
+  EXPECT_THAT(copy.get_attr_int("n"), Eq(1));
+  EXPECT_THROW(idx.get_attr_int("n"), boost::bad_get);
+  EXPECT_FALSE(idx.has_attr("n"));
+}
+
+TEST(StripeClone, DeepCopiesStatementsAndDeps) {
+  Block block;
+  block.set_tag("outer");
+  auto inner = std::make_shared<Block>();
+  inner->set_tag("inner");
+  block.stmts.push_back(std::make_shared<Load>("a", "$a"));
+  block.stmts.push_back(inner);
+  inner->deps.push_back(block.stmts.begin());
+
+  auto clone = CloneBlock(block);
+  EXPECT_TRUE(clone->has_tag("outer"));
+  auto clone_inner = clone->SubBlock(1);
+  EXPECT_THAT(clone_inner.get(), Ne(inner.get()));
+  EXPECT_TRUE(clone_inner->has_tag("inner"));
+  ASSERT_THAT(clone_inner->deps.size(), Eq(1));
+  EXPECT_THAT(clone_inner->deps.front(), Eq(clone->stmts.begin()));
+
+  clone_inner->set_tag("changed");
+  EXPECT_FALSE(inner->has_tag("changed"));
+
+  auto shallow = CloneBlock(block, 0);
+  EXPECT_THAT(shallow->SubBlock(1).get(), Eq(inner.get()));
+}
+
 }  // namespace
 }  // namespace stripe
 }  // namespace tile
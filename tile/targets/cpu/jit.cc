@@ -5,21 +5,28 @@
 #include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Intrinsics.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Support/DynamicLibrary.h>
+#include <llvm/Support/Host.h>
 #include <llvm/Support/ToolOutputFile.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
 #include <llvm/Transforms/Utils/Cloning.h>
 
 #include <algorithm>
+#include <cstdlib>
 #include <deque>
 #include <memory>
+#include <set>
 
 #include <half.hpp>
 
 #include "base/util/lookup.h"
 #include "tile/stripe/stripe.h"
+#include "tile/targets/cpu/parallel.h"
+#include "tile/targets/cpu/thread_pool.h"
+#include "tile/targets/cpu/vector_math.h"
 
 namespace vertexai {
 namespace tile {
@@ -28,22 +35,102 @@ namespace cpu {
 
 namespace {
 const char invoker_name_[] = "__invoke_";
+const char parallel_for_name_[] = "plaidml_rt_parallel_for";
+const char scratch_name_[] = "plaidml_rt_scratch";
+const char parallel_tag_[] = "parallel";
+const char mac_inner_tag_[] = "mac_inner";
+
+// Local buffers no larger than this are allocated on the stack of the block
+// function that calls their block; larger ones are placed in scratch memory.
+constexpr uint64_t kMaxStackBufferBytes = 256;
+// The alignment of local buffers, and of scratch memory.
+constexpr uint64_t kBufferAlign = 64;
+
+uint64_t AlignBuffer(uint64_t size) { return (size + kBufferAlign - 1) / kBufferAlign * kBufferAlign; }
+
+// The most vectors of each row a GEMM micro-kernel tile accumulates, and the
+// most tiles a block is split into before it's left to the generic loops.
+constexpr uint64_t kMaxGemmTileVectors = 4;
+constexpr uint64_t kMaxGemmTiles = 16;
+
+bool HasParallelTag(const stripe::Block& block) {
+  if (block.has_tag(parallel_tag_)) {
+    return true;
+  }
+  for (const auto& stmt : block.stmts) {
+    auto inner = stripe::Block::Downcast(stmt);
+    if (inner && HasParallelTag(*inner)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The width of the host's widest vector registers, in bits.
+unsigned HostVectorBits() {
+  static const unsigned bits = []() {
+    llvm::StringMap<bool> features;
+    llvm::sys::getHostCPUFeatures(features);
+    if (features.lookup("avx512f")) {
+      return 512u;
+    }
+    if (features.lookup("avx")) {
+      return 256u;
+    }
+    return 128u;
+  }();
+  return bits;
+}
+
+// The host's CPU features, in the form of target attributes.
+std::vector<std::string> HostAttributes() {
+  llvm::StringMap<bool> features;
+  std::vector<std::string> attrs;
+  if (llvm::sys::getHostCPUFeatures(features)) {
+    for (const auto& feature : features) {
+      attrs.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+    }
+  }
+  return attrs;
+}
+
+// The coefficient of the named index in an affine.
+int64_t Coefficient(const stripe::Affine& affine, const std::string& name) {
+  const auto& terms = affine.getMap();
+  auto it = terms.find(name);
+  return it == terms.end() ? 0 : it->second;
 }
 
+// The stride of a refinement along an index; an absent index has none.
+int64_t Stride(const stripe::Refinement* ref, const stripe::Index* idx) {
+  return idx ? Coefficient(ref->FlatAccess(), idx->name) : 0;
+}
+
+// The range of an index; an absent index has a single iteration.
+uint64_t Range(const stripe::Index* idx) { return idx ? idx->range : 1; }
+
+}  // namespace
+
 struct ProgramModule {
   std::unique_ptr<llvm::Module> module;
   std::vector<std::string> parameters;
+  // The number of bytes of scratch memory the program's local buffers need.
+  uint64_t scratch_size = 0;
 };
 
 class Executable {
  public:
   explicit Executable(const ProgramModule& module);
-  void Run(const std::map<std::string, void*>& buffers);
+  // Runs the program, with at most max_threads threads (zero meaning all of
+  // the process-wide pool's threads) running each of its parallel loops.
+  void Run(const std::map<std::string, void*>& buffers, std::size_t max_threads = 0);
   void Save(const std::string& filename);
 
  private:
   std::unique_ptr<llvm::ExecutionEngine> engine_;
   std::vector<std::string> parameters_;
+  uint64_t scratch_size_;
+  uint64_t entrypoint_ = 0;  // The invoker's address, looked up once, since the lookup allocates
 };
 
 class Error : public std::runtime_error {
@@ -61,11 +148,14 @@ class Compiler : private stripe::ConstStmtVisitor {
  public:
   explicit Compiler(llvm::LLVMContext* context);
   ProgramModule CompileProgram(const stripe::Block& program);
+  // Enables or disables vectorization of innermost blocks; it's enabled by
+  // default.
+  void set_vectorize(bool vectorize) { vector_bits_ = vectorize ? HostVectorBits() : 0; }
 
  protected:
   explicit Compiler(llvm::LLVMContext* context, llvm::Module* module);
   void GenerateInvoker(const stripe::Block& program, llvm::Function* main);
-  llvm::Function* CompileBlock(const stripe::Block& block);
+  llvm::Function* CompileBlock(const stripe::Block& block, const stripe::Index* fixed = nullptr);
   void Visit(const stripe::Load&) override;
   void Visit(const stripe::Store&) override;
   void Visit(const stripe::LoadIndex&) override;
@@ -125,20 +215,56 @@ class Compiler : private stripe::ConstStmtVisitor {
     llvm::BasicBlock* done = nullptr;
   };
 
+  // A multiply-accumulate block of the form C[m, n] += A[m, k] * B[k, n],
+  // along with the register blocking of the micro-kernel implementing it:
+  // C is split into tiles of rows by vectors along n, each accumulated in
+  // vector registers across the whole of k. The m and k indexes are optional.
+  struct gemm {
+    const stripe::Refinement* a = nullptr;
+    const stripe::Refinement* b = nullptr;
+    const stripe::Refinement* c = nullptr;
+    const stripe::Index* m = nullptr;
+    const stripe::Index* n = nullptr;
+    const stripe::Index* k = nullptr;
+    unsigned width = 1;
+    uint64_t tile_rows = 1;
+    uint64_t tile_vectors = 1;
+  };
+
  private:
   scalar Cast(scalar, DataType);
   scalar CheckBool(scalar);
   llvm::Type* CType(DataType);
+  llvm::Type* ValueType(DataType);
   llvm::Value* ElementPtr(const buffer& buf);
+  llvm::Value* LoadElement(const buffer& buf);
+  void StoreElement(const buffer& buf, llvm::Value* value);
   llvm::Value* Eval(const stripe::Affine& access);
   void OutputType(llvm::Value* ret, const stripe::Intrinsic&);
   void OutputBool(llvm::Value* ret, const stripe::Intrinsic&);
   void CallIntrinsicFunc(const stripe::Intrinsic&, const char* name);
+  void CallVectorMathFunc(const stripe::Intrinsic&, const char* name);
   llvm::Type* IndexType();
   llvm::Value* IndexConst(ssize_t val);
   llvm::FunctionType* BlockType(const stripe::Block&);
-  llvm::Value* MallocFunction();
-  llvm::Value* FreeFunction();
+  llvm::Value* LocalBuffer(const stripe::Refinement& ref, uint64_t* frame_size);
+  llvm::Value* ScratchFunction();
+  const stripe::Index* ParallelIndex(const stripe::Block& block);
+  void CallParallel(const stripe::Block& block, const stripe::Index& idx, llvm::Function* function,
+                    const std::vector<llvm::Value*>& args, uint64_t scratch_size);
+  llvm::Function* ParallelWorker(const stripe::Block& block, const stripe::Index& idx, llvm::Function* function,
+                                 llvm::StructType* closure_type, uint64_t scratch_size);
+  llvm::FunctionType* ParallelWorkerType();
+  llvm::Value* ParallelForFunction();
+  const stripe::Index* VectorIndex(const stripe::Block& block, const stripe::Index* fixed);
+  unsigned VectorWidth(const stripe::Block& block, const stripe::Index& idx);
+  llvm::Value* VectorMask(const stripe::Block& block);
+  llvm::Value* LaneOffsets(int64_t stride);
+  llvm::Value* SafeDivisor(llvm::Value* divisor);
+  bool MatchGemm(const stripe::Block& block, gemm* kernel);
+  void GemmKernel(const stripe::Block& block, const gemm& kernel);
+  void GemmTile(const gemm& kernel, llvm::Value* a, llvm::Value* b, llvm::Value* c, uint64_t row, uint64_t rows,
+                uint64_t vector, uint64_t vectors);
 
   llvm::LLVMContext& context_;
   llvm::IRBuilder<> builder_;
@@ -147,6 +273,33 @@ class Compiler : private stripe::ConstStmtVisitor {
   std::map<std::string, scalar> scalars_;
   std::map<std::string, buffer> buffers_;
   std::map<std::string, index> indexes_;
+
+  // Local buffers too large for the stack are laid out statically in scratch
+  // memory: each block function receives a pointer to scratch memory, from
+  // which it carves the local buffers of each nested block it calls, passing
+  // the remainder on to that block.  Sibling blocks run one after another, so
+  // their buffers share the same offsets.  scratch_size_ is the number of
+  // bytes this block needs, including those needed by its nested blocks.
+  llvm::Value* scratch_ = nullptr;
+  uint64_t scratch_size_ = 0;
+
+  // Whether blocks are chosen for parallel execution automatically, rather
+  // than by the "parallel" tag.
+  bool auto_parallel_ = true;
+  // Whether this block runs within a parallel loop.
+  bool in_parallel_ = false;
+
+  // The width of the host's vector registers, in bits, or zero if blocks are
+  // not to be vectorized.
+  unsigned vector_bits_ = HostVectorBits();
+  // When this block is vectorized: the index whose consecutive iterations
+  // occupy the lanes of each vector, the number of lanes, and the mask of the
+  // lanes which are active in the current iteration.
+  const stripe::Index* vector_index_ = nullptr;
+  unsigned width_ = 1;
+  llvm::Value* mask_ = nullptr;
+  // Whether the first lane may be inactive, due to the block's constraints.
+  bool masked_first_lane_ = false;
 };
 
 Compiler::Compiler(llvm::LLVMContext* context) : context_(*context), builder_{context_} {
@@ -164,7 +317,9 @@ ProgramModule Compiler::CompileProgram(const stripe::Block& program) {
   ProgramModule ret;
   ret.module = std::make_unique<llvm::Module>("stripe", context_);
   module_ = ret.module.get();
+  auto_parallel_ = !HasParallelTag(program);
   llvm::Function* main = CompileBlock(program);
+  ret.scratch_size = scratch_size_;
   // Generate a stub function we can invoke from the outside, passing buffers
   // as an array of generic pointers.
   GenerateInvoker(program, main);
@@ -211,12 +366,13 @@ void Compiler::GenerateInvoker(const stripe::Block& program, llvm::Function* mai
   // buffer parameters it expects. From C, we will prepare a vector of void*,
   // containing the parameter buffer data pointers; the wrapper will extract
   // each data pointer, then pass each one as a parameter when it calls the
-  // program's top-level block function.
+  // program's top-level block function, along with the scratch memory for
+  // the program's local buffers.
   // LLVM doesn't have the notion of a void pointer, so we'll pretend all of
   // these buffers are arrays of int8, then bitcast later.
   llvm::Type* arrayptr = builder_.getInt8PtrTy()->getPointerTo();
   llvm::Type* voidtype = builder_.getVoidTy();
-  auto invoker_type = llvm::FunctionType::get(voidtype, {arrayptr}, false);
+  auto invoker_type = llvm::FunctionType::get(voidtype, {arrayptr, builder_.getInt8PtrTy()}, false);
   auto linkage = llvm::Function::ExternalLinkage;
   auto invoker = llvm::Function::Create(invoker_type, linkage, invoker_name_, module_);
   auto block = llvm::BasicBlock::Create(context_, "block", invoker);
@@ -225,7 +381,8 @@ void Compiler::GenerateInvoker(const stripe::Block& program, llvm::Function* mai
   // it using our int32-pointers in place of whatever it actually expects;
   // LLVM will tolerate this mismatch when we use getOrInsertFunction.
   auto ai = invoker->arg_begin();
-  llvm::Value* argvec = &(*ai);
+  llvm::Value* argvec = &(*ai++);
+  llvm::Value* scratch = &(*ai);
   // The body of the invoker will compute the element pointer for each
   // argument value in order, then load the value.
   std::vector<llvm::Value*> args;
@@ -245,16 +402,19 @@ void Compiler::GenerateInvoker(const stripe::Block& program, llvm::Function* mai
   for (unsigned i = 0; i < program.idxs.size(); ++i) {
     args.push_back(IndexConst(0));
   }
+  args.push_back(scratch);
   // Having built the argument list, we'll call the actual kernel using the
   // parameter signature it expects.
   builder_.CreateCall(main, args, "");
   builder_.CreateRetVoid();
 }
 
-llvm::Function* Compiler::CompileBlock(const stripe::Block& block) {
+llvm::Function* Compiler::CompileBlock(const stripe::Block& block, const stripe::Index* fixed) {
   // Generate a function implementing the body of this block.
   // Buffers (refinements) will be passed in as function parameters, as will
-  // the initial value for each index.
+  // the initial value for each index. If a fixed index is specified, the
+  // function doesn't loop over it; it runs only the iterations at its initial
+  // value, so that a parallel loop can run the others.
 
   for (const auto& ref : block.refs) {
     buffers_[ref.into()] = buffer{&ref};
@@ -263,6 +423,17 @@ llvm::Function* Compiler::CompileBlock(const stripe::Block& block) {
     indexes_[idx.name] = index{&idx};
   }
 
+  // A multiply-accumulate block shaped by the stencil pass is implemented by
+  // a register-blocked micro-kernel rather than the generic loops.
+  gemm kernel;
+  bool use_gemm = !fixed && MatchGemm(block, &kernel);
+
+  // If the block is vectorized, each iteration of the vector index's loop
+  // processes width_ consecutive values of the index, one per vector lane.
+  vector_index_ = use_gemm ? nullptr : VectorIndex(block, fixed);
+  width_ = vector_index_ ? VectorWidth(block, *vector_index_) : 1;
+  masked_first_lane_ = vector_index_ && !block.constraints.empty();
+
   // create the LLVM function which will implement the Stripe block
   auto linkage = llvm::Function::ExternalLinkage;
   auto name = block.name;
@@ -272,7 +443,7 @@ llvm::Function* Compiler::CompileBlock(const stripe::Block& block) {
   auto bb = llvm::BasicBlock::Create(context_, "entry", function);
   builder_.SetInsertPoint(bb);
 
-  // associate parameter values with buffers and indexes
+  // associate parameter values with buffers, indexes, and scratch memory
   for (auto ai = function->arg_begin(); ai != function->arg_end(); ++ai) {
     unsigned idx = ai->getArgNo();
     if (idx < block.refs.size()) {
@@ -282,12 +453,15 @@ llvm::Function* Compiler::CompileBlock(const stripe::Block& block) {
       ai->setName(param_name);
       assert(nullptr == buffers_[param_name].base);
       buffers_[param_name].base = &(*ai);
-    } else {
+    } else if (idx < block.refs.size() + block.idxs.size()) {
       idx -= block.refs.size();
       std::string param_name = block.idxs[idx].name;
       ai->setName(param_name);
       assert(nullptr == indexes_[param_name].init);
       indexes_[param_name].init = &(*ai);
+    } else {
+      ai->setName("scratch");
+      scratch_ = &(*ai);
     }
   }
 
@@ -299,23 +473,36 @@ llvm::Function* Compiler::CompileBlock(const stripe::Block& block) {
     indexes_[idx.name].variable = variable;
   }
 
+  if (use_gemm) {
+    GemmKernel(block, kernel);
+    builder_.CreateRetVoid();
+    return function;
+  }
+
   // generate the basic blocks for each nested loop's evaluation stages
-  std::vector<loop> loops;
-  for (auto& idx : block.idxs) {
-    std::string name = idx.name;
+  std::vector<loop> loops(block.idxs.size());
+  for (size_t i = 0; i < block.idxs.size(); ++i) {
+    if (&block.idxs[i] == fixed) {
+      continue;
+    }
+    std::string name = block.idxs[i].name;
     auto init = llvm::BasicBlock::Create(context_, "init_" + name, function);
     auto test = llvm::BasicBlock::Create(context_, "test_" + name, function);
     auto body = llvm::BasicBlock::Create(context_, "body_" + name, function);
     auto done = llvm::BasicBlock::Create(context_, "done_" + name, function);
-    loops.push_back({init, test, body, done});
+    loops[i] = {init, test, body, done};
   }
 
   // initialize each loop index and generate the termination check
   for (size_t i = 0; i < block.idxs.size(); ++i) {
-    builder_.CreateBr(loops[i].init);
-    builder_.SetInsertPoint(loops[i].init);
     llvm::Value* variable = indexes_[block.idxs[i].name].variable;
     llvm::Value* init = indexes_[block.idxs[i].name].init;
+    if (&block.idxs[i] == fixed) {
+      builder_.CreateStore(init, variable);
+      continue;
+    }
+    builder_.CreateBr(loops[i].init);
+    builder_.SetInsertPoint(loops[i].init);
     builder_.CreateStore(init, variable);
     builder_.CreateBr(loops[i].test);
     builder_.SetInsertPoint(loops[i].test);
@@ -328,12 +515,17 @@ llvm::Function* Compiler::CompileBlock(const stripe::Block& block) {
   }
 
   // check the constraints against the current index values and decide whether
-  // to execute the block body for this iteration
+  // to execute the block body for this iteration; a vectorized block instead
+  // computes the mask of lanes for which to execute it
   llvm::Value* go = builder_.getTrue();
-  for (auto& constraint : block.constraints) {
-    llvm::Value* gateval = Eval(constraint);
-    llvm::Value* check = builder_.CreateICmpSGE(gateval, IndexConst(0));
-    go = builder_.CreateAnd(check, go);
+  if (vector_index_) {
+    mask_ = VectorMask(block);
+  } else {
+    for (auto& constraint : block.constraints) {
+      llvm::Value* gateval = Eval(constraint);
+      llvm::Value* check = builder_.CreateICmpSGE(gateval, IndexConst(0));
+      go = builder_.CreateAnd(check, go);
+    }
   }
   auto block_body = llvm::BasicBlock::Create(context_, "block", function);
   auto block_done = llvm::BasicBlock::Create(context_, "next", function);
@@ -352,9 +544,12 @@ llvm::Function* Compiler::CompileBlock(const stripe::Block& block) {
 
   // increment each index, from innermost to outermost, then jump back to test
   for (size_t i = block.idxs.size(); i-- > 0;) {
+    if (&block.idxs[i] == fixed) {
+      continue;
+    }
     llvm::Value* variable = indexes_[block.idxs[i].name].variable;
     llvm::Value* index = builder_.CreateLoad(variable);
-    llvm::Value* increment = IndexConst(1);
+    llvm::Value* increment = IndexConst(&block.idxs[i] == vector_index_ ? width_ : 1);
     index = builder_.CreateAdd(index, increment);
     builder_.CreateStore(index, variable);
     builder_.CreateBr(loops[i].test);
@@ -369,11 +564,9 @@ void Compiler::Visit(const stripe::Load& load) {
   // op->from is the name of a source buffer
   // op->into is the name of a destination scalar
   buffer from = buffers_[load.from];
-  // Look up the address of the target element.
-  // Load the value from that address and use it to redefine the
+  // Load the value of the target element and use it to redefine the
   // destination scalar.
-  llvm::Value* element = ElementPtr(from);
-  llvm::Value* value = builder_.CreateLoad(element);
+  llvm::Value* value = LoadElement(from);
   scalars_[load.into] = scalar{value, from.refinement->interior_shape.type};
 }
 
@@ -389,10 +582,9 @@ void Compiler::Visit(const stripe::Store& store) {
   buffer into = buffers_[store.into];
   scalar from = Cast(scalars_[store.from], into.refinement->interior_shape.type);
   llvm::Value* value = from.value;
-  llvm::Value* element = ElementPtr(into);
   std::string agg_op = into.refinement->agg_op;
   if ("add" == agg_op) {
-    llvm::Value* prev = builder_.CreateLoad(element);
+    llvm::Value* prev = LoadElement(into);
     if (is_float(from.type)) {
       value = builder_.CreateFAdd(value, prev);
     } else if (is_int(from.type) || is_uint(from.type)) {
@@ -401,7 +593,7 @@ void Compiler::Visit(const stripe::Store& store) {
       throw Error("Invalid addition type: " + to_string(from.type));
     }
   } else if ("mul" == agg_op) {
-    llvm::Value* prev = builder_.CreateLoad(element);
+    llvm::Value* prev = LoadElement(into);
     if (is_float(from.type)) {
       value = builder_.CreateFMul(value, prev);
     } else if (is_int(from.type) || is_uint(from.type)) {
@@ -410,7 +602,7 @@ void Compiler::Visit(const stripe::Store& store) {
       throw Error("Invalid multiplication type: " + to_string(from.type));
     }
   } else if ("max" == agg_op) {
-    llvm::Value* prev = builder_.CreateLoad(element);
+    llvm::Value* prev = LoadElement(into);
     llvm::Value* flag = nullptr;
     if (is_float(from.type)) {
       flag = builder_.CreateFCmpUGT(prev, value);
@@ -425,7 +617,7 @@ void Compiler::Visit(const stripe::Store& store) {
   } else if (!agg_op.empty()) {
     throw Error("Unimplemented agg_op: " + to_string(agg_op));
   }
-  builder_.CreateStore(value, element);
+  StoreElement(into, value);
 }
 
 void Compiler::Visit(const stripe::LoadIndex& load_index) {
@@ -441,12 +633,18 @@ void Compiler::Visit(const stripe::Constant& constant) {
   switch (constant.type) {
     case stripe::ConstType::Integer: {
       auto ty = builder_.getInt64Ty();
-      auto value = llvm::ConstantInt::get(ty, constant.iconst);
+      llvm::Value* value = llvm::ConstantInt::get(ty, constant.iconst);
+      if (vector_index_) {
+        value = builder_.CreateVectorSplat(width_, value);
+      }
       scalars_[constant.name] = scalar{value, DataType::INT64};
     } break;
     case stripe::ConstType::Float: {
       auto ty = builder_.getDoubleTy();
-      auto value = llvm::ConstantFP::get(ty, constant.fconst);
+      llvm::Value* value = llvm::ConstantFP::get(ty, constant.fconst);
+      if (vector_index_) {
+        value = builder_.CreateVectorSplat(width_, value);
+      }
       scalars_[constant.name] = scalar{value, DataType::FLOAT64};
     } break;
   }
@@ -517,29 +715,27 @@ void Compiler::Visit(const stripe::Intrinsic& intrinsic) {
 }
 
 void Compiler::Visit(const stripe::Block& block) {
+  // Decide whether to distribute the nested block's iterations across threads;
+  // blocks within a parallel loop always run serially.
+  const stripe::Index* parallel = in_parallel_ ? nullptr : ParallelIndex(block);
   // Compile a nested block as a function in the same module
   Compiler nested(&context_, module_);
-  auto function = nested.CompileBlock(block);
+  nested.auto_parallel_ = auto_parallel_;
+  nested.in_parallel_ = in_parallel_ || parallel;
+  nested.vector_bits_ = vector_bits_;
+  auto function = nested.CompileBlock(block, parallel);
   // Generate a list of args.
   // The argument list begins with a pointer to each refinement. We will either
-  // pass along the address of a refinement from the current block, or allocate
-  // a new buffer for the nested block's use.
+  // pass along the address of a refinement from the current block, or provide
+  // a local buffer for the nested block's use.
   std::vector<llvm::Value*> args;
-  std::vector<llvm::Value*> allocs;
+  uint64_t frame_size = 0;
   for (auto& ref : block.refs) {
     llvm::Value* buffer = nullptr;
     // When a refinement is neither in nor out, and it has no "from"
     // name, it represents a local allocation.
     if (ref.dir == stripe::RefDir::None && ref.from.empty()) {
-      // Allocate new storage for the buffer.
-      size_t size = ref.interior_shape.byte_size();
-      std::vector<llvm::Value*> malloc_args;
-      malloc_args.push_back(IndexConst(size));
-      auto malloc_func = MallocFunction();
-      buffer = builder_.CreateCall(malloc_func, malloc_args, "");
-      allocs.push_back(buffer);
-      llvm::Type* buftype = CType(ref.interior_shape.type)->getPointerTo();
-      buffer = builder_.CreateBitCast(buffer, buftype);
+      buffer = LocalBuffer(ref, &frame_size);
     } else {
       // Pass in the current element address from the source buffer.
       // If a "from" name is specified, use that buffer; if not, that means
@@ -555,14 +751,18 @@ void Compiler::Visit(const stripe::Block& block) {
   for (auto& idx : block.idxs) {
     args.push_back(Eval(idx.affine));
   }
+  // Finally, the nested block gets the scratch memory following its own local
+  // buffers. A parallel block's iterations run concurrently, so each worker
+  // provides its own scratch memory instead.
   // Invoke the function. It does not return a value.
-  builder_.CreateCall(function, args, "");
-  // Free the temporary buffers we allocated as parameter values.
-  for (auto ptr : allocs) {
-    std::vector<llvm::Value*> free_args;
-    free_args.push_back(ptr);
-    auto free_func = FreeFunction();
-    builder_.CreateCall(free_func, free_args, "");
+  if (parallel) {
+    args.push_back(llvm::Constant::getNullValue(builder_.getInt8PtrTy()));
+    CallParallel(block, *parallel, function, args, nested.scratch_size_);
+    scratch_size_ = std::max(scratch_size_, frame_size);
+  } else {
+    args.push_back(builder_.CreateConstGEP1_64(scratch_, frame_size));
+    builder_.CreateCall(function, args, "");
+    scratch_size_ = std::max(scratch_size_, frame_size + nested.scratch_size_);
   }
 }
 
@@ -648,9 +848,9 @@ void Compiler::Divide(const stripe::Intrinsic& div) {
   if (is_float(div.type)) {
     ret = builder_.CreateFDiv(lhs.value, rhs.value);
   } else if (is_int(div.type)) {
-    ret = builder_.CreateSDiv(lhs.value, rhs.value);
+    ret = builder_.CreateSDiv(lhs.value, SafeDivisor(rhs.value));
   } else if (is_uint(div.type)) {
-    ret = builder_.CreateUDiv(lhs.value, rhs.value);
+    ret = builder_.CreateUDiv(lhs.value, SafeDivisor(rhs.value));
   } else {
     throw Error("Invalid division type: " + to_string(div.type));
   }
@@ -666,9 +866,9 @@ void Compiler::Mod(const stripe::Intrinsic& mod) {
   // Output type is operation type
   llvm::Value* ret = nullptr;
   if (is_int(mod.type)) {
-    ret = builder_.CreateSRem(lhs.value, rhs.value);
+    ret = builder_.CreateSRem(lhs.value, SafeDivisor(rhs.value));
   } else if (is_uint(mod.type)) {
-    ret = builder_.CreateURem(lhs.value, rhs.value);
+    ret = builder_.CreateURem(lhs.value, SafeDivisor(rhs.value));
   } else {
     throw Error("Invalid modulo type: " + to_string(mod.type));
   }
@@ -903,7 +1103,7 @@ Compiler::scalar Compiler::Cast(scalar v, DataType to_type) {
   if (v.type == to_type) {
     return v;
   }
-  llvm::Type* to_llvmtype = CType(to_type);
+  llvm::Type* to_llvmtype = ValueType(to_type);
   bool from_signed = is_int(v.type) || is_float(v.type);
   bool to_signed = is_int(to_type) || is_float(to_type);
   auto op = llvm::CastInst::getCastOpcode(v.value, from_signed, to_llvmtype, to_signed);
@@ -948,6 +1148,16 @@ llvm::Type* Compiler::CType(DataType type) {
   return builder_.getVoidTy();
 }
 
+llvm::Type* Compiler::ValueType(DataType type) {
+  // In a vectorized block, every scalar is a vector with one lane per
+  // iteration of the vector index.
+  llvm::Type* ctype = CType(type);
+  if (!vector_index_) {
+    return ctype;
+  }
+  return llvm::VectorType::get(ctype, width_);
+}
+
 llvm::Value* Compiler::ElementPtr(const buffer& buf) {
   // Ask the source refinement to generate an access path, in the form of
   // a sequence of indexes to scale and sum. Load each index value, multiply,
@@ -957,6 +1167,49 @@ llvm::Value* Compiler::ElementPtr(const buffer& buf) {
   return builder_.CreateGEP(buf.base, idxList);
 }
 
+llvm::Value* Compiler::LoadElement(const buffer& buf) {
+  // In a vectorized block, the element pointer addresses the first lane's
+  // element; the others follow at the refinement's stride along the vector
+  // index. Inactive lanes are never accessed.
+  llvm::Value* element = ElementPtr(buf);
+  if (!vector_index_) {
+    return builder_.CreateLoad(element);
+  }
+  auto type = buf.refinement->interior_shape.type;
+  auto vector_type = ValueType(type);
+  unsigned align = byte_width(type);
+  llvm::Value* zero = llvm::Constant::getNullValue(vector_type);
+  int64_t stride = Coefficient(buf.refinement->FlatAccess(), vector_index_->name);
+  if (stride == 1) {
+    llvm::Value* ptr = builder_.CreateBitCast(element, vector_type->getPointerTo());
+    return builder_.CreateMaskedLoad(ptr, align, mask_, zero);
+  }
+  if (stride == 0 && !masked_first_lane_) {
+    // Every lane reads the same element, and the first lane is always active.
+    return builder_.CreateVectorSplat(width_, builder_.CreateLoad(element));
+  }
+  llvm::Value* ptrs = builder_.CreateGEP(element, LaneOffsets(stride));
+  return builder_.CreateMaskedGather(ptrs, align, mask_, zero);
+}
+
+void Compiler::StoreElement(const buffer& buf, llvm::Value* value) {
+  llvm::Value* element = ElementPtr(buf);
+  if (!vector_index_) {
+    builder_.CreateStore(value, element);
+    return;
+  }
+  // VectorIndex ensures that each lane writes a distinct element.
+  unsigned align = byte_width(buf.refinement->interior_shape.type);
+  int64_t stride = Coefficient(buf.refinement->FlatAccess(), vector_index_->name);
+  if (stride == 1) {
+    llvm::Value* ptr = builder_.CreateBitCast(element, value->getType()->getPointerTo());
+    builder_.CreateMaskedStore(value, ptr, align, mask_);
+  } else {
+    llvm::Value* ptrs = builder_.CreateGEP(element, LaneOffsets(stride));
+    builder_.CreateMaskedScatter(value, ptrs, align, mask_);
+  }
+}
+
 llvm::Value* Compiler::Eval(const stripe::Affine& access) {
   llvm::Value* offset = IndexConst(0);
   for (auto& term : access.getMap()) {
@@ -985,6 +1238,10 @@ void Compiler::OutputBool(llvm::Value* ret, const stripe::Intrinsic& intrinsic)
 }
 
 void Compiler::CallIntrinsicFunc(const stripe::Intrinsic& stmt, const char* name) {
+  if (vector_index_) {
+    CallVectorMathFunc(stmt, name);
+    return;
+  }
   assert(1 == stmt.inputs.size());
   scalar op = Cast(scalars_[stmt.inputs[0]], stmt.type);
   std::vector<llvm::Value*> argvals{op.value};
@@ -996,6 +1253,51 @@ void Compiler::CallIntrinsicFunc(const stripe::Intrinsic& stmt, const char* name
   OutputType(ret, stmt);
 }
 
+void Compiler::CallVectorMathFunc(const stripe::Intrinsic& stmt, const char* name) {
+  // Float exp, log, and tanh are computed in-line, and sqrt, exp, log, and pow
+  // map to LLVM's vector intrinsics; anything else calls the C library
+  // function once per lane.
+  std::vector<llvm::Value*> argvals;
+  for (const auto& input : stmt.inputs) {
+    argvals.push_back(Cast(scalars_[input], stmt.type).value);
+  }
+  static std::map<std::string, llvm::Intrinsic::ID> intrinsics{
+      {"sqrt", llvm::Intrinsic::sqrt},
+      {"exp", llvm::Intrinsic::exp},
+      {"log", llvm::Intrinsic::log},
+      {"pow", llvm::Intrinsic::pow},
+  };
+  std::string func_name = name;
+  bool is_f32 = stmt.type == DataType::FLOAT32;
+  bool is_f64 = stmt.type == DataType::FLOAT64;
+  auto intrinsic = intrinsics.find(func_name);
+  llvm::Value* ret = nullptr;
+  if (is_f32 && func_name == "exp") {
+    ret = VectorExp(&builder_, argvals[0]);
+  } else if (is_f32 && func_name == "log") {
+    ret = VectorLog(&builder_, argvals[0]);
+  } else if (is_f32 && func_name == "tanh") {
+    ret = VectorTanh(&builder_, argvals[0]);
+  } else if ((is_f32 || is_f64) && intrinsic != intrinsics.end()) {
+    auto func = llvm::Intrinsic::getDeclaration(module_, intrinsic->second, {ValueType(stmt.type)});
+    ret = builder_.CreateCall(func, argvals, "");
+  } else {
+    auto ctype = CType(stmt.type);
+    std::vector<llvm::Type*> argtypes(argvals.size(), ctype);
+    auto functype = llvm::FunctionType::get(ctype, argtypes, false);
+    auto func = module_->getOrInsertFunction(name, functype);
+    ret = llvm::UndefValue::get(ValueType(stmt.type));
+    for (unsigned lane = 0; lane < width_; ++lane) {
+      std::vector<llvm::Value*> lane_args;
+      for (auto argval : argvals) {
+        lane_args.push_back(builder_.CreateExtractElement(argval, lane));
+      }
+      ret = builder_.CreateInsertElement(ret, builder_.CreateCall(func, lane_args, ""), lane);
+    }
+  }
+  OutputType(ret, stmt);
+}
+
 llvm::Type* Compiler::IndexType() {
   unsigned archbits = module_->getDataLayout().getPointerSizeInBits();
   return llvm::IntegerType::get(context_, archbits);
@@ -1018,29 +1320,475 @@ llvm::FunctionType* Compiler::BlockType(const stripe::Block& block) {
   for (size_t i = 0; i < block.idxs.size(); ++i) {
     param_types.push_back(IndexType());
   }
+  // The last parameter points to the scratch memory for the local buffers of
+  // the block's nested blocks.
+  param_types.push_back(builder_.getInt8PtrTy());
   // Blocks never return a value.
   llvm::Type* return_type = builder_.getVoidTy();
   return llvm::FunctionType::get(return_type, param_types, false);
 }
 
-llvm::Value* Compiler::MallocFunction(void) {
+llvm::Value* Compiler::LocalBuffer(const stripe::Refinement& ref, uint64_t* frame_size) {
+  // Small buffers are allocated in the entry block, so that they're allocated
+  // once per call of the current block's function, even when the nested block
+  // is called within a loop. Larger buffers are placed in the next available
+  // region of scratch memory.
+  uint64_t size = ref.interior_shape.byte_size();
+  llvm::Value* buffer;
+  if (size <= kMaxStackBufferBytes) {
+    auto& entry = builder_.GetInsertBlock()->getParent()->getEntryBlock();
+    llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+    auto alloca = entry_builder.CreateAlloca(llvm::ArrayType::get(builder_.getInt8Ty(), std::max<uint64_t>(size, 1)));
+    alloca->setAlignment(kBufferAlign);
+    buffer = alloca;
+  } else {
+    buffer = builder_.CreateConstGEP1_64(scratch_, *frame_size);
+    *frame_size += AlignBuffer(size);
+  }
+  return builder_.CreateBitCast(buffer, CType(ref.interior_shape.type)->getPointerTo());
+}
+
+llvm::Value* Compiler::ScratchFunction() {
+  // void* plaidml_rt_scratch(size_t size)
   std::vector<llvm::Type*> argtypes{IndexType()};
-  llvm::Type* rettype = builder_.getInt8PtrTy();
-  auto functype = llvm::FunctionType::get(rettype, argtypes, false);
-  const char* funcname = "malloc";
-  return module_->getOrInsertFunction(funcname, functype);
+  auto functype = llvm::FunctionType::get(builder_.getInt8PtrTy(), argtypes, false);
+  return module_->getOrInsertFunction(scratch_name_, functype);
+}
+
+const stripe::Index* Compiler::ParallelIndex(const stripe::Block& block) {
+  // Select the outermost index whose iterations write disjoint memory, so that
+  // they can run concurrently. An index that two iterations writing the same
+  // element (e.g. a reduction index of an aggregation) differ in is never
+  // selected; each aggregation output is still accumulated by one thread.
+  if (!auto_parallel_ && !block.has_tag(parallel_tag_)) {
+    return nullptr;
+  }
+  for (const auto& idx : block.idxs) {
+    if (idx.range < 2 || !idx.affine.getMap().empty()) {
+      continue;
+    }
+    if (IsParallelizable(block, idx.name)) {
+      IVLOG(2, "Running block " << block.name << " in parallel over " << idx.name);
+      return &idx;
+    }
+  }
+  if (block.has_tag(parallel_tag_)) {
+    IVLOG(1, "Block " << block.name << " is tagged parallel, but has no index with disjoint outputs");
+  }
+  return nullptr;
+}
+
+void Compiler::CallParallel(const stripe::Block& block, const stripe::Index& idx, llvm::Function* function,
+                            const std::vector<llvm::Value*>& args, uint64_t scratch_size) {
+  // Pack the block function's arguments into a closure on the stack, and hand
+  // the closure to the runtime's parallel-for along with a worker function
+  // that unpacks them and runs a range of the parallel index's iterations.
+  std::vector<llvm::Type*> field_types;
+  for (auto arg : args) {
+    field_types.push_back(arg->getType());
+  }
+  auto closure_type = llvm::StructType::get(context_, field_types);
+  // The closure is allocated in the entry block, so that it's allocated once
+  // even when this call is within a loop.
+  auto& entry = builder_.GetInsertBlock()->getParent()->getEntryBlock();
+  llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+  llvm::Value* closure = entry_builder.CreateAlloca(closure_type);
+  for (unsigned i = 0; i < args.size(); ++i) {
+    builder_.CreateStore(args[i], builder_.CreateStructGEP(closure_type, closure, i));
+  }
+  auto worker = ParallelWorker(block, idx, function, closure_type, scratch_size);
+  std::vector<llvm::Value*> parallel_args{
+      worker,
+      builder_.CreateBitCast(closure, builder_.getInt8PtrTy()),
+      IndexConst(idx.range),
+  };
+  builder_.CreateCall(ParallelForFunction(), parallel_args, "");
+}
+
+llvm::Function* Compiler::ParallelWorker(const stripe::Block& block, const stripe::Index& idx,
+                                         llvm::Function* function, llvm::StructType* closure_type,
+                                         uint64_t scratch_size) {
+  // Generate a function which runs the iterations [begin, end) of the
+  // parallel index, by calling the block function with each value of the
+  // index in turn. The iterations share the calling thread's scratch memory,
+  // since they run one after another.
+  auto linkage = llvm::Function::InternalLinkage;
+  auto worker = llvm::Function::Create(ParallelWorkerType(), linkage, block.name + "_parallel", module_);
+  llvm::IRBuilder<> builder(context_);
+  auto entry = llvm::BasicBlock::Create(context_, "entry", worker);
+  auto test = llvm::BasicBlock::Create(context_, "test", worker);
+  auto body = llvm::BasicBlock::Create(context_, "body", worker);
+  auto done = llvm::BasicBlock::Create(context_, "done", worker);
+  auto ai = worker->arg_begin();
+  llvm::Value* closure = &(*ai++);
+  llvm::Value* begin = &(*ai++);
+  llvm::Value* end = &(*ai);
+
+  builder.SetInsertPoint(entry);
+  closure = builder.CreateBitCast(closure, closure_type->getPointerTo());
+  std::vector<llvm::Value*> args;
+  for (unsigned i = 0; i < closure_type->getNumElements(); ++i) {
+    args.push_back(builder.CreateLoad(builder.CreateStructGEP(closure_type, closure, i)));
+  }
+  if (scratch_size) {
+    std::vector<llvm::Value*> scratch_args{llvm::ConstantInt::get(IndexType(), scratch_size)};
+    args.back() = builder.CreateCall(ScratchFunction(), scratch_args, "");
+  }
+  auto idx_pos = std::distance(block.idxs.data(), &idx);
+  size_t init_arg = block.refs.size() + idx_pos;
+  llvm::Value* init = args[init_arg];
+  builder.CreateBr(test);
+
+  builder.SetInsertPoint(test);
+  auto iteration = builder.CreatePHI(IndexType(), 2);
+  iteration->addIncoming(begin, entry);
+  builder.CreateCondBr(builder.CreateICmpULT(iteration, end), body, done);
+
+  builder.SetInsertPoint(body);
+  args[init_arg] = builder.CreateAdd(init, iteration);
+  builder.CreateCall(function, args, "");
+  iteration->addIncoming(builder.CreateAdd(iteration, IndexConst(1)), body);
+  builder.CreateBr(test);
+
+  builder.SetInsertPoint(done);
+  builder.CreateRetVoid();
+  return worker;
+}
+
+llvm::FunctionType* Compiler::ParallelWorkerType() {
+  // void worker(void* closure, size_t begin, size_t end)
+  std::vector<llvm::Type*> argtypes{builder_.getInt8PtrTy(), IndexType(), IndexType()};
+  return llvm::FunctionType::get(builder_.getVoidTy(), argtypes, false);
 }
 
-llvm::Value* Compiler::FreeFunction(void) {
-  llvm::Type* ptrtype = builder_.getInt8PtrTy();
-  std::vector<llvm::Type*> argtypes{ptrtype};
-  llvm::Type* rettype = llvm::Type::getVoidTy(context_);
-  auto functype = llvm::FunctionType::get(rettype, argtypes, false);
-  const char* funcname = "free";
-  return module_->getOrInsertFunction(funcname, functype);
+llvm::Value* Compiler::ParallelForFunction() {
+  // void plaidml_rt_parallel_for(worker_fn* worker, void* closure, size_t count)
+  std::vector<llvm::Type*> argtypes{ParallelWorkerType()->getPointerTo(), builder_.getInt8PtrTy(), IndexType()};
+  auto functype = llvm::FunctionType::get(builder_.getVoidTy(), argtypes, false);
+  return module_->getOrInsertFunction(parallel_for_name_, functype);
 }
 
-Executable::Executable(const ProgramModule& module) : parameters_(module.parameters) {
+const stripe::Index* Compiler::VectorIndex(const stripe::Block& block, const stripe::Index* fixed) {
+  // Select the index to vectorize: only innermost blocks whose statements all
+  // have vector forms are vectorized, over the index with the most unit-stride
+  // accesses, preferring the innermost. Lanes mustn't write the same element,
+  // and since all of an iteration's loads precede its stores, no buffer may be
+  // both written and accessed through another refinement.
+  if (!vector_bits_) {
+    return nullptr;
+  }
+  for (const auto& stmt : block.stmts) {
+    switch (stmt->kind()) {
+      case stripe::StmtKind::Load:
+      case stripe::StmtKind::Store:
+      case stripe::StmtKind::Constant:
+      case stripe::StmtKind::Intrinsic:
+        break;
+      default:
+        return nullptr;
+    }
+  }
+  std::map<std::string, size_t> sources;
+  for (const auto& ref : block.refs) {
+    auto type = ref.interior_shape.type;
+    if (type == DataType::BOOLEAN || type == DataType::FLOAT16) {
+      return nullptr;
+    }
+    sources[ref.from.empty() ? ref.into() : ref.from]++;
+  }
+  for (const auto& ref : block.refs) {
+    if (ref.dir != stripe::RefDir::In && 1 < sources[ref.from.empty() ? ref.into() : ref.from]) {
+      return nullptr;
+    }
+  }
+  const stripe::Index* best = nullptr;
+  size_t best_unit = 0;
+  for (const auto& idx : block.idxs) {
+    if (&idx == fixed || idx.range < 2) {
+      continue;
+    }
+    size_t unit = 0;
+    bool distinct = true;
+    for (const auto& ref : block.refs) {
+      int64_t stride = Coefficient(ref.FlatAccess(), idx.name);
+      if (stride == 1) {
+        unit++;
+      } else if (stride == 0 && ref.dir != stripe::RefDir::In) {
+        distinct = false;
+        break;
+      }
+    }
+    if (distinct && unit && best_unit <= unit) {
+      best = &idx;
+      best_unit = unit;
+    }
+  }
+  if (best) {
+    IVLOG(2, "Vectorizing block " << block.name << " over " << best->name);
+  }
+  return best;
+}
+
+unsigned Compiler::VectorWidth(const stripe::Block& block, const stripe::Index& idx) {
+  // Fill a vector register with the block's widest elements, but use no more
+  // lanes than necessary to cover the index's range.
+  size_t elem_bits = 8;
+  for (const auto& ref : block.refs) {
+    elem_bits = std::max(elem_bits, bit_width(ref.interior_shape.type));
+  }
+  unsigned width = std::max<unsigned>(2, vector_bits_ / elem_bits);
+  while (2 < width && idx.range <= width / 2) {
+    width /= 2;
+  }
+  return width;
+}
+
+llvm::Value* Compiler::VectorMask(const stripe::Block& block) {
+  // A lane is active if its value of the vector index is within the index's
+  // range, and it satisfies the block's constraints.
+  const index& vidx = indexes_[vector_index_->name];
+  llvm::Value* first = builder_.CreateLoad(vidx.variable);
+  llvm::Value* limit = builder_.CreateAdd(vidx.init, IndexConst(vector_index_->range));
+  llvm::Value* remaining = builder_.CreateVectorSplat(width_, builder_.CreateSub(limit, first));
+  llvm::Value* mask = builder_.CreateICmpSLT(LaneOffsets(1), remaining);
+  for (const auto& constraint : block.constraints) {
+    // Each lane's value of the constraint differs from the first lane's by a
+    // multiple of the constraint's coefficient on the vector index.
+    int64_t coeff = Coefficient(constraint, vector_index_->name);
+    llvm::Value* gateval = builder_.CreateVectorSplat(width_, Eval(constraint));
+    gateval = builder_.CreateAdd(gateval, LaneOffsets(coeff));
+    llvm::Value* zero = llvm::Constant::getNullValue(gateval->getType());
+    mask = builder_.CreateAnd(mask, builder_.CreateICmpSGE(gateval, zero));
+  }
+  return mask;
+}
+
+llvm::Value* Compiler::LaneOffsets(int64_t stride) {
+  // The vector <0, stride, 2 * stride, ...>.
+  std::vector<llvm::Constant*> offsets;
+  for (unsigned lane = 0; lane < width_; ++lane) {
+    offsets.push_back(llvm::ConstantInt::get(IndexType(), lane * stride));
+  }
+  return llvm::ConstantVector::get(offsets);
+}
+
+llvm::Value* Compiler::SafeDivisor(llvm::Value* divisor) {
+  // Inactive lanes may hold zeros; divide them by one instead, so that
+  // integer division can't trap.
+  if (!vector_index_) {
+    return divisor;
+  }
+  return builder_.CreateSelect(mask_, divisor, llvm::ConstantInt::get(divisor->getType(), 1));
+}
+
+bool Compiler::MatchGemm(const stripe::Block& block, gemm* kernel) {
+  // Recognize a block the stencil pass has tagged as the inner block of a
+  // multiply-accumulate, when it loads from A and B, multiplies, and adds the
+  // product into C, all in one floating-point type. B and C must have unit
+  // stride along n, along which A mustn't vary; C mustn't vary along k, nor B
+  // along m. Any other index must have a range of one.
+  if (!vector_bits_ || !block.has_tag(mac_inner_tag_) || !block.constraints.empty() || block.stmts.size() != 4) {
+    return false;
+  }
+  auto stmt = block.stmts.begin();
+  auto load_x = stripe::Load::Downcast(*stmt++);
+  auto load_y = stripe::Load::Downcast(*stmt++);
+  auto mul = stripe::Intrinsic::Downcast(*stmt++);
+  auto store = stripe::Store::Downcast(*stmt++);
+  if (!load_x || !load_y || !mul || !store || load_x->into == load_y->into || mul->name != stripe::Intrinsic::MUL ||
+      mul->inputs.size() != 2 || mul->outputs.size() != 1 || store->from != mul->outputs[0]) {
+    return false;
+  }
+  if (std::set<std::string>(mul->inputs.begin(), mul->inputs.end()) !=
+      std::set<std::string>{load_x->into, load_y->into}) {
+    return false;
+  }
+  auto c = buffers_[store->into].refinement;
+  auto x = buffers_[load_x->from].refinement;
+  auto y = buffers_[load_y->from].refinement;
+  if (!c || !x || !y) {
+    return false;
+  }
+  auto type = c->interior_shape.type;
+  if (c->agg_op != "add" || (type != DataType::FLOAT32 && type != DataType::FLOAT64) ||
+      x->interior_shape.type != type || y->interior_shape.type != type) {
+    return false;
+  }
+  // The accumulators are only written back once all of k is done, so C
+  // mustn't share its buffer with either operand.
+  auto source = [](const stripe::Refinement* ref) { return ref->from.empty() ? ref->into() : ref->from; };
+  if (source(c) == source(x) || source(c) == source(y)) {
+    return false;
+  }
+
+  // Either operand may be A, the one that doesn't vary along n.
+  auto classify = [&](const stripe::Refinement* a, const stripe::Refinement* b) {
+    gemm match;
+    match.a = a;
+    match.b = b;
+    match.c = c;
+    for (const auto& idx : block.idxs) {
+      if (idx.range == 1) {
+        continue;
+      }
+      int64_t a_stride = Stride(a, &idx);
+      int64_t b_stride = Stride(b, &idx);
+      int64_t c_stride = Stride(c, &idx);
+      if (!match.n && c_stride == 1 && b_stride == 1 && a_stride == 0) {
+        match.n = &idx;
+      } else if (!match.k && c_stride == 0) {
+        match.k = &idx;
+      } else if (!match.m && c_stride != 0 && b_stride == 0) {
+        match.m = &idx;
+      } else {
+        return false;
+      }
+    }
+    // Each row's accumulators are written back whole, so rows mustn't overlap.
+    if (!match.n || (match.m && std::abs(Stride(c, match.m)) < static_cast<int64_t>(match.n->range))) {
+      return false;
+    }
+    *kernel = match;
+    return true;
+  };
+  if (!classify(x, y) && !classify(y, x)) {
+    return false;
+  }
+
+  // Size the tiles to keep the accumulators, a vector of B for each of the
+  // tile's vectors, and the broadcast element of A in registers: x86-64 has
+  // 32 vector registers with AVX-512, and 16 otherwise.
+  uint64_t registers = vector_bits_ < 512 ? 16 : 32;
+  kernel->width = std::max<unsigned>(2, vector_bits_ / bit_width(type));
+  uint64_t vectors = (kernel->n->range + kernel->width - 1) / kernel->width;
+  uint64_t rows = Range(kernel->m);
+  kernel->tile_vectors = std::min(vectors, kMaxGemmTileVectors);
+  kernel->tile_rows = std::min(rows, std::max<uint64_t>(1, (registers - 1) / kernel->tile_vectors - 1));
+  uint64_t tiles = ((rows + kernel->tile_rows - 1) / kernel->tile_rows) *
+                   ((vectors + kernel->tile_vectors - 1) / kernel->tile_vectors);
+  if (kMaxGemmTiles < tiles) {
+    return false;
+  }
+  IVLOG(2, "Compiling block " << block.name << " as a micro-kernel of " << kernel->tile_rows << "x"
+                              << kernel->tile_vectors << " vectors of " << kernel->width);
+  return true;
+}
+
+void Compiler::GemmKernel(const stripe::Block& block, const gemm& kernel) {
+  // Find the first element of each operand, given the indexes' initial
+  // values, then run each tile of C in turn.
+  for (const auto& idx : block.idxs) {
+    builder_.CreateStore(indexes_[idx.name].init, indexes_[idx.name].variable);
+  }
+  llvm::Value* a = ElementPtr(buffers_[kernel.a->into()]);
+  llvm::Value* b = ElementPtr(buffers_[kernel.b->into()]);
+  llvm::Value* c = ElementPtr(buffers_[kernel.c->into()]);
+  uint64_t rows = Range(kernel.m);
+  uint64_t vectors = (kernel.n->range + kernel.width - 1) / kernel.width;
+  for (uint64_t row = 0; row < rows; row += kernel.tile_rows) {
+    for (uint64_t vector = 0; vector < vectors; vector += kernel.tile_vectors) {
+      GemmTile(kernel, a, b, c, row, std::min(kernel.tile_rows, rows - row), vector,
+               std::min(kernel.tile_vectors, vectors - vector));
+    }
+  }
+}
+
+void Compiler::GemmTile(const gemm& kernel, llvm::Value* a, llvm::Value* b, llvm::Value* c, uint64_t row,
+                        uint64_t rows, uint64_t vector, uint64_t vectors) {
+  // Load the tile's accumulators from C, then for each value of k, load a
+  // vector of B for each of the tile's vectors and multiply-add it with the
+  // broadcast element of A for each of the tile's rows. The accumulators
+  // live in registers throughout the loop, and are stored back once it's
+  // done. Lanes beyond the range of n are masked off.
+  auto type = kernel.c->interior_shape.type;
+  auto vector_type = llvm::VectorType::get(CType(type), kernel.width);
+  unsigned align = byte_width(type);
+  int64_t width = kernel.width;
+  int64_t a_m = Stride(kernel.a, kernel.m);
+  int64_t a_k = Stride(kernel.a, kernel.k);
+  int64_t b_k = Stride(kernel.b, kernel.k);
+  int64_t c_m = Stride(kernel.c, kernel.m);
+  auto vector_ptr = [&](llvm::Value* base, llvm::Value* offset) {
+    return builder_.CreateBitCast(builder_.CreateGEP(base, offset), vector_type->getPointerTo());
+  };
+  std::vector<llvm::Value*> masks;
+  for (uint64_t v = 0; v < vectors; ++v) {
+    uint64_t first = (vector + v) * width;
+    if (first + width <= kernel.n->range) {
+      masks.push_back(nullptr);
+      continue;
+    }
+    std::vector<llvm::Constant*> lanes;
+    for (uint64_t lane = 0; lane < kernel.width; ++lane) {
+      lanes.push_back(builder_.getInt1(first + lane < kernel.n->range));
+    }
+    masks.push_back(llvm::ConstantVector::get(lanes));
+  }
+  auto load = [&](llvm::Value* ptr, llvm::Value* mask) -> llvm::Value* {
+    if (!mask) {
+      return builder_.CreateAlignedLoad(ptr, align);
+    }
+    return builder_.CreateMaskedLoad(ptr, align, mask, llvm::Constant::getNullValue(vector_type));
+  };
+
+  std::vector<llvm::Value*> c_ptrs;
+  std::vector<llvm::Value*> accs;
+  for (uint64_t r = 0; r < rows; ++r) {
+    for (uint64_t v = 0; v < vectors; ++v) {
+      auto offset = IndexConst(static_cast<int64_t>(row + r) * c_m + static_cast<int64_t>(vector + v) * width);
+      c_ptrs.push_back(vector_ptr(c, offset));
+      accs.push_back(load(c_ptrs.back(), masks[v]));
+    }
+  }
+
+  auto function = builder_.GetInsertBlock()->getParent();
+  auto entry = builder_.GetInsertBlock();
+  auto body = llvm::BasicBlock::Create(context_, "gemm_k", function);
+  auto done = llvm::BasicBlock::Create(context_, "gemm_done", function);
+  builder_.CreateBr(body);
+  builder_.SetInsertPoint(body);
+  auto k = builder_.CreatePHI(IndexType(), 2);
+  k->addIncoming(IndexConst(0), entry);
+  std::vector<llvm::PHINode*> phis;
+  for (auto acc : accs) {
+    phis.push_back(builder_.CreatePHI(vector_type, 2));
+    phis.back()->addIncoming(acc, entry);
+  }
+  std::vector<llvm::Value*> b_vectors;
+  for (uint64_t v = 0; v < vectors; ++v) {
+    auto offset = builder_.CreateAdd(builder_.CreateMul(k, IndexConst(b_k)),
+                                     IndexConst(static_cast<int64_t>(vector + v) * width));
+    b_vectors.push_back(load(vector_ptr(b, offset), masks[v]));
+  }
+  auto fmuladd = llvm::Intrinsic::getDeclaration(module_, llvm::Intrinsic::fmuladd, {vector_type});
+  for (uint64_t r = 0; r < rows; ++r) {
+    auto offset = builder_.CreateAdd(builder_.CreateMul(k, IndexConst(a_k)),
+                                     IndexConst(static_cast<int64_t>(row + r) * a_m));
+    auto a_vector = builder_.CreateVectorSplat(kernel.width, builder_.CreateLoad(builder_.CreateGEP(a, offset)));
+    for (uint64_t v = 0; v < vectors; ++v) {
+      auto i = r * vectors + v;
+      std::vector<llvm::Value*> args{a_vector, b_vectors[v], phis[i]};
+      accs[i] = builder_.CreateCall(fmuladd, args, "");
+      phis[i]->addIncoming(accs[i], body);
+    }
+  }
+  auto next = builder_.CreateAdd(k, IndexConst(1));
+  k->addIncoming(next, body);
+  builder_.CreateCondBr(builder_.CreateICmpULT(next, IndexConst(Range(kernel.k))), body, done);
+
+  builder_.SetInsertPoint(done);
+  for (size_t i = 0; i < accs.size(); ++i) {
+    auto mask = masks[i % vectors];
+    if (mask) {
+      builder_.CreateMaskedStore(accs[i], c_ptrs[i], align, mask);
+    } else {
+      builder_.CreateAlignedStore(accs[i], c_ptrs[i], align);
+    }
+  }
+}
+
+Executable::Executable(const ProgramModule& module)
+    : parameters_(module.parameters), scratch_size_(module.scratch_size) {
   std::string errStr;
   std::unique_ptr<llvm::LegacyJITSymbolResolver> rez(new Runtime);
   assert(module.module);
@@ -1049,24 +1797,64 @@ Executable::Executable(const ProgramModule& module) : parameters_(module.paramet
                 .setErrorStr(&errStr)
                 .setEngineKind(llvm::EngineKind::JIT)
                 .setVerifyModules(true)
+                .setMCPU(llvm::sys::getHostCPUName())
+                .setMAttrs(HostAttributes())
                 .setSymbolResolver(std::move(rez))
                 .create();
   if (ee) {
     ee->finalizeObject();
     engine_.reset(ee);
+    entrypoint_ = engine_->getFunctionAddress(invoker_name_);
   } else {
     throw Error("Failed to create ExecutionEngine: " + errStr);
   }
 }
 
-void Executable::Run(const std::map<std::string, void*>& buffers) {
-  std::vector<void*> args(parameters_.size());
+namespace rt {
+// The thread limit for the parallel loops of the program being run on this
+// thread.
+thread_local std::size_t current_max_threads = 0;
+
+// Scratch memory that grows as needed, and is otherwise reused from one run
+// to the next, so that running a program doesn't normally allocate.
+class Scratch {
+ public:
+  void* Get(size_t size) {
+    if (size_ < size) {
+      storage_.reset(new char[size + kBufferAlign]);
+      size_ = size;
+    }
+    auto addr = reinterpret_cast<uintptr_t>(storage_.get());
+    return reinterpret_cast<void*>((addr + kBufferAlign - 1) / kBufferAlign * kBufferAlign);
+  }
+
+ private:
+  std::unique_ptr<char[]> storage_;
+  size_t size_ = 0;
+};
+
+// Each thread keeps separate scratch memory for the programs it runs and for
+// the parallel loop iterations it runs, since a thread running a program also
+// runs some of the iterations of its parallel loops.
+thread_local Scratch program_scratch;
+thread_local Scratch worker_scratch;
+
+// The argument vector passed to the program being run on this thread; like
+// scratch memory, it's reused from one run to the next.
+thread_local std::vector<void*> program_args;
+}  // namespace rt
+
+void Executable::Run(const std::map<std::string, void*>& buffers, std::size_t max_threads) {
+  auto& args = rt::program_args;
+  args.resize(parameters_.size());
   for (size_t i = 0; i < args.size(); ++i) {
     args[i] = safe_at(buffers, parameters_[i]);
   }
   void* argvec = args.data();
-  uint64_t entrypoint = engine_->getFunctionAddress(invoker_name_);
-  ((void (*)(void*))entrypoint)(argvec);
+  void* scratch = rt::program_scratch.Get(scratch_size_);
+  rt::current_max_threads = max_threads;
+  ((void (*)(void*, void*))entrypoint_)(argvec, scratch);
+  rt::current_max_threads = 0;
 }
 
 namespace rt {
@@ -1074,6 +1862,12 @@ namespace rt {
 // that we won't be able to resolve from system libraries.
 float h2f(half_float::half n) { return n; }
 half_float::half f2h(float n) { return half_float::half_cast<half_float::half>(n); }
+void parallel_for(void (*worker)(void*, size_t, size_t), void* closure, size_t count) {
+  // Nested parallel loops, which run on the pool's threads, run serially.
+  ThreadPool::Global()->ParallelFor(count, [&](size_t begin, size_t end) { worker(closure, begin, end); },
+                                    current_max_threads);
+}
+void* scratch(size_t size) { return worker_scratch.Get(size); }
 }  // namespace rt
 
 template <typename T>
@@ -1089,6 +1883,10 @@ llvm::JITSymbol Runtime::findSymbol(const std::string& name) {
       {"__gnu_f2h_ieee", symInfo(rt::f2h)},
       {"___truncsfhf2", symInfo(rt::f2h)},
       {"___extendhfsf2", symInfo(rt::h2f)},
+      {parallel_for_name_, symInfo(rt::parallel_for)},
+      {std::string("_") + parallel_for_name_, symInfo(rt::parallel_for)},
+      {scratch_name_, symInfo(rt::scratch)},
+      {std::string("_") + scratch_name_, symInfo(rt::scratch)},
   };
   auto loc = symbols.find(name);
   if (loc != symbols.end()) {
@@ -1126,15 +1924,18 @@ struct Native::Impl {
   llvm::LLVMContext context;
   ProgramModule module;
   std::unique_ptr<Executable> executable;
+  std::size_t threads = 0;
+  bool vectorize = true;
 
   void compile(const stripe::Block& program) {
     Compiler compiler(&context);
+    compiler.set_vectorize(vectorize);
     module = compiler.CompileProgram(program);
     assert(module.module);
     executable.reset(new Executable(module));
   }
 
-  void run(const std::map<std::string, void*>& buffers) { executable->Run(buffers); }
+  void run(const std::map<std::string, void*>& buffers) { executable->Run(buffers, threads); }
 
   void save(const std::string& filename) {
     std::error_code ec;
@@ -1149,6 +1950,8 @@ Native::~Native() {}
 void Native::compile(const stripe::Block& program) { m_impl->compile(program); }
 void Native::run(const std::map<std::string, void*>& buffers) { m_impl->run(buffers); }
 void Native::save(const std::string& filename) { m_impl->save(filename); }
+void Native::set_threads(std::size_t threads) { m_impl->threads = threads; }
+void Native::set_vectorize(bool vectorize) { m_impl->vectorize = vectorize; }
 
 }  // namespace cpu
 }  // namespace targets
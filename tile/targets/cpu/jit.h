@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <map>
 #include <memory>
 #include <string>
@@ -24,6 +25,13 @@ class Native {
   void compile(const stripe::Block& program);
   void run(const std::map<std::string, void*>& buffers);
   void save(const std::string& filename);
+  // Limits the number of threads running each of the program's parallel
+  // loops.  Loops run on a process-wide pool sized to the host's hardware
+  // concurrency; zero, the default, lets a loop use all of its threads.
+  void set_threads(std::size_t threads);
+  // Enables or disables explicit vectorization of innermost blocks, using the
+  // host's widest vector registers; it's enabled by default.
+  void set_vectorize(bool vectorize);
 };
 
 void JitExecute(const stripe::Block& program, const std::map<std::string, void*>& buffers);
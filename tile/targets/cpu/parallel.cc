@@ -0,0 +1,76 @@
+// Copyright 2019, Intel Corp.
+
+#include "tile/targets/cpu/parallel.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+
+namespace {
+
+// Checks whether distinct values of the named index always select disjoint
+// regions of the refinement: some dimension must be accessed by that index
+// alone, with a stride covering the refinement's extent in that dimension.
+bool IsDisjointAcross(const stripe::Refinement& ref, const std::string& name) {
+  for (size_t i = 0; i < ref.access.size(); ++i) {
+    const auto& terms = ref.access[i].getMap();
+    auto it = terms.find(name);
+    if (it == terms.end()) {
+      continue;
+    }
+    bool alone = std::all_of(terms.begin(), terms.end(),
+                             [&](const std::pair<const std::string, int64_t>& term) {  //
+                               return term.first.empty() || term.first == name;
+                             });
+    if (alone && ref.interior_shape.dims[i].size <= static_cast<uint64_t>(std::llabs(it->second))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The name of the buffer in the parent block that a refinement refers to.
+const std::string& Source(const stripe::Refinement& ref) { return ref.from.empty() ? ref.into() : ref.from; }
+
+// Checks whether two refinements of the same buffer select the same region in
+// every iteration, so that they can't overlap each other across iterations.
+bool IsSameRegion(const stripe::Refinement& lhs, const stripe::Refinement& rhs) {
+  return lhs.offset == rhs.offset && lhs.access == rhs.access && lhs.interior_shape.dims == rhs.interior_shape.dims;
+}
+
+}  // namespace
+
+bool IsParallelizable(const stripe::Block& block, const std::string& idx_name) {
+  bool writes = false;
+  for (const auto& ref : block.refs) {
+    if (ref.dir == stripe::RefDir::In) {
+      continue;
+    }
+    writes = true;
+    if (!IsDisjointAcross(ref, idx_name)) {
+      return false;
+    }
+    if (ref.dir == stripe::RefDir::None && ref.from.empty()) {
+      // A local buffer.  The parent allocates it once for all of the
+      // iterations, which is why it must be disjoint across them like any
+      // other written refinement; no other refinement can refer to it.
+      continue;
+    }
+    for (const auto& other : block.refs) {
+      if (&other != &ref && Source(other) == Source(ref) && !IsSameRegion(other, ref)) {
+        return false;
+      }
+    }
+  }
+  return writes;
+}
+
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,25 @@
+// Copyright 2019, Intel Corp.
+
+#pragma once
+
+#include <string>
+
+#include "tile/stripe/stripe.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+
+// Checks whether the iterations of a block over the named index can run
+// concurrently.  The block must write something, each refinement it writes
+// must select disjoint regions for distinct values of the index, and no other
+// refinement of a written buffer may select a different region (which another
+// iteration might be writing).  The block's local buffers are shared by its
+// iterations, so they're held to the same rule.
+bool IsParallelizable(const stripe::Block& block, const std::string& idx_name);
+
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
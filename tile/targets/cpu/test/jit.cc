@@ -3,6 +3,11 @@
 #include <gmock/gmock.h>
 #include <google/protobuf/text_format.h>
 
+#include <boost/format.hpp>
+
+#include "base/proto/proto.h"
+#include "tile/codegen/codegen.pb.h"
+#include "tile/codegen/driver.h"
 #include "tile/codegen/tile.h"
 #include "tile/lang/compose.h"
 #include "tile/lang/gen_stripe.h"
@@ -329,6 +334,80 @@ TEST(Jit, JitMatMul) {
   EXPECT_THAT(bufC, ContainerEq(expected));
 }
 
+// Runs the stencil pass over a matmul, so that its inner blocks are compiled
+// with the GEMM micro-kernel, and checks the result against a reference. The
+// tile sizes cover a whole number of vectors (as in the CPU config), and a
+// partial vector, whose excess lanes are masked off.
+TEST(Jit, JitGemmMicroKernel) {
+  const size_t M = 12, N = 48, K = 7;
+  std::vector<float> bufA(M * K);
+  std::vector<float> bufB(K * N);
+  std::vector<float> expected(M * N);
+  for (size_t i = 0; i < bufA.size(); ++i) {
+    bufA[i] = static_cast<float>(i % 5) - 2;
+  }
+  for (size_t i = 0; i < bufB.size(); ++i) {
+    bufB[i] = static_cast<float>(i % 7) - 3;
+  }
+  for (size_t m = 0; m < M; ++m) {
+    for (size_t n = 0; n < N; ++n) {
+      for (size_t k = 0; k < K; ++k) {
+        expected[m * N + n] += bufA[m * K + k] * bufB[k * N + n];
+      }
+    }
+  }
+
+  for (auto tile : std::vector<std::pair<size_t, size_t>>{{16, 4}, {12, 3}}) {
+    lang::RunInfo runinfo;
+    runinfo.program_name = "matmul";
+    runinfo.code = "function (A[M, K], B[K, N]) -> (C) { C[m, n : M, N] = +(A[m, k] * B[k, n]); }";
+    runinfo.input_shapes.emplace("A", SimpleShape(DataType::FLOAT32, {M, K}));
+    runinfo.input_shapes.emplace("B", SimpleShape(DataType::FLOAT32, {K, N}));
+    runinfo.output_shapes.emplace("C", SimpleShape(DataType::FLOAT32, {M, N}));
+    auto program = GenerateStripe(runinfo);
+    auto stage = ParseProtoText<codegen::proto::Stage>(str(boost::format(R"(
+      passes: [
+        {
+          name: "stencil_mac"
+          pass: {
+            [type.vertex.ai/vertexai.tile.codegen.proto.StencilPass] {
+              reqs: ["agg_op_add", "comb_op_mul"]
+              outer_set: ["mac"]
+              inner_set: ["mac_inner"]
+              stencils: [
+                {
+                  startup_cost: 32
+                  idxs: [
+                    { name: "n" size: %1% outs: [1] ins: [0, 1] },
+                    { name: "m" size: %2% outs: [-1] ins: [-1, 0] },
+                    { name: "k" size: -1 outs: [0] ins: [-1, -1] }
+                  ]
+                }
+              ]
+            }
+          }
+        }
+      ]
+    )") % tile.first % tile.second));
+    codegen::Optimize(program->entry.get(), stage.passes(), codegen::OptimizeOptions{});
+
+    for (bool vectorize : {true, false}) {
+      std::vector<float> bufC(M * N);
+      std::map<std::string, void*> data = {
+          {"A", bufA.data()},
+          {"B", bufB.data()},
+          {"C", bufC.data()},
+      };
+      Native native;
+      native.set_vectorize(vectorize);
+      native.compile(*program->entry->SubBlock(0));
+      native.run(data);
+      EXPECT_THAT(bufC, ContainerEq(expected)) << "tile " << tile.first << "x" << tile.second << ", vectorize "
+                                               << vectorize;
+    }
+  }
+}
+
 TEST(Jit, JitNestedAlloc) {
   stripe::proto::Block input_proto;
   gp::TextFormat::ParseFromString(R"(
@@ -0,0 +1,70 @@
+// Copyright 2019, Intel Corp.
+
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/util/logging.h"
+#include "testing/benchmark.h"
+#include "tile/targets/cpu/jit.h"
+#include "tile/targets/cpu/test/programs.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace test {
+namespace {
+
+// Times runs of JIT-compiled programs.  The checks are left to the regular
+// tests: JitScratch.SteadyStateRunsDontAllocate checks that the scratch
+// program's runs don't call the allocator, and JitParallel.MatchesSerial that
+// the parallel workloads compute the serial results.
+constexpr std::size_t kWarmup = 10;
+constexpr std::size_t kRuns = 1000;
+
+TEST(JitBenchmark, Scratch) {
+  // Each run enters the row block, and so needs its local buffer, once per
+  // row.
+  auto program = RowsProgram();
+  std::vector<float> bufA(kRows * kCols, 1);
+  std::vector<float> bufB(bufA.size());
+  std::map<std::string, void*> buffers{{"bufA", bufA.data()}, {"bufB", bufB.data()}};
+  for (std::size_t threads : {1, 4}) {
+    Native native;
+    native.set_threads(threads);
+    native.compile(*program);
+    auto time = testing::MeanTime(kWarmup, kRuns, [&](std::size_t) { native.run(buffers); });
+    LOG(INFO) << "rows: " << threads << " threads, " << time.count() << " us/run";
+  }
+}
+
+TEST(JitBenchmark, Parallel) {
+  const std::size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  const std::size_t kParallelRuns = 3;
+  for (const auto& workload : Workloads()) {
+    Fixture fixture{workload};
+    double serial_us = 0;
+    for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+      Native native;
+      fixture.Compile(&native, threads);
+      auto time = testing::MeanTime(1, kParallelRuns, [&](std::size_t) { fixture.Run(&native); });
+      if (threads == 1) {
+        serial_us = time.count();
+      }
+      LOG(INFO) << workload.name << ": " << threads << " threads, " << time.count() / 1000 << " ms, speedup "
+                << serial_us / time.count();
+    }
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,103 @@
+// Copyright 2019, Intel Corp.
+
+#include <gmock/gmock.h>
+
+#include <string>
+
+#include "tile/stripe/stripe.h"
+#include "tile/targets/cpu/jit.h"
+#include "tile/targets/cpu/parallel.h"
+#include "tile/targets/cpu/test/programs.h"
+
+using ::testing::ContainerEq;
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace test {
+namespace {
+
+TEST(JitParallel, MatchesSerial) {
+  for (const auto& workload : Workloads()) {
+    Fixture fixture{workload};
+    Native serial;
+    fixture.Compile(&serial, 1);
+    auto expected = fixture.Run(&serial);
+    Native parallel;
+    fixture.Compile(&parallel, 4);
+    EXPECT_THAT(fixture.Run(&parallel), ContainerEq(expected)) << workload.name;
+  }
+}
+
+// A block over i, with refinements added by the test.
+class Refs {
+ public:
+  Refs() { block_.idxs.emplace_back("i", 8); }
+
+  // Adds a refinement of one element of a buffer, at [i + shift].
+  Refs& Add(stripe::RefDir dir, const std::string& from, const std::string& into, int64_t shift) {
+    TensorShape shape(DataType::FLOAT32, {TensorDimension{1, 1}});
+    block_.refs.emplace(stripe::Refinement{
+        dir,                            // dir
+        from,                           // from
+        into,                           // into
+        {stripe::Affine{"i"} + shift},  // access
+        shape,                          // interior_shape
+    });
+    return *this;
+  }
+
+  // Adds a local buffer of one element, written at [i] if indexed, or at the
+  // same place by every iteration otherwise.
+  Refs& AddLocal(const std::string& into, bool indexed) {
+    TensorShape shape(DataType::FLOAT32, {TensorDimension{1, 1}});
+    stripe::Affine access = indexed ? stripe::Affine{"i"} : stripe::Affine{};
+    block_.refs.emplace(stripe::Refinement{
+        stripe::RefDir::None,  // dir
+        "",                    // from
+        into,                  // into
+        {access},              // access
+        shape,                 // interior_shape
+    });
+    return *this;
+  }
+
+  bool IsParallelizable() const { return cpu::IsParallelizable(block_, "i"); }
+
+ private:
+  stripe::Block block_;
+};
+
+TEST(JitParallel, DisjointWrites) {
+  EXPECT_TRUE(Refs{}.Add(stripe::RefDir::Out, "B", "B", 0).IsParallelizable());
+  EXPECT_TRUE(Refs{}.Add(stripe::RefDir::In, "A", "A", 1).Add(stripe::RefDir::Out, "B", "B", 0).IsParallelizable());
+  // In-place updates read and write the same element.
+  EXPECT_TRUE(Refs{}.Add(stripe::RefDir::In, "B", "B_in", 0).Add(stripe::RefDir::Out, "B", "B", 0).IsParallelizable());
+  // Nothing's written.
+  EXPECT_FALSE(Refs{}.Add(stripe::RefDir::In, "A", "A", 0).IsParallelizable());
+}
+
+TEST(JitParallel, OverlappingWritesOfOneBuffer) {
+  // Each refinement is disjoint across i on its own, but iteration i writes B[i + 1] while iteration i + 1 writes it
+  // through the other refinement.
+  EXPECT_FALSE(
+      Refs{}.Add(stripe::RefDir::Out, "B", "B0", 0).Add(stripe::RefDir::Out, "B", "B1", 1).IsParallelizable());
+  // Likewise for a read of an element another iteration writes.
+  EXPECT_FALSE(
+      Refs{}.Add(stripe::RefDir::In, "B", "B_in", 1).Add(stripe::RefDir::Out, "B", "B", 0).IsParallelizable());
+}
+
+TEST(JitParallel, LocalBuffersAreShared) {
+  // A block's local buffer is allocated once, for all of its iterations, so
+  // they may only use it if they use disjoint parts of it.
+  EXPECT_TRUE(Refs{}.AddLocal("T", true).Add(stripe::RefDir::Out, "B", "B", 0).IsParallelizable());
+  EXPECT_FALSE(Refs{}.AddLocal("T", false).Add(stripe::RefDir::Out, "B", "B", 0).IsParallelizable());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
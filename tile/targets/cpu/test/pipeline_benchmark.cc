@@ -0,0 +1,61 @@
+// Copyright 2019 Intel Corporation.
+
+#include <gmock/gmock.h>
+
+#include "base/util/logging.h"
+#include "testing/benchmark.h"
+#include "tile/codegen/driver.h"
+#include "tile/lang/gen_stripe.h"
+#include "tile/lib/tests.h"
+#include "tile/stripe/stripe.h"
+#include "tile/targets/targets.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace test {
+
+// Measures how long the CPU config's optimization pipeline takes on a few of
+// the internal test networks, along with the cost of deep-cloning the
+// resulting Stripe programs.  Much of the pipeline's time goes to copying
+// Stripe IR (tiling, fusion, unrolling), so this tracks the IR's overhead.
+class PipelineBenchmark : public ::testing::TestWithParam<const char*> {};
+
+constexpr std::size_t kIterations = 10;
+constexpr std::size_t kClones = 100;
+
+TEST_P(PipelineBenchmark, Optimize) {
+  auto runinfo = lib::CreateTest(GetParam());
+  ASSERT_TRUE(runinfo);
+  auto configs = GetConfigs();
+  const auto& stage = configs.configs().at("cpu").stages().at("default");
+
+  // Only the optimization is timed, not the generation of the Stripe it optimizes.
+  testing::BenchmarkMicros optimize_time{0};
+  std::shared_ptr<stripe::Program> program;
+  for (std::size_t i = 0; i < kIterations; ++i) {
+    program = GenerateStripe(*runinfo);
+    optimize_time += testing::MeanTime(0, 1, [&](std::size_t) {
+      codegen::Optimize(program->entry.get(), stage.passes(), codegen::OptimizeOptions{});
+    });
+  }
+
+  auto clone_time = testing::MeanTime(0, kClones, [&](std::size_t) {
+    auto clone = stripe::CloneBlock(*program->entry);
+    ASSERT_THAT(clone->stmts.size(), ::testing::Eq(program->entry->stmts.size()));
+  });
+
+  LOG(INFO) << GetParam() << ": optimize: " << optimize_time.count() / kIterations << "us; "
+            << "clone: " << clone_time.count() << "us";
+}
+
+INSTANTIATE_TEST_CASE_P(Networks, PipelineBenchmark,
+                        ::testing::Values("matmul_among_eltwise", "eltwise_multi_add", "dilated_conv2d",
+                                          "layer_test7"));
+
+}  // namespace test
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
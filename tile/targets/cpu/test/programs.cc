@@ -0,0 +1,231 @@
+// Copyright 2019, Intel Corp.
+
+#include "tile/targets/cpu/test/programs.h"
+
+#include <google/protobuf/text_format.h>
+
+#include <algorithm>
+
+#include "tile/lang/gen_stripe.h"
+#include "tile/stripe/stripe.pb.h"
+
+namespace gp = google::protobuf;
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace test {
+
+std::shared_ptr<stripe::Block> RowsProgram() {
+  stripe::proto::Block input_proto;
+  gp::TextFormat::ParseFromString(R"(
+    loc {}
+    refs [
+      {
+        key: "bufA"
+        value {
+          loc {}
+          dir: 1
+          interior_shape { type: FLOAT32 dims: {size:64 stride:128} dims: {size:128 stride:1} }
+          access { }
+          access { }
+        }
+      },
+      {
+        key: "bufB"
+        value {
+          loc {}
+          dir: 2
+          interior_shape { type: FLOAT32 dims: {size:64 stride:128} dims: {size:128 stride:1} }
+          access { }
+          access { }
+        }
+      }
+    ]
+    stmts { block {
+      name: "rows"
+      idxs { name: "i" range: 64 }
+      refs [
+        {
+          key: "bufA"
+          value {
+            loc {}
+            dir: 1
+            interior_shape { type: FLOAT32 dims: {size:1 stride:128} dims: {size:128 stride:1} }
+            access { terms {key:"i" value:1} }
+            access { }
+          }
+        },
+        {
+          key: "bufB"
+          value {
+            loc {}
+            dir: 2
+            interior_shape { type: FLOAT32 dims: {size:1 stride:128} dims: {size:128 stride:1} }
+            access { terms {key:"i" value:1} }
+            access { }
+          }
+        }
+      ]
+      stmts { block {
+        name: "row"
+        refs [
+          {
+            key: "bufA"
+            value {
+              loc {}
+              dir: 1
+              interior_shape { type: FLOAT32 dims: {size:1 stride:128} dims: {size:128 stride:1} }
+              access { }
+              access { }
+            }
+          },
+          {
+            key: "bufB"
+            value {
+              loc {}
+              dir: 2
+              interior_shape { type: FLOAT32 dims: {size:1 stride:128} dims: {size:128 stride:1} }
+              access { }
+              access { }
+            }
+          },
+          {
+            key: "bufTemp"
+            value {
+              dir: 0
+              interior_shape { type: FLOAT32 dims: {size:128 stride:1} }
+              access { }
+            }
+          }
+        ]
+        stmts { block {
+          name: "fill"
+          idxs { name: "j" range: 128 }
+          refs [
+            {
+              key: "bufA"
+              value {
+                loc {}
+                dir: 1
+                interior_shape { type: FLOAT32 dims: {size:1 stride:128} dims: {size:1 stride:1} }
+                access { }
+                access { terms {key:"j" value:1} }
+              }
+            },
+            {
+              key: "bufTemp"
+              value {
+                dir: 2
+                interior_shape { type: FLOAT32 dims: {size:1 stride:1} }
+                access { terms {key:"j" value:1} }
+              }
+            }
+          ]
+          stmts { load { from:"bufA" into:"$1" } }
+          stmts { store { from:"$1" into:"bufTemp"} }
+        } }
+        stmts { block {
+          name: "drain"
+          idxs { name: "j" range: 128 }
+          refs [
+            {
+              key: "bufTemp"
+              value {
+                dir: 1
+                interior_shape { type: FLOAT32 dims: {size:1 stride:1} }
+                access { terms {key:"j" value:1} }
+              }
+            },
+            {
+              key: "bufB"
+              value {
+                loc {}
+                dir: 2
+                interior_shape { type: FLOAT32 dims: {size:1 stride:128} dims: {size:1 stride:1} }
+                access { }
+                access { terms {key:"j" value:1} }
+              }
+            }
+          ]
+          stmts { load { from:"bufTemp" into:"$1" } }
+          stmts { intrinsic { name:"add" type:FLOAT32 inputs:"$1" inputs:"$1" outputs:"$2"} }
+          stmts { store { from:"$2" into:"bufB"} }
+        } }
+      } }
+    } }
+  )",
+                                  &input_proto);
+  return std::shared_ptr<stripe::Block>{stripe::FromProto(input_proto)};
+}
+
+std::vector<Workload> Workloads() {
+  return {
+      {
+          "matmul",
+          "function (A[M, K], B[K, N]) -> (C) { C[m, n : M, N] = +(A[m, k] * B[k, n]); }",
+          {{"A", {256, 256}}, {"B", {256, 256}}},
+          {"C", {256, 256}},
+      },
+      {
+          "conv",
+          R"(function (I[N, X, Y, CI], K[KX, KY, CI, CO]) -> (O) {
+               O[n, x, y, co : N, X - KX + 1, Y - KY + 1, CO] = +(I[n, x + kx, y + ky, ci] * K[kx, ky, ci, co]);
+             })",
+          {{"I", {1, 34, 34, 32}}, {"K", {3, 3, 32, 32}}},
+          {"O", {1, 32, 32, 32}},
+      },
+  };
+}
+
+namespace {
+
+size_t ElementCount(const std::vector<size_t>& dims) {
+  size_t count = 1;
+  for (auto dim : dims) {
+    count *= dim;
+  }
+  return count;
+}
+
+}  // namespace
+
+Fixture::Fixture(const Workload& workload) {
+  lang::RunInfo runinfo;
+  runinfo.program_name = workload.name;
+  runinfo.code = workload.code;
+  for (const auto& input : workload.inputs) {
+    runinfo.input_shapes.emplace(input.first, SimpleShape(DataType::FLOAT32, input.second));
+    auto& data = data_[input.first];
+    data.resize(ElementCount(input.second));
+    for (size_t i = 0; i < data.size(); ++i) {
+      data[i] = static_cast<float>(i % 7) - 3;
+    }
+  }
+  runinfo.output_shapes.emplace(workload.output.first, SimpleShape(DataType::FLOAT32, workload.output.second));
+  output_ = workload.output.first;
+  data_[output_].resize(ElementCount(workload.output.second));
+  program_ = GenerateStripe(runinfo);
+}
+
+void Fixture::Compile(Native* native, size_t threads) {
+  native->set_threads(threads);
+  native->compile(*program_->entry->SubBlock(0));
+}
+
+std::vector<float> Fixture::Run(Native* native) {
+  std::fill(data_[output_].begin(), data_[output_].end(), 0);
+  std::map<std::string, void*> buffers;
+  for (auto& kvp : data_) {
+    buffers[kvp.first] = kvp.second.data();
+  }
+  native->run(buffers);
+  return data_[output_];
+}
+
+}  // namespace test
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,62 @@
+// Copyright 2019, Intel Corp.
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tile/stripe/stripe.h"
+#include "tile/targets/cpu/jit.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace test {
+
+// Doubles each element of A into B, one row at a time, by way of a local
+// buffer holding the row.  The row block runs once per iteration of the
+// (parallel) rows block, and its buffer is too large for the stack, so it's
+// placed in each thread's scratch memory.
+constexpr std::size_t kRows = 64;
+constexpr std::size_t kCols = 128;
+
+std::shared_ptr<stripe::Block> RowsProgram();
+
+// A Tile function with parallelizable loops, along with the shapes to run it
+// on.
+struct Workload {
+  const char* name;
+  const char* code;
+  std::map<std::string, std::vector<size_t>> inputs;
+  std::pair<std::string, std::vector<size_t>> output;
+};
+
+std::vector<Workload> Workloads();
+
+// A workload's Stripe program, along with its input and output buffers.
+class Fixture {
+ public:
+  explicit Fixture(const Workload& workload);
+
+  // Compiles the program to run on the specified number of threads.
+  void Compile(Native* native, size_t threads);
+
+  // Runs the program, returning its output.
+  std::vector<float> Run(Native* native);
+
+ private:
+  std::shared_ptr<stripe::Program> program_;
+  std::map<std::string, std::vector<float>> data_;
+  std::string output_;
+};
+
+}  // namespace test
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,100 @@
+// Copyright 2019, Intel Corp.
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "tile/targets/cpu/jit.h"
+#include "tile/targets/cpu/test/programs.h"
+#include "tile/targets/cpu/thread_pool.h"
+
+namespace {
+
+// The number of allocations made through operator new, by any thread.
+std::atomic<std::size_t> allocations{0};
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  ++allocations;
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+using ::testing::ContainerEq;
+using ::testing::Eq;
+using ::testing::Le;
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace test {
+namespace {
+
+TEST(JitScratch, LocalBuffersInParallelLoop) {
+  auto program = RowsProgram();
+  std::vector<float> bufA(kRows * kCols);
+  std::vector<float> expected(bufA.size());
+  for (size_t i = 0; i < bufA.size(); ++i) {
+    bufA[i] = static_cast<float>(i % 13);
+    expected[i] = 2 * bufA[i];
+  }
+  for (size_t threads : {1, 4}) {
+    Native native;
+    native.set_threads(threads);
+    native.compile(*program);
+    // Run twice, so that the second run reuses the first's scratch memory.
+    for (int run = 0; run < 2; ++run) {
+      std::vector<float> bufB(bufA.size());
+      native.run({{"bufA", bufA.data()}, {"bufB", bufB.data()}});
+      EXPECT_THAT(bufB, ContainerEq(expected)) << threads << " threads, run " << run;
+    }
+  }
+}
+
+TEST(JitScratch, SteadyStateRunsDontAllocate) {
+  // Each run enters the row block, and so needs its local buffer, once per
+  // row; the buffer's memory is planned at compile time, and each thread's
+  // scratch memory only grows the first time the thread needs it.
+  const int kRuns = 100;
+  auto program = RowsProgram();
+  std::vector<float> bufA(kRows * kCols, 1);
+  std::vector<float> bufB(bufA.size());
+  std::map<std::string, void*> buffers{{"bufA", bufA.data()}, {"bufB", bufB.data()}};
+  for (size_t threads : {1, 4}) {
+    Native native;
+    native.set_threads(threads);
+    native.compile(*program);
+    native.run(buffers);  // Warm up
+    std::size_t before = allocations;
+    for (int run = 0; run < kRuns; ++run) {
+      native.run(buffers);
+    }
+    std::size_t count = allocations - before;
+    if (threads == 1) {
+      EXPECT_THAT(count, Eq(0u));
+    } else {
+      // Which of the pool's threads run a loop's iterations varies from run
+      // to run, so a thread that sat out the warm-up may grow its scratch
+      // memory later -- but only once.
+      EXPECT_THAT(count, Le(ThreadPool::Global()->size())) << threads << " threads";
+    }
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,178 @@
+// Copyright 2019, Intel Corp.
+
+#include <gmock/gmock.h>
+#include <google/protobuf/text_format.h>
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tile/stripe/stripe.h"
+#include "tile/stripe/stripe.pb.h"
+#include "tile/targets/cpu/jit.h"
+
+namespace gp = google::protobuf;
+
+using ::testing::ContainerEq;
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace test {
+namespace {
+
+std::shared_ptr<stripe::Block> Parse(const std::string& text) {
+  stripe::proto::Block proto;
+  EXPECT_TRUE(gp::TextFormat::ParseFromString(text, &proto));
+  return std::shared_ptr<stripe::Block>{stripe::FromProto(proto)};
+}
+
+template <typename T>
+std::vector<T> Execute(const stripe::Block& block, bool vectorize, std::map<std::string, std::vector<T>> data,
+                   const std::string& output) {
+  Native native;
+  native.set_vectorize(vectorize);
+  native.compile(block);
+  std::map<std::string, void*> buffers;
+  for (auto& kvp : data) {
+    buffers[kvp.first] = kvp.second.data();
+  }
+  native.run(buffers);
+  return data[output];
+}
+
+// A block computing B[i] = op(A[i]) over an index range which isn't a
+// multiple of any vector width.
+std::string Unary(const std::string& type, const std::string& op, size_t n) {
+  std::string size = std::to_string(n);
+  return R"(
+    loc {}
+    idxs { name: "i" range: )" +
+         size + R"( }
+    refs [
+      { key: "A" value { loc {} dir: 1 access { terms { key: "i" value: 1 } }
+        interior_shape { type: )" +
+         type + " dims: { size: " + size + R"( stride: 1 } } } },
+      { key: "B" value { loc {} dir: 2 access { terms { key: "i" value: 1 } }
+        interior_shape { type: )" +
+         type + " dims: { size: " + size + R"( stride: 1 } } } }
+    ]
+    stmts { load { from: "A" into: "$a" } }
+    stmts { intrinsic { name: ")" +
+         op + R"(" type: )" + type + R"( inputs: "$a" outputs: "$b" } }
+    stmts { store { from: "$b" into: "B" } }
+  )";
+}
+
+TEST(JitVectorize, Tail) {
+  for (size_t n : {1, 2, 3, 17, 64, 67}) {
+    auto block = Parse(Unary("FLOAT32", "neg", n));
+    std::vector<float> a(n);
+    for (size_t i = 0; i < n; ++i) {
+      a[i] = i;
+    }
+    // The block's output is one element longer than its range, to check that
+    // the vectorized tail doesn't write past the end.
+    std::map<std::string, std::vector<float>> data{{"A", a}, {"B", std::vector<float>(n + 1, 7)}};
+    auto expected = Execute(*block, false, data, "B");
+    auto actual = Execute(*block, true, data, "B");
+    EXPECT_THAT(actual, ContainerEq(expected)) << n;
+    EXPECT_EQ(actual[n], 7) << n;
+  }
+}
+
+TEST(JitVectorize, Transcendental) {
+  const size_t n = 203;
+  std::vector<float> a(n);
+  for (size_t i = 0; i < n; ++i) {
+    a[i] = static_cast<float>(i) / 10 - 10;
+  }
+  std::map<std::string, float (*)(float)> funcs{{"exp", std::exp}, {"tanh", std::tanh}, {"sqrt", std::sqrt}};
+  for (const auto& func : funcs) {
+    auto block = Parse(Unary("FLOAT32", func.first, n));
+    auto actual = Execute(*block, true, std::map<std::string, std::vector<float>>{{"A", a}, {"B", a}}, "B");
+    for (size_t i = 0; i < n; ++i) {
+      float expected = func.second(a[i]);
+      if (std::isnan(expected)) {
+        EXPECT_TRUE(std::isnan(actual[i])) << func.first << "(" << a[i] << ")";
+      } else {
+        EXPECT_NEAR(actual[i], expected, 1e-6 * std::abs(expected) + 1e-7) << func.first << "(" << a[i] << ")";
+      }
+    }
+  }
+  auto block = Parse(Unary("FLOAT32", "log", n));
+  auto actual = Execute(*block, true, std::map<std::string, std::vector<float>>{{"A", a}, {"B", a}}, "B");
+  for (size_t i = 0; i < n; ++i) {
+    if (a[i] > 0) {
+      EXPECT_NEAR(actual[i], std::log(a[i]), 1e-6) << "log(" << a[i] << ")";
+    }
+  }
+}
+
+TEST(JitVectorize, Transpose) {
+  // B[i, j] = A[j, i]: the stores have unit stride along j, so the loads are
+  // gathered.
+  auto block = Parse(R"(
+    loc {}
+    idxs { name: "i" range: 13 }
+    idxs { name: "j" range: 11 }
+    refs [
+      { key: "A" value { loc {} dir: 1 access { terms { key: "j" value: 1 } } access { terms { key: "i" value: 1 } }
+        interior_shape { type: INT32 dims: { size: 11 stride: 13 } dims: { size: 13 stride: 1 } } } },
+      { key: "B" value { loc {} dir: 2 access { terms { key: "i" value: 1 } } access { terms { key: "j" value: 1 } }
+        interior_shape { type: INT32 dims: { size: 13 stride: 11 } dims: { size: 11 stride: 1 } } } }
+    ]
+    stmts { load { from: "A" into: "$a" } }
+    stmts { store { from: "$a" into: "B" } }
+  )");
+  std::vector<int32_t> a(13 * 11);
+  for (size_t i = 0; i < a.size(); ++i) {
+    a[i] = i;
+  }
+  std::map<std::string, std::vector<int32_t>> data{{"A", a}, {"B", std::vector<int32_t>(a.size())}};
+  EXPECT_THAT(Execute(*block, true, data, "B"), ContainerEq(Execute(*block, false, data, "B")));
+}
+
+TEST(JitVectorize, ConstrainedReduction) {
+  // C[i] = sum(A[i, k] / B[k]) for k <= i: the output doesn't depend on k, so
+  // the block is vectorized along i, with the constraint masking lanes.
+  auto block = Parse(R"(
+    loc {}
+    idxs { name: "i" range: 19 }
+    idxs { name: "k" range: 19 }
+    constraints { terms { key: "i" value: 1 } terms { key: "k" value: -1 } }
+    refs [
+      { key: "A" value { loc {} dir: 1 access { terms { key: "i" value: 1 } } access { terms { key: "k" value: 1 } }
+        interior_shape { type: INT32 dims: { size: 19 stride: 19 } dims: { size: 19 stride: 1 } } } },
+      { key: "B" value { loc {} dir: 1 access { terms { key: "k" value: 1 } }
+        interior_shape { type: INT32 dims: { size: 19 stride: 1 } } } },
+      { key: "C" value { loc {} dir: 3 agg_op: "add" access { terms { key: "i" value: 1 } }
+        interior_shape { type: INT32 dims: { size: 19 stride: 1 } } } }
+    ]
+    stmts { load { from: "A" into: "$a" } }
+    stmts { load { from: "B" into: "$b" } }
+    stmts { intrinsic { name: "div" type: INT32 inputs: "$a" inputs: "$b" outputs: "$c" } }
+    stmts { store { from: "$c" into: "C" } }
+  )");
+  std::vector<int32_t> a(19 * 19);
+  std::vector<int32_t> b(19);
+  for (size_t i = 0; i < a.size(); ++i) {
+    a[i] = 100 + i;
+  }
+  for (size_t k = 0; k < b.size(); ++k) {
+    b[k] = k + 1;
+  }
+  std::map<std::string, std::vector<int32_t>> data{{"A", a}, {"B", b}, {"C", std::vector<int32_t>(19)}};
+  auto expected = Execute(*block, false, data, "C");
+  EXPECT_THAT(Execute(*block, true, data, "C"), ContainerEq(expected));
+  EXPECT_EQ(expected[0], 100);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
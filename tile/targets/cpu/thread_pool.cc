@@ -0,0 +1,115 @@
+// Copyright 2019 Intel Corporation.
+
+#include "tile/targets/cpu/thread_pool.h"
+
+#include <algorithm>
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace {
+
+// Set while a thread is running loop iterations.
+thread_local bool in_parallel_for = false;
+
+}  // namespace
+
+constexpr std::size_t ThreadPool::kChunksPerThread;
+
+ThreadPool::ThreadPool(std::size_t threads) {
+  if (!threads) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (std::size_t idx = 1; idx < threads; ++idx) {
+    workers_.emplace_back([this, idx]() { WorkerMain(idx - 1); });
+  }
+}
+
+ThreadPool* ThreadPool::Global() {
+  static ThreadPool* pool = new ThreadPool;  // Leaked, so that it outlives programs run during static destruction
+  return pool;
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{mu_};
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::ParallelFor(std::size_t count, const ChunkFunction& fn, std::size_t max_threads) {
+  if (!count) {
+    return;
+  }
+  std::size_t threads = max_threads ? std::min(max_threads, size()) : size();
+  if (threads == 1 || count == 1 || in_parallel_for) {
+    fn(0, count);
+    return;
+  }
+
+  std::unique_lock<std::mutex> loop_lock{loop_mu_, std::try_to_lock};
+  if (!loop_lock) {
+    // The pool's threads are busy with another program's loop.
+    fn(0, count);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock{mu_};
+    fn_ = &fn;
+    count_ = count;
+    chunk_ = std::max<std::size_t>(1, count / (threads * kChunksPerThread));
+    next_ = 0;
+    active_ = workers_.size();
+    helpers_ = threads - 1;
+    ++generation_;
+  }
+  work_cv_.notify_all();
+
+  RunChunks();
+
+  std::unique_lock<std::mutex> lock{mu_};
+  done_cv_.wait(lock, [this]() { return !active_; });
+  fn_ = nullptr;
+}
+
+void ThreadPool::WorkerMain(std::size_t index) {
+  std::uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock{mu_};
+  for (;;) {
+    work_cv_.wait(lock, [&]() { return stop_ || seen != generation_; });
+    if (stop_) {
+      return;
+    }
+    seen = generation_;
+    if (index < helpers_) {
+      lock.unlock();
+      RunChunks();
+      lock.lock();
+    }
+    if (!--active_) {
+      done_cv_.notify_all();
+    }
+  }
+}
+
+void ThreadPool::RunChunks() {
+  in_parallel_for = true;
+  for (;;) {
+    std::size_t begin = next_.fetch_add(chunk_);
+    if (count_ <= begin) {
+      break;
+    }
+    (*fn_)(begin, std::min(begin + chunk_, count_));
+  }
+  in_parallel_for = false;
+}
+
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
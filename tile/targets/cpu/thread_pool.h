@@ -0,0 +1,84 @@
+// Copyright 2019 Intel Corporation.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+
+// A fixed set of worker threads for running the parallel loops of JIT-compiled
+// programs.
+//
+// ParallelFor cuts its range into chunks, which the workers and the calling
+// thread claim from a shared atomic counter until the range is exhausted.
+// Only one loop runs on a pool at a time; a ParallelFor issued from within a
+// loop body (i.e. a nested parallel loop), or while another thread's loop is
+// running, runs serially on the calling thread, so that concurrently running
+// programs never put more than the pool's threads to work.
+class ThreadPool final {
+ public:
+  // The chunk function is called with a half-open [begin, end) range of
+  // iterations.
+  using ChunkFunction = std::function<void(std::size_t begin, std::size_t end)>;
+
+  // The number of chunks per participating thread; more chunks balance uneven
+  // iterations better, at the cost of more contention on the counter.
+  static constexpr std::size_t kChunksPerThread = 4;
+
+  // Creates a pool in which loops run on `threads` threads, including the
+  // calling thread.  Zero selects the host's hardware concurrency.
+  explicit ThreadPool(std::size_t threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // The process-wide pool, sized to the host's hardware concurrency; it's
+  // created on first use.
+  static ThreadPool* Global();
+
+  // The number of threads that run each loop, including the calling thread.
+  std::size_t size() const { return workers_.size() + 1; }
+
+  // Runs fn over [0, count), returning once every iteration is complete.  At
+  // most max_threads threads (including the calling thread) run the loop;
+  // zero means all of the pool's threads.
+  void ParallelFor(std::size_t count, const ChunkFunction& fn, std::size_t max_threads = 0);
+
+ private:
+  void WorkerMain(std::size_t index);
+  void RunChunks();
+
+  std::vector<std::thread> workers_;
+
+  std::mutex loop_mu_;  // Serializes loops
+
+  std::mutex mu_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::uint64_t generation_ = 0;  // Incremented for each loop
+  std::size_t active_ = 0;        // Workers still running the current loop
+  std::size_t helpers_ = 0;       // Workers taking part in the current loop
+  bool stop_ = false;
+
+  // The current loop.
+  const ChunkFunction* fn_ = nullptr;
+  std::size_t count_ = 0;
+  std::size_t chunk_ = 0;
+  std::atomic<std::size_t> next_{0};
+};
+
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,138 @@
+// Copyright 2019, Intel Corp.
+
+#include "tile/targets/cpu/vector_math.h"
+
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/Module.h>
+
+#include <limits>
+#include <vector>
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+
+namespace {
+
+llvm::Value* FloatConst(llvm::Value* x, double value) { return llvm::ConstantFP::get(x->getType(), value); }
+
+llvm::Type* IntType(llvm::Value* x) { return llvm::VectorType::getInteger(llvm::cast<llvm::VectorType>(x->getType())); }
+
+llvm::Value* IntConst(llvm::Value* x, int64_t value) { return llvm::ConstantInt::get(IntType(x), value); }
+
+llvm::Value* CallIntrinsic(llvm::IRBuilder<>* builder, llvm::Intrinsic::ID id, llvm::Value* x) {
+  auto module = builder->GetInsertBlock()->getModule();
+  auto func = llvm::Intrinsic::getDeclaration(module, id, {x->getType()});
+  return builder->CreateCall(func, {x});
+}
+
+// Evaluates the polynomial with the specified coefficients, highest order first.
+llvm::Value* Polynomial(llvm::IRBuilder<>* builder, llvm::Value* x, const std::vector<double>& coefficients) {
+  llvm::Value* result = FloatConst(x, coefficients[0]);
+  for (size_t i = 1; i < coefficients.size(); ++i) {
+    result = builder->CreateFAdd(builder->CreateFMul(result, x), FloatConst(x, coefficients[i]));
+  }
+  return result;
+}
+
+// Computes 2^n for integer lanes n within the normal exponent range.
+llvm::Value* Pow2(llvm::IRBuilder<>* builder, llvm::Value* n, llvm::Type* type) {
+  llvm::Value* biased = builder->CreateAdd(n, llvm::ConstantInt::get(n->getType(), 127));
+  return builder->CreateBitCast(builder->CreateShl(biased, 23), type);
+}
+
+// ln(2), split into a part with few significant bits, so that multiplying it
+// by a small integer is exact, and a correction.
+const double kLn2Hi = 0.693359375;
+const double kLn2Lo = -2.12194440e-4;
+
+}  // namespace
+
+llvm::Value* VectorExp(llvm::IRBuilder<>* builder, llvm::Value* x) {
+  // exp(x) = 2^n * exp(r), with n = round(x / ln(2)) and |r| <= ln(2) / 2.
+  const double kMax = 88.72283905206835;  // ln(FLT_MAX)
+  const double kMin = -103.97207708399179;  // ln(2^-150), below which the result rounds to zero
+  llvm::Value* nan = builder->CreateFCmpUNO(x, x);
+  llvm::Value* clamped = builder->CreateSelect(nan, FloatConst(x, 0), x);
+  clamped = builder->CreateSelect(builder->CreateFCmpOGT(clamped, FloatConst(x, kMax)), FloatConst(x, kMax), clamped);
+  clamped = builder->CreateSelect(builder->CreateFCmpOLT(clamped, FloatConst(x, kMin)), FloatConst(x, kMin), clamped);
+  llvm::Value* n = builder->CreateFAdd(builder->CreateFMul(clamped, FloatConst(x, 1.44269504088896341)),  // log2(e)
+                                       FloatConst(x, 0.5));
+  n = CallIntrinsic(builder, llvm::Intrinsic::floor, n);
+  llvm::Value* r = builder->CreateFSub(clamped, builder->CreateFMul(n, FloatConst(x, kLn2Hi)));
+  r = builder->CreateFSub(r, builder->CreateFMul(n, FloatConst(x, kLn2Lo)));
+  llvm::Value* p = Polynomial(builder, r,
+                              {1.9875691500E-4, 1.3981999507E-3, 8.3334519073E-3, 4.1665795894E-2, 1.6666665459E-1,
+                               5.0000001201E-1});
+  p = builder->CreateFMul(p, builder->CreateFMul(r, r));
+  p = builder->CreateFAdd(builder->CreateFAdd(p, r), FloatConst(x, 1));
+  // Scale by 2^n in two steps, since near either end of the range 2^n itself
+  // isn't representable.
+  llvm::Value* ni = builder->CreateFPToSI(n, IntType(x));
+  llvm::Value* n1 = builder->CreateAShr(ni, 1);
+  llvm::Value* n2 = builder->CreateSub(ni, n1);
+  p = builder->CreateFMul(p, Pow2(builder, n1, x->getType()));
+  p = builder->CreateFMul(p, Pow2(builder, n2, x->getType()));
+  p = builder->CreateSelect(builder->CreateFCmpOGT(x, FloatConst(x, kMax)),
+                            FloatConst(x, std::numeric_limits<float>::infinity()), p);
+  p = builder->CreateSelect(builder->CreateFCmpOLT(x, FloatConst(x, kMin)), FloatConst(x, 0), p);
+  return builder->CreateSelect(nan, x, p);
+}
+
+llvm::Value* VectorLog(llvm::IRBuilder<>* builder, llvm::Value* x) {
+  // log(x) = e * ln(2) + log(m), with x = m * 2^e and sqrt(1/2) <= m < sqrt(2).
+  const double kMinNormal = std::numeric_limits<float>::min();
+  llvm::Value* denormal = builder->CreateFCmpOLT(x, FloatConst(x, kMinNormal));
+  llvm::Value* scaled = builder->CreateSelect(denormal, builder->CreateFMul(x, FloatConst(x, 8388608.0)), x);  // 2^23
+  llvm::Value* bits = builder->CreateBitCast(scaled, IntType(x));
+  llvm::Value* e = builder->CreateSub(builder->CreateLShr(bits, 23), IntConst(x, 126));
+  e = builder->CreateSelect(denormal, builder->CreateSub(e, IntConst(x, 23)), e);
+  // Replace the exponent to get 1/2 <= m < 1.
+  llvm::Value* m = builder->CreateOr(builder->CreateAnd(bits, IntConst(x, 0x807fffff)), IntConst(x, 0x3f000000));
+  m = builder->CreateBitCast(m, x->getType());
+  llvm::Value* small = builder->CreateFCmpOLT(m, FloatConst(x, 0.707106781186547524));
+  e = builder->CreateSelect(small, builder->CreateSub(e, IntConst(x, 1)), e);
+  m = builder->CreateSelect(small, builder->CreateFAdd(m, m), m);
+  m = builder->CreateFSub(m, FloatConst(x, 1));
+  llvm::Value* ef = builder->CreateSIToFP(e, x->getType());
+  llvm::Value* z = builder->CreateFMul(m, m);
+  llvm::Value* y = Polynomial(builder, m,
+                              {7.0376836292E-2, -1.1514610310E-1, 1.1676998740E-1, -1.2420140846E-1, 1.4249322787E-1,
+                               -1.6668057665E-1, 2.0000714765E-1, -2.4999993993E-1, 3.3333331174E-1});
+  y = builder->CreateFMul(builder->CreateFMul(y, m), z);
+  y = builder->CreateFAdd(y, builder->CreateFMul(ef, FloatConst(x, kLn2Lo)));
+  y = builder->CreateFSub(y, builder->CreateFMul(z, FloatConst(x, 0.5)));
+  llvm::Value* result = builder->CreateFAdd(builder->CreateFAdd(m, y), builder->CreateFMul(ef, FloatConst(x, kLn2Hi)));
+  // Special cases: log(0) = -inf, log(x < 0) = NaN, log(inf) = inf, log(NaN) = NaN.
+  const double kInf = std::numeric_limits<float>::infinity();
+  result = builder->CreateSelect(builder->CreateFCmpOEQ(x, FloatConst(x, 0)), FloatConst(x, -kInf), result);
+  result = builder->CreateSelect(builder->CreateFCmpOLT(x, FloatConst(x, 0)),
+                                 FloatConst(x, std::numeric_limits<float>::quiet_NaN()), result);
+  result = builder->CreateSelect(builder->CreateFCmpOEQ(x, FloatConst(x, kInf)), x, result);
+  return builder->CreateSelect(builder->CreateFCmpUNO(x, x), x, result);
+}
+
+llvm::Value* VectorTanh(llvm::IRBuilder<>* builder, llvm::Value* x) {
+  // Small arguments use an odd polynomial, which avoids the cancellation the
+  // exponential formula suffers near zero.
+  llvm::Value* z = builder->CreateFMul(x, x);
+  llvm::Value* poly = Polynomial(builder, z,
+                                 {-5.70498872745E-3, 2.06390887954E-2, -5.37397155531E-2, 1.33314422036E-1,
+                                  -3.33332819422E-1});
+  poly = builder->CreateFAdd(builder->CreateFMul(builder->CreateFMul(poly, z), x), x);
+  // Otherwise, tanh(|x|) = 1 - 2 / (exp(2|x|) + 1), which goes to 1 as exp overflows.
+  llvm::Value* ax = CallIntrinsic(builder, llvm::Intrinsic::fabs, x);
+  llvm::Value* e = VectorExp(builder, builder->CreateFAdd(ax, ax));
+  llvm::Value* large = builder->CreateFDiv(FloatConst(x, 2), builder->CreateFAdd(e, FloatConst(x, 1)));
+  large = builder->CreateFSub(FloatConst(x, 1), large);
+  auto module = builder->GetInsertBlock()->getModule();
+  auto copysign = llvm::Intrinsic::getDeclaration(module, llvm::Intrinsic::copysign, {x->getType()});
+  large = builder->CreateCall(copysign, {large, x});
+  return builder->CreateSelect(builder->CreateFCmpOLT(ax, FloatConst(x, 0.625)), poly, large);
+}
+
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,29 @@
+// Copyright 2019, Intel Corp.
+
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+
+// In-line implementations of transcendental functions over vectors of float,
+// so that vectorized blocks needn't call the scalar C library once per lane.
+// They use the Cephes polynomial approximations, and are accurate to within a
+// few ulps over the normal range; NaN inputs produce NaN results.
+
+// Computes exp(x) for each lane of x.
+llvm::Value* VectorExp(llvm::IRBuilder<>* builder, llvm::Value* x);
+
+// Computes log(x) for each lane of x.
+llvm::Value* VectorLog(llvm::IRBuilder<>* builder, llvm::Value* x);
+
+// Computes tanh(x) for each lane of x.
+llvm::Value* VectorTanh(llvm::IRBuilder<>* builder, llvm::Value* x);
+
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai